@@ -1,3 +1,8 @@
+newoption {
+    trigger = "gfx-software",
+    description = "Use the software rasterizer instead of the null gfx backend on linux"
+}
+
 -- workspace for runtime libraries/executables
 workspace("locust")
     configurations {"Debug", "Release"}
@@ -20,6 +25,10 @@ workspace("locust")
             defines {"GT_DEBUG"}
         filter "configurations:Release"
             defines {"GT_NODEBUG"}
+        filter {"options:gfx-software", "system:linux"}
+            defines {"GT_GFX_SOFTWARE"}
+        filter {"system:linux"}
+            links {"pthread"}
     filter {}
 
     -- create some helper functions
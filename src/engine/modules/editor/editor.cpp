@@ -591,6 +591,7 @@ struct Editor {
 
     entity_system::World* currentWorld = nullptr;
     renderer::RenderWorld* currentRenderWorld = nullptr;
+    fnd::filesystem::MappedFile sceneFile;
     renderer::RendererInterface* renderer = nullptr;
 
     runtime::RuntimeInterface* runtime = nullptr;
@@ -737,7 +738,7 @@ Editor::Asset* PushAsset(Editor* editor, Editor::Asset::Type type, const char* p
 }
 
 
-extern "C" __declspec(dllexport)
+extern "C" GT_DLL_EXPORT
 void* Initialize(fnd::memory::MemoryArenaBase* memoryArena, core::api_registry::APIRegistry* apiRegistry, core::api_registry::APIRegistryInterface* apiRegistryInterface)
 {
     Editor* editor = (Editor*)GT_NEW(Editor, memoryArena);
@@ -851,6 +852,9 @@ Editor::Asset* AssetRefLabel(Editor* editor, Editor::Asset* asset, bool acceptDr
     return res;
 }
 
+// @NOTE worlds are stored at this alignment within scene files so their columns can be used in place when mapped
+static const size_t SCENE_WORLD_ALIGNMENT = 64;
+
 struct SceneFileHeader
 {
     static const uint32_t MAX_NAME_STRING_LEN = 512;
@@ -2099,7 +2103,7 @@ static void ShowExampleAppCustomNodeGraph(ObjectDatabase* objDatabase, TypeHandl
 }
 
 
-extern "C" __declspec(dllexport)
+extern "C" GT_DLL_EXPORT
 void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCtx, entity_system::World* world, renderer::RenderWorld* renderWorld, fnd::memory::LinearAllocator* frameAllocator, entity_system::Entity** entitySelection, size_t* numEntitiesSelected)
 {
 
@@ -2115,6 +2119,12 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
 
     auto fbxImporter = (fbx_importer::FBXImportInterface*) editor->apiRegistryInterface->Get(editor->apiRegistry, FBX_IMPORTER_API_NAME);
 
+    // @NOTE the editor keeps undo history for whichever world it is editing
+    if (editor->currentWorld != world) {
+        entity_system::JournalConfig journalConfig;
+        entitySystem->EnableJournal(world, &journalConfig);
+    }
+
     editor->currentWorld = world;
     editor->currentRenderWorld = renderWorld;
     editor->renderer = renderer;
@@ -2135,6 +2145,16 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
 
     ImGuizmo::BeginFrame();
 
+    // text fields have their own undo
+    if (ImGui::GetIO().KeyCtrl && !ImGui::GetIO().WantTextInput) {
+        bool undo = ImGui::IsKeyPressed('Z');
+        bool redo = ImGui::IsKeyPressed('Y');
+        if ((undo && entitySystem->UndoJournalStep(world)) || (redo && entitySystem->RedoJournalStep(world))) {
+            // undo and redo may destroy selected entities
+            ClearList(&editor->entitySelection);
+        }
+    }
+
     ImGui::ShowTestWindow();
 
     int WINDOW_WIDTH = 1920;
@@ -2536,17 +2556,17 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
     };
 
     static auto LoadScene = [](Editor* editor, const char* path, fnd::memory::LinearAllocator* allocator, renderer::RendererInterface* renderer, renderer::RenderWorld* renderWorld) -> bool {
-        fnd::memory::SimpleMemoryArena<fnd::memory::LinearAllocator> arena(allocator);
-
         auto entitySystem = (entity_system::EntitySystemInterface*) editor->apiRegistryInterface->Get(editor->apiRegistry, ENTITY_SYSTEM_API_NAME);
         assert(entitySystem);
 
-
-        size_t fileSize = 0;
-        auto fileContents = LoadFileContents(path, &arena, &fileSize);
-        if (!fileContents) {
+        // @NOTE the scene stays mapped while it is open, the world uses its transform column in place
+        fnd::filesystem::MappedFile sceneFile;
+        if (!fnd::filesystem::MapFile(path, &sceneFile)) {
             GT_LOG_ERROR("Editor", "Failed to load %s", path);
+            return false;
         }
+        size_t fileSize = sceneFile.size;
+        void* fileContents = sceneFile.data;
 
         union {
             void* as_void;
@@ -2582,10 +2602,29 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
             as_asset++;
         }
 
+        // skip the zero padding SaveScene puts in front of the world, older scenes have none
+        size_t worldOffset = as_char - (char*)fileContents;
+        size_t alignedWorldOffset = (worldOffset + SCENE_WORLD_ALIGNMENT - 1) & ~(SCENE_WORLD_ALIGNMENT - 1);
+        bool isPadded = alignedWorldOffset <= fileSize;
+        for (size_t i = worldOffset; i < alignedWorldOffset && isPadded; ++i) {
+            isPadded = ((char*)fileContents)[i] == 0;
+        }
+        if (isPadded) {
+            as_char = (char*)fileContents + alignedWorldOffset;
+        }
+
         size_t worldSize = 0;
-        entitySystem->DeserializeWorld(editor->currentWorld, as_void, fileSize, &worldSize);    // @TODO use proper size
+        size_t worldBufferSize = fileSize - (as_char - (char*)fileContents);
+        if (!entitySystem->DeserializeWorldInPlace(editor->currentWorld, as_void, worldBufferSize, &worldSize)) {
+            GT_LOG_ERROR("Editor", "Failed to load world from %s", path);
+            fnd::filesystem::UnmapFile(&sceneFile);
+            return false;
+        }
         as_char += worldSize;
-        renderer->DeserializeRenderWorld(editor->currentRenderWorld, as_void, fileSize - worldSize, nullptr);   // @TODO use proper size
+        renderer->DeserializeRenderWorld(editor->currentRenderWorld, as_void, worldBufferSize - worldSize, nullptr);
+
+        fnd::filesystem::UnmapFile(&editor->sceneFile);
+        editor->sceneFile = sceneFile;
 
         return true;
     };
@@ -2611,8 +2650,11 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
         size_t renderWorldSize = 0;
         editor->renderer->SerializeRenderWorld(editor->currentRenderWorld, nullptr, 0, &renderWorldSize);
 
-        size_t totalSize = sizeof(SceneFileHeader) + sizeof(Editor::Asset) * header.numAssets + worldSize + renderWorldSize;
+        size_t worldOffset = sizeof(SceneFileHeader) + sizeof(Editor::Asset) * header.numAssets;
+        worldOffset = (worldOffset + SCENE_WORLD_ALIGNMENT - 1) & ~(SCENE_WORLD_ALIGNMENT - 1);
+        size_t totalSize = worldOffset + worldSize + renderWorldSize;
         char* buf = as_char = (char*)allocator->Allocate(totalSize, 4);
+        memset(buf, 0x0, worldOffset);
 
         *as_header = header;
         as_header++;
@@ -2629,10 +2671,14 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
             as_asset++;
         }
 
+        as_char = buf + worldOffset;
         entitySystem->SerializeWorld(editor->currentWorld, as_char, worldSize, nullptr);
         as_char += worldSize;
         editor->renderer->SerializeRenderWorld(editor->currentRenderWorld, as_char, renderWorldSize, nullptr);
 
+        // the open scene may be the file we're about to overwrite
+        entitySystem->DetachWorld(editor->currentWorld);
+        fnd::filesystem::UnmapFile(&editor->sceneFile);
 
         return DumpToFile(path, buf, totalSize);
     };
@@ -3108,7 +3154,7 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
             for (size_t i = 0; i < numEntities; ++i) {
                 entity_system::Entity entity = entityList[i];
                 const char* name = entitySystem->GetEntityName(world, entity);
-                ImGui::PushID(entity.id);
+                ImGui::PushID((void*)(uintptr_t)entity.id);
 
                 auto GetIndex = [](entity_system::Entity entity, entity_system::Entity* entities, size_t numEntities) -> int {
                     int index = -1;
@@ -3201,7 +3247,7 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
                     //camPos = util::Get4x4FloatMatrixColumnCM(entity_system::GetEntityTransform(world, state->selectedEntity), 3).xyz;
                 }
                 ImGui::SameLine();
-                ImGui::Text("(id = %i)", entity.id);
+                ImGui::Text("(id = %llu)", (unsigned long long)entity.id);
                 ImGui::PopID();
             }
             if (ImGui::IsWindowHovered() && !ImGui::IsAnyItemHovered() && ImGui::IsMouseClicked(0)) {
@@ -3607,7 +3653,7 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
                 ImVec2 contentRegion = ImGui::GetContentRegionAvail();
 
                 ImGui::BeginChild("##tabs", ImVec2(contentRegion.x, 50), false, flags);
-                ImGui::PushID(it->ent.id);
+                ImGui::PushID((void*)(uintptr_t)it->ent.id);
                 ImGui::PushStyleVar(ImGuiStyleVar_Alpha, selectedEntity.id != it->ent.id ? ImGui::GetStyle().Alpha * 0.4f : ImGui::GetStyle().Alpha);
                 if (ImGui::Button(entitySystem->GetEntityName(world, it->ent))) {
                     selectedEntity = it->ent;
@@ -3647,9 +3693,23 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
             ImGui::BeginChild("##properties", contentRegion);
             if (selectedEntity.id != entity_system::INVALID_ID) {
                 if (ImGui::TreeNode(ICON_FA_PENCIL "    Object")) {
-                    if (ImGui::InputText(" " ICON_FA_TAG " Name", entitySystem->GetEntityName(world, selectedEntity), ENTITY_NAME_SIZE, ImGuiInputTextFlags_EnterReturnsTrue)) {
-                        //entitySystem->SetEntityName(world, selectedEntity, entitySystem->GetEntityName(world, selectedEntity));
+                    // @NOTE names are interned, so edit a copy and only commit it on enter
+                    // the copy is refreshed when the selection changes or the journal moves (undo, redo, other edits)
+                    static char nameBuf[ENTITY_NAME_SIZE] = "";
+                    static entity_system::Entity nameBufEntity;
+                    static uint64_t nameBufJournalPosition = 0;
+                    static bool isEditingName = false;
+                    uint64_t journalPosition = entitySystem->GetJournalPosition(world);
+                    if (nameBufEntity.id != selectedEntity.id || (nameBufJournalPosition != journalPosition && !isEditingName)) {
+                        snprintf(nameBuf, ENTITY_NAME_SIZE, "%s", entitySystem->GetEntityName(world, selectedEntity));
+                        nameBufEntity = selectedEntity;
+                        nameBufJournalPosition = journalPosition;
+                    }
+                    if (ImGui::InputText(" " ICON_FA_TAG " Name", nameBuf, ENTITY_NAME_SIZE, ImGuiInputTextFlags_EnterReturnsTrue)) {
+                        entitySystem->SetEntityName(world, selectedEntity, nameBuf);
+                        nameBufJournalPosition = entitySystem->GetJournalPosition(world);
                     }
+                    isEditingName = ImGui::IsItemActive();
                     ImGui::TreePop();
                 }
                 if (ImGui::TreeNode(ICON_FA_LOCATION_ARROW "    Transform")) {
@@ -3818,14 +3878,17 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
 
             it = editor->entitySelection.head;
             while (it) {
-                math::float3 pos = util::Get4x4FloatMatrixColumnCM(entitySystem->GetEntityTransform(world, it->ent), 3).xyz;
+                float transform[16];
+                util::Copy4x4FloatMatrixCM(entitySystem->GetEntityTransform(world, it->ent), transform);
+                math::float3 pos = util::Get4x4FloatMatrixColumnCM(transform, 3).xyz;
 
                 if (it->ent.id == selectedEntity.id) {
-                    util::Copy4x4FloatMatrixCM(groupTransform, entitySystem->GetEntityTransform(world, selectedEntity));
+                    util::Copy4x4FloatMatrixCM(groupTransform, transform);
                 }
 
                 math::float3 newPos = pos + posDifference;
-                util::Set4x4FloatMatrixColumnCM(entitySystem->GetEntityTransform(world, it->ent), 3, math::float4(newPos, 1.0f));
+                util::Set4x4FloatMatrixColumnCM(transform, 3, math::float4(newPos, 1.0f));
+                entitySystem->SetEntityTransform(world, it->ent, transform);
 
                 it = it->next;
             }
@@ -3833,6 +3896,11 @@ void Update(void* userData, ImGuiContext* imguiContext, runtime::UIContext* uiCt
         } ImGui::End();
     }
 
+    // everything changed while the mouse button is held, e.g. a gizmo drag, is undone in one go
+    if (!ImGui::IsMouseDown(0)) {
+        entitySystem->CommitJournalStep(world);
+    }
+
     *numEntitiesSelected = 0;
     auto it = editor->entitySelection.head;
     while (it != nullptr) {
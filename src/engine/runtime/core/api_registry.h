@@ -1,5 +1,7 @@
 #pragma once
 
+#include <foundation/int_types.h>
+
 namespace fnd
 {
     namespace memory
@@ -31,7 +33,7 @@ namespace core
     }
 }
 
-extern "C" __declspec(dllexport)
+extern "C" GT_DLL_EXPORT
 void api_registry_get_interface(core::api_registry::APIRegistryInterface* outInterface);
 
 #define SIM_UPDATE_API_NAME "sim_update"
@@ -1,15 +1,17 @@
 #include "entities.h"
 #include <foundation/memory/memory.h>
+#include <foundation/logging/logging.h>
 #include <foundation/math/math.h>
 #include <cassert>
 #include <string.h>
 
-#define HANDLE_INDEX(handle)        (uint16_t)(handle)
-#define HANDLE_GENERATION(handle)   (uint16_t)(handle >> 16)
+// @NOTE entity handles are 64 bit: lower 32 bits index into the pool, upper 32 bits hold the generation
+#define HANDLE_INDEX(handle)        (uint32_t)(handle)
+#define HANDLE_GENERATION(handle)   (uint32_t)(handle >> 32)
 
 #define HANDLE_GENERATION_START 1
 
-#define MAKE_HANDLE(index, generation) (uint32_t)(((uint32_t)generation) << 16 | index); 
+#define MAKE_HANDLE(index, generation) (uint64_t)(((uint64_t)generation) << 32 | index); 
 
 
 namespace entity_system
@@ -20,40 +22,55 @@ namespace entity_system
         uint32_t    size = 0;
         uint32_t    numElements = 0;
         TResource*  buffer = nullptr;
-        uint16_t*   indexList = nullptr;
+        uint32_t*   indexList = nullptr;
+        uint32_t*   ringPositions = nullptr;    // where a free index sits in indexList, stale for indices in use
         uint32_t    indexListHead = 0;
         uint32_t    indexListTail = 0;
+        uint32_t    numFreeIndices = 0;
 
         void Initialize(uint32_t bufferSize, fnd::memory::MemoryArenaBase* memoryArena)
         {
             numElements = 0;
             size = bufferSize;
             buffer = GT_NEW_ARRAY(TResource, size, memoryArena);
-            indexList = GT_NEW_ARRAY(uint16_t, size, memoryArena);
-            indexListHead = indexListTail = 0;
+            indexList = GT_NEW_ARRAY(uint32_t, size, memoryArena);
+            ringPositions = GT_NEW_ARRAY(uint32_t, size, memoryArena);
             for (uint32_t i = 0; i < size; ++i) {
                 indexList[i] = i;
+                ringPositions[i] = i;
             }
-            indexListTail = size - 1;
+            indexListHead = indexListTail = 0;
+            numFreeIndices = size;
         }
 
-        bool GetNextIndex(uint16_t* outIndex)
+        bool GetNextIndex(uint32_t* outIndex)
         {
-            if (indexListHead == indexListTail) { return false; }
+            if (numFreeIndices == 0) { return false; }
             *outIndex = indexList[indexListHead];
             indexListHead = (indexListHead + 1) % size;
+            numFreeIndices--;
             return true;
         }
 
-        void ReleaseIndex(uint16_t index)
+        // @NOTE free indices are the numFreeIndices slots from indexListHead on, indexListTail is the next slot written to.
+        // The count is kept separately because head and tail are equal both when the ring is empty and when it is full.
+        void ReleaseIndex(uint32_t index)
         {
-            indexListTail = (indexListTail + 1) % size;
+            assert(numFreeIndices < size);
             indexList[indexListTail] = index;
+            ringPositions[index] = indexListTail;
+            indexListTail = (indexListTail + 1) % size;
+            numFreeIndices++;
+        }
+
+        uint32_t GetNumFreeIndices()
+        {
+            return numFreeIndices;
         }
 
-        bool Allocate(TResource** resource, uint32_t* id)
+        bool Allocate(TResource** resource, uint64_t* id)
         {
-            uint16_t index = 0;
+            uint32_t index = 0;
             if (!GetNextIndex(&index)) {
                 return false;
             }
@@ -65,9 +82,9 @@ namespace entity_system
             return true;
         }
 
-        void Free(uint32_t id)
+        void Free(uint64_t id)
         {
-            uint16_t index = HANDLE_INDEX(id);
+            uint32_t index = HANDLE_INDEX(id);
             TResource* res = &buffer[index];
             assert(res->generation == HANDLE_GENERATION(id));
             //D3D11ReleaseResource(res);
@@ -78,9 +95,62 @@ namespace entity_system
             ReleaseIndex(index);
         }
 
-        TResource* Get(uint32_t id)
+        // allocates either all count resources or none, reserving the whole index range up front
+        bool AllocateRange(uint32_t count, uint64_t* outIds)
         {
-            uint16_t index = HANDLE_INDEX(id);
+            if (count > GetNumFreeIndices()) { return false; }
+            for (uint32_t i = 0; i < count; ++i) {
+                uint32_t index = indexList[(indexListHead + i) % size];
+                outIds[i] = MAKE_HANDLE(index, buffer[index].generation);
+            }
+            indexListHead = (indexListHead + count) % size;
+            numFreeIndices -= count;
+            numElements += count;
+            return true;
+        }
+
+        // frees every valid handle in ids and returns the number freed, stale handles are skipped
+        uint32_t FreeRange(uint32_t count, uint64_t* ids)
+        {
+            uint32_t numFreed = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                TResource* res = Get(ids[i]);
+                if (res == nullptr) { continue; }
+                res->generation++;
+                uint32_t position = (indexListTail + numFreed) % size;
+                indexList[position] = HANDLE_INDEX(ids[i]);
+                ringPositions[HANDLE_INDEX(ids[i])] = position;
+                numFreed++;
+            }
+            indexListTail = (indexListTail + numFreed) % size;
+            numFreeIndices += numFreed;
+            numElements -= numFreed;
+            return numFreed;
+        }
+
+        // takes a specific index off the free list, to bring a freed resource back under its old handle,
+        // by swapping it with the head of the ring
+        bool ClaimIndex(uint32_t index)
+        {
+            if (index >= size) { return false; }
+            uint32_t position = ringPositions[index];
+            if ((position + size - indexListHead) % size >= numFreeIndices || indexList[position] != index) {
+                return false;
+            }
+            uint32_t headIndex = indexList[indexListHead];
+            indexList[position] = headIndex;
+            ringPositions[headIndex] = position;
+            indexList[indexListHead] = index;
+            indexListHead = (indexListHead + 1) % size;
+            numFreeIndices--;
+            numElements++;
+            return true;
+        }
+
+        TResource* Get(uint64_t id)
+        {
+            uint32_t index = HANDLE_INDEX(id);
+            if (index >= size) { return nullptr; }
             TResource* res = &buffer[index];
             if (res->generation != HANDLE_GENERATION(id)) { return nullptr; }
             //assert(res->generation == HANDLE_GENERATION(id));
@@ -89,170 +159,1037 @@ namespace entity_system
     };
 
 
+    static const uint32_t INVALID_SLOT = 0xffffffff;
+    static const uint32_t DEFAULT_NAME_ID = 0;
+
     struct EntityData
     {
-        uint16_t generation = HANDLE_GENERATION_START;
-        char name[ENTITY_NAME_SIZE] = "Entity";
-        float transform[16];
+        uint32_t generation = HANDLE_GENERATION_START;
+        uint32_t nameId = DEFAULT_NAME_ID;
+
+        // slots of the previous and next live entity sharing this name
+        uint32_t prevWithName = INVALID_SLOT;
+        uint32_t nextWithName = INVALID_SLOT;
 
         bool isAlive = false;
+    };
 
-        EntityData()
-        {
-            util::Make4x4FloatMatrixIdentity(transform);
-        }
+    // @NOTE every distinct entity name is stored once and referred to by its id. the table is append only,
+    // names are found through an open addressing hash table and each name keeps a list of the entities using it
+    struct NameTable
+    {
+        char*       chars = nullptr;        // zero terminated names, back to back
+        uint32_t    charsSize = 0;
+        uint32_t    charsCapacity = 0;
+
+        uint32_t*   offsets = nullptr;      // per name id, into chars
+        uint32_t*   firstEntity = nullptr;  // per name id, slot of the first live entity with that name
+        uint32_t    numNames = 0;
+        uint32_t    namesCapacity = 0;
+
+        uint32_t*   buckets = nullptr;      // name id + 1, 0 marks an empty bucket
+        uint32_t    numBuckets = 0;         // power of two
     };
 
+    struct Journal;
+
     struct World
     {
         fnd::memory::MemoryArenaBase* memoryArena = nullptr;
         ResourcePool<EntityData> entities;
-        
+        NameTable names;
+        Journal* journal = nullptr;     // only while the change journal is enabled
+
+        // @NOTE transforms live in their own column, indexed like the entity pool, so they can be used
+        // straight out of a loaded world file. while mapped, only the first numMappedTransforms slots
+        // are backed by the file and the column is not owned by the world
+        float* transforms = nullptr;
+        uint32_t numMappedTransforms = 0;
+        bool transformsMapped = false;
     };
 
+    static uint32_t HashName(const char* name, size_t len)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < len; ++i) {
+            hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    template <class T>
+    static T* GrowArray(T* array, uint32_t oldCount, uint32_t newCount, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        T* result = GT_NEW_ARRAY(T, newCount, memoryArena);
+        if (array != nullptr) {
+            memcpy(result, array, sizeof(T) * oldCount);
+            GT_DELETE_ARRAY(array, memoryArena);
+        }
+        return result;
+    }
+
+    static void FreeNameTable(NameTable* table, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        if (table->chars != nullptr) {
+            GT_DELETE_ARRAY(table->chars, memoryArena);
+            GT_DELETE_ARRAY(table->offsets, memoryArena);
+            GT_DELETE_ARRAY(table->firstEntity, memoryArena);
+            GT_DELETE_ARRAY(table->buckets, memoryArena);
+        }
+        *table = NameTable();
+    }
+
+    static void InsertNameBucket(NameTable* table, uint32_t nameId)
+    {
+        const char* name = table->chars + table->offsets[nameId];
+        uint32_t mask = table->numBuckets - 1;
+        uint32_t bucket = HashName(name, strlen(name)) & mask;
+        while (table->buckets[bucket] != 0) {
+            bucket = (bucket + 1) & mask;
+        }
+        table->buckets[bucket] = nameId + 1;
+    }
+
+    // looks up a name of len chars (not necessarily zero terminated), returns INVALID_SLOT if it was never interned
+    static uint32_t FindName(NameTable* table, const char* name, size_t len)
+    {
+        uint32_t mask = table->numBuckets - 1;
+        uint32_t bucket = HashName(name, len) & mask;
+        while (table->buckets[bucket] != 0) {
+            uint32_t nameId = table->buckets[bucket] - 1;
+            const char* candidate = table->chars + table->offsets[nameId];
+            if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0') {
+                return nameId;
+            }
+            bucket = (bucket + 1) & mask;
+        }
+        return INVALID_SLOT;
+    }
+
+    static uint32_t InternName(NameTable* table, const char* name, size_t len, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        const void* terminator = memchr(name, 0x0, len);
+        len = terminator != nullptr ? (const char*)terminator - name : len;
+        len = len > ENTITY_NAME_SIZE - 1 ? ENTITY_NAME_SIZE - 1 : len;
+
+        uint32_t nameId = FindName(table, name, len);
+        if (nameId != INVALID_SLOT) { return nameId; }
+
+        if (table->charsSize + len + 1 > table->charsCapacity) {
+            uint32_t newCapacity = table->charsCapacity * 2 + (uint32_t)len + 1;
+            table->chars = GrowArray(table->chars, table->charsSize, newCapacity, memoryArena);
+            table->charsCapacity = newCapacity;
+        }
+        if (table->numNames == table->namesCapacity) {
+            uint32_t newCapacity = table->namesCapacity * 2;
+            table->offsets = GrowArray(table->offsets, table->numNames, newCapacity, memoryArena);
+            table->firstEntity = GrowArray(table->firstEntity, table->numNames, newCapacity, memoryArena);
+            table->namesCapacity = newCapacity;
+        }
+
+        nameId = table->numNames++;
+        table->offsets[nameId] = table->charsSize;
+        table->firstEntity[nameId] = INVALID_SLOT;
+        memcpy(table->chars + table->charsSize, name, len);
+        table->chars[table->charsSize + len] = '\0';
+        table->charsSize += (uint32_t)len + 1;
+
+        // keep the load factor at or below one half
+        if (table->numNames * 2 > table->numBuckets) {
+            GT_DELETE_ARRAY(table->buckets, memoryArena);
+            table->numBuckets *= 2;
+            table->buckets = GT_NEW_ARRAY(uint32_t, table->numBuckets, memoryArena);
+            memset(table->buckets, 0x0, sizeof(uint32_t) * table->numBuckets);
+            for (uint32_t i = 0; i < table->numNames; ++i) {
+                InsertNameBucket(table, i);
+            }
+        }
+        else {
+            InsertNameBucket(table, nameId);
+        }
+        return nameId;
+    }
+
+    static void InitializeNameTable(NameTable* table, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        static const uint32_t INITIAL_NUM_NAMES = 64;
+        table->charsCapacity = INITIAL_NUM_NAMES * 16;
+        table->chars = GT_NEW_ARRAY(char, table->charsCapacity, memoryArena);
+        table->namesCapacity = INITIAL_NUM_NAMES;
+        table->offsets = GT_NEW_ARRAY(uint32_t, table->namesCapacity, memoryArena);
+        table->firstEntity = GT_NEW_ARRAY(uint32_t, table->namesCapacity, memoryArena);
+        table->numBuckets = INITIAL_NUM_NAMES * 2;
+        table->buckets = GT_NEW_ARRAY(uint32_t, table->numBuckets, memoryArena);
+        memset(table->buckets, 0x0, sizeof(uint32_t) * table->numBuckets);
+
+        uint32_t defaultNameId = InternName(table, "Entity", strlen("Entity"), memoryArena);
+        assert(defaultNameId == DEFAULT_NAME_ID);
+    }
+
+    static void LinkEntityName(World* world, uint32_t index)
+    {
+        EntityData* data = &world->entities.buffer[index];
+        uint32_t* first = &world->names.firstEntity[data->nameId];
+        data->prevWithName = INVALID_SLOT;
+        data->nextWithName = *first;
+        if (*first != INVALID_SLOT) {
+            world->entities.buffer[*first].prevWithName = index;
+        }
+        *first = index;
+    }
+
+    static void UnlinkEntityName(World* world, uint32_t index)
+    {
+        EntityData* data = &world->entities.buffer[index];
+        if (data->prevWithName != INVALID_SLOT) {
+            world->entities.buffer[data->prevWithName].nextWithName = data->nextWithName;
+        }
+        else {
+            world->names.firstEntity[data->nameId] = data->nextWithName;
+        }
+        if (data->nextWithName != INVALID_SLOT) {
+            world->entities.buffer[data->nextWithName].prevWithName = data->prevWithName;
+        }
+        data->prevWithName = data->nextWithName = INVALID_SLOT;
+    }
+
+    // rebuilds all per name entity lists, after the pool or the name table was replaced
+    static void RelinkEntityNames(World* world)
+    {
+        for (uint32_t i = 0; i < world->names.numNames; ++i) {
+            world->names.firstEntity[i] = INVALID_SLOT;
+        }
+        for (uint32_t i = world->entities.size; i > 0; --i) {
+            if (world->entities.buffer[i - 1].isAlive) {
+                LinkEntityName(world, i - 1);
+            }
+        }
+    }
+
+    static void FreeTransforms(World* world)
+    {
+        if (world->transforms != nullptr && !world->transformsMapped) {
+            GT_DELETE_ARRAY(world->transforms, world->memoryArena);
+        }
+        world->transforms = nullptr;
+        world->numMappedTransforms = 0;
+        world->transformsMapped = false;
+    }
+
+    static void AllocateTransforms(World* world, uint32_t capacity)
+    {
+        FreeTransforms(world);
+        world->transforms = GT_NEW_ARRAY(float, capacity * 16, world->memoryArena);
+        for (uint32_t i = 0; i < capacity; ++i) {
+            util::Make4x4FloatMatrixIdentity(world->transforms + i * 16);
+        }
+    }
+
     bool CreateWorld(World** outWorld, fnd::memory::MemoryArenaBase* memoryArena, WorldConfig* config)
     {
         World* world = GT_NEW(World, memoryArena);
         world->memoryArena = memoryArena;
         world->entities.Initialize(config->maxNumEntities, memoryArena);
+        InitializeNameTable(&world->names, memoryArena);
+        AllocateTransforms(world, config->maxNumEntities);
         *outWorld = world;
         return true;
     }
 
     void DestroyWorld(World* world)
     {
-
+        DisableJournal(world);
+        FreeTransforms(world);
+        FreeNameTable(&world->names, world->memoryArena);
+        if (world->entities.buffer != nullptr) {
+            GT_DELETE_ARRAY(world->entities.buffer, world->memoryArena);
+            GT_DELETE_ARRAY(world->entities.indexList, world->memoryArena);
+            GT_DELETE_ARRAY(world->entities.ringPositions, world->memoryArena);
+        }
         GT_DELETE(world, world->memoryArena);
     }
 
+    void DetachWorld(World* world)
+    {
+        if (!world->transformsMapped) { return; }
+        float* mapped = world->transforms;
+        uint32_t numMapped = world->numMappedTransforms;
+        world->transforms = nullptr;
+        world->transformsMapped = false;
+        AllocateTransforms(world, world->entities.size);
+        memcpy(world->transforms, mapped, sizeof(float) * 16 * numMapped);
+    }
+
+    /**
+        Change journal. Records are appended to a byte ring buffer and addressed by virtual positions that only
+        ever grow, the physical offset is the position modulo the buffer size. A record never wraps around the end
+        of the buffer, the space left there is filled with a padding record instead. Every record holds the values
+        before and after the change, so it can be applied in both directions.
+
+        Memory layout of a record:
+        {
+            JournalRecord
+            JOURNAL_CREATE, JOURNAL_DESTROY:    float[16] transform, char[] name
+            JOURNAL_TRANSFORM:                  float[16] from, float[16] to
+            JOURNAL_NAME:                       char[] from, char[] to
+            padding up to JOURNAL_RECORD_ALIGNMENT
+        }
+    */
+    enum JournalRecordType : uint16_t
+    {
+        JOURNAL_PADDING = 0,
+        JOURNAL_CREATE,
+        JOURNAL_DESTROY,
+        JOURNAL_TRANSFORM,
+        JOURNAL_NAME,
+        NUM_JOURNAL_RECORD_TYPES
+    };
+
+    struct JournalRecord
+    {
+        uint16_t type;
+        uint16_t size;          // including this header and the padding
+        uint16_t prevSize;      // size of the preceding record in the ring, to walk steps backwards
+        uint16_t reserved;
+        uint64_t entity;
+    };
+
+    static const uint32_t JOURNAL_RECORD_ALIGNMENT = 16;
+    static const uint32_t MAX_JOURNAL_RECORD_SIZE = 512;    // fits a header and two transforms or two names
+    static const uint32_t MIN_JOURNAL_BUFFER_SIZE = 16 * MAX_JOURNAL_RECORD_SIZE;
+
+    static_assert(sizeof(JournalRecord) == JOURNAL_RECORD_ALIGNMENT, "records are padded to the header size");
+    static_assert(sizeof(JournalRecord) + 2 * ENTITY_NAME_SIZE <= MAX_JOURNAL_RECORD_SIZE, "name records don't fit");
+
+    // range of positions of the records making up one undo step
+    struct JournalStep
+    {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+    };
+
+    struct Journal
+    {
+        char*           buffer = nullptr;
+        uint32_t        capacity = 0;
+        uint64_t        head = 0;               // position the next record is written to
+        uint64_t        tail = 0;               // position of the oldest record still in the buffer
+        uint32_t        lastRecordSize = 0;
+
+        uint64_t        openStepBegin = 0;      // records from here on belong to the step not committed yet
+        uint64_t        sealedPosition = 0;     // records before this may have been serialized and are left alone
+
+        JournalStep*    undoSteps = nullptr;    // ring of maxSteps entries, oldest steps are dropped first
+        uint32_t        firstUndoStep = 0;
+        uint32_t        numUndoSteps = 0;
+        JournalStep*    redoSteps = nullptr;
+        uint32_t        numRedoSteps = 0;
+        uint32_t        maxSteps = 0;
+
+        bool            replaying = false;      // set while undoing or redoing, keeps the redo history alive
+    };
+
+    static JournalRecord* GetJournalRecord(Journal* journal, uint64_t position)
+    {
+        return (JournalRecord*)(journal->buffer + position % journal->capacity);
+    }
+
+    // drops all records. positions keep growing with a gap, so no delta can span the reset
+    static void ResetJournal(Journal* journal)
+    {
+        journal->head += JOURNAL_RECORD_ALIGNMENT;
+        journal->tail = journal->head;
+        journal->lastRecordSize = 0;
+        journal->openStepBegin = journal->sealedPosition = journal->head;
+        journal->firstUndoStep = journal->numUndoSteps = journal->numRedoSteps = 0;
+        journal->replaying = false;
+    }
+
+    bool EnableJournal(World* world, JournalConfig* config)
+    {
+        if (world->journal != nullptr) { return true; }
+        if (config->bufferSize < MIN_JOURNAL_BUFFER_SIZE || config->maxUndoSteps == 0) {
+            GT_LOG_ERROR("Entity System", "Journal needs at least %u bytes and one undo step", MIN_JOURNAL_BUFFER_SIZE);
+            return false;
+        }
+        Journal* journal = GT_NEW(Journal, world->memoryArena);
+        journal->capacity = config->bufferSize - config->bufferSize % JOURNAL_RECORD_ALIGNMENT;
+        // @NOTE records are read in place, so the ring is aligned like them
+        journal->buffer = (char*)world->memoryArena->Allocate(journal->capacity, JOURNAL_RECORD_ALIGNMENT, GT_SOURCE_INFO);
+        journal->maxSteps = config->maxUndoSteps;
+        journal->undoSteps = GT_NEW_ARRAY(JournalStep, journal->maxSteps, world->memoryArena);
+        journal->redoSteps = GT_NEW_ARRAY(JournalStep, journal->maxSteps, world->memoryArena);
+        ResetJournal(journal);
+        world->journal = journal;
+        return true;
+    }
+
+    void DisableJournal(World* world)
+    {
+        Journal* journal = world->journal;
+        if (journal == nullptr) { return; }
+        world->memoryArena->Free(journal->buffer);
+        GT_DELETE_ARRAY(journal->undoSteps, world->memoryArena);
+        GT_DELETE_ARRAY(journal->redoSteps, world->memoryArena);
+        GT_DELETE(journal, world->memoryArena);
+        world->journal = nullptr;
+    }
+
+    static void EvictJournalRecords(Journal* journal, uint32_t size)
+    {
+        while (journal->head + size - journal->tail > journal->capacity) {
+            journal->tail += GetJournalRecord(journal, journal->tail)->size;
+        }
+    }
+
+    static JournalRecord* WriteJournalRecord(Journal* journal, uint16_t type, uint32_t size, uint64_t entity)
+    {
+        EvictJournalRecords(journal, size);
+        JournalRecord* record = GetJournalRecord(journal, journal->head);
+        record->type = type;
+        record->size = (uint16_t)size;
+        record->prevSize = (uint16_t)journal->lastRecordSize;
+        record->reserved = 0;
+        record->entity = entity;
+        journal->head += size;
+        journal->lastRecordSize = size;
+        return record;
+    }
+
+    // appends a record for a change made to the world, the caller fills in payloadSize bytes after the header
+    static JournalRecord* AppendJournalRecord(Journal* journal, uint16_t type, uint32_t payloadSize, uint64_t entity)
+    {
+        uint32_t size = (uint32_t)(sizeof(JournalRecord) + payloadSize + JOURNAL_RECORD_ALIGNMENT - 1) & ~(JOURNAL_RECORD_ALIGNMENT - 1);
+        assert(size <= MAX_JOURNAL_RECORD_SIZE);
+        uint32_t offset = (uint32_t)(journal->head % journal->capacity);
+        if (offset + size > journal->capacity) {
+            WriteJournalRecord(journal, JOURNAL_PADDING, journal->capacity - offset, 0);
+        }
+        // a fresh change makes everything that was undone before unreachable
+        if (!journal->replaying) {
+            journal->numRedoSteps = 0;
+        }
+        JournalRecord* record = WriteJournalRecord(journal, type, size, entity);
+        // @NOTE cleared so the padding is the same in every serialized delta, replays compare them bytewise
+        memset(record + 1, 0x0, size - sizeof(JournalRecord));
+        return record;
+    }
+
+    // records the full state of an entity that was just created or is about to be destroyed
+    static void RecordEntityLifetime(World* world, JournalRecordType type, uint64_t entity)
+    {
+        if (world->journal == nullptr) { return; }
+        uint32_t index = HANDLE_INDEX(entity);
+        const char* name = world->names.chars + world->names.offsets[world->entities.buffer[index].nameId];
+        size_t nameSize = strlen(name) + 1;
+        JournalRecord* record = AppendJournalRecord(world->journal, type, (uint32_t)(sizeof(float) * 16 + nameSize), entity);
+        char* payload = (char*)(record + 1);
+        memcpy(payload, world->transforms + index * 16, sizeof(float) * 16);
+        memcpy(payload + sizeof(float) * 16, name, nameSize);
+    }
+
+    static void RecordTransformChange(World* world, uint64_t entity, const float* from, const float* to)
+    {
+        Journal* journal = world->journal;
+        if (journal == nullptr) { return; }
+
+        // @NOTE consecutive changes to the same transform within a step collapse into one record, so e.g. dragging
+        // a gizmo costs one record per drag instead of one per frame
+        if (!journal->replaying && journal->lastRecordSize > 0) {
+            uint64_t last = journal->head - journal->lastRecordSize;
+            if (last >= journal->openStepBegin && last >= journal->sealedPosition && last >= journal->tail) {
+                JournalRecord* record = GetJournalRecord(journal, last);
+                if (record->type == JOURNAL_TRANSFORM && record->entity == entity) {
+                    memcpy((char*)(record + 1) + sizeof(float) * 16, to, sizeof(float) * 16);
+                    return;
+                }
+            }
+        }
+        JournalRecord* record = AppendJournalRecord(journal, JOURNAL_TRANSFORM, sizeof(float) * 32, entity);
+        memcpy(record + 1, from, sizeof(float) * 16);
+        memcpy((char*)(record + 1) + sizeof(float) * 16, to, sizeof(float) * 16);
+    }
+
+    static void RecordNameChange(World* world, uint64_t entity, uint32_t fromNameId, uint32_t toNameId)
+    {
+        if (world->journal == nullptr) { return; }
+        const char* from = world->names.chars + world->names.offsets[fromNameId];
+        const char* to = world->names.chars + world->names.offsets[toNameId];
+        size_t fromSize = strlen(from) + 1;
+        size_t toSize = strlen(to) + 1;
+        JournalRecord* record = AppendJournalRecord(world->journal, JOURNAL_NAME, (uint32_t)(fromSize + toSize), entity);
+        memcpy(record + 1, from, fromSize);
+        memcpy((char*)(record + 1) + fromSize, to, toSize);
+    }
+
+    /**
+        World file format, version 2. Nothing in the file is a pointer and every column starts on a
+        WORLD_FILE_COLUMN_ALIGNMENT boundary relative to the start of the world, so a world that is itself
+        placed on such a boundary (e.g. in a mapped file) can use its transform column in place.
+        Columns are indexed by pool slot up to the highest live slot, dead slots in that range are
+        cleared in the alive mask. All integers are written in the byte order of the saving machine,
+        endianTag lets the loader detect a mismatch.
+
+        Memory layout on disk:
+        {
+            WorldFileHeader
+            uint64_t[(numSlots + 63) / 64]  <- alive mask
+            uint32_t[numSlots]              <- generations
+            float[numSlots * 16]            <- transforms
+            uint32_t[numSlots]              <- name offsets into the string table
+            char[stringTableSize]           <- zero terminated names of live entities
+        }
+    */
+    static const uint32_t WORLD_FILE_MAGIC = 0x444C5257; // 'WRLD'
+    static const uint16_t WORLD_FILE_VERSION = 2;
+    static const uint16_t WORLD_FILE_ENDIAN_TAG = 0x0102;
+    static const uint64_t WORLD_FILE_COLUMN_ALIGNMENT = 64;
+
+    struct WorldFileHeader
+    {
+        uint32_t magic = WORLD_FILE_MAGIC;
+        uint16_t version = WORLD_FILE_VERSION;
+        uint16_t endianTag = WORLD_FILE_ENDIAN_TAG;
+        uint64_t totalSize = 0;         // in bytes, including this header
+        uint32_t capacity = 0;          // size of the entity pool the world was saved with
+        uint32_t numEntities = 0;       // live entities
+        uint32_t numSlots = 0;          // highest live slot + 1
+        uint32_t stringTableSize = 0;
+        uint64_t aliveMaskOffset = 0;   // column offsets, in bytes from the start of the header
+        uint64_t generationsOffset = 0;
+        uint64_t transformsOffset = 0;
+        uint64_t nameOffsetsOffset = 0;
+        uint64_t stringTableOffset = 0;
+    };
+
+    // version 1, packed columns of live entities only
+    struct WorldFileHeaderV1
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t endianTag;
+        uint64_t totalSize;
+        uint32_t capacity;
+        uint32_t numEntities;
+        uint32_t stringTableSize;
+        uint32_t reserved;
+    };
+
+    static uint64_t AlignColumnOffset(uint64_t offset)
+    {
+        return (offset + WORLD_FILE_COLUMN_ALIGNMENT - 1) & ~(WORLD_FILE_COLUMN_ALIGNMENT - 1);
+    }
+
+    static void ComputeWorldFileLayout(WorldFileHeader* header)
+    {
+        header->aliveMaskOffset = AlignColumnOffset(sizeof(WorldFileHeader));
+        header->generationsOffset = AlignColumnOffset(header->aliveMaskOffset + sizeof(uint64_t) * (((uint64_t)header->numSlots + 63) / 64));
+        header->transformsOffset = AlignColumnOffset(header->generationsOffset + sizeof(uint32_t) * (uint64_t)header->numSlots);
+        header->nameOffsetsOffset = AlignColumnOffset(header->transformsOffset + sizeof(float) * 16 * (uint64_t)header->numSlots);
+        header->stringTableOffset = AlignColumnOffset(header->nameOffsetsOffset + sizeof(uint32_t) * (uint64_t)header->numSlots);
+        header->totalSize = header->stringTableOffset + header->stringTableSize;
+    }
+
+    // gives every name used by a live entity its offset in the file's string table, so each name is written once.
+    // returns the size of the string table
+    static uint32_t AssignNameFileOffsets(World* world, uint32_t* nameFileOffsets)
+    {
+        for (uint32_t i = 0; i < world->names.numNames; ++i) {
+            nameFileOffsets[i] = INVALID_SLOT;
+        }
+        uint32_t stringTableSize = 0;
+        for (uint32_t i = 0; i < world->entities.size; ++i) {
+            EntityData* data = &world->entities.buffer[i];
+            if (data->isAlive && nameFileOffsets[data->nameId] == INVALID_SLOT) {
+                nameFileOffsets[data->nameId] = stringTableSize;
+                stringTableSize += (uint32_t)strlen(world->names.chars + world->names.offsets[data->nameId]) + 1;
+            }
+        }
+        return stringTableSize;
+    }
+
+    // puts all dead slots on the free list in ascending order and recounts live entities, the rest of the ring is
+    // where the live ones go once they are destroyed
+    static void RebuildFreeList(ResourcePool<EntityData>* pool)
+    {
+        uint32_t numFree = 0;
+        for (uint32_t i = 0; i < pool->size; ++i) {
+            if (!pool->buffer[i].isAlive) {
+                pool->ringPositions[i] = numFree;
+                pool->indexList[numFree++] = i;
+            }
+        }
+        pool->numElements = pool->size - numFree;
+        pool->numFreeIndices = numFree;
+        pool->indexListHead = 0;
+        pool->indexListTail = pool->size > 0 ? numFree % pool->size : 0;
+    }
+
+    static void ReplaceEntityPool(World* world, EntityData* buffer, uint32_t capacity, NameTable* names)
+    {
+        if (world->entities.buffer != nullptr) {
+            GT_DELETE_ARRAY(world->entities.buffer, world->memoryArena);
+            GT_DELETE_ARRAY(world->entities.indexList, world->memoryArena);
+            GT_DELETE_ARRAY(world->entities.ringPositions, world->memoryArena);
+        }
+        world->entities.size = capacity;
+        world->entities.buffer = buffer;
+        world->entities.indexList = GT_NEW_ARRAY(uint32_t, capacity, world->memoryArena);
+        world->entities.ringPositions = GT_NEW_ARRAY(uint32_t, capacity, world->memoryArena);
+        RebuildFreeList(&world->entities);
+
+        FreeNameTable(&world->names, world->memoryArena);
+        world->names = *names;
+        RelinkEntityNames(world);
+
+        // recorded changes refer to the previous contents of the world
+        if (world->journal != nullptr) {
+            ResetJournal(world->journal);
+        }
+    }
+
     bool SerializeWorld(World* world, void* buffer, size_t bufferSize, size_t* outRequiredBufferSize)
     {   
-        auto requiredBufferSize = sizeof(ResourcePool<EntityData>) + world->entities.size * (sizeof(EntityData) + sizeof(uint16_t));
+        uint32_t* nameFileOffsets = GT_NEW_ARRAY(uint32_t, world->names.numNames, world->memoryArena);
+        WorldFileHeader header;
+        header.capacity = world->entities.size;
+        header.stringTableSize = AssignNameFileOffsets(world, nameFileOffsets);
+        for (uint32_t i = 0; i < world->entities.size; ++i) {
+            if (world->entities.buffer[i].isAlive) {
+                header.numEntities++;
+                header.numSlots = i + 1;
+            }
+        }
+        ComputeWorldFileLayout(&header);
+        auto requiredBufferSize = (size_t)header.totalSize;
         if (outRequiredBufferSize != nullptr) {
             *outRequiredBufferSize = requiredBufferSize;
         }
         if (buffer != nullptr) {
-            if (bufferSize < requiredBufferSize) { return false; }
-            union {
-                void* as_void;
-                ResourcePool<EntityData>* as_pool;
-                EntityData* as_entityData;
-                uint16_t* as_uint16_t;
-                uint64_t* as_uint64_t;
-            };
-
-            /**
-                Memory layout on disk:
-                {
-                    uint64_t                                <- size in bytes
-                    ResourcePool                    <- 
-                    EntityData[resource pool size]  <- 
-                    uint16_t[resource pool size]    <- index table
-            */
-
-
-            as_void = buffer;
-            
-            uint64_t requiredSizeU64 = requiredBufferSize;
-            memcpy(as_uint64_t, &requiredSizeU64, sizeof(uint64_t));
-            as_uint64_t++;
-
-            memcpy(as_pool, &world->entities, sizeof(ResourcePool<EntityData>));
-            as_pool++;
-            memcpy(as_entityData, world->entities.buffer, sizeof(EntityData) * world->entities.size);
-            as_entityData += world->entities.size;
-            memcpy(as_uint16_t, world->entities.indexList, sizeof(uint16_t) * world->entities.size);
+            if (bufferSize < requiredBufferSize) { 
+                GT_DELETE_ARRAY(nameFileOffsets, world->memoryArena);
+                return false; 
+            }
+
+            char* out = (char*)buffer;
+            memset(out, 0x0, requiredBufferSize);
+            memcpy(out, &header, sizeof(WorldFileHeader));
+            memcpy(out + header.transformsOffset, world->transforms, sizeof(float) * 16 * header.numSlots);
+
+            for (uint32_t i = 0; i < world->names.numNames; ++i) {
+                if (nameFileOffsets[i] != INVALID_SLOT) {
+                    const char* name = world->names.chars + world->names.offsets[i];
+                    memcpy(out + header.stringTableOffset + nameFileOffsets[i], name, strlen(name));
+                }
+            }
+            for (uint32_t i = 0; i < header.numSlots; ++i) {
+                EntityData* data = &world->entities.buffer[i];
+                memcpy(out + header.generationsOffset + sizeof(uint32_t) * i, &data->generation, sizeof(uint32_t));
+                if (!data->isAlive) { continue; }
+
+                uint64_t mask = 0;
+                char* maskWord = out + header.aliveMaskOffset + sizeof(uint64_t) * (i / 64);
+                memcpy(&mask, maskWord, sizeof(uint64_t));
+                mask |= 1ull << (i % 64);
+                memcpy(maskWord, &mask, sizeof(uint64_t));
+
+                memcpy(out + header.nameOffsetsOffset + sizeof(uint32_t) * i, &nameFileOffsets[data->nameId], sizeof(uint32_t));
+            }
         }
+        GT_DELETE_ARRAY(nameFileOffsets, world->memoryArena);
         return true;
     }
 
-    bool DeserializeWorld(World* world, void* buffer, size_t bufferSize, size_t* bytesRead)
+    /**
+        Pre-versioned format, a raw dump of the 16 bit handle entity pool as laid out by MSVC x64:
+        {
+            uint64_t                        <- size in bytes, excluding this field
+            ResourcePool                    <- 32 bytes, contains pointers
+            EntityData[resource pool size]  <- 200 bytes each
+            uint16_t[resource pool size]    <- index table
+        }
+    */
+    static const size_t LEGACY_POOL_SIZE = 32;
+    static const size_t LEGACY_ENTITY_DATA_SIZE = 200;
+    static const size_t LEGACY_ENTITY_NAME_OFFSET = 2;
+    static const size_t LEGACY_ENTITY_TRANSFORM_OFFSET = 132;
+    static const size_t LEGACY_ENTITY_IS_ALIVE_OFFSET = 196;
+
+    static bool DeserializeLegacyWorld(World* world, const char* in, size_t bufferSize, size_t* bytesRead)
     {
-        union {
-            void* as_void;
-            ResourcePool<EntityData>* as_pool;
-            EntityData* as_entityData;
-            uint16_t* as_uint16_t;
-            uint64_t* as_uint64_t;
-        };
-        as_void = buffer;
+        if (bufferSize < sizeof(uint64_t) + LEGACY_POOL_SIZE) { return false; }
+        uint64_t storedSize = 0;
+        uint32_t capacity = 0;
+        memcpy(&storedSize, in, sizeof(uint64_t));
+        memcpy(&capacity, in + sizeof(uint64_t), sizeof(uint32_t));
+        uint64_t expectedSize = LEGACY_POOL_SIZE + (uint64_t)capacity * (LEGACY_ENTITY_DATA_SIZE + sizeof(uint16_t));
+        if (capacity == 0 || storedSize != expectedSize || sizeof(uint64_t) + storedSize > bufferSize) {
+            GT_LOG_ERROR("Entities", "World data is neither a versioned nor a valid legacy world");
+            return false;
+        }
 
-        uint64_t bytesReadU64 = 0;
-        memcpy(&bytesReadU64, as_uint64_t, sizeof(uint64_t));
-        as_uint64_t++;
+        EntityData* buffer = GT_NEW_ARRAY(EntityData, capacity, world->memoryArena);
+        NameTable names;
+        InitializeNameTable(&names, world->memoryArena);
+        AllocateTransforms(world, capacity);
+        const char* slots = in + sizeof(uint64_t) + LEGACY_POOL_SIZE;
+        for (uint32_t i = 0; i < capacity; ++i) {
+            const char* slot = slots + LEGACY_ENTITY_DATA_SIZE * i;
+            uint16_t generation = 0;
+            memcpy(&generation, slot, sizeof(uint16_t));
+            buffer[i].generation = generation;
+            buffer[i].isAlive = slot[LEGACY_ENTITY_IS_ALIVE_OFFSET] != 0;
+            if (buffer[i].isAlive) {
+                buffer[i].nameId = InternName(&names, slot + LEGACY_ENTITY_NAME_OFFSET, ENTITY_NAME_SIZE, world->memoryArena);
+            }
+            memcpy(world->transforms + i * 16, slot + LEGACY_ENTITY_TRANSFORM_OFFSET, sizeof(float) * 16);
+        }
+        ReplaceEntityPool(world, buffer, capacity, &names);
 
         if (bytesRead != nullptr) {
-            *bytesRead = (size_t)bytesReadU64;
+            *bytesRead = (size_t)(sizeof(uint64_t) + storedSize);
         }
+        return true;
+    }
 
-        if (world->entities.buffer != nullptr) {
-            GT_DELETE_ARRAY(world->entities.buffer, world->memoryArena);
-            GT_DELETE_ARRAY(world->entities.indexList, world->memoryArena);
+    static bool DeserializeWorldV1(World* world, const char* in, size_t bufferSize, size_t* bytesRead)
+    {
+        WorldFileHeaderV1 header;
+        if (bufferSize < sizeof(WorldFileHeaderV1)) { return false; }
+        memcpy(&header, in, sizeof(WorldFileHeaderV1));
+        uint64_t expectedSize = sizeof(WorldFileHeaderV1) + (uint64_t)header.numEntities * (sizeof(uint64_t) + sizeof(float) * 16 + sizeof(uint32_t)) + header.stringTableSize;
+        if (header.capacity == 0 || header.numEntities > header.capacity || header.totalSize != expectedSize || header.totalSize > bufferSize) {
+            GT_LOG_ERROR("Entities", "World data is truncated or corrupt");
+            return false;
+        }
+
+        const char* handles = in + sizeof(WorldFileHeaderV1);
+        const char* transforms = handles + sizeof(uint64_t) * header.numEntities;
+        const char* nameOffsets = transforms + sizeof(float) * 16 * header.numEntities;
+        const char* stringTable = nameOffsets + sizeof(uint32_t) * header.numEntities;
+        if (header.stringTableSize > 0 && stringTable[header.stringTableSize - 1] != '\0') {
+            GT_LOG_ERROR("Entities", "World data has an unterminated string table");
+            return false;
+        }
+
+        EntityData* entities = GT_NEW_ARRAY(EntityData, header.capacity, world->memoryArena);
+        NameTable names;
+        InitializeNameTable(&names, world->memoryArena);
+        for (uint32_t i = 0; i < header.numEntities; ++i) {
+            uint64_t handle = 0;
+            uint32_t nameOffset = 0;
+            memcpy(&handle, handles + sizeof(uint64_t) * i, sizeof(uint64_t));
+            memcpy(&nameOffset, nameOffsets + sizeof(uint32_t) * i, sizeof(uint32_t));
+
+            uint32_t index = HANDLE_INDEX(handle);
+            if (index >= header.capacity || entities[index].isAlive || nameOffset >= header.stringTableSize) {
+                GT_LOG_ERROR("Entities", "World data contains an invalid entity record");
+                GT_DELETE_ARRAY(entities, world->memoryArena);
+                FreeNameTable(&names, world->memoryArena);
+                return false;
+            }
+            EntityData* data = &entities[index];
+            data->isAlive = true;
+            data->generation = HANDLE_GENERATION(handle);
+            const char* name = stringTable + nameOffset;
+            data->nameId = InternName(&names, name, strlen(name), world->memoryArena);
+        }
+
+        AllocateTransforms(world, header.capacity);
+        for (uint32_t i = 0; i < header.numEntities; ++i) {
+            uint64_t handle = 0;
+            memcpy(&handle, handles + sizeof(uint64_t) * i, sizeof(uint64_t));
+            memcpy(world->transforms + HANDLE_INDEX(handle) * 16, transforms + sizeof(float) * 16 * i, sizeof(float) * 16);
+        }
+        ReplaceEntityPool(world, entities, header.capacity, &names);
+
+        if (bytesRead != nullptr) {
+            *bytesRead = (size_t)header.totalSize;
+        }
+        return true;
+    }
+
+    static bool DeserializeWorldV2(World* world, char* in, size_t bufferSize, size_t* bytesRead, bool inPlace)
+    {
+        WorldFileHeader header;
+        if (bufferSize < sizeof(WorldFileHeader)) { return false; }
+        memcpy(&header, in, sizeof(WorldFileHeader));
+
+        WorldFileHeader expected = header;
+        ComputeWorldFileLayout(&expected);
+        if (header.capacity == 0 || header.numSlots > header.capacity || header.numEntities > header.numSlots 
+            || memcmp(&header, &expected, sizeof(WorldFileHeader)) != 0 || header.totalSize > bufferSize) {
+            GT_LOG_ERROR("Entities", "World data is truncated or corrupt");
+            return false;
         }
-        memcpy(&world->entities, as_pool, sizeof(ResourcePool<EntityData>));
-        
-        world->entities.buffer = GT_NEW_ARRAY(EntityData, world->entities.size, world->memoryArena);
-        world->entities.indexList = GT_NEW_ARRAY(uint16_t, world->entities.size, world->memoryArena);
 
-        as_pool++;
-        memcpy(world->entities.buffer, as_entityData, sizeof(EntityData) * world->entities.size);
-        as_entityData += world->entities.size;
-        memcpy(world->entities.indexList, as_uint16_t, sizeof(uint16_t) * world->entities.size);
+        const char* stringTable = in + header.stringTableOffset;
+        if (header.stringTableSize > 0 && stringTable[header.stringTableSize - 1] != '\0') {
+            GT_LOG_ERROR("Entities", "World data has an unterminated string table");
+            return false;
+        }
+
+        EntityData* entities = GT_NEW_ARRAY(EntityData, header.capacity, world->memoryArena);
+        NameTable names;
+        InitializeNameTable(&names, world->memoryArena);
+        uint32_t numAlive = 0;
+        for (uint32_t i = 0; i < header.numSlots; ++i) {
+            EntityData* data = &entities[i];
+            memcpy(&data->generation, in + header.generationsOffset + sizeof(uint32_t) * i, sizeof(uint32_t));
 
+            uint64_t mask = 0;
+            memcpy(&mask, in + header.aliveMaskOffset + sizeof(uint64_t) * (i / 64), sizeof(uint64_t));
+            if ((mask & (1ull << (i % 64))) == 0) { continue; }
+
+            uint32_t nameOffset = 0;
+            memcpy(&nameOffset, in + header.nameOffsetsOffset + sizeof(uint32_t) * i, sizeof(uint32_t));
+            if (nameOffset >= header.stringTableSize) {
+                GT_LOG_ERROR("Entities", "World data contains an invalid entity record");
+                GT_DELETE_ARRAY(entities, world->memoryArena);
+                FreeNameTable(&names, world->memoryArena);
+                return false;
+            }
+            data->isAlive = true;
+            const char* name = stringTable + nameOffset;
+            data->nameId = InternName(&names, name, strlen(name), world->memoryArena);
+            numAlive++;
+        }
+        if (numAlive != header.numEntities) {
+            GT_LOG_ERROR("Entities", "World data alive mask does not match its entity count");
+            GT_DELETE_ARRAY(entities, world->memoryArena);
+            FreeNameTable(&names, world->memoryArena);
+            return false;
+        }
+
+        float* transforms = (float*)(in + header.transformsOffset);
+        if (inPlace && ((uintptr_t)transforms % WORLD_FILE_COLUMN_ALIGNMENT) == 0) {
+            FreeTransforms(world);
+            world->transforms = transforms;
+            world->numMappedTransforms = header.numSlots;
+            world->transformsMapped = true;
+        }
+        else {
+            AllocateTransforms(world, header.capacity);
+            memcpy(world->transforms, transforms, sizeof(float) * 16 * header.numSlots);
+        }
+        ReplaceEntityPool(world, entities, header.capacity, &names);
+
+        if (bytesRead != nullptr) {
+            *bytesRead = (size_t)header.totalSize;
+        }
         return true;
     }
 
+    static bool DeserializeWorldVersioned(World* world, void* buffer, size_t bufferSize, size_t* bytesRead, bool inPlace)
+    {
+        char* in = (char*)buffer;
+        if (bufferSize < sizeof(uint32_t) * 2) { return false; }
+        uint32_t magic = 0;
+        memcpy(&magic, in, sizeof(uint32_t));
+        if (magic != WORLD_FILE_MAGIC) {
+            return DeserializeLegacyWorld(world, in, bufferSize, bytesRead);
+        }
+
+        uint16_t version = 0;
+        uint16_t endianTag = 0;
+        memcpy(&version, in + sizeof(uint32_t), sizeof(uint16_t));
+        memcpy(&endianTag, in + sizeof(uint32_t) + sizeof(uint16_t), sizeof(uint16_t));
+        if (endianTag != WORLD_FILE_ENDIAN_TAG) {
+            GT_LOG_ERROR("Entities", "World data was saved with a different byte order");
+            return false;
+        }
+        switch (version) {
+            case 1: return DeserializeWorldV1(world, in, bufferSize, bytesRead);
+            case 2: return DeserializeWorldV2(world, in, bufferSize, bytesRead, inPlace);
+            default: {
+                GT_LOG_ERROR("Entities", "World data has version %i, newest supported is %i", version, WORLD_FILE_VERSION);
+                return false;
+            }
+        }
+    }
+
+    bool DeserializeWorld(World* world, void* buffer, size_t bufferSize, size_t* bytesRead)
+    {
+        return DeserializeWorldVersioned(world, buffer, bufferSize, bytesRead, false);
+    }
+
+    bool DeserializeWorldInPlace(World* world, void* buffer, size_t bufferSize, size_t* bytesRead)
+    {
+        return DeserializeWorldVersioned(world, buffer, bufferSize, bytesRead, true);
+    }
+
     void SetEntityName(World* world, Entity entity, const char* name)
     {
         assert(entity.id != 0);
         EntityData* data = world->entities.Get(entity.id);
-        size_t len = strlen(name);
-        len = len > ENTITY_NAME_SIZE ? ENTITY_NAME_SIZE : len;
-        memset(data->name + len, 0x0, ENTITY_NAME_SIZE - len);
-        memcpy(data->name, name, len);
+        uint32_t nameId = InternName(&world->names, name, strlen(name), world->memoryArena);
+        if (nameId == data->nameId) { return; }
+        uint32_t index = HANDLE_INDEX(entity.id);
+        RecordNameChange(world, entity.id, data->nameId, nameId);
+        UnlinkEntityName(world, index);
+        data->nameId = nameId;
+        LinkEntityName(world, index);
     }
 
-    char* GetEntityNameBuf(World* world, Entity entity)
+    const char* GetEntityName(World* world, Entity entity)
     {
         assert(entity.id != 0);
         EntityData* data = world->entities.Get(entity.id);
-        return data->name;
+        return world->names.chars + world->names.offsets[data->nameId];
+    }
+
+    Entity FindEntityByName(World* world, const char* name)
+    {
+        uint32_t nameId = FindName(&world->names, name, strlen(name));
+        if (nameId == INVALID_SLOT || world->names.firstEntity[nameId] == INVALID_SLOT) {
+            return { INVALID_ID };
+        }
+        uint32_t index = world->names.firstEntity[nameId];
+        Entity entity;
+        entity.id = MAKE_HANDLE(index, world->entities.buffer[index].generation);
+        return entity;
     }
 
     float* GetEntityTransform(World* world, Entity entity)
     {
         assert(entity.id != 0);
-        EntityData* data = world->entities.Get(entity.id);
-        return data->transform;
+        assert(world->entities.Get(entity.id) != nullptr);
+        return world->transforms + HANDLE_INDEX(entity.id) * 16;
+    }
+
+    void SetEntityTransform(World* world, Entity entity, const float* transform)
+    {
+        float* current = GetEntityTransform(world, entity);
+        if (memcmp(current, transform, sizeof(float) * 16) == 0) { return; }
+        RecordTransformChange(world, entity.id, current, transform);
+        memcpy(current, transform, sizeof(float) * 16);
+    }
+
+    static_assert(sizeof(Entity) == sizeof(uint64_t), "entity arrays are passed to the pool as raw handle arrays");
+
+    // a mapped transform column only covers the slots that were saved, so new entities past it detach the world
+    static void ReserveTransforms(World* world, Entity* entities, size_t count)
+    {
+        if (!world->transformsMapped) { return; }
+        for (size_t i = 0; i < count; ++i) {
+            if (HANDLE_INDEX(entities[i].id) >= world->numMappedTransforms) {
+                DetachWorld(world);
+                return;
+            }
+        }
+    }
+
+    // brings a freshly allocated slot to life under the given name, keeping its generation
+    static void InitEntityData(World* world, uint32_t index, uint32_t nameId)
+    {
+        EntityData* data = &world->entities.buffer[index];
+        data->nameId = nameId;
+        data->isAlive = true;
+        LinkEntityName(world, index);
+    }
+
+    bool CreateEntities(World* world, size_t count, Entity* outEntities)
+    {
+        if (count == 0) { return true; }
+        if (!world->entities.AllocateRange((uint32_t)count, (uint64_t*)outEntities)) {
+            return false;
+        }
+        ReserveTransforms(world, outEntities, count);
+        float identity[16];
+        util::Make4x4FloatMatrixIdentity(identity);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t index = HANDLE_INDEX(outEntities[i].id);
+            InitEntityData(world, index, DEFAULT_NAME_ID);
+            memcpy(world->transforms + index * 16, identity, sizeof(float) * 16);
+            RecordEntityLifetime(world, JOURNAL_CREATE, outEntities[i].id);
+        }
+        return true;
+    }
+
+    void DestroyEntities(World* world, Entity* entities, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            EntityData* data = world->entities.Get(entities[i].id);
+            if (data != nullptr && data->isAlive) {
+                RecordEntityLifetime(world, JOURNAL_DESTROY, entities[i].id);
+                UnlinkEntityName(world, HANDLE_INDEX(entities[i].id));
+                data->isAlive = false;
+            }
+        }
+        world->entities.FreeRange((uint32_t)count, (uint64_t*)entities);
+    }
+
+    static const uint32_t COPY_CHUNK_SIZE = 256;
+
+    // @NOTE the source slots of a chunk are resolved before its handles are written, so copying in place with
+    // outEntities == entities works, partially overlapping arrays don't
+    bool CopyEntities(World* world, Entity* entities, size_t count, Entity* outEntities)
+    {
+        if (count == 0) { return true; }
+        assert(outEntities == entities || outEntities + count <= entities || entities + count <= outEntities);
+        for (size_t i = 0; i < count; ++i) {
+            if (world->entities.Get(entities[i].id) == nullptr) { return false; }
+        }
+        if (count > world->entities.GetNumFreeIndices()) {
+            return false;
+        }
+        uint32_t fromIndices[COPY_CHUNK_SIZE];
+        for (size_t first = 0; first < count; first += COPY_CHUNK_SIZE) {
+            uint32_t numInChunk = count - first < COPY_CHUNK_SIZE ? (uint32_t)(count - first) : COPY_CHUNK_SIZE;
+            for (uint32_t i = 0; i < numInChunk; ++i) {
+                fromIndices[i] = HANDLE_INDEX(entities[first + i].id);
+            }
+            Entity* chunkEntities = outEntities + first;
+            world->entities.AllocateRange(numInChunk, (uint64_t*)chunkEntities);
+            ReserveTransforms(world, chunkEntities, numInChunk);
+            for (uint32_t i = 0; i < numInChunk; ++i) {
+                uint32_t toIndex = HANDLE_INDEX(chunkEntities[i].id);
+                InitEntityData(world, toIndex, world->entities.buffer[fromIndices[i]].nameId);
+                memcpy(world->transforms + toIndex * 16, world->transforms + fromIndices[i] * 16, sizeof(float) * 16);
+                RecordEntityLifetime(world, JOURNAL_CREATE, chunkEntities[i].id);
+            }
+        }
+        return true;
+    }
+
+    // brings a destroyed entity back under its old handle, its slot has to be free
+    static bool RestoreEntity(World* world, uint64_t id, const char* name, const float* transform)
+    {
+        uint32_t index = HANDLE_INDEX(id);
+        if (index >= world->entities.size || world->entities.buffer[index].isAlive || !world->entities.ClaimIndex(index)) {
+            GT_LOG_ERROR("Entity System", "Cannot restore entity %llu, its slot is in use", (unsigned long long)id);
+            return false;
+        }
+        Entity entity;
+        entity.id = id;
+        world->entities.buffer[index].generation = HANDLE_GENERATION(id);
+        ReserveTransforms(world, &entity, 1);
+        InitEntityData(world, index, InternName(&world->names, name, strlen(name), world->memoryArena));
+        memcpy(world->transforms + index * 16, transform, sizeof(float) * 16);
+        RecordEntityLifetime(world, JOURNAL_CREATE, id);
+        return true;
     }
 
     Entity CreateEntity(World* world)
     {
-        EntityData* entityData;
         Entity entity;
-        if (!world->entities.Allocate(&entityData, &entity.id)) {
+        if (!CreateEntities(world, 1, &entity)) {
             return { INVALID_ID };
         }
-        //GT_PLACEMENT_NEW(entityData) Entity();
-        entityData->isAlive = true;
         return entity;
     }
 
     void DestroyEntity(World* world, Entity entity)
     {
-        world->entities.Get(entity.id)->isAlive = false;
-        world->entities.Free(entity.id);
+        assert(world->entities.Get(entity.id) != nullptr);
+        DestroyEntities(world, &entity, 1);
     }
 
     Entity CopyEntity(World* world, Entity entity)
     {
-        Entity newEnt = CreateEntity(world);
-        if (newEnt.id != INVALID_ID) {
-            EntityData* from = world->entities.Get(entity.id);
-            EntityData* to = world->entities.Get(newEnt.id);
-            assert(from); 
-            assert(to);
-            memcpy(to, from, sizeof(EntityData));
+        Entity newEnt;
+        if (!CopyEntities(world, &entity, 1, &newEnt)) {
+            return { INVALID_ID };
         }
         return newEnt;
     }
@@ -263,6 +1200,215 @@ namespace entity_system
         return data != nullptr;
     }
 
+    // applies a recorded change, or its inverse, through the regular entity functions so it gets recorded again
+    static bool ApplyJournalRecord(World* world, const JournalRecord* record, bool inverse)
+    {
+        const char* payload = (const char*)(record + 1);
+        Entity entity;
+        entity.id = record->entity;
+
+        switch (record->type) {
+            case JOURNAL_PADDING: return true;
+            case JOURNAL_CREATE:
+            case JOURNAL_DESTROY: {
+                if ((record->type == JOURNAL_CREATE) != inverse) {
+                    float transform[16];
+                    memcpy(transform, payload, sizeof(float) * 16);
+                    return RestoreEntity(world, record->entity, payload + sizeof(float) * 16, transform);
+                }
+                if (!IsEntityAlive(world, entity)) { break; }
+                DestroyEntities(world, &entity, 1);
+                return true;
+            }
+            case JOURNAL_TRANSFORM: {
+                if (!IsEntityAlive(world, entity)) { break; }
+                float transform[16];
+                memcpy(transform, payload + (inverse ? 0 : sizeof(float) * 16), sizeof(float) * 16);
+                SetEntityTransform(world, entity, transform);
+                return true;
+            }
+            case JOURNAL_NAME: {
+                if (!IsEntityAlive(world, entity)) { break; }
+                const char* from = payload;
+                const char* to = from + strlen(from) + 1;
+                SetEntityName(world, entity, inverse ? from : to);
+                return true;
+            }
+            default: {
+                GT_LOG_ERROR("Entity System", "Unknown journal record type %u", (uint32_t)record->type);
+                return false;
+            }
+        }
+        GT_LOG_ERROR("Entity System", "Journal record refers to entity %llu which is not alive", (unsigned long long)record->entity);
+        return false;
+    }
+
+    static void PushUndoStep(Journal* journal, JournalStep step)
+    {
+        if (journal->numUndoSteps == journal->maxSteps) {
+            journal->firstUndoStep = (journal->firstUndoStep + 1) % journal->maxSteps;
+            journal->numUndoSteps--;
+        }
+        journal->undoSteps[(journal->firstUndoStep + journal->numUndoSteps) % journal->maxSteps] = step;
+        journal->numUndoSteps++;
+    }
+
+    // applies the inverse of every record of step, last one first, and returns the range of records this produced
+    static bool RevertJournalStep(World* world, JournalStep step, JournalStep* outStep)
+    {
+        Journal* journal = world->journal;
+
+        // @NOTE the reverted records are appended while the step is still being read from the ring, so the step
+        // plus everything written after it plus one padding record has to fit or it would overwrite itself
+        if (step.begin < journal->tail || (journal->head - step.begin) + (step.end - step.begin) + MAX_JOURNAL_RECORD_SIZE > journal->capacity) {
+            return false;
+        }
+
+        journal->replaying = true;
+        outStep->begin = journal->head;
+        uint64_t position = step.end;
+        uint32_t prevSize = step.end == journal->head ? journal->lastRecordSize : GetJournalRecord(journal, step.end)->prevSize;
+        while (position > step.begin) {
+            position -= prevSize;
+            JournalRecord* record = GetJournalRecord(journal, position);
+            prevSize = record->prevSize;
+            ApplyJournalRecord(world, record, true);
+        }
+        outStep->end = journal->head;
+        journal->openStepBegin = journal->head;
+        journal->replaying = false;
+        return true;
+    }
+
+    void CommitJournalStep(World* world)
+    {
+        Journal* journal = world->journal;
+        if (journal == nullptr || journal->head == journal->openStepBegin) { return; }
+        if (journal->openStepBegin >= journal->tail) {
+            JournalStep step;
+            step.begin = journal->openStepBegin;
+            step.end = journal->head;
+            PushUndoStep(journal, step);
+        }
+        else {
+            // the step outgrew the ring buffer, so neither it nor anything before it can be undone
+            journal->numUndoSteps = 0;
+        }
+        journal->openStepBegin = journal->head;
+    }
+
+    bool UndoJournalStep(World* world)
+    {
+        Journal* journal = world->journal;
+        if (journal == nullptr) { return false; }
+        CommitJournalStep(world);
+        if (journal->numUndoSteps == 0) { return false; }
+
+        JournalStep step = journal->undoSteps[(journal->firstUndoStep + journal->numUndoSteps - 1) % journal->maxSteps];
+        journal->numUndoSteps--;
+        JournalStep reverted;
+        if (!RevertJournalStep(world, step, &reverted)) {
+            // older steps are even further back in the ring
+            journal->numUndoSteps = 0;
+            return false;
+        }
+        assert(journal->numRedoSteps < journal->maxSteps);
+        journal->redoSteps[journal->numRedoSteps++] = reverted;
+        return true;
+    }
+
+    bool RedoJournalStep(World* world)
+    {
+        Journal* journal = world->journal;
+        if (journal == nullptr || journal->numRedoSteps == 0) { return false; }
+
+        JournalStep step = journal->redoSteps[--journal->numRedoSteps];
+        JournalStep reapplied;
+        if (!RevertJournalStep(world, step, &reapplied)) {
+            journal->numRedoSteps = 0;
+            return false;
+        }
+        PushUndoStep(journal, reapplied);
+        return true;
+    }
+
+    uint64_t GetJournalPosition(World* world)
+    {
+        return world->journal != nullptr ? world->journal->head : 0;
+    }
+
+    /**
+        Journal deltas are the records between two journal positions, back to back and without padding records.
+        prevSize is meaningless outside of the ring buffer, it is written as zero so the same changes always
+        serialize to the same bytes.
+    */
+    bool SerializeJournal(World* world, uint64_t fromPosition, void* buffer, size_t bufferSize, size_t* outRequiredBufferSize, uint64_t* outPosition)
+    {
+        Journal* journal = world->journal;
+        if (journal == nullptr || fromPosition < journal->tail || fromPosition > journal->head) {
+            return false;
+        }
+
+        size_t requiredBufferSize = 0;
+        for (uint64_t position = fromPosition; position < journal->head; position += GetJournalRecord(journal, position)->size) {
+            JournalRecord* record = GetJournalRecord(journal, position);
+            if (record->type != JOURNAL_PADDING) {
+                requiredBufferSize += record->size;
+            }
+        }
+        if (outRequiredBufferSize != nullptr) {
+            *outRequiredBufferSize = requiredBufferSize;
+        }
+        if (buffer != nullptr) {
+            if (bufferSize < requiredBufferSize) { return false; }
+
+            char* out = (char*)buffer;
+            for (uint64_t position = fromPosition; position < journal->head; position += GetJournalRecord(journal, position)->size) {
+                JournalRecord* record = GetJournalRecord(journal, position);
+                if (record->type != JOURNAL_PADDING) {
+                    static const uint16_t noPrevSize = 0;
+                    memcpy(out, record, record->size);
+                    memcpy(out + offsetof(JournalRecord, prevSize), &noPrevSize, sizeof(uint16_t));
+                    out += record->size;
+                }
+            }
+            // the serialized records must not change anymore
+            journal->sealedPosition = journal->head;
+            if (outPosition != nullptr) {
+                *outPosition = journal->head;
+            }
+        }
+        return true;
+    }
+
+    bool ApplyJournal(World* world, const void* buffer, size_t bufferSize)
+    {
+        const char* in = (const char*)buffer;
+        size_t offset = 0;
+        bool success = true;
+        // @NOTE copied out so records can be read from unaligned buffers
+        union { JournalRecord header; char bytes[MAX_JOURNAL_RECORD_SIZE]; } record;
+        CommitJournalStep(world);
+        while (offset + sizeof(JournalRecord) <= bufferSize) {
+            memcpy(&record.header, in + offset, sizeof(JournalRecord));
+            uint32_t size = record.header.size;
+            if (size < sizeof(JournalRecord) || size > MAX_JOURNAL_RECORD_SIZE || size % JOURNAL_RECORD_ALIGNMENT != 0 || offset + size > bufferSize) {
+                GT_LOG_ERROR("Entity System", "Journal delta is corrupted at offset %zu", offset);
+                success = false;
+                break;
+            }
+            memcpy(record.bytes, in + offset, size);
+            // names in a record are zero terminated, make sure a corrupted one can't run past it
+            if (record.header.type != JOURNAL_TRANSFORM) {
+                record.bytes[size - 1] = '\0';
+            }
+            success = ApplyJournalRecord(world, &record.header, false) && success;
+            offset += size;
+        }
+        CommitJournalStep(world);
+        return success;
+    }
+
     void GetAllEntities(World* world, Entity* entities, size_t* numEntities)
     {
         *numEntities = 0;
@@ -279,20 +1425,34 @@ namespace entity_system
 }
 
 
-
 bool entity_system_get_interface(entity_system::EntitySystemInterface* interface) 
 {
     interface->CreateWorld = &entity_system::CreateWorld;
     interface->DestroyWorld = &entity_system::DestroyWorld;
     interface->SerializeWorld = &entity_system::SerializeWorld;
     interface->DeserializeWorld = &entity_system::DeserializeWorld;
+    interface->DeserializeWorldInPlace = &entity_system::DeserializeWorldInPlace;
+    interface->DetachWorld = &entity_system::DetachWorld;
     interface->CreateEntity = &entity_system::CreateEntity;
     interface->DestroyEntity = &entity_system::DestroyEntity;
     interface->CopyEntity = &entity_system::CopyEntity;
+    interface->CreateEntities = &entity_system::CreateEntities;
+    interface->DestroyEntities = &entity_system::DestroyEntities;
+    interface->CopyEntities = &entity_system::CopyEntities;
     interface->IsEntityAlive = &entity_system::IsEntityAlive;
     interface->SetEntityName = &entity_system::SetEntityName;
-    interface->GetEntityName = &entity_system::GetEntityNameBuf;
+    interface->GetEntityName = &entity_system::GetEntityName;
+    interface->FindEntityByName = &entity_system::FindEntityByName;
     interface->GetEntityTransform = &entity_system::GetEntityTransform;
     interface->GetAllEntities = &entity_system::GetAllEntities;
+    interface->SetEntityTransform = &entity_system::SetEntityTransform;
+    interface->EnableJournal = &entity_system::EnableJournal;
+    interface->DisableJournal = &entity_system::DisableJournal;
+    interface->CommitJournalStep = &entity_system::CommitJournalStep;
+    interface->UndoJournalStep = &entity_system::UndoJournalStep;
+    interface->RedoJournalStep = &entity_system::RedoJournalStep;
+    interface->GetJournalPosition = &entity_system::GetJournalPosition;
+    interface->SerializeJournal = &entity_system::SerializeJournal;
+    interface->ApplyJournal = &entity_system::ApplyJournal;
     return true;
 }
\ No newline at end of file
@@ -28,8 +28,14 @@ namespace entity_system
     bool SerializeWorld(World* world, void* buffer, size_t bufferSize, size_t* requiredBufferSize);
     bool DeserializeWorld(World* world, void* buffer, size_t bufferSize, size_t* bytesRead);
 
+    // like DeserializeWorld, but hot columns are used directly from buffer instead of being copied when its layout allows it.
+    // buffer has to stay valid and writable (e.g. a copy-on-write file mapping) until the world is detached, destroyed or loaded again
+    bool DeserializeWorldInPlace(World* world, void* buffer, size_t bufferSize, size_t* bytesRead);
+    // copies everything still referencing a buffer passed to DeserializeWorldInPlace into memory owned by the world
+    void DetachWorld(World* world);
+
     enum { INVALID_ID = 0 };
-    typedef struct { uint32_t id = INVALID_ID; } Entity;
+    typedef struct { uint64_t id = INVALID_ID; } Entity;
     
     Entity CreateEntity(World* world);
     void DestroyEntity(World* world, Entity entity);
@@ -37,32 +43,86 @@ namespace entity_system
 
     Entity CopyEntity(World* world, Entity entity);
 
+    // batch versions check the world's free slots once; create and copy fail without allocating anything
+    // if the world cannot hold count more entities, destroy skips handles that are no longer alive.
+    // copy may be done in place, with outEntities == entities
+    bool CreateEntities(World* world, size_t count, Entity* outEntities);
+    void DestroyEntities(World* world, Entity* entities, size_t count);
+    bool CopyEntities(World* world, Entity* entities, size_t count, Entity* outEntities);
+
+    // names are interned per world and truncated to ENTITY_NAME_SIZE - 1 chars. the returned string
+    // stays valid until the next name is set in this world
     void SetEntityName(World* world, Entity entity, const char* name);
-    char* GetEntityNameBuf(World* world, Entity entity);
+    const char* GetEntityName(World* world, Entity entity);
+    // returns one of the live entities with that name or an invalid entity if there is none
+    Entity FindEntityByName(World* world, const char* name);
 
     float* GetEntityTransform(World* world, Entity entity);
+    // same as writing through GetEntityTransform, except that the change is recorded in the journal
+    void SetEntityTransform(World* world, Entity entity, const float* transform);
 
     void GetAllEntities(World* world, Entity* entities, size_t* numEntities);
 
+    // @NOTE the change journal is opt in. while it is enabled, every change made through the functions above
+    // is recorded as a delta into a ring buffer of bufferSize bytes, dropping the oldest deltas when it is full.
+    // writes through the pointer returned by GetEntityTransform are not recorded, use SetEntityTransform instead
+    struct JournalConfig
+    {
+        uint32_t bufferSize = 1 << 20;
+        uint32_t maxUndoSteps = 256;
+    };
+
+    bool EnableJournal(World* world, JournalConfig* config);
+    void DisableJournal(World* world);
+
+    // ends the current undo step, all changes recorded since the previous step are undone and redone together
+    void CommitJournalStep(World* world);
+    bool UndoJournalStep(World* world);
+    bool RedoJournalStep(World* world);
+
+    // journal positions only grow, undo and redo are recorded as changes of their own.
+    // loading a world drops all recorded changes
+    uint64_t GetJournalPosition(World* world);
+    // writes all changes recorded since fromPosition. fails if those have been dropped from the ring buffer
+    // or a world was loaded since, the consumer then has to start over from a serialized world
+    bool SerializeJournal(World* world, uint64_t fromPosition, void* buffer, size_t bufferSize, size_t* requiredBufferSize, uint64_t* outPosition);
+    // applies changes written by SerializeJournal to a world that matched the source world at fromPosition
+    bool ApplyJournal(World* world, const void* buffer, size_t bufferSize);
+
     struct EntitySystemInterface
     {
         bool(*CreateWorld)(World**, fnd::memory::MemoryArenaBase*, WorldConfig*) = nullptr;
         void(*DestroyWorld)(World*) = nullptr;
-        decltype(SerializeWorld)*   SerializeWorld = nullptr;
-        decltype(DeserializeWorld)* DeserializeWorld = nullptr;
+        decltype(entity_system::SerializeWorld)* SerializeWorld = nullptr;
+        decltype(entity_system::DeserializeWorld)* DeserializeWorld = nullptr;
+        decltype(entity_system::DeserializeWorldInPlace)* DeserializeWorldInPlace = nullptr;
+        decltype(entity_system::DetachWorld)* DetachWorld = nullptr;
         Entity(*CreateEntity)(World*) = nullptr;
         void(*DestroyEntity)(World*, Entity) = nullptr;
         Entity(*CopyEntity)(World*, Entity) = nullptr;
+        decltype(entity_system::CreateEntities)* CreateEntities = nullptr;
+        decltype(entity_system::DestroyEntities)* DestroyEntities = nullptr;
+        decltype(entity_system::CopyEntities)* CopyEntities = nullptr;
         bool(*IsEntityAlive)(World*, Entity) = nullptr;
         void(*SetEntityName)(World*, Entity, const char*) = nullptr;
-        char*(*GetEntityName)(World*, Entity) = nullptr;
+        const char*(*GetEntityName)(World*, Entity) = nullptr;
+        decltype(entity_system::FindEntityByName)* FindEntityByName = nullptr;
         float*(*GetEntityTransform)(World*, Entity) = nullptr;
         void(*GetAllEntities)(World*, Entity*, size_t*) = nullptr;
+        decltype(entity_system::SetEntityTransform)* SetEntityTransform = nullptr;
+        decltype(entity_system::EnableJournal)* EnableJournal = nullptr;
+        decltype(entity_system::DisableJournal)* DisableJournal = nullptr;
+        decltype(entity_system::CommitJournalStep)* CommitJournalStep = nullptr;
+        decltype(entity_system::UndoJournalStep)* UndoJournalStep = nullptr;
+        decltype(entity_system::RedoJournalStep)* RedoJournalStep = nullptr;
+        decltype(entity_system::GetJournalPosition)* GetJournalPosition = nullptr;
+        decltype(entity_system::SerializeJournal)* SerializeJournal = nullptr;
+        decltype(entity_system::ApplyJournal)* ApplyJournal = nullptr;
     };
 }
 
 
 extern "C"
 {
-    __declspec(dllexport) bool entity_system_get_interface(entity_system::EntitySystemInterface* interface);
+    GT_DLL_EXPORT bool entity_system_get_interface(entity_system::EntitySystemInterface* interface);
 }
\ No newline at end of file
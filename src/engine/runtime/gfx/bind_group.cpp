@@ -0,0 +1,202 @@
+#include "bind_group.h"
+#include <foundation/logging/logging.h>
+#include <string.h>
+
+static_assert(GFX_MAX_VERTEX_STREAMS <= 8, "vertex stream mask is 8 bits");
+static_assert(GFX_MAX_CONSTANT_INPUTS_PER_STAGE <= 8, "constant input mask is 8 bits");
+static_assert(GFX_MAX_IMAGE_INPUTS_PER_STAGE <= 16, "image input mask is 16 bits");
+
+#define NUM_SHADER_STAGES 5
+
+namespace gfx
+{
+    struct GroupInputs
+    {
+        Image*      images[NUM_SHADER_STAGES];
+        Buffer*     constants[NUM_SHADER_STAGES];
+        uint32_t*   constantOffsets[NUM_SHADER_STAGES];     // nullptr for stages without offsets
+    };
+
+    static GroupInputs GetGroupInputs(BindGroupDesc* desc)
+    {
+        return {
+            { desc->vsImageInputs, desc->psImageInputs, desc->gsImageInputs, desc->hsImageInputs, desc->dsImageInputs },
+            { desc->vsConstantInputs, desc->psConstantInputs, desc->gsConstantInputs, desc->hsConstantInputs, desc->dsConstantInputs },
+            { desc->vsConstantOffsets, desc->psConstantOffsets, nullptr, nullptr, nullptr }
+        };
+    }
+
+    static GroupInputs GetGroupInputs(DrawCall* drawCall)
+    {
+        return {
+            { drawCall->vsImageInputs, drawCall->psImageInputs, drawCall->gsImageInputs, drawCall->hsImageInputs, drawCall->dsImageInputs },
+            { drawCall->vsConstantInputs, drawCall->psConstantInputs, drawCall->gsConstantInputs, drawCall->hsConstantInputs, drawCall->dsConstantInputs },
+            { drawCall->vsConstantOffsets, drawCall->psConstantOffsets, nullptr, nullptr, nullptr }
+        };
+    }
+
+    static bool ValidateBuffer(Device* device, Buffer buffer, BufferType type, const char* what)
+    {
+        BufferDesc desc = GetBufferDesc(device, buffer);
+        if (desc.byteWidth == 0 || desc.type != type) {
+            GT_LOG_ERROR("Gfx", "Bind group uses invalid %s buffer 0x%08x", what, buffer.id);
+            return false;
+        }
+        return true;
+    }
+
+    bool ValidateBindGroupDesc(Device* device, BindGroupDesc* desc)
+    {
+        bool isValid = true;
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            if (GFX_CHECK_RESOURCE(desc->vertexBuffers[i])) {
+                isValid = ValidateBuffer(device, desc->vertexBuffers[i], BufferType::BUFFER_TYPE_VERTEX, "vertex") && isValid;
+            }
+        }
+        if (GFX_CHECK_RESOURCE(desc->indexBuffer)) {
+            isValid = ValidateBuffer(device, desc->indexBuffer, BufferType::BUFFER_TYPE_INDEX, "index") && isValid;
+        }
+
+        GroupInputs inputs = GetGroupInputs(desc);
+        bool* dynamicConstants[NUM_SHADER_STAGES] = { desc->vsDynamicConstants, desc->psDynamicConstants, nullptr, nullptr, nullptr };
+        for (uint32_t stage = 0; stage < NUM_SHADER_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                Buffer buffer = inputs.constants[stage][i];
+                if (!GFX_CHECK_RESOURCE(buffer)) {
+                    if (dynamicConstants[stage] != nullptr && dynamicConstants[stage][i]) {
+                        GT_LOG_ERROR("Gfx", "Bind group has dynamic offsets for empty constant slot %u", i);
+                        isValid = false;
+                    }
+                    continue;
+                }
+                if (!ValidateBuffer(device, buffer, BufferType::BUFFER_TYPE_CONSTANT, "constant")) {
+                    isValid = false;
+                    continue;
+                }
+                uint32_t offset = inputs.constantOffsets[stage] != nullptr ? inputs.constantOffsets[stage][i] : 0;
+                if (offset % GFX_CONSTANT_BUFFER_ALIGNMENT != 0 || offset >= GetBufferDesc(device, buffer).byteWidth) {
+                    GT_LOG_ERROR("Gfx", "Bind group has invalid constant offset %u in slot %u", offset, i);
+                    isValid = false;
+                }
+            }
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                Image image = inputs.images[stage][i];
+                if (GFX_CHECK_RESOURCE(image) && GetImageDesc(device, image).width == 0) {
+                    GT_LOG_ERROR("Gfx", "Bind group uses invalid image 0x%08x in slot %u", image.id, i);
+                    isValid = false;
+                }
+            }
+        }
+        return isValid;
+    }
+
+    void InitializeBindGroupData(BindGroupData* data, BindGroupDesc* desc)
+    {
+        *data = BindGroupData();
+        data->desc = *desc;
+
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            data->vertexStreamMask |= GFX_CHECK_RESOURCE(desc->vertexBuffers[i]) ? (uint8_t)(1 << i) : 0;
+        }
+        GroupInputs inputs = GetGroupInputs(&data->desc);
+        for (uint32_t stage = 0; stage < NUM_SHADER_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                data->constantMasks[stage] |= GFX_CHECK_RESOURCE(inputs.constants[stage][i]) ? (uint8_t)(1 << i) : 0;
+            }
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                data->imageMasks[stage] |= GFX_CHECK_RESOURCE(inputs.images[stage][i]) ? (uint16_t)(1 << i) : 0;
+            }
+        }
+        for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+            if (desc->vsDynamicConstants[i]) {
+                data->dynamicConstants[data->numDynamicConstants++] = (uint8_t)i;
+            }
+        }
+        for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+            if (desc->psDynamicConstants[i]) {
+                data->dynamicConstants[data->numDynamicConstants++] = (uint8_t)(GFX_MAX_CONSTANT_INPUTS_PER_STAGE + i);
+            }
+        }
+    }
+
+    void InvalidateResolvedDrawInputs(ResolvedDrawInputs* resolved)
+    {
+        for (uint32_t i = 0; i < GFX_MAX_BIND_GROUPS; ++i) {
+            resolved->bindGroups[i].id = 0xffffffff;    // matches no handle, not even an empty one
+        }
+    }
+
+    static void ApplyBindGroup(DrawCall* drawCall, BindGroupData* data)
+    {
+        BindGroupDesc* desc = &data->desc;
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            if (!(data->vertexStreamMask & (1 << i))) { continue; }
+            drawCall->vertexBuffers[i] = desc->vertexBuffers[i];
+            drawCall->vertexOffsets[i] = desc->vertexOffsets[i];
+            drawCall->vertexStrides[i] = desc->vertexStrides[i];
+        }
+        if (GFX_CHECK_RESOURCE(desc->indexBuffer)) {
+            drawCall->indexBuffer = desc->indexBuffer;
+        }
+
+        GroupInputs source = GetGroupInputs(desc);
+        GroupInputs target = GetGroupInputs(drawCall);
+        for (uint32_t stage = 0; stage < NUM_SHADER_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                if (!(data->constantMasks[stage] & (1 << i))) { continue; }
+                target.constants[stage][i] = source.constants[stage][i];
+                if (target.constantOffsets[stage] != nullptr) {
+                    target.constantOffsets[stage][i] = source.constantOffsets[stage][i];
+                }
+            }
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                if (!(data->imageMasks[stage] & (1 << i))) { continue; }
+                target.images[stage][i] = source.images[stage][i];
+            }
+        }
+    }
+
+    DrawCall* ResolveDrawItem(ResolvedDrawInputs* resolved, DrawItem* drawItem, BindGroupData** groups)
+    {
+        DrawCall* drawCall = &resolved->drawCall;
+
+        bool hasChanged = false;
+        for (uint32_t i = 0; i < GFX_MAX_BIND_GROUPS; ++i) {
+            hasChanged = hasChanged || drawItem->bindGroups[i].id != resolved->bindGroups[i].id;
+        }
+        if (hasChanged) {
+            *drawCall = DrawCall();
+            memset(drawCall->vertexOffsets, 0, sizeof(drawCall->vertexOffsets));
+            memset(drawCall->vertexStrides, 0, sizeof(drawCall->vertexStrides));
+            for (uint32_t i = 0; i < GFX_MAX_BIND_GROUPS; ++i) {
+                resolved->bindGroups[i] = drawItem->bindGroups[i];
+                if (groups[i] != nullptr) {
+                    ApplyBindGroup(drawCall, groups[i]);
+                }
+            }
+        }
+
+        uint32_t numDynamicOffsets = 0;
+        for (uint32_t i = 0; i < GFX_MAX_BIND_GROUPS; ++i) {
+            if (groups[i] == nullptr) { continue; }
+            for (uint32_t j = 0; j < groups[i]->numDynamicConstants; ++j) {
+                if (numDynamicOffsets == GFX_MAX_DYNAMIC_CONSTANT_OFFSETS) {
+                    GT_LOG_ERROR("Gfx", "Draw item binds more than %u dynamic constants", GFX_MAX_DYNAMIC_CONSTANT_OFFSETS);
+                    InvalidateResolvedDrawInputs(resolved);
+                    return nullptr;
+                }
+                uint8_t slot = groups[i]->dynamicConstants[j];
+                uint32_t* offsets = slot < GFX_MAX_CONSTANT_INPUTS_PER_STAGE ? drawCall->vsConstantOffsets : drawCall->psConstantOffsets;
+                offsets[slot % GFX_MAX_CONSTANT_INPUTS_PER_STAGE] = drawItem->dynamicConstantOffsets[numDynamicOffsets++];
+            }
+        }
+
+        drawCall->pipelineState = drawItem->pipelineState;
+        drawCall->numElements = drawItem->numElements;
+        drawCall->elementOffset = drawItem->elementOffset;
+        drawCall->numInstances = drawItem->numInstances;
+        drawCall->startVertexLocation = drawItem->startVertexLocation;
+        drawCall->startInstanceLocation = drawItem->startInstanceLocation;
+        return drawCall;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "gfx.h"
+
+/**
+    Bind groups and draw items, shared by all backends.
+    Backends keep a BindGroupData per bind group in their pools and resolve draw items into a DrawCall that is kept
+    between draws, so only groups that changed since the previous draw item are copied in again.
+*/
+
+namespace gfx
+{
+    struct BindGroupData
+    {
+        BindGroupDesc   desc;
+
+        // bound slots, so applying a group only touches what it sets
+        uint8_t         vertexStreamMask = 0;
+        uint8_t         constantMasks[5] = {};      // vs, ps, gs, hs, ds
+        uint16_t        imageMasks[5] = {};
+
+        // slots taking DrawItem::dynamicConstantOffsets, in order, as stage * GFX_MAX_CONSTANT_INPUTS_PER_STAGE + slot
+        uint8_t         dynamicConstants[2 * GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+        uint32_t        numDynamicConstants = 0;
+    };
+
+    struct ResolvedDrawInputs
+    {
+        BindGroup       bindGroups[GFX_MAX_BIND_GROUPS];    // the groups drawCall holds the inputs of
+        DrawCall        drawCall;
+    };
+
+    // checks the resources through the public gfx API, logs what is wrong
+    bool ValidateBindGroupDesc(Device* device, BindGroupDesc* desc);
+    void InitializeBindGroupData(BindGroupData* data, BindGroupDesc* desc);
+
+    // the next draw item copies in all of its groups again
+    void InvalidateResolvedDrawInputs(ResolvedDrawInputs* resolved);
+
+    // groups has an entry per DrawItem::bindGroups, nullptr for empty ones, returns nullptr if the item can't be drawn
+    DrawCall* ResolveDrawItem(ResolvedDrawInputs* resolved, DrawItem* drawItem, BindGroupData** groups);
+}
@@ -0,0 +1,418 @@
+#include "command_stream.h"
+#include <foundation/memory/memory.h>
+#include <foundation/logging/logging.h>
+#include <string.h>
+
+// draw calls store which slots are bound as bit masks
+static_assert(GFX_MAX_VERTEX_STREAMS <= 8, "vertex stream mask is 8 bits");
+static_assert(GFX_MAX_CONSTANT_INPUTS_PER_STAGE <= 8, "constant input mask is 8 bits");
+static_assert(GFX_MAX_IMAGE_INPUTS_PER_STAGE <= 16, "image input mask is 16 bits");
+
+#define NUM_SHADER_STAGES 5
+
+namespace gfx
+{
+    enum class StreamCommandType : uint8_t
+    {
+        CMD_BEGIN_DEFAULT_RENDER_PASS,
+        CMD_BEGIN_RENDER_PASS,
+        CMD_DRAW,
+        CMD_DRAW_ITEM,
+        CMD_END_RENDER_PASS
+    };
+
+    enum StreamDrawFlags : uint8_t
+    {
+        DRAW_HAS_VIEWPORT       = 1 << 0,
+        DRAW_HAS_SCISSOR_RECT   = 1 << 1,
+        DRAW_IS_INDIRECT        = 1 << 2
+    };
+
+    struct StreamCommandHeader
+    {
+        StreamCommandType   type;
+        uint8_t             flags;
+        uint16_t            reserved;
+    };
+
+    // followed by the indirect arguments, bound vertex streams, constant inputs and image inputs in slot order, then viewport and scissor rect
+    struct PackedDrawCall
+    {
+        PipelineState   pipelineState;
+        Buffer          indexBuffer;
+        uint32_t        numElements;
+        uint32_t        elementOffset;
+        uint32_t        numInstances;
+        uint32_t        startVertexLocation;
+        uint32_t        startInstanceLocation;
+        uint16_t        imageMasks[NUM_SHADER_STAGES];      // vs, ps, gs, hs, ds
+        uint8_t         constantMasks[NUM_SHADER_STAGES];
+        uint8_t         vertexStreamMask;
+    };
+
+    struct PackedVertexStream
+    {
+        Buffer      buffer;
+        uint32_t    offset;
+        uint32_t    stride;
+    };
+
+    struct PackedConstantInput
+    {
+        Buffer      buffer;
+        uint32_t    offset;
+    };
+
+    struct PackedIndirectArgs
+    {
+        Buffer      buffer;
+        uint32_t    offset;
+        uint32_t    numDraws;
+    };
+
+    struct StageInputs
+    {
+        Image*      images[NUM_SHADER_STAGES];
+        Buffer*     constants[NUM_SHADER_STAGES];
+        uint32_t*   constantOffsets[NUM_SHADER_STAGES];     // nullptr for stages without offsets
+    };
+
+    static StageInputs GetStageInputs(DrawCall* drawCall)
+    {
+        return {
+            { drawCall->vsImageInputs, drawCall->psImageInputs, drawCall->gsImageInputs, drawCall->hsImageInputs, drawCall->dsImageInputs },
+            { drawCall->vsConstantInputs, drawCall->psConstantInputs, drawCall->gsConstantInputs, drawCall->hsConstantInputs, drawCall->dsConstantInputs },
+            { drawCall->vsConstantOffsets, drawCall->psConstantOffsets, nullptr, nullptr, nullptr }
+        };
+    }
+
+    static uint32_t CountBits(uint32_t mask)
+    {
+        uint32_t count = 0;
+        for (; mask != 0; mask &= mask - 1) {
+            count++;
+        }
+        return count;
+    }
+
+    template <class T>
+    static void Write(char** cursor, const T& value)
+    {
+        memcpy(*cursor, &value, sizeof(T));
+        *cursor += sizeof(T);
+    }
+
+    template <class T>
+    static void Read(const char** cursor, T* outValue)
+    {
+        memcpy(outValue, *cursor, sizeof(T));
+        *cursor += sizeof(T);
+    }
+
+    // returns where to write the payload, nullptr once the stream is full
+    static char* AppendCommand(CommandStream* stream, StreamCommandType type, uint8_t flags, size_t payloadSize)
+    {
+        size_t size = sizeof(StreamCommandHeader) + payloadSize;
+        if (stream->hasOverflowed || size > stream->capacity - stream->size) {
+            stream->hasOverflowed = true;
+            return nullptr;
+        }
+        char* cursor = stream->memory + stream->size;
+        StreamCommandHeader header = { type, flags, 0 };
+        Write(&cursor, header);
+        stream->size += size;
+        stream->numCommands++;
+        return cursor;
+    }
+
+    bool InitializeCommandStream(CommandStream* stream, size_t capacity, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        *stream = CommandStream();
+        if (capacity == 0) { return false; }
+        stream->memory = GT_NEW_ARRAY(char, capacity, memoryArena);
+        stream->capacity = capacity;
+        return true;
+    }
+
+    void ReleaseCommandStream(CommandStream* stream, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        if (stream->memory != nullptr) {
+            GT_DELETE_ARRAY(stream->memory, memoryArena);
+        }
+        *stream = CommandStream();
+    }
+
+    void ResetCommandStream(CommandStream* stream)
+    {
+        stream->size = 0;
+        stream->numCommands = 0;
+        stream->isInRenderPass = false;
+        stream->hasOverflowed = false;
+        stream->isMisused = false;
+    }
+
+    void RecordBeginDefaultRenderPass(CommandStream* stream, SwapChain swapChain, RenderPassAction* action)
+    {
+        stream->isMisused = stream->isMisused || stream->isInRenderPass;
+        stream->isInRenderPass = true;
+        char* cursor = AppendCommand(stream, StreamCommandType::CMD_BEGIN_DEFAULT_RENDER_PASS, 0, sizeof(SwapChain) + sizeof(RenderPassAction));
+        if (cursor == nullptr) { return; }
+        Write(&cursor, swapChain);
+        Write(&cursor, *action);
+    }
+
+    void RecordBeginRenderPass(CommandStream* stream, RenderPass renderPass, RenderPassAction* action)
+    {
+        stream->isMisused = stream->isMisused || stream->isInRenderPass;
+        stream->isInRenderPass = true;
+        char* cursor = AppendCommand(stream, StreamCommandType::CMD_BEGIN_RENDER_PASS, 0, sizeof(RenderPass) + sizeof(RenderPassAction));
+        if (cursor == nullptr) { return; }
+        Write(&cursor, renderPass);
+        Write(&cursor, *action);
+    }
+
+    static void RecordPackedDrawCall(CommandStream* stream, DrawCall* drawCall, PackedIndirectArgs* indirectArgs, Viewport* viewport, Rect* scissorRect)
+    {
+        if (!stream->isInRenderPass) {
+            stream->isMisused = true;
+            return;
+        }
+
+        PackedDrawCall packed;
+        packed.pipelineState = drawCall->pipelineState;
+        packed.indexBuffer = drawCall->indexBuffer;
+        packed.numElements = drawCall->numElements;
+        packed.elementOffset = drawCall->elementOffset;
+        packed.numInstances = drawCall->numInstances;
+        packed.startVertexLocation = drawCall->startVertexLocation;
+        packed.startInstanceLocation = drawCall->startInstanceLocation;
+        packed.vertexStreamMask = 0;
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            packed.vertexStreamMask |= GFX_CHECK_RESOURCE(drawCall->vertexBuffers[i]) ? (uint8_t)(1 << i) : 0;
+        }
+        size_t payloadSize = sizeof(PackedDrawCall) + CountBits(packed.vertexStreamMask) * sizeof(PackedVertexStream);
+
+        StageInputs stages = GetStageInputs(drawCall);
+        for (uint32_t stage = 0; stage < NUM_SHADER_STAGES; ++stage) {
+            packed.imageMasks[stage] = 0;
+            packed.constantMasks[stage] = 0;
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                packed.imageMasks[stage] |= GFX_CHECK_RESOURCE(stages.images[stage][i]) ? (uint16_t)(1 << i) : 0;
+            }
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                packed.constantMasks[stage] |= GFX_CHECK_RESOURCE(stages.constants[stage][i]) ? (uint8_t)(1 << i) : 0;
+            }
+            payloadSize += CountBits(packed.imageMasks[stage]) * sizeof(Image) + CountBits(packed.constantMasks[stage]) * sizeof(PackedConstantInput);
+        }
+
+        uint8_t flags = 0;
+        if (indirectArgs != nullptr) {
+            flags |= DRAW_IS_INDIRECT;
+            payloadSize += sizeof(PackedIndirectArgs);
+        }
+        if (viewport != nullptr) {
+            flags |= DRAW_HAS_VIEWPORT;
+            payloadSize += sizeof(Viewport);
+        }
+        if (scissorRect != nullptr) {
+            flags |= DRAW_HAS_SCISSOR_RECT;
+            payloadSize += sizeof(Rect);
+        }
+
+        char* cursor = AppendCommand(stream, StreamCommandType::CMD_DRAW, flags, payloadSize);
+        if (cursor == nullptr) { return; }
+        Write(&cursor, packed);
+        if (indirectArgs != nullptr) {
+            Write(&cursor, *indirectArgs);
+        }
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            if (!(packed.vertexStreamMask & (1 << i))) { continue; }
+            PackedVertexStream vertexStream = { drawCall->vertexBuffers[i], drawCall->vertexOffsets[i], drawCall->vertexStrides[i] };
+            Write(&cursor, vertexStream);
+        }
+        for (uint32_t stage = 0; stage < NUM_SHADER_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                if (!(packed.constantMasks[stage] & (1 << i))) { continue; }
+                PackedConstantInput constantInput = { stages.constants[stage][i], stages.constantOffsets[stage] != nullptr ? stages.constantOffsets[stage][i] : 0 };
+                Write(&cursor, constantInput);
+            }
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                if (!(packed.imageMasks[stage] & (1 << i))) { continue; }
+                Write(&cursor, stages.images[stage][i]);
+            }
+        }
+        if (viewport != nullptr) {
+            Write(&cursor, *viewport);
+        }
+        if (scissorRect != nullptr) {
+            Write(&cursor, *scissorRect);
+        }
+    }
+
+    void RecordDrawCall(CommandStream* stream, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    {
+        RecordPackedDrawCall(stream, drawCall, nullptr, viewport, scissorRect);
+    }
+
+    void RecordDrawIndirect(CommandStream* stream, DrawCall* drawCall, Buffer argsBuffer, uint32_t argsOffset, uint32_t numDraws, Viewport* viewport, Rect* scissorRect)
+    {
+        PackedIndirectArgs indirectArgs = { argsBuffer, argsOffset, numDraws };
+        RecordPackedDrawCall(stream, drawCall, &indirectArgs, viewport, scissorRect);
+    }
+
+    void RecordDrawItem(CommandStream* stream, DrawItem* drawItem, Viewport* viewport, Rect* scissorRect)
+    {
+        if (!stream->isInRenderPass) {
+            stream->isMisused = true;
+            return;
+        }
+
+        uint8_t flags = 0;
+        size_t payloadSize = sizeof(DrawItem);
+        if (viewport != nullptr) {
+            flags |= DRAW_HAS_VIEWPORT;
+            payloadSize += sizeof(Viewport);
+        }
+        if (scissorRect != nullptr) {
+            flags |= DRAW_HAS_SCISSOR_RECT;
+            payloadSize += sizeof(Rect);
+        }
+
+        char* cursor = AppendCommand(stream, StreamCommandType::CMD_DRAW_ITEM, flags, payloadSize);
+        if (cursor == nullptr) { return; }
+        Write(&cursor, *drawItem);
+        if (viewport != nullptr) {
+            Write(&cursor, *viewport);
+        }
+        if (scissorRect != nullptr) {
+            Write(&cursor, *scissorRect);
+        }
+    }
+
+    void RecordEndRenderPass(CommandStream* stream)
+    {
+        stream->isMisused = stream->isMisused || !stream->isInRenderPass;
+        stream->isInRenderPass = false;
+        AppendCommand(stream, StreamCommandType::CMD_END_RENDER_PASS, 0, 0);
+    }
+
+    static void ReplayDrawCall(Device* device, CommandBuffer cmdBuffer, const char** cursor, uint8_t flags)
+    {
+        PackedDrawCall packed;
+        Read(cursor, &packed);
+
+        DrawCall drawCall;
+        drawCall.pipelineState = packed.pipelineState;
+        drawCall.indexBuffer = packed.indexBuffer;
+        drawCall.numElements = packed.numElements;
+        drawCall.elementOffset = packed.elementOffset;
+        drawCall.numInstances = packed.numInstances;
+        drawCall.startVertexLocation = packed.startVertexLocation;
+        drawCall.startInstanceLocation = packed.startInstanceLocation;
+        PackedIndirectArgs indirectArgs;
+        if (flags & DRAW_IS_INDIRECT) {
+            Read(cursor, &indirectArgs);
+        }
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            drawCall.vertexOffsets[i] = 0;
+            drawCall.vertexStrides[i] = 0;
+            if (!(packed.vertexStreamMask & (1 << i))) { continue; }
+            PackedVertexStream vertexStream;
+            Read(cursor, &vertexStream);
+            drawCall.vertexBuffers[i] = vertexStream.buffer;
+            drawCall.vertexOffsets[i] = vertexStream.offset;
+            drawCall.vertexStrides[i] = vertexStream.stride;
+        }
+        StageInputs stages = GetStageInputs(&drawCall);
+        for (uint32_t stage = 0; stage < NUM_SHADER_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                if (!(packed.constantMasks[stage] & (1 << i))) { continue; }
+                PackedConstantInput constantInput;
+                Read(cursor, &constantInput);
+                stages.constants[stage][i] = constantInput.buffer;
+                if (stages.constantOffsets[stage] != nullptr) {
+                    stages.constantOffsets[stage][i] = constantInput.offset;
+                }
+            }
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                if (!(packed.imageMasks[stage] & (1 << i))) { continue; }
+                Read(cursor, &stages.images[stage][i]);
+            }
+        }
+        Viewport viewport;
+        Rect scissorRect;
+        if (flags & DRAW_HAS_VIEWPORT) {
+            Read(cursor, &viewport);
+        }
+        if (flags & DRAW_HAS_SCISSOR_RECT) {
+            Read(cursor, &scissorRect);
+        }
+        Viewport* viewportArg = (flags & DRAW_HAS_VIEWPORT) ? &viewport : nullptr;
+        Rect* scissorRectArg = (flags & DRAW_HAS_SCISSOR_RECT) ? &scissorRect : nullptr;
+        if (flags & DRAW_IS_INDIRECT) {
+            SubmitDrawIndirect(device, cmdBuffer, &drawCall, indirectArgs.buffer, indirectArgs.offset, indirectArgs.numDraws, viewportArg, scissorRectArg);
+        }
+        else {
+            SubmitDrawCall(device, cmdBuffer, &drawCall, viewportArg, scissorRectArg);
+        }
+    }
+
+    static void ReplayDrawItem(Device* device, CommandBuffer cmdBuffer, const char** cursor, uint8_t flags)
+    {
+        DrawItem drawItem;
+        Read(cursor, &drawItem);
+        Viewport viewport;
+        Rect scissorRect;
+        if (flags & DRAW_HAS_VIEWPORT) {
+            Read(cursor, &viewport);
+        }
+        if (flags & DRAW_HAS_SCISSOR_RECT) {
+            Read(cursor, &scissorRect);
+        }
+        SubmitDrawItem(device, cmdBuffer, &drawItem, (flags & DRAW_HAS_VIEWPORT) ? &viewport : nullptr, (flags & DRAW_HAS_SCISSOR_RECT) ? &scissorRect : nullptr);
+    }
+
+    bool ReplayCommandStream(Device* device, CommandBuffer cmdBuffer, CommandStream* stream)
+    {
+        if (stream->hasOverflowed || stream->isMisused || stream->isInRenderPass) {
+            GT_LOG_ERROR("Gfx", "Dropping %u recorded commands, %s", stream->numCommands,
+                stream->hasOverflowed ? "the command buffer ran out of memory" : "render passes weren't begun and ended in the same command buffer");
+            ResetCommandStream(stream);
+            return false;
+        }
+
+        const char* cursor = stream->memory;
+        const char* end = stream->memory + stream->size;
+        while (cursor < end) {
+            StreamCommandHeader header;
+            Read(&cursor, &header);
+            switch (header.type) {
+            case StreamCommandType::CMD_BEGIN_DEFAULT_RENDER_PASS: {
+                SwapChain swapChain;
+                RenderPassAction action;
+                Read(&cursor, &swapChain);
+                Read(&cursor, &action);
+                BeginDefaultRenderPass(device, cmdBuffer, swapChain, &action);
+            } break;
+            case StreamCommandType::CMD_BEGIN_RENDER_PASS: {
+                RenderPass renderPass;
+                RenderPassAction action;
+                Read(&cursor, &renderPass);
+                Read(&cursor, &action);
+                BeginRenderPass(device, cmdBuffer, renderPass, &action);
+            } break;
+            case StreamCommandType::CMD_DRAW: {
+                ReplayDrawCall(device, cmdBuffer, &cursor, header.flags);
+            } break;
+            case StreamCommandType::CMD_DRAW_ITEM: {
+                ReplayDrawItem(device, cmdBuffer, &cursor, header.flags);
+            } break;
+            case StreamCommandType::CMD_END_RENDER_PASS: {
+                EndRenderPass(device, cmdBuffer);
+            } break;
+            }
+        }
+        ResetCommandStream(stream);
+        return true;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "gfx.h"
+
+/**
+    Commands recorded by deferred command buffers, shared by all backends.
+    A stream is one block of memory allocated up front that commands are appended to linearly, so recording never
+    allocates and never touches the device: any thread can record into its own stream. Draw calls are packed to
+    the inputs they actually bind, draw items are stored as they are. Replaying goes through the regular gfx API on the immediate command buffer,
+    which validates and executes the commands as if they had been submitted there directly.
+*/
+
+namespace gfx
+{
+    struct CommandStream
+    {
+        char*       memory = nullptr;
+        size_t      capacity = 0;
+        size_t      size = 0;
+        uint32_t    numCommands = 0;
+        bool        isInRenderPass = false;
+        bool        hasOverflowed = false;  // commands were dropped, the stream won't be replayed
+        bool        isMisused = false;      // draws outside of a render pass or unbalanced passes
+    };
+
+    bool InitializeCommandStream(CommandStream* stream, size_t capacity, fnd::memory::MemoryArenaBase* memoryArena);
+    void ReleaseCommandStream(CommandStream* stream, fnd::memory::MemoryArenaBase* memoryArena);
+    void ResetCommandStream(CommandStream* stream);
+
+    void RecordBeginDefaultRenderPass(CommandStream* stream, SwapChain swapChain, RenderPassAction* action);
+    void RecordBeginRenderPass(CommandStream* stream, RenderPass renderPass, RenderPassAction* action);
+    void RecordDrawCall(CommandStream* stream, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect);
+    void RecordDrawIndirect(CommandStream* stream, DrawCall* drawCall, Buffer argsBuffer, uint32_t argsOffset, uint32_t numDraws, Viewport* viewport, Rect* scissorRect);
+    void RecordDrawItem(CommandStream* stream, DrawItem* drawItem, Viewport* viewport, Rect* scissorRect);
+    void RecordEndRenderPass(CommandStream* stream);
+
+    // executes the commands on cmdBuffer and resets the stream, nothing is executed if recording went wrong
+    bool ReplayCommandStream(Device* device, CommandBuffer cmdBuffer, CommandStream* stream);
+}
@@ -0,0 +1,72 @@
+#include "gfx.h"
+#include <cassert>
+
+// backend independent parts of the gfx API
+
+namespace gfx
+{
+    bool CreateConstantRing(Device* device, ConstantRing* outRing, uint32_t size)
+    {
+        BufferDesc desc;
+        desc.type = BufferType::BUFFER_TYPE_CONSTANT;
+        desc.usage = ResourceUsage::USAGE_STREAM;
+        desc.byteWidth = (size + GFX_CONSTANT_BUFFER_ALIGNMENT - 1) & ~(GFX_CONSTANT_BUFFER_ALIGNMENT - 1);
+        outRing->buffer = CreateBuffer(device, &desc);
+        if (!GFX_CHECK_RESOURCE(outRing->buffer)) {
+            return false;
+        }
+        outRing->size = (uint32_t)desc.byteWidth;
+        outRing->head = 0;
+        outRing->mapped = nullptr;
+        return true;
+    }
+
+    void DestroyConstantRing(Device* device, ConstantRing* ring)
+    {
+        assert(ring->mapped == nullptr);
+        DestroyBuffer(device, ring->buffer);
+        *ring = ConstantRing();
+    }
+
+    bool BeginConstantRing(Device* device, ConstantRing* ring)
+    {
+        assert(ring->mapped == nullptr);
+        ring->head = 0;
+        ring->mapped = (char*)MapBuffer(device, ring->buffer, MapType::MAP_WRITE_DISCARD);
+        return ring->mapped != nullptr;
+    }
+
+    void* AllocateConstants(ConstantRing* ring, uint32_t size, uint32_t* outOffset)
+    {
+        assert(ring->mapped != nullptr);
+        uint32_t alignedSize = (size + GFX_CONSTANT_BUFFER_ALIGNMENT - 1) & ~(GFX_CONSTANT_BUFFER_ALIGNMENT - 1);
+        if (alignedSize > ring->size - ring->head) {
+            return nullptr;
+        }
+        *outOffset = ring->head;
+        ring->head += alignedSize;
+        return ring->mapped + *outOffset;
+    }
+
+    void EndConstantRing(Device* device, ConstantRing* ring)
+    {
+        assert(ring->mapped != nullptr);
+        UnmapBuffer(device, ring->buffer);
+        ring->mapped = nullptr;
+    }
+
+    size_t GetImageMipSize(ImageDesc* desc, uint32_t mip)
+    {
+        size_t texelSize = 4;   // backends store the default format as R8G8B8A8_UNORM
+        switch (desc->pixelFormat) {
+        case PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT:
+        case PixelFormat::PIXEL_FORMAT_R16G16B16A16_UINT:
+        case PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT: texelSize = 8; break;
+        case PixelFormat::PIXEL_FORMAT_R32G32B32A32_FLOAT: texelSize = 16; break;
+        default: break;
+        }
+        size_t width = desc->width >> mip;
+        size_t height = desc->height >> mip;
+        return (width > 0 ? width : 1) * (height > 0 ? height : 1) * texelSize;
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 // @TODO remove dependency on this?
 namespace fnd {
@@ -17,8 +18,10 @@ namespace fnd {
 #define GFX_DEFAULT_SHADER_POOL_SIZE        1024
 #define GFX_DEFAULT_RENDER_PASS_POOL_SIZE   1024
 #define GFX_DEFAULT_CMD_BUFFER_POOL_SIZE    1024
+#define GFX_DEFAULT_BIND_GROUP_POOL_SIZE    4096
 #define GFX_DEFAULT_MAX_NUM_SWAPCHAINS      64
 #define GFX_DEFAULT_MAX_NUM_DEVICES         4
+#define GFX_DEFAULT_CMD_BUFFER_MEMORY_SIZE  (256 * 1024)
 
 #ifndef GFX_MAX_VERTEX_ATTRIBS
 #define GFX_MAX_VERTEX_ATTRIBS 8
@@ -40,6 +43,17 @@ namespace fnd {
 #define GFX_MAX_CONSTANT_INPUTS_PER_STAGE 4
 #endif
 
+#ifndef GFX_MAX_BIND_GROUPS
+#define GFX_MAX_BIND_GROUPS 4
+#endif
+
+#ifndef GFX_MAX_DYNAMIC_CONSTANT_OFFSETS
+#define GFX_MAX_DYNAMIC_CONSTANT_OFFSETS 4
+#endif
+
+// constant buffers can be bound starting at multiples of this many bytes
+#define GFX_CONSTANT_BUFFER_ALIGNMENT 256
+
 #define GFX_CHECK_RESOURCE(handle) (handle.id != gfx::INVALID_ID)
 
 
@@ -60,6 +74,7 @@ namespace gfx
     typedef struct { uint32_t id = INVALID_ID; } RenderPass;     // defines a complete render pass with all render targets, clear/resolve actions, etc
 
     typedef struct { uint32_t id = INVALID_ID; } CommandBuffer;  // wraps (or emulates) a command buffer for multithreaded command recording
+    typedef struct { uint32_t id = INVALID_ID; } BindGroup;      // immutable set of draw inputs, e.g. a material's images, shared by many draws
 
     typedef struct { uint32_t id = INVALID_ID; } SwapChain;      // wraps a swap chain (for multi window stuff)
 
@@ -71,7 +86,8 @@ namespace gfx
         USAGE_IMMUTABLE,      // data is never updated
         USAGE_DYNAMIC,        // data is updated infrequently
         USAGE_STREAM,         // data is updated at least once or multiple times per frame
-        USAGE_STAGING         // data can be read back by the CPU
+        USAGE_STAGING,        // data can be read back by the CPU
+        USAGE_COPY_DESTINATION  // data is only written by UpdateBuffer/UpdateImage, e.g. through an UploadQueue
     };
 
     enum class MapType : uint8_t
@@ -89,7 +105,8 @@ namespace gfx
         _DEFAULT = 0,
         BUFFER_TYPE_VERTEX,
         BUFFER_TYPE_INDEX,
-        BUFFER_TYPE_CONSTANT
+        BUFFER_TYPE_CONSTANT,
+        BUFFER_TYPE_INDIRECT_ARGS       // DrawIndirectArgs or DrawIndexedIndirectArgs read by SubmitDrawIndirect
     };
 
     enum class IndexFormat : uint8_t
@@ -174,6 +191,7 @@ namespace gfx
 
 
 
+    // pool sizes are initial capacities, pools grow when they run full
     struct InterfaceDesc
     {
         uint32_t    bufferPoolSize      = GFX_DEFAULT_BUFFER_POOL_SIZE;
@@ -182,6 +200,7 @@ namespace gfx
         uint32_t    shaderPoolSize      = GFX_DEFAULT_SHADER_POOL_SIZE;
         uint32_t    renderPassPoolSize  = GFX_DEFAULT_RENDER_PASS_POOL_SIZE;
         uint32_t    cmdBufferPoolSize   = GFX_DEFAULT_CMD_BUFFER_POOL_SIZE;
+        uint32_t    bindGroupPoolSize   = GFX_DEFAULT_BIND_GROUP_POOL_SIZE;
         uint32_t    maxNumSwapChains    = GFX_DEFAULT_MAX_NUM_SWAPCHAINS;
         uint32_t    maxNumDevices       = GFX_DEFAULT_MAX_NUM_DEVICES;
     };
@@ -237,6 +256,9 @@ namespace gfx
             uint16_t    numSlices = 1;
         //};
 
+        bool        isStreamed          = false;    // see SetImageResidentMips
+        uint16_t    firstResidentMip    = 0;        // of streamed images, kept up to date by GetImageDesc
+
         ResourceUsage   usage       = ResourceUsage::_DEFAULT;
         
         PixelFormat     pixelFormat = PixelFormat::_DEFAULT;
@@ -524,11 +546,95 @@ namespace gfx
         Buffer  gsConstantInputs[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
         Buffer  hsConstantInputs[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
         Buffer  dsConstantInputs[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+
+        // byte offsets of the data the shaders see within the constant inputs, multiples of GFX_CONSTANT_BUFFER_ALIGNMENT
+        uint32_t vsConstantOffsets[GFX_MAX_CONSTANT_INPUTS_PER_STAGE] = {};
+        uint32_t psConstantOffsets[GFX_MAX_CONSTANT_INPUTS_PER_STAGE] = {};
     };
     
+    /**
+        Arguments of one draw of SubmitDrawIndirect, tightly packed in a BUFFER_TYPE_INDIRECT_ARGS buffer.
+        Pipelines without index format read DrawIndirectArgs, indexed ones DrawIndexedIndirectArgs, laid out like
+        the arguments of the native indirect draws. Whatever fills them, e.g. a culling job writing to a mapped
+        buffer, can drop a draw by setting numInstances to 0.
+    */
+    struct DrawIndirectArgs
+    {
+        uint32_t numElements = 0;
+        uint32_t numInstances = 0;
+        uint32_t startVertexLocation = 0;
+        uint32_t startInstanceLocation = 0;
+    };
+
+    struct DrawIndexedIndirectArgs
+    {
+        uint32_t numElements = 0;
+        uint32_t numInstances = 0;
+        uint32_t elementOffset = 0;
+        int32_t  startVertexLocation = 0;
+        uint32_t startInstanceLocation = 0;
+    };
+
+    /**
+        Draw inputs that are set up once, per material, mesh or pass, and referenced by DrawItems instead of being copied
+        into every draw. The resources are validated when the group is created and the group can't change after that.
+        Vertex and pixel shader constants marked dynamic take their offsets from the DrawItem, for per object data in a ConstantRing.
+    */
+    struct BindGroupDesc
+    {
+        Buffer      vertexBuffers[GFX_MAX_VERTEX_STREAMS];
+        uint32_t    vertexOffsets[GFX_MAX_VERTEX_STREAMS] = {};
+        uint32_t    vertexStrides[GFX_MAX_VERTEX_STREAMS] = {};
+        Buffer      indexBuffer;
+
+        Image       vsImageInputs[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+        Image       psImageInputs[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+        Image       gsImageInputs[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+        Image       hsImageInputs[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+        Image       dsImageInputs[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+
+        Buffer      vsConstantInputs[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+        Buffer      psConstantInputs[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+        Buffer      gsConstantInputs[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+        Buffer      hsConstantInputs[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+        Buffer      dsConstantInputs[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+
+        uint32_t    vsConstantOffsets[GFX_MAX_CONSTANT_INPUTS_PER_STAGE] = {};
+        uint32_t    psConstantOffsets[GFX_MAX_CONSTANT_INPUTS_PER_STAGE] = {};
+        bool        vsDynamicConstants[GFX_MAX_CONSTANT_INPUTS_PER_STAGE] = {};
+        bool        psDynamicConstants[GFX_MAX_CONSTANT_INPUTS_PER_STAGE] = {};
+    };
+
+    /**
+        A draw that references its inputs through bind groups, a small fraction of the size of a DrawCall.
+        Groups are applied in order: a slot one group leaves empty can be filled by another, later groups win where they overlap.
+        Dynamic constants take the offsets in the same order, group by group and vertex shader slots before pixel shader slots.
+        Submitting draws with the same groups as the previous one reuses the inputs that were resolved for it.
+    */
+    struct DrawItem
+    {
+        PipelineState   pipelineState;
+        BindGroup       bindGroups[GFX_MAX_BIND_GROUPS];
+
+        uint32_t numElements = 0;
+        uint32_t elementOffset = 0;
+        uint32_t numInstances = 1;
+
+        uint32_t startVertexLocation = 0;
+        uint32_t startInstanceLocation = 0;
+
+        uint32_t dynamicConstantOffsets[GFX_MAX_DYNAMIC_CONSTANT_OFFSETS] = {};
+    };
+
+    /**
+        Command buffers created with CreateCommandBuffer are deferred: begin/end render pass and draw calls are only
+        recorded, into memory the buffer allocates up front, and nothing reaches the device until SubmitCommandBuffers.
+        Each buffer can be recorded on a different thread, as long as one buffer is only recorded on one thread at a time.
+        Render passes have to begin and end in the same buffer.
+    */
     struct CommandBufferDesc
     {
-        // @TODO
+        size_t  memorySize = GFX_DEFAULT_CMD_BUFFER_MEMORY_SIZE;   // recording more than fits drops the whole buffer at submit
     };
 
     struct SwapChainDesc
@@ -546,10 +652,13 @@ namespace gfx
     Shader CreateShader(Device* device, ShaderDesc* desc);
     RenderPass CreateRenderPass(Device* device, RenderPassDesc* desc);
     CommandBuffer CreateCommandBuffer(Device* device, CommandBufferDesc* desc);
+    BindGroup CreateBindGroup(Device* device, BindGroupDesc* desc);
     SwapChain CreateSwapChain(Device* device, SwapChainDesc* desc);
 
     void DestroyBuffer(Device* device, Buffer buffer);
     void DestroyImage(Device* device, Image image);
+    void DestroyCommandBuffer(Device* device, CommandBuffer cmdBuffer);
+    void DestroyBindGroup(Device* device, BindGroup bindGroup);
 
     BufferDesc GetBufferDesc(Device* device, Buffer buffer);
     ImageDesc GetImageDesc(Device* device, Image image);
@@ -581,12 +690,184 @@ namespace gfx
     void BeginRenderPass(Device* device, CommandBuffer cmdBuffer, RenderPass renderPass, RenderPassAction* action);
     // @NOTE might regret default arguments for viewport, scissor rect
     void SubmitDrawCall(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Viewport* viewport = nullptr, Rect* scissorRect = nullptr);
+    void SubmitDrawItem(Device* device, CommandBuffer cmdBuffer, DrawItem* drawItem, Viewport* viewport = nullptr, Rect* scissorRect = nullptr);
+    // draws in order with a shared viewport and scissor rect, command buffer and render pass are only checked once
+    void SubmitDrawCalls(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCalls, uint32_t numDrawCalls, Viewport* viewport = nullptr, Rect* scissorRect = nullptr);
+    /**
+        Binds drawCall's inputs once and issues numDraws draws with the arguments in argsBuffer, starting at byte argsOffset,
+        which has to be a multiple of 4. The element and instance counts of drawCall are ignored.
+        Arguments are read when the draws execute, for deferred command buffers that's when they are submitted.
+    */
+    void SubmitDrawIndirect(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Buffer argsBuffer, uint32_t argsOffset, uint32_t numDraws,
+        Viewport* viewport = nullptr, Rect* scissorRect = nullptr);
     void EndRenderPass(Device* device, CommandBuffer cmdBuffer);
 
+    // executes deferred command buffers in order on the immediate command buffer and resets them for recording again
+    void SubmitCommandBuffers(Device* device, CommandBuffer* cmdBuffers, uint32_t numCmdBuffers);
+
     void PresentSwapChain(Device* device, SwapChain swapChain);
 
+    /**
+        What draw submission bound over a frame. Draws only rebind state that differs from what the previous draw
+        on the same command buffer left bound, numSkippedBindings counts the bindings of draws that were already in place.
+        Slot counters count slots, a range of changed slots may be bound with a single call.
+    */
+    struct StateChangeStats
+    {
+        uint32_t    numDrawCalls = 0;
+        uint32_t    numPipelineChanges = 0;
+        uint32_t    numRenderTargetChanges = 0;
+        uint32_t    numViewportChanges = 0;
+        uint32_t    numScissorChanges = 0;
+        uint32_t    numVertexBufferChanges = 0;
+        uint32_t    numIndexBufferChanges = 0;
+        uint32_t    numConstantChanges = 0;
+        uint32_t    numImageChanges = 0;
+        uint32_t    numSkippedBindings = 0;
+    };
+
+    // counters of the last frame, frames end when a swap chain is presented
+    void GetStateChangeStats(Device* device, StateChangeStats* outStats);
+
+    struct ResourcePoolStats
+    {
+        uint32_t    numUsed = 0;
+        uint32_t    peakUsed = 0;       // since the interface was created
+        uint32_t    capacity = 0;       // slots allocated so far
+        uint32_t    maxCapacity = 0;    // the pool can't grow past this
+    };
+
+    // occupancy of the resource pools, they are shared by all devices of an interface
+    struct ResourceStats
+    {
+        ResourcePoolStats   buffers;
+        ResourcePoolStats   images;
+        ResourcePoolStats   pipelineStates;
+        ResourcePoolStats   shaders;
+        ResourcePoolStats   renderPasses;
+        ResourcePoolStats   cmdBuffers;
+        ResourcePoolStats   bindGroups;
+        ResourcePoolStats   swapChains;
+    };
+
+    void GetResourceStats(Device* device, ResourceStats* outStats);
+
+    /**
+        Pipeline states are cached by content: creating one for a desc that matches an existing pipeline state, with
+        shaders of identical code, returns the existing handle. Blend, raster and depth stencil states and input layouts
+        are shared between pipeline states where the backend has such objects.
+        The keys can be saved, e.g. to disk on shutdown, and used to create the pipeline states of the next run up front,
+        as soon as its shaders are created.
+    */
+    struct PipelineCacheStats
+    {
+        uint32_t    numPipelineStates = 0;
+        uint32_t    numHits = 0;
+        uint32_t    numMisses = 0;              // pipeline states that had to be created
+        uint32_t    numSharedSubStates = 0;     // sub-state objects reused instead of created
+    };
+
+    void GetPipelineCacheStats(Device* device, PipelineCacheStats* outStats);
+    // returns the size of the keys in bytes, they are only written if they fit into bufferSize
+    size_t SavePipelineCache(Device* device, void* buffer, size_t bufferSize);
+    // creates the pipeline states of saved keys whose shaders exist, returns how many were created
+    uint32_t WarmPipelineCache(Device* device, const void* data, size_t size);
+
 
     void*   MapBuffer(Device* device, Buffer buffer, MapType mapType);
     void    UnmapBuffer(Device* device, Buffer buffer);
 
+    /**
+        Streamed images keep only their smaller mips in memory, from firstResidentMip down to the smallest one, and
+        can change that without changing the image handle, so bind groups using them stay valid. Only resident mips
+        are sampled, mips that become resident are undefined until data is copied into them.
+        Streamed images are 2D images with a single slice that aren't render targets, their initial data starts at
+        firstResidentMip. Both functions run on the device right away, outside of render passes.
+    */
+    // reallocates the image, mips that stay resident keep their contents
+    bool    SetImageResidentMips(Device* device, Image image, uint32_t firstResidentMip);
+    // fills a resident mip from a USAGE_STAGING buffer that isn't mapped, rows are tightly packed
+    bool    CopyBufferToImage(Device* device, Buffer source, size_t sourceOffset, Image image, uint32_t mip);
+    // bytes of one slice of a mip with tightly packed rows
+    size_t  GetImageMipSize(ImageDesc* desc, uint32_t mip);
+
+    /**
+        Copy CPU memory into USAGE_COPY_DESTINATION resources, on the device right away and outside of render passes.
+        Images are 2D images with a single slice, the data is one whole mip with tightly packed rows. Streamed images
+        can be updated as well, in their resident mips.
+    */
+    bool    UpdateBuffer(Device* device, Buffer buffer, size_t offset, const void* data, size_t size);
+    bool    UpdateImage(Device* device, Image image, uint32_t mip, const void* data, size_t size);
+
+    /**
+        Constant data for a frame, allocated linearly from one large dynamic constant buffer that is mapped once per
+        frame and bound with offsets by draw calls. Every frame maps the buffer with MAP_WRITE_DISCARD, so the driver
+        hands out fresh memory while previous frames are still in flight, which makes it a ring of whole frames.
+        Backends that can't bind constants with offsets keep the ring in CPU memory and copy the constants a draw
+        sees into a constant buffer of their own before the draw.
+    */
+    struct ConstantRing
+    {
+        Buffer      buffer;
+        uint32_t    size = 0;
+        uint32_t    head = 0;
+        char*       mapped = nullptr;
+    };
+
+    bool    CreateConstantRing(Device* device, ConstantRing* outRing, uint32_t size);
+    void    DestroyConstantRing(Device* device, ConstantRing* ring);
+    bool    BeginConstantRing(Device* device, ConstantRing* ring);
+    // returns memory for size bytes, aligned for binding, or nullptr if the ring is full for this frame
+    void*   AllocateConstants(ConstantRing* ring, uint32_t size, uint32_t* outOffset);
+    // has to be called before any draw call using this frame's constants is submitted
+    void    EndConstantRing(Device* device, ConstantRing* ring);
+
+    /**
+        Uploads of resource data that don't block the thread creating the resources. Loader threads create
+        USAGE_COPY_DESTINATION buffers and images without initial data, write the data into a persistent staging ring
+        and submit it. The render thread processes the queue at the start of every frame, which copies submitted data
+        into the resources in order, up to maxBytesPerFrame, and frees the ring space again.
+        Every upload has a fence. Once it is complete, the resource holds the data and can be drawn with.
+        Allocating and submitting lock the queue and can be called from any thread. Every allocated upload has to be
+        submitted or canceled, later ones wait for it.
+        Uploads into streamed images make their mips resident right before the copy, see SetImageResidentMips, so
+        mips never become visible before their data is in.
+    */
+    struct UploadQueue;
+    typedef uint64_t UploadFence;   // increasing in allocation order, 0 is never handed out and always complete
+
+    struct UploadQueueDesc
+    {
+        size_t      ringSize = 64 * 1024 * 1024;
+        uint32_t    maxUploads = 1024;                  // allocated but not yet copied
+        size_t      maxBytesPerFrame = 16 * 1024 * 1024; // at least one upload is copied per frame
+    };
+
+    struct UploadQueueStats
+    {
+        size_t      ringSize = 0;
+        size_t      usedBytes = 0;                      // of the ring, including padding at its end
+        uint32_t    numPending = 0;                     // allocated but not yet copied
+
+        // of the last ProcessUploads
+        uint32_t    numCopies = 0;
+        size_t      copiedBytes = 0;
+        uint32_t    numFailedAllocations = 0;           // since the last ProcessUploads, the ring or the upload list was full
+    };
+
+    bool        CreateUploadQueue(Device* device, UploadQueue** outQueue, UploadQueueDesc* desc, fnd::memory::MemoryArenaBase* memoryArena);
+    // uploads that weren't processed yet are dropped
+    void        DestroyUploadQueue(UploadQueue* queue);
+    // returns size bytes of the ring to fill, nullptr if it doesn't fit right now
+    void*       AllocateUpload(UploadQueue* queue, size_t size, UploadFence* outFence);
+    void        SubmitBufferUpload(UploadQueue* queue, UploadFence fence, Buffer buffer, size_t offset);
+    // the allocation holds the data of numMips consecutive mips, see UpdateImage
+    void        SubmitImageUpload(UploadQueue* queue, UploadFence fence, Image image, uint32_t firstMip, uint32_t numMips);
+    // before or after submitting, e.g. when the data couldn't be read or the resource is destroyed. the fence still completes
+    void        CancelUpload(UploadQueue* queue, UploadFence fence);
+    // render thread only, outside of render passes, returns the number of uploads that were copied
+    uint32_t    ProcessUploads(UploadQueue* queue);
+    bool        IsUploadComplete(UploadQueue* queue, UploadFence fence);
+    void        GetUploadQueueStats(UploadQueue* queue, UploadQueueStats* outStats);
+
 }
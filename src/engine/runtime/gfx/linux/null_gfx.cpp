@@ -0,0 +1,1115 @@
+#ifndef GT_GFX_SOFTWARE
+
+#include "null_gfx.h"
+#include "../command_stream.h"
+#include "../state_cache.h"
+#include "../bind_group.h"
+#include "../resource_pool.h"
+#include "../pipeline_cache.h"
+#include <foundation/memory/memory.h>
+#include <foundation/logging/logging.h>
+#include <cassert>
+#include <string.h>
+
+// @NOTE validation errors don't stop the call unless it couldn't go on, like the D3D11 debug layer
+#define VALIDATION_ERROR(device, ...) do { (device)->stats.numValidationErrors++; GT_LOG_ERROR("NullGfx", __VA_ARGS__); } while (0)
+
+namespace gfx
+{
+    struct NullBuffer
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        BufferDesc      desc;
+        char*           data = nullptr;     // what maps hand out
+        bool            isMapped = false;
+    };
+
+    struct NullImage
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        ImageDesc       desc;
+    };
+
+    struct NullShader
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        ShaderDesc      desc;
+    };
+
+    struct NullPipelineState
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        PipelineStateDesc desc;
+    };
+
+    struct NullRenderPass
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        RenderPassDesc  desc;
+    };
+
+    struct NullCommandBuffer
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        bool            isInRenderPass = false;
+        RenderPass      renderPass;                 // invalid for default render passes
+        uint32_t        width = 0;                  // of the render pass, what draws without viewport cover
+        uint32_t        height = 0;
+        bool            isDeferred = false;
+        CommandStream   stream;
+        StateCache      stateCache;                 // what a GPU backend would have bound, for the state change counters
+    };
+
+    struct NullBindGroup
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        BindGroupData   data;
+    };
+
+    struct NullSwapChain
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        SwapChainDesc   desc;
+    };
+
+    static void NullReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, NullBuffer* buffer)
+    {
+        if (buffer->data != nullptr) {
+            GT_DELETE_ARRAY(buffer->data, memoryArena);
+            buffer->data = nullptr;
+        }
+        buffer->isMapped = false;
+    }
+
+    static void NullReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, NullCommandBuffer* cmdBuffer)
+    {
+        ReleaseCommandStream(&cmdBuffer->stream, memoryArena);
+    }
+
+    template <class TResource>
+    static void NullReleaseResource(fnd::memory::MemoryArenaBase*, TResource*)
+    {
+        // nothing held besides the description
+    }
+
+    struct Interface
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+
+        ResourcePool<NullBuffer, NullReleaseResource>           bufferPool;
+        ResourcePool<NullImage, NullReleaseResource>            imagePool;
+        ResourcePool<NullPipelineState, NullReleaseResource>    pipelineStatePool;
+        ResourcePool<NullShader, NullReleaseResource>           shaderPool;
+        ResourcePool<NullRenderPass, NullReleaseResource>       passPool;
+        ResourcePool<NullCommandBuffer, NullReleaseResource>    cmdBufferPool;
+        ResourcePool<NullBindGroup, NullReleaseResource>        bindGroupPool;
+        ResourcePool<NullSwapChain, NullReleaseResource>        swapChainPool;
+
+        Device*     deviceList = nullptr;
+        uint32_t    numDevices = 0;
+    };
+
+    struct Device
+    {
+        Interface*          interf = nullptr;
+        DeviceInfo          info;
+        bool                isCreated = false;
+        CommandBuffer       immediateCmdBuffer;
+
+        bool                isRecording = true;
+        RecordedCommand*    commands = nullptr;
+        size_t              numCommands = 0;
+        size_t              commandCapacity = 0;
+        DrawCall*           drawCalls = nullptr;
+        size_t              numDrawCalls = 0;
+        size_t              drawCallCapacity = 0;
+
+        NullDeviceStats     stats;
+        StateChangeStats    stateChangeStats;
+        StateChangeStats    lastFrameStateChangeStats;
+        ResolvedDrawInputs  resolvedDrawInputs;     // of the draw items submitted to the immediate command buffer
+        PipelineCache       pipelineCache;
+    };
+
+    bool CreateInterface(Interface** outInterface, InterfaceDesc* desc, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        Interface* interf = GT_NEW(Interface, memoryArena);
+        *outInterface = interf;
+
+        interf->memoryArena = memoryArena;
+
+        // a single device that is always there
+        interf->deviceList = GT_NEW_ARRAY(Device, 1, memoryArena);
+        interf->deviceList[0].interf = interf;
+        interf->deviceList[0].info.index = 0;
+        strncpy(interf->deviceList[0].info.friendlyName, "Null device", GFX_DEVICE_INFO_NAME_LEN - 1);
+        interf->numDevices = 1;
+
+        bool poolsInitialized = interf->bufferPool.Initialize(desc->bufferPoolSize, memoryArena, "Buffer")
+            && interf->imagePool.Initialize(desc->imagePoolSize, memoryArena, "Image")
+            && interf->pipelineStatePool.Initialize(desc->pipelinePoolSize, memoryArena, "Pipeline state")
+            && interf->shaderPool.Initialize(desc->shaderPoolSize, memoryArena, "Shader")
+            && interf->passPool.Initialize(desc->renderPassPoolSize, memoryArena, "Render pass")
+            && interf->cmdBufferPool.Initialize(desc->cmdBufferPoolSize, memoryArena, "Command buffer")
+            && interf->bindGroupPool.Initialize(desc->bindGroupPoolSize, memoryArena, "Bind group")
+            && interf->swapChainPool.Initialize(desc->maxNumSwapChains, memoryArena, "Swap chain");
+
+        return poolsInitialized;
+    }
+
+    void EnumerateDevices(Interface* interf, DeviceInfo* outInfo, uint32_t* numDevices)
+    {
+        *numDevices = interf->numDevices;
+        for (uint32_t i = 0; i < *numDevices; ++i) {
+            outInfo[i] = interf->deviceList[i].info;
+        }
+    }
+
+    Device* GetDevice(Interface* interf, uint32_t index)
+    {
+        if (index >= interf->numDevices) { return nullptr; }
+        Device* device = &interf->deviceList[index];
+        if (device->isCreated) { return device; }
+
+        NullCommandBuffer* immediateBuffer;
+        if (!interf->cmdBufferPool.Allocate(&immediateBuffer, &device->immediateCmdBuffer.id)) {
+            return nullptr;
+        }
+        immediateBuffer->associatedDevice = device;
+        immediateBuffer->resState = _ResourceState::STATE_VALID;
+        InvalidateStateCache(&immediateBuffer->stateCache);
+        InvalidateResolvedDrawInputs(&device->resolvedDrawInputs);
+        InitializePipelineCache(&device->pipelineCache, interf->memoryArena);
+        device->isCreated = true;
+        return device;
+    }
+
+    CommandBuffer GetImmediateCommandBuffer(Device* device)
+    {
+        return device->immediateCmdBuffer;
+    }
+
+    //
+    //
+
+    static RecordedCommand* RecordCommand(Device* device, RecordedCommandType type)
+    {
+        device->stats.numCommands++;
+        if (!device->isRecording) { return nullptr; }
+        if (device->numCommands == device->commandCapacity) {
+            size_t capacity = device->commandCapacity > 0 ? device->commandCapacity * 2 : 1024;
+            RecordedCommand* commands = GT_NEW_ARRAY(RecordedCommand, capacity, device->interf->memoryArena);
+            if (device->commands != nullptr) {
+                memcpy(commands, device->commands, sizeof(RecordedCommand) * device->numCommands);
+                GT_DELETE_ARRAY(device->commands, device->interf->memoryArena);
+            }
+            device->commands = commands;
+            device->commandCapacity = capacity;
+        }
+        RecordedCommand* command = &device->commands[device->numCommands++];
+        *command = RecordedCommand();
+        command->type = type;
+        return command;
+    }
+
+    static uint32_t RecordDrawCall(Device* device, DrawCall* drawCall)
+    {
+        if (device->numDrawCalls == device->drawCallCapacity) {
+            size_t capacity = device->drawCallCapacity > 0 ? device->drawCallCapacity * 2 : 1024;
+            DrawCall* drawCalls = GT_NEW_ARRAY(DrawCall, capacity, device->interf->memoryArena);
+            if (device->drawCalls != nullptr) {
+                memcpy(drawCalls, device->drawCalls, sizeof(DrawCall) * device->numDrawCalls);
+                GT_DELETE_ARRAY(device->drawCalls, device->interf->memoryArena);
+            }
+            device->drawCalls = drawCalls;
+            device->drawCallCapacity = capacity;
+        }
+        device->drawCalls[device->numDrawCalls] = *drawCall;
+        return (uint32_t)device->numDrawCalls++;
+    }
+
+    void SetCommandRecording(Device* device, bool isEnabled)
+    {
+        device->isRecording = isEnabled;
+    }
+
+    const RecordedCommand* GetRecordedCommands(Device* device, size_t* outNumCommands)
+    {
+        *outNumCommands = device->numCommands;
+        return device->commands;
+    }
+
+    const DrawCall* GetRecordedDrawCalls(Device* device, size_t* outNumDrawCalls)
+    {
+        *outNumDrawCalls = device->numDrawCalls;
+        return device->drawCalls;
+    }
+
+    void GetNullDeviceStats(Device* device, NullDeviceStats* outStats)
+    {
+        *outStats = device->stats;
+    }
+
+    void ResetRecording(Device* device)
+    {
+        device->numCommands = 0;
+        device->numDrawCalls = 0;
+        device->stats = NullDeviceStats();
+    }
+
+    //
+    //
+
+    Buffer CreateBuffer(Device* device, BufferDesc* desc)
+    {
+        if (desc->byteWidth == 0) {
+            VALIDATION_ERROR(device, "Buffer of type %i with size 0", (int)desc->type);
+            return { INVALID_ID };
+        }
+        ResourceUsage usage = desc->usage == ResourceUsage::_DEFAULT ? ResourceUsage::USAGE_IMMUTABLE : desc->usage;
+        if (usage == ResourceUsage::USAGE_IMMUTABLE && desc->initialData == nullptr) {
+            VALIDATION_ERROR(device, "Immutable buffer of %llu bytes without initial data", (unsigned long long)desc->byteWidth);
+            return { INVALID_ID };
+        }
+        if (desc->initialData != nullptr && desc->initialDataSize > desc->byteWidth) {
+            VALIDATION_ERROR(device, "Initial data of %llu bytes doesn't fit a buffer of %llu bytes", (unsigned long long)desc->initialDataSize, (unsigned long long)desc->byteWidth);
+            return { INVALID_ID };
+        }
+
+        NullBuffer* buffer = nullptr;
+        Buffer result;
+        if (!device->interf->bufferPool.Allocate(&buffer, &result.id)) {
+            return { INVALID_ID };
+        }
+        buffer->desc = *desc;
+        buffer->desc.usage = usage;
+        buffer->desc.initialData = nullptr;
+        buffer->desc.initialDataSize = 0;
+        buffer->data = GT_NEW_ARRAY(char, desc->byteWidth, device->interf->memoryArena);
+        if (desc->initialData != nullptr) {
+            memcpy(buffer->data, desc->initialData, desc->initialDataSize);
+        }
+        buffer->associatedDevice = device;
+        buffer->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    Image CreateImage(Device* device, ImageDesc* desc)
+    {
+        if (desc->width == 0 || desc->height == 0) {
+            VALIDATION_ERROR(device, "Image with size %ix%i", desc->width, desc->height);
+            return { INVALID_ID };
+        }
+        if (desc->isRenderTarget && desc->isDepthStencilTarget) {
+            VALIDATION_ERROR(device, "Image of %ix%i can't be both render target and depth stencil target", desc->width, desc->height);
+            return { INVALID_ID };
+        }
+        if (desc->isStreamed && (desc->type != ImageType::IMAGE_TYPE_2D || desc->numSlices != 1 || desc->isRenderTarget
+            || desc->isDepthStencilTarget || desc->firstResidentMip >= desc->numMipmaps)) {
+            VALIDATION_ERROR(device, "Streamed image of %ix%i has to be a 2D image with resident mips", desc->width, desc->height);
+            return { INVALID_ID };
+        }
+
+        NullImage* image = nullptr;
+        Image result;
+        if (!device->interf->imagePool.Allocate(&image, &result.id)) {
+            return { INVALID_ID };
+        }
+        image->desc = *desc;
+        // @NOTE the pointers in the description belong to the caller and don't outlive this call
+        image->desc.samplerDesc = nullptr;
+        image->desc.numDataItems = 0;
+        image->desc.initialData = nullptr;
+        image->desc.initialDataSizes = nullptr;
+        image->desc.firstResidentMip = desc->isStreamed ? desc->firstResidentMip : 0;
+        image->associatedDevice = device;
+        image->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    Shader CreateShader(Device* device, ShaderDesc* desc)
+    {
+        if (desc->type == ShaderType::_DEFAULT || desc->code == nullptr || desc->codeSize == 0) {
+            VALIDATION_ERROR(device, "Shader of type %i without code", (int)desc->type);
+            return { INVALID_ID };
+        }
+
+        NullShader* shader = nullptr;
+        Shader result;
+        if (!device->interf->shaderPool.Allocate(&shader, &result.id)) {
+            return { INVALID_ID };
+        }
+        shader->desc = *desc;
+        shader->desc.code = nullptr;
+        shader->associatedDevice = device;
+        shader->resState = _ResourceState::STATE_VALID;
+        RegisterShader(&device->pipelineCache, result, desc);
+        return result;
+    }
+
+    static bool ValidateShader(Device* device, Shader handle, ShaderType type, bool isRequired)
+    {
+        if (!GFX_CHECK_RESOURCE(handle)) {
+            if (isRequired) {
+                VALIDATION_ERROR(device, "Pipeline state is missing a required shader of type %i", (int)type);
+            }
+            return !isRequired;
+        }
+        NullShader* shader = device->interf->shaderPool.Get(handle.id);
+        if (shader == nullptr || shader->desc.type != type) {
+            VALIDATION_ERROR(device, "Pipeline state uses invalid shader 0x%08x or one of the wrong type", handle.id);
+            return false;
+        }
+        return true;
+    }
+
+    PipelineState CreatePipelineState(Device* device, PipelineStateDesc* desc)
+    {
+        bool isValid = ValidateShader(device, desc->vertexShader, ShaderType::SHADER_TYPE_VS, true);
+        isValid = ValidateShader(device, desc->pixelShader, ShaderType::SHADER_TYPE_PS, true) && isValid;
+        isValid = ValidateShader(device, desc->geometryShader, ShaderType::SHADER_TYPE_GS, false) && isValid;
+        isValid = ValidateShader(device, desc->hullShader, ShaderType::SHADER_TYPE_HS, false) && isValid;
+        isValid = ValidateShader(device, desc->domainShader, ShaderType::SHADER_TYPE_DS, false) && isValid;
+        if (!isValid) { return { INVALID_ID }; }
+
+        PipelineKey key;
+        bool isCacheable = BuildPipelineKey(&device->pipelineCache, desc, &key);
+        if (isCacheable) {
+            PipelineState cached = FindPipelineState(&device->pipelineCache, &key);
+            if (GFX_CHECK_RESOURCE(cached)) { return cached; }
+        }
+
+        NullPipelineState* pipelineState = nullptr;
+        PipelineState result;
+        if (!device->interf->pipelineStatePool.Allocate(&pipelineState, &result.id)) {
+            return { INVALID_ID };
+        }
+        pipelineState->desc = *desc;
+        pipelineState->associatedDevice = device;
+        pipelineState->resState = _ResourceState::STATE_VALID;
+
+        PipelineState cached = isCacheable ? AddPipelineState(&device->pipelineCache, &key, result) : result;
+        if (cached.id != result.id) {
+            device->interf->pipelineStatePool.Free(result.id);   // another thread created the same one
+        }
+        return cached;
+    }
+
+    RenderPass CreateRenderPass(Device* device, RenderPassDesc* desc)
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        bool hasAttachment = false;
+        for (size_t i = 0; i < GFX_MAX_COLOR_ATTACHMENTS + 1; ++i) {
+            Image handle = i < GFX_MAX_COLOR_ATTACHMENTS ? desc->colorAttachments[i].image : desc->depthStencilAttachment.image;
+            if (!GFX_CHECK_RESOURCE(handle)) { continue; }
+            NullImage* image = device->interf->imagePool.Get(handle.id);
+            bool isDepth = i == GFX_MAX_COLOR_ATTACHMENTS;
+            if (image == nullptr || (isDepth ? !image->desc.isDepthStencilTarget : !image->desc.isRenderTarget)) {
+                VALIDATION_ERROR(device, "Render pass attachment %i is not a valid %s target", (int)i, isDepth ? "depth stencil" : "render");
+                return { INVALID_ID };
+            }
+            if (hasAttachment && (image->desc.width != width || image->desc.height != height)) {
+                VALIDATION_ERROR(device, "Render pass attachment %i differs in size from the others", (int)i);
+                return { INVALID_ID };
+            }
+            width = image->desc.width;
+            height = image->desc.height;
+            hasAttachment = true;
+        }
+        if (!hasAttachment) {
+            VALIDATION_ERROR(device, "Render pass without attachments (%i color slots)", (int)GFX_MAX_COLOR_ATTACHMENTS);
+            return { INVALID_ID };
+        }
+
+        NullRenderPass* renderPass = nullptr;
+        RenderPass result;
+        if (!device->interf->passPool.Allocate(&renderPass, &result.id)) {
+            return { INVALID_ID };
+        }
+        renderPass->desc = *desc;
+        renderPass->associatedDevice = device;
+        renderPass->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    CommandBuffer CreateCommandBuffer(Device* device, CommandBufferDesc* desc)
+    {
+        NullCommandBuffer* cmdBuffer = nullptr;
+        CommandBuffer result;
+        if (!device->interf->cmdBufferPool.Allocate(&cmdBuffer, &result.id)) {
+            return { INVALID_ID };
+        }
+        if (!InitializeCommandStream(&cmdBuffer->stream, desc->memorySize, device->interf->memoryArena)) {
+            VALIDATION_ERROR(device, "Command buffer with %llu bytes of memory", (unsigned long long)desc->memorySize);
+            device->interf->cmdBufferPool.Free(result.id);
+            return { INVALID_ID };
+        }
+        cmdBuffer->isDeferred = true;
+        cmdBuffer->associatedDevice = device;
+        cmdBuffer->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    BindGroup CreateBindGroup(Device* device, BindGroupDesc* desc)
+    {
+        if (!ValidateBindGroupDesc(device, desc)) {
+            VALIDATION_ERROR(device, "Bind group with invalid inputs");
+            return { INVALID_ID };
+        }
+
+        NullBindGroup* bindGroup = nullptr;
+        BindGroup result;
+        if (!device->interf->bindGroupPool.Allocate(&bindGroup, &result.id)) {
+            return { INVALID_ID };
+        }
+        InitializeBindGroupData(&bindGroup->data, desc);
+        bindGroup->associatedDevice = device;
+        bindGroup->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    SwapChain CreateSwapChain(Device* device, SwapChainDesc* desc)
+    {
+        if (desc->width == 0 || desc->height == 0) {
+            VALIDATION_ERROR(device, "Swap chain with size %ux%u", desc->width, desc->height);
+            return { INVALID_ID };
+        }
+
+        NullSwapChain* swapChain = nullptr;
+        SwapChain result;
+        if (!device->interf->swapChainPool.Allocate(&swapChain, &result.id)) {
+            return { INVALID_ID };
+        }
+        swapChain->desc = *desc;
+        swapChain->associatedDevice = device;
+        swapChain->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    void ResizeSwapChain(Device* device, SwapChain handle, uint32_t width, uint32_t height)
+    {
+        NullSwapChain* swapChain = device->interf->swapChainPool.Get(handle.id);
+        if (swapChain == nullptr) {
+            VALIDATION_ERROR(device, "Resizing invalid swap chain 0x%08x", handle.id);
+            return;
+        }
+        swapChain->desc.width = width;
+        swapChain->desc.height = height;
+    }
+
+    void DestroyBuffer(Device* device, Buffer buffer)
+    {
+        NullBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj != nullptr && bufferObj->isMapped) {
+            VALIDATION_ERROR(device, "Destroying buffer 0x%08x while it is mapped", buffer.id);
+        }
+        if (!device->interf->bufferPool.Free(buffer.id)) {
+            VALIDATION_ERROR(device, "Destroying invalid buffer 0x%08x", buffer.id);
+        }
+    }
+
+    void DestroyImage(Device* device, Image image)
+    {
+        if (!device->interf->imagePool.Free(image.id)) {
+            VALIDATION_ERROR(device, "Destroying invalid image 0x%08x", image.id);
+        }
+    }
+
+    void DestroyCommandBuffer(Device* device, CommandBuffer cmdBuffer)
+    {
+        NullCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (cmdBuf == nullptr || !cmdBuf->isDeferred) {
+            VALIDATION_ERROR(device, "Destroying invalid or immediate command buffer 0x%08x", cmdBuffer.id);
+            return;
+        }
+        device->interf->cmdBufferPool.Free(cmdBuffer.id);
+    }
+
+    void DestroyBindGroup(Device* device, BindGroup bindGroup)
+    {
+        if (!device->interf->bindGroupPool.Free(bindGroup.id)) {
+            VALIDATION_ERROR(device, "Destroying invalid bind group 0x%08x", bindGroup.id);
+        }
+    }
+
+    BufferDesc GetBufferDesc(Device* device, Buffer buffer)
+    {
+        NullBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        return bufferObj != nullptr ? bufferObj->desc : BufferDesc();
+    }
+
+    ImageDesc GetImageDesc(Device* device, Image image)
+    {
+        NullImage* imageObj = device->interf->imagePool.Get(image.id);
+        return imageObj != nullptr ? imageObj->desc : ImageDesc();
+    }
+
+    PipelineStateDesc GetPipelineStateDesc(Device* device, PipelineState pipelineState)
+    {
+        NullPipelineState* pipelineStateObj = device->interf->pipelineStatePool.Get(pipelineState.id);
+        return pipelineStateObj != nullptr ? pipelineStateObj->desc : PipelineStateDesc();
+    }
+
+    ShaderDesc GetShaderDesc(Device* device, Shader shader)
+    {
+        NullShader* shaderObj = device->interf->shaderPool.Get(shader.id);
+        return shaderObj != nullptr ? shaderObj->desc : ShaderDesc();
+    }
+
+    RenderPass GetRenderPassDesc(Device* device, RenderPass pass)
+    {
+        // @NOTE declared to return the handle, which is all there is to give back here
+        return device->interf->passPool.Get(pass.id) != nullptr ? pass : RenderPass();
+    }
+
+    SwapChainDesc GetSwapChainDesc(Device* device, SwapChain swapChain)
+    {
+        NullSwapChain* swapChainObj = device->interf->swapChainPool.Get(swapChain.id);
+        return swapChainObj != nullptr ? swapChainObj->desc : SwapChainDesc();
+    }
+
+    //
+    //
+
+    // commands on deferred command buffers are only recorded, this may run on any thread so it touches nothing else
+    static CommandStream* GetDeferredStream(Device* device, CommandBuffer cmdBuffer)
+    {
+        NullCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        return cmdBuf != nullptr && cmdBuf->isDeferred ? &cmdBuf->stream : nullptr;
+    }
+
+    static NullCommandBuffer* BeginPass(Device* device, CommandBuffer cmdBuffer)
+    {
+        NullCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (cmdBuf == nullptr) {
+            VALIDATION_ERROR(device, "Beginning render pass on invalid command buffer 0x%08x", cmdBuffer.id);
+            return nullptr;
+        }
+        if (cmdBuf->isInRenderPass) {
+            VALIDATION_ERROR(device, "Beginning render pass on command buffer 0x%08x while another one is active", cmdBuffer.id);
+        }
+        cmdBuf->isInRenderPass = true;
+        cmdBuf->width = cmdBuf->height = 0;
+        InvalidateImageInputs(&cmdBuf->stateCache);
+        device->stats.numRenderPasses++;
+        device->stateChangeStats.numRenderTargetChanges++;
+        return cmdBuf;
+    }
+
+    void BeginDefaultRenderPass(Device* device, CommandBuffer cmdBuffer, SwapChain swapChain, RenderPassAction* action)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordBeginDefaultRenderPass(stream, swapChain, action);
+            return;
+        }
+        NullSwapChain* swapChainObj = device->interf->swapChainPool.Get(swapChain.id);
+        if (swapChainObj == nullptr) {
+            VALIDATION_ERROR(device, "Beginning render pass on invalid swap chain 0x%08x", swapChain.id);
+        }
+        NullCommandBuffer* cmdBuf = BeginPass(device, cmdBuffer);
+        if (cmdBuf == nullptr) { return; }
+        cmdBuf->renderPass = RenderPass();
+        if (swapChainObj != nullptr) {
+            cmdBuf->width = swapChainObj->desc.width;
+            cmdBuf->height = swapChainObj->desc.height;
+        }
+
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_BEGIN_DEFAULT_RENDER_PASS);
+        if (command != nullptr) {
+            command->commandBuffer = cmdBuffer;
+            command->resource = swapChain.id;
+        }
+    }
+
+    void BeginRenderPass(Device* device, CommandBuffer cmdBuffer, RenderPass renderPass, RenderPassAction* action)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordBeginRenderPass(stream, renderPass, action);
+            return;
+        }
+        NullRenderPass* pass = device->interf->passPool.Get(renderPass.id);
+        if (pass == nullptr) {
+            VALIDATION_ERROR(device, "Beginning invalid render pass 0x%08x", renderPass.id);
+        }
+        else {
+            // attachments destroyed after the pass was created
+            for (size_t i = 0; i < GFX_MAX_COLOR_ATTACHMENTS + 1; ++i) {
+                Image image = i < GFX_MAX_COLOR_ATTACHMENTS ? pass->desc.colorAttachments[i].image : pass->desc.depthStencilAttachment.image;
+                if (GFX_CHECK_RESOURCE(image) && device->interf->imagePool.Get(image.id) == nullptr) {
+                    VALIDATION_ERROR(device, "Render pass 0x%08x uses destroyed image 0x%08x", renderPass.id, image.id);
+                }
+            }
+        }
+        NullCommandBuffer* cmdBuf = BeginPass(device, cmdBuffer);
+        if (cmdBuf == nullptr) { return; }
+        cmdBuf->renderPass = renderPass;
+        for (size_t i = 0; pass != nullptr && i < GFX_MAX_COLOR_ATTACHMENTS + 1; ++i) {
+            Image image = i < GFX_MAX_COLOR_ATTACHMENTS ? pass->desc.colorAttachments[i].image : pass->desc.depthStencilAttachment.image;
+            NullImage* imageObj = device->interf->imagePool.Get(image.id);
+            if (imageObj != nullptr) {
+                cmdBuf->width = imageObj->desc.width;
+                cmdBuf->height = imageObj->desc.height;
+                break;
+            }
+        }
+
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_BEGIN_RENDER_PASS);
+        if (command != nullptr) {
+            command->commandBuffer = cmdBuffer;
+            command->resource = renderPass.id;
+        }
+    }
+
+    void EndRenderPass(Device* device, CommandBuffer cmdBuffer)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordEndRenderPass(stream);
+            return;
+        }
+        NullCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (cmdBuf == nullptr || !cmdBuf->isInRenderPass) {
+            VALIDATION_ERROR(device, "Ending render pass on command buffer 0x%08x that wasn't begun", cmdBuffer.id);
+            return;
+        }
+        cmdBuf->isInRenderPass = false;
+        cmdBuf->renderPass = RenderPass();
+
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_END_RENDER_PASS);
+        if (command != nullptr) {
+            command->commandBuffer = cmdBuffer;
+        }
+    }
+
+    static void ValidateBufferInput(Device* device, Buffer handle, BufferType type, const char* what)
+    {
+        NullBuffer* buffer = device->interf->bufferPool.Get(handle.id);
+        if (buffer == nullptr) {
+            VALIDATION_ERROR(device, "Draw call uses invalid %s buffer 0x%08x", what, handle.id);
+            return;
+        }
+        if (buffer->desc.type != type) {
+            VALIDATION_ERROR(device, "Draw call uses buffer 0x%08x as %s buffer", handle.id, what);
+        }
+        if (buffer->isMapped) {
+            VALIDATION_ERROR(device, "Draw call uses %s buffer 0x%08x while it is mapped", what, handle.id);
+        }
+    }
+
+    static void ValidateConstantInputs(Device* device, Buffer* inputs, uint32_t* offsets)
+    {
+        for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+            uint32_t offset = offsets != nullptr ? offsets[i] : 0;
+            if (!GFX_CHECK_RESOURCE(inputs[i])) {
+                if (offset != 0) {
+                    VALIDATION_ERROR(device, "Draw call has a constant offset for an empty slot %u", i);
+                }
+                continue;
+            }
+            ValidateBufferInput(device, inputs[i], BufferType::BUFFER_TYPE_CONSTANT, "constant");
+            NullBuffer* buffer = device->interf->bufferPool.Get(inputs[i].id);
+            if (offset % GFX_CONSTANT_BUFFER_ALIGNMENT != 0 || (buffer != nullptr && offset >= buffer->desc.byteWidth)) {
+                VALIDATION_ERROR(device, "Draw call has invalid constant offset %u in slot %u", offset, i);
+            }
+        }
+    }
+
+    static void ValidateImageInputs(Device* device, NullCommandBuffer* cmdBuf, Image* inputs)
+    {
+        NullRenderPass* pass = device->interf->passPool.Get(cmdBuf->renderPass.id);
+        for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+            if (!GFX_CHECK_RESOURCE(inputs[i])) { continue; }
+            if (device->interf->imagePool.Get(inputs[i].id) == nullptr) {
+                VALIDATION_ERROR(device, "Draw call uses invalid image 0x%08x in slot %u", inputs[i].id, i);
+                continue;
+            }
+            if (pass == nullptr) { continue; }
+            for (uint32_t j = 0; j < GFX_MAX_COLOR_ATTACHMENTS + 1; ++j) {
+                Image attachment = j < GFX_MAX_COLOR_ATTACHMENTS ? pass->desc.colorAttachments[j].image : pass->desc.depthStencilAttachment.image;
+                if (attachment.id == inputs[i].id) {
+                    VALIDATION_ERROR(device, "Draw call reads image 0x%08x while rendering to it", inputs[i].id);
+                }
+            }
+        }
+    }
+
+    static NullCommandBuffer* GetDrawCommandBuffer(Device* device, CommandBuffer cmdBuffer)
+    {
+        NullCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (cmdBuf == nullptr || !cmdBuf->isInRenderPass) {
+            VALIDATION_ERROR(device, "Draw call on command buffer 0x%08x outside of a render pass", cmdBuffer.id);
+            return nullptr;
+        }
+        return cmdBuf;
+    }
+
+    static void ExecuteDrawCall(Device* device, CommandBuffer cmdBuffer, NullCommandBuffer* cmdBuf, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    {
+        NullPipelineState* pipelineState = device->interf->pipelineStatePool.Get(drawCall->pipelineState.id);
+        if (pipelineState == nullptr) {
+            VALIDATION_ERROR(device, "Draw call uses invalid pipeline state 0x%08x", drawCall->pipelineState.id);
+        }
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            if (!GFX_CHECK_RESOURCE(drawCall->vertexBuffers[i])) { break; }
+            ValidateBufferInput(device, drawCall->vertexBuffers[i], BufferType::BUFFER_TYPE_VERTEX, "vertex");
+        }
+        if (pipelineState != nullptr && pipelineState->desc.indexFormat != IndexFormat::INDEX_FORMAT_NONE) {
+            ValidateBufferInput(device, drawCall->indexBuffer, BufferType::BUFFER_TYPE_INDEX, "index");
+        }
+        ValidateConstantInputs(device, drawCall->vsConstantInputs, drawCall->vsConstantOffsets);
+        ValidateConstantInputs(device, drawCall->psConstantInputs, drawCall->psConstantOffsets);
+        ValidateConstantInputs(device, drawCall->gsConstantInputs, nullptr);
+        ValidateConstantInputs(device, drawCall->hsConstantInputs, nullptr);
+        ValidateConstantInputs(device, drawCall->dsConstantInputs, nullptr);
+        ValidateImageInputs(device, cmdBuf, drawCall->vsImageInputs);
+        ValidateImageInputs(device, cmdBuf, drawCall->psImageInputs);
+        ValidateImageInputs(device, cmdBuf, drawCall->gsImageInputs);
+        ValidateImageInputs(device, cmdBuf, drawCall->hsImageInputs);
+        ValidateImageInputs(device, cmdBuf, drawCall->dsImageInputs);
+
+        if (pipelineState != nullptr) {
+            Viewport passViewport = { (float)cmdBuf->width, (float)cmdBuf->height };
+            Rect passRect;
+            passRect.right = cmdBuf->width;
+            passRect.bottom = cmdBuf->height;
+            StateChanges changes;
+            UpdateStateCache(&cmdBuf->stateCache, drawCall, pipelineState->desc.indexFormat, viewport != nullptr ? viewport : &passViewport,
+                scissorRect != nullptr ? scissorRect : &passRect, &changes, &device->stateChangeStats);
+        }
+
+        uint32_t numInstances = drawCall->numInstances > 0 ? drawCall->numInstances : 1;
+        device->stats.numDrawCalls++;
+        device->stats.numInstances += numInstances;
+        device->stats.numElements += (uint64_t)drawCall->numElements * numInstances;
+
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_DRAW);
+        if (command != nullptr) {
+            command->commandBuffer = cmdBuffer;
+            command->resource = drawCall->pipelineState.id;
+            command->drawIndex = RecordDrawCall(device, drawCall);
+        }
+    }
+
+    void SubmitDrawCall(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawCall(stream, drawCall, viewport, scissorRect);
+            return;
+        }
+        if (NullCommandBuffer* cmdBuf = GetDrawCommandBuffer(device, cmdBuffer)) {
+            ExecuteDrawCall(device, cmdBuffer, cmdBuf, drawCall, viewport, scissorRect);
+        }
+    }
+
+    void SubmitDrawCalls(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCalls, uint32_t numDrawCalls, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            for (uint32_t i = 0; i < numDrawCalls; ++i) {
+                RecordDrawCall(stream, &drawCalls[i], viewport, scissorRect);
+            }
+            return;
+        }
+        NullCommandBuffer* cmdBuf = GetDrawCommandBuffer(device, cmdBuffer);
+        if (cmdBuf == nullptr) { return; }
+        for (uint32_t i = 0; i < numDrawCalls; ++i) {
+            ExecuteDrawCall(device, cmdBuffer, cmdBuf, &drawCalls[i], viewport, scissorRect);
+        }
+    }
+
+    // @NOTE issues a regular draw per argument record, so recorded draws show the arguments that were read
+    void SubmitDrawIndirect(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Buffer argsBuffer, uint32_t argsOffset, uint32_t numDraws,
+        Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawIndirect(stream, drawCall, argsBuffer, argsOffset, numDraws, viewport, scissorRect);
+            return;
+        }
+        NullCommandBuffer* cmdBuf = GetDrawCommandBuffer(device, cmdBuffer);
+        if (cmdBuf == nullptr) { return; }
+        NullPipelineState* pipelineState = device->interf->pipelineStatePool.Get(drawCall->pipelineState.id);
+        if (pipelineState == nullptr) {
+            VALIDATION_ERROR(device, "Indirect draw uses invalid pipeline state 0x%08x", drawCall->pipelineState.id);
+            return;
+        }
+        bool isIndexed = pipelineState->desc.indexFormat != IndexFormat::INDEX_FORMAT_NONE;
+        size_t stride = isIndexed ? sizeof(DrawIndexedIndirectArgs) : sizeof(DrawIndirectArgs);
+        NullBuffer* args = device->interf->bufferPool.Get(argsBuffer.id);
+        if (args == nullptr || args->desc.type != BufferType::BUFFER_TYPE_INDIRECT_ARGS) {
+            VALIDATION_ERROR(device, "Indirect draw reads arguments from invalid buffer 0x%08x", argsBuffer.id);
+            return;
+        }
+        if (argsOffset % 4 != 0 || argsOffset + numDraws * stride > args->desc.byteWidth) {
+            VALIDATION_ERROR(device, "Indirect draw reads %u draws at offset %u past the end of buffer 0x%08x", numDraws, argsOffset, argsBuffer.id);
+            return;
+        }
+        if (args->isMapped) {
+            VALIDATION_ERROR(device, "Indirect draw reads arguments from buffer 0x%08x while it is mapped", argsBuffer.id);
+        }
+
+        DrawCall indirectDraw = *drawCall;
+        const char* record = args->data + argsOffset;
+        for (uint32_t i = 0; i < numDraws; ++i, record += stride) {
+            if (isIndexed) {
+                DrawIndexedIndirectArgs indexedArgs;
+                memcpy(&indexedArgs, record, sizeof(indexedArgs));
+                indirectDraw.numElements = indexedArgs.numElements;
+                indirectDraw.numInstances = indexedArgs.numInstances;
+                indirectDraw.elementOffset = indexedArgs.elementOffset;
+                indirectDraw.startVertexLocation = (uint32_t)indexedArgs.startVertexLocation;
+                indirectDraw.startInstanceLocation = indexedArgs.startInstanceLocation;
+            }
+            else {
+                DrawIndirectArgs drawArgs;
+                memcpy(&drawArgs, record, sizeof(drawArgs));
+                indirectDraw.numElements = drawArgs.numElements;
+                indirectDraw.numInstances = drawArgs.numInstances;
+                indirectDraw.elementOffset = 0;
+                indirectDraw.startVertexLocation = drawArgs.startVertexLocation;
+                indirectDraw.startInstanceLocation = drawArgs.startInstanceLocation;
+            }
+            if (indirectDraw.numInstances == 0) { continue; }
+            ExecuteDrawCall(device, cmdBuffer, cmdBuf, &indirectDraw, viewport, scissorRect);
+        }
+    }
+
+    void SubmitDrawItem(Device* device, CommandBuffer cmdBuffer, DrawItem* drawItem, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawItem(stream, drawItem, viewport, scissorRect);
+            return;
+        }
+
+        BindGroupData* groups[GFX_MAX_BIND_GROUPS];
+        for (uint32_t i = 0; i < GFX_MAX_BIND_GROUPS; ++i) {
+            groups[i] = nullptr;
+            if (!GFX_CHECK_RESOURCE(drawItem->bindGroups[i])) { continue; }
+            NullBindGroup* bindGroup = device->interf->bindGroupPool.Get(drawItem->bindGroups[i].id);
+            if (bindGroup == nullptr) {
+                VALIDATION_ERROR(device, "Draw item uses invalid bind group 0x%08x", drawItem->bindGroups[i].id);
+                return;
+            }
+            groups[i] = &bindGroup->data;
+        }
+        DrawCall* drawCall = ResolveDrawItem(&device->resolvedDrawInputs, drawItem, groups);
+        if (drawCall == nullptr) {
+            device->stats.numValidationErrors++;
+            return;
+        }
+        SubmitDrawCall(device, cmdBuffer, drawCall, viewport, scissorRect);
+    }
+
+    void SubmitCommandBuffers(Device* device, CommandBuffer* cmdBuffers, uint32_t numCmdBuffers)
+    {
+        for (uint32_t i = 0; i < numCmdBuffers; ++i) {
+            CommandStream* stream = GetDeferredStream(device, cmdBuffers[i]);
+            if (stream == nullptr) {
+                VALIDATION_ERROR(device, "Submitting invalid or immediate command buffer 0x%08x", cmdBuffers[i].id);
+                continue;
+            }
+            if (!ReplayCommandStream(device, device->immediateCmdBuffer, stream)) {
+                device->stats.numValidationErrors++;
+            }
+        }
+    }
+
+    void PresentSwapChain(Device* device, SwapChain swapChain)
+    {
+        if (device->interf->swapChainPool.Get(swapChain.id) == nullptr) {
+            VALIDATION_ERROR(device, "Presenting invalid swap chain 0x%08x", swapChain.id);
+            return;
+        }
+        device->stats.numPresents++;
+        EndStateChangeFrame(&device->stateChangeStats, &device->lastFrameStateChangeStats);
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_PRESENT);
+        if (command != nullptr) {
+            command->resource = swapChain.id;
+        }
+    }
+
+    void GetStateChangeStats(Device* device, StateChangeStats* outStats)
+    {
+        *outStats = device->lastFrameStateChangeStats;
+    }
+
+    void GetResourceStats(Device* device, ResourceStats* outStats)
+    {
+        Interface* interf = device->interf;
+        outStats->buffers = interf->bufferPool.GetStats();
+        outStats->images = interf->imagePool.GetStats();
+        outStats->pipelineStates = interf->pipelineStatePool.GetStats();
+        outStats->shaders = interf->shaderPool.GetStats();
+        outStats->renderPasses = interf->passPool.GetStats();
+        outStats->cmdBuffers = interf->cmdBufferPool.GetStats();
+        outStats->bindGroups = interf->bindGroupPool.GetStats();
+        outStats->swapChains = interf->swapChainPool.GetStats();
+    }
+
+    void GetPipelineCacheStats(Device* device, PipelineCacheStats* outStats)
+    {
+        *outStats = ReadPipelineCacheStats(&device->pipelineCache);
+    }
+
+    size_t SavePipelineCache(Device* device, void* buffer, size_t bufferSize)
+    {
+        return SavePipelineCacheKeys(&device->pipelineCache, buffer, bufferSize);
+    }
+
+    uint32_t WarmPipelineCache(Device* device, const void* data, size_t size)
+    {
+        return WarmPipelineCacheKeys(device, &device->pipelineCache, data, size);
+    }
+
+    void* MapBuffer(Device* device, Buffer buffer, MapType mapType)
+    {
+        NullBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj == nullptr) {
+            VALIDATION_ERROR(device, "Mapping invalid buffer 0x%08x", buffer.id);
+            return nullptr;
+        }
+        if (bufferObj->isMapped) {
+            VALIDATION_ERROR(device, "Mapping buffer 0x%08x while it is mapped", buffer.id);
+            return nullptr;
+        }
+        ResourceUsage usage = bufferObj->desc.usage;
+        bool isRead = mapType == MapType::MAP_READ || mapType == MapType::MAP_READ_WRITE || mapType == MapType::_DEFAULT;
+        bool isDiscard = mapType == MapType::MAP_WRITE_DISCARD || mapType == MapType::MAP_WRITE_NO_OVERWRITE;
+        if (usage == ResourceUsage::USAGE_IMMUTABLE || usage == ResourceUsage::USAGE_COPY_DESTINATION
+            || (isRead && usage != ResourceUsage::USAGE_STAGING)
+            || (isDiscard && usage != ResourceUsage::USAGE_DYNAMIC && usage != ResourceUsage::USAGE_STREAM)) {
+            VALIDATION_ERROR(device, "Buffer 0x%08x can't be mapped this way", buffer.id);
+            return nullptr;
+        }
+        bufferObj->isMapped = true;
+
+        device->stats.numMaps++;
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_MAP_BUFFER);
+        if (command != nullptr) {
+            command->resource = buffer.id;
+            command->mapType = mapType;
+        }
+        return bufferObj->data;
+    }
+
+    void UnmapBuffer(Device* device, Buffer buffer)
+    {
+        NullBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj == nullptr || !bufferObj->isMapped) {
+            VALIDATION_ERROR(device, "Unmapping buffer 0x%08x that isn't mapped", buffer.id);
+            return;
+        }
+        bufferObj->isMapped = false;
+
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_UNMAP_BUFFER);
+        if (command != nullptr) {
+            command->resource = buffer.id;
+        }
+    }
+
+    bool SetImageResidentMips(Device* device, Image image, uint32_t firstResidentMip)
+    {
+        NullImage* imageObj = device->interf->imagePool.Get(image.id);
+        if (imageObj == nullptr || !imageObj->desc.isStreamed || firstResidentMip >= imageObj->desc.numMipmaps) {
+            VALIDATION_ERROR(device, "Can't make mips from %u on of image 0x%08x resident", firstResidentMip, image.id);
+            return false;
+        }
+        imageObj->desc.firstResidentMip = (uint16_t)firstResidentMip;
+        return true;
+    }
+
+    bool CopyBufferToImage(Device* device, Buffer source, size_t sourceOffset, Image image, uint32_t mip)
+    {
+        NullBuffer* bufferObj = device->interf->bufferPool.Get(source.id);
+        NullImage* imageObj = device->interf->imagePool.Get(image.id);
+        if (bufferObj == nullptr || bufferObj->desc.usage != ResourceUsage::USAGE_STAGING || bufferObj->isMapped) {
+            VALIDATION_ERROR(device, "Copying to an image from buffer 0x%08x that isn't an unmapped staging buffer", source.id);
+            return false;
+        }
+        if (imageObj == nullptr || !imageObj->desc.isStreamed || mip < imageObj->desc.firstResidentMip || mip >= imageObj->desc.numMipmaps) {
+            VALIDATION_ERROR(device, "Copying to mip %u of image 0x%08x that isn't resident", mip, image.id);
+            return false;
+        }
+        if (sourceOffset + GetImageMipSize(&imageObj->desc, mip) > bufferObj->desc.byteWidth) {
+            VALIDATION_ERROR(device, "Copying mip %u of image 0x%08x reads past the end of buffer 0x%08x", mip, image.id, source.id);
+            return false;
+        }
+
+        device->stats.numImageCopies++;
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_COPY_BUFFER_TO_IMAGE);
+        if (command != nullptr) {
+            command->resource = image.id;
+        }
+        return true;
+    }
+
+    bool UpdateBuffer(Device* device, Buffer buffer, size_t offset, const void* data, size_t size)
+    {
+        NullBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj == nullptr || bufferObj->desc.usage != ResourceUsage::USAGE_COPY_DESTINATION || bufferObj->isMapped) {
+            VALIDATION_ERROR(device, "Updating buffer 0x%08x that isn't an unmapped copy destination", buffer.id);
+            return false;
+        }
+        if (offset + size > bufferObj->desc.byteWidth) {
+            VALIDATION_ERROR(device, "Updating %llu bytes at %llu writes past the end of buffer 0x%08x", (unsigned long long)size, (unsigned long long)offset, buffer.id);
+            return false;
+        }
+        memcpy(bufferObj->data + offset, data, size);
+
+        device->stats.numBufferUpdates++;
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_UPDATE_BUFFER);
+        if (command != nullptr) {
+            command->resource = buffer.id;
+        }
+        return true;
+    }
+
+    bool UpdateImage(Device* device, Image image, uint32_t mip, const void* data, size_t size)
+    {
+        NullImage* imageObj = device->interf->imagePool.Get(image.id);
+        if (imageObj == nullptr || (imageObj->desc.usage != ResourceUsage::USAGE_COPY_DESTINATION && !imageObj->desc.isStreamed)
+            || imageObj->desc.type != ImageType::IMAGE_TYPE_2D || imageObj->desc.numSlices != 1) {
+            VALIDATION_ERROR(device, "Updating image 0x%08x that isn't a 2D copy destination", image.id);
+            return false;
+        }
+        if (mip < imageObj->desc.firstResidentMip || mip >= imageObj->desc.numMipmaps) {
+            VALIDATION_ERROR(device, "Updating mip %u of image 0x%08x that isn't resident", mip, image.id);
+            return false;
+        }
+        if (data == nullptr || size != GetImageMipSize(&imageObj->desc, mip)) {
+            VALIDATION_ERROR(device, "Updating mip %u of image 0x%08x with %llu bytes instead of a whole mip", mip, image.id, (unsigned long long)size);
+            return false;
+        }
+
+        device->stats.numImageUpdates++;
+        RecordedCommand* command = RecordCommand(device, RecordedCommandType::CMD_UPDATE_IMAGE);
+        if (command != nullptr) {
+            command->resource = image.id;
+        }
+        return true;
+    }
+}
+
+#endif // !GT_GFX_SOFTWARE
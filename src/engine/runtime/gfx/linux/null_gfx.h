@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../gfx.h"
+
+/**
+    Headless gfx backend. Resources live in real handle pools and every call is validated, but nothing is drawn:
+    buffers are backed by plain memory so they can be mapped, and render passes, draw calls, maps and presents
+    are recorded into a stream that can be inspected, e.g. to measure or regression test the renderer without a GPU.
+*/
+
+namespace gfx
+{
+    enum class RecordedCommandType : uint8_t
+    {
+        CMD_BEGIN_RENDER_PASS,
+        CMD_BEGIN_DEFAULT_RENDER_PASS,
+        CMD_END_RENDER_PASS,
+        CMD_DRAW,
+        CMD_MAP_BUFFER,
+        CMD_UNMAP_BUFFER,
+        CMD_COPY_BUFFER_TO_IMAGE,
+        CMD_UPDATE_BUFFER,
+        CMD_UPDATE_IMAGE,
+        CMD_PRESENT
+    };
+
+    struct RecordedCommand
+    {
+        RecordedCommandType type = RecordedCommandType::CMD_DRAW;
+        MapType             mapType = MapType::_DEFAULT;    // CMD_MAP_BUFFER only
+        CommandBuffer       commandBuffer;                  // invalid for maps, copies, updates and presents
+        uint32_t            resource = INVALID_ID;          // render pass, swap chain, buffer or image
+        uint32_t            drawIndex = 0;                  // CMD_DRAW only, index into the recorded draw calls
+    };
+
+    struct NullDeviceStats
+    {
+        uint64_t    numCommands = 0;
+        uint64_t    numRenderPasses = 0;
+        uint64_t    numDrawCalls = 0;
+        uint64_t    numInstances = 0;
+        uint64_t    numElements = 0;            // indices or vertices over all instances
+        uint64_t    numMaps = 0;
+        uint64_t    numImageCopies = 0;
+        uint64_t    numBufferUpdates = 0;
+        uint64_t    numImageUpdates = 0;
+        uint64_t    numPresents = 0;
+        uint64_t    numValidationErrors = 0;
+    };
+
+    // commands are recorded unless disabled, counters are always kept
+    void SetCommandRecording(Device* device, bool isEnabled);
+    // commands since the last reset, pointers stay valid until the next command is recorded
+    const RecordedCommand* GetRecordedCommands(Device* device, size_t* outNumCommands);
+    // copies of the submitted draw calls, referenced by RecordedCommand::drawIndex
+    const DrawCall* GetRecordedDrawCalls(Device* device, size_t* outNumDrawCalls);
+    void GetNullDeviceStats(Device* device, NullDeviceStats* outStats);
+    // clears the recorded commands and the counters
+    void ResetRecording(Device* device);
+}
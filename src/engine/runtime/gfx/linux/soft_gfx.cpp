@@ -0,0 +1,2135 @@
+#ifdef GT_GFX_SOFTWARE
+
+#include "soft_gfx.h"
+#include "../command_stream.h"
+#include "../state_cache.h"
+#include "../bind_group.h"
+#include "../resource_pool.h"
+#include "../pipeline_cache.h"
+#include <foundation/memory/memory.h>
+#include <foundation/logging/logging.h>
+#include <cassert>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFT_GFX_SSE
+#endif
+
+// vertex positions are snapped to 1/16th of a pixel so shared edges are evaluated the same for both triangles
+#define SUBPIXEL_STEPS 16.0f
+// smallest w triangles are clipped to, keeps the perspective divide finite
+#define MIN_CLIP_W 1e-5f
+#define VERTEX_CACHE_SIZE 32
+// enough for a triangle clipped by three planes
+#define MAX_CLIP_VERTICES 9
+
+namespace gfx
+{
+    struct SoftBuffer
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        BufferDesc      desc;
+        char*           data = nullptr;
+        bool            isMapped = false;
+    };
+
+    struct SoftImage
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        ImageDesc       desc;
+        SamplerDesc     sampler;
+        PixelFormat     format = PixelFormat::PIXEL_FORMAT_R8G8B8A8_UNORM;     // storage format, depth targets keep the depth only
+        uint32_t        texelSize = 0;
+        char*           data = nullptr;
+        size_t*         subresourceOffsets = nullptr;   // slice major, like D3D11 subresources
+        uint32_t        numSubresources = 0;
+    };
+
+    struct SoftShader
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        ShaderDesc              desc;
+        SoftVertexShaderFunc    vertexFunc = nullptr;
+        SoftPixelShaderFunc     pixelFunc = nullptr;
+        uint32_t                numVaryings = 0;
+        void*                   userData = nullptr;
+    };
+
+    struct SoftPipelineState
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        PipelineStateDesc desc;
+    };
+
+    struct SoftRenderPass
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        RenderPassDesc  desc;
+    };
+
+    struct SoftCommandBuffer
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        bool            isInRenderPass = false;
+        bool            isDeferred = false;
+        CommandStream   stream;
+        StateCache      stateCache;                 // nothing is bound, kept for the state change counters
+    };
+
+    struct SoftBindGroup
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        BindGroupData   data;
+    };
+
+    struct SoftSwapChain
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        SwapChainDesc   desc;
+        SoftImage       backBuffer;
+        SoftImage       depthBuffer;
+    };
+
+    static void FreeImageData(fnd::memory::MemoryArenaBase* memoryArena, SoftImage* image)
+    {
+        if (image->data != nullptr) {
+            GT_DELETE_ARRAY(image->data, memoryArena);
+            GT_DELETE_ARRAY(image->subresourceOffsets, memoryArena);
+        }
+        image->data = nullptr;
+        image->subresourceOffsets = nullptr;
+        image->numSubresources = 0;
+    }
+
+    static void SoftReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, SoftBuffer* buffer)
+    {
+        if (buffer->data != nullptr) {
+            GT_DELETE_ARRAY(buffer->data, memoryArena);
+            buffer->data = nullptr;
+        }
+    }
+
+    static void SoftReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, SoftImage* image)
+    {
+        FreeImageData(memoryArena, image);
+    }
+
+    static void SoftReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, SoftSwapChain* swapChain)
+    {
+        FreeImageData(memoryArena, &swapChain->backBuffer);
+        FreeImageData(memoryArena, &swapChain->depthBuffer);
+    }
+
+    static void SoftReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, SoftCommandBuffer* cmdBuffer)
+    {
+        ReleaseCommandStream(&cmdBuffer->stream, memoryArena);
+    }
+
+    template <class TResource>
+    static void SoftReleaseResource(fnd::memory::MemoryArenaBase*, TResource*)
+    {
+    }
+
+    template <class T>
+    struct GrowableArray
+    {
+        T*          data = nullptr;
+        uint32_t    size = 0;
+        uint32_t    capacity = 0;
+    };
+
+    // returns room for count more elements, pointers into the array are invalidated
+    template <class T>
+    static T* Push(GrowableArray<T>* array, uint32_t count, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        if (array->size + count > array->capacity) {
+            uint32_t capacity = array->capacity > 0 ? array->capacity * 2 : 256;
+            while (capacity < array->size + count) {
+                capacity *= 2;
+            }
+            T* data = GT_NEW_ARRAY(T, capacity, memoryArena);
+            if (array->data != nullptr) {
+                memcpy(data, array->data, sizeof(T) * array->size);
+                GT_DELETE_ARRAY(array->data, memoryArena);
+            }
+            array->data = data;
+            array->capacity = capacity;
+        }
+        T* result = array->data + array->size;
+        array->size += count;
+        return result;
+    }
+
+    struct RenderTarget
+    {
+        char*           data = nullptr;
+        PixelFormat     format = PixelFormat::PIXEL_FORMAT_R8G8B8A8_UNORM;
+        uint32_t        texelSize = 0;
+        uint32_t        pitch = 0;
+    };
+
+    // state of a draw call its triangles are rasterized with
+    struct DrawState
+    {
+        const PipelineStateDesc*    pipelineState;
+        SoftPixelShaderFunc         pixelFunc;
+        void*                       pixelUserData;
+        uint32_t                    numVaryings;
+        SoftShaderResources         resources;
+    };
+
+    // screen space triangle with positive area, edge i lies opposite of vertex i and is positive inside
+    struct Triangle
+    {
+        float       edgeA[3];
+        float       edgeB[3];
+        float       edgeC[3];
+        float       invArea;
+        float       z[3];
+        float       invW[3];
+        int32_t     minX, minY, maxX, maxY;     // inclusive, within viewport and scissor rect
+        uint32_t    drawIndex;
+        uint32_t    firstVarying;               // varyings divided by w, for three vertices
+        uint8_t     topLeftMask;                // edges pixels exactly on count as covered
+        bool        isFrontFace;
+    };
+
+    struct TileStats
+    {
+        uint64_t    numPixelsTested = 0;
+        uint64_t    numPixelsShaded = 0;
+    };
+
+    struct Interface
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+
+        ResourcePool<SoftBuffer, SoftReleaseResource>           bufferPool;
+        ResourcePool<SoftImage, SoftReleaseResource>            imagePool;
+        ResourcePool<SoftPipelineState, SoftReleaseResource>    pipelineStatePool;
+        ResourcePool<SoftShader, SoftReleaseResource>           shaderPool;
+        ResourcePool<SoftRenderPass, SoftReleaseResource>       passPool;
+        ResourcePool<SoftCommandBuffer, SoftReleaseResource>    cmdBufferPool;
+        ResourcePool<SoftBindGroup, SoftReleaseResource>        bindGroupPool;
+        ResourcePool<SoftSwapChain, SoftReleaseResource>        swapChainPool;
+
+        Device*     deviceList = nullptr;
+        uint32_t    numDevices = 0;
+    };
+
+    struct Device
+    {
+        Interface*          interf = nullptr;
+        DeviceInfo          info;
+        bool                isCreated = false;
+        CommandBuffer       immediateCmdBuffer;
+
+        // the render pass being recorded, only one at a time for all command buffers
+        bool                isInRenderPass = false;
+        uint32_t            width = 0;
+        uint32_t            height = 0;
+        RenderTarget        colorTargets[GFX_MAX_COLOR_ATTACHMENTS];
+        uint32_t            numColorTargets = 0;
+        RenderTarget        depthTarget;
+        RenderPassAction    action;
+        bool                hasPendingClear = false;
+
+        uint32_t                    numTilesX = 0;
+        uint32_t                    numTilesY = 0;
+        GrowableArray<DrawState>    draws;
+        GrowableArray<Triangle>     triangles;
+        GrowableArray<float>        varyings;
+        GrowableArray<uint32_t>*    bins = nullptr;     // triangle indices per tile
+        uint32_t                    binCapacity = 0;
+
+        pthread_t           threads[SOFT_GFX_MAX_WORKERS];
+        uint32_t            numThreads = 0;
+        pthread_mutex_t     mutex;
+        pthread_cond_t      wakeCondition;
+        pthread_cond_t      doneCondition;
+        uint32_t            jobGeneration = 0;
+        uint32_t            numBusyThreads = 0;
+        uint32_t            nextTile = 0;
+
+        SoftDeviceStats     stats;
+        StateChangeStats    stateChangeStats;
+        StateChangeStats    lastFrameStateChangeStats;
+        ResolvedDrawInputs  resolvedDrawInputs;     // of the draw items submitted to the immediate command buffer
+        PipelineCache       pipelineCache;
+    };
+
+    //
+    //
+
+    static uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t exponentBits = (bits >> 23) & 0xff;
+        int32_t exponent = (int32_t)exponentBits - 127 + 15;
+        uint32_t mantissa = bits & 0x7fffff;
+        if (exponentBits == 0xff) {
+            return (uint16_t)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+        }
+        if (exponent >= 31) {
+            return (uint16_t)(sign | 0x7c00);
+        }
+        if (exponent <= 0) {
+            if (exponent < -10) { return (uint16_t)sign; }
+            mantissa |= 0x800000;
+            uint32_t shift = (uint32_t)(14 - exponent);
+            uint32_t half = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (half & 1))) { half++; }
+            return (uint16_t)(sign | half);
+        }
+        // rounding may carry into the exponent, which is still correct
+        uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+        uint32_t remainder = mantissa & 0x1fff;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) { half++; }
+        return (uint16_t)half;
+    }
+
+    static float HalfToFloat(uint16_t half)
+    {
+        uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+        uint32_t exponent = (half >> 10) & 0x1f;
+        uint32_t mantissa = half & 0x3ff;
+        uint32_t bits = 0;
+        if (exponent == 0) {
+            float value = (float)mantissa * (1.0f / 16777216.0f);
+            return sign != 0 ? -value : value;
+        }
+        if (exponent == 31) {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    static float Clamp(float value, float min, float max)
+    {
+        return value < min ? min : (value > max ? max : value);
+    }
+
+    static PixelFormat GetStorageFormat(ImageDesc* desc)
+    {
+        if (desc->isDepthStencilTarget) { return PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT; }
+        if (desc->pixelFormat == PixelFormat::_DEFAULT || desc->pixelFormat == PixelFormat::PIXEL_FORMAT_NONE) {
+            return PixelFormat::PIXEL_FORMAT_R8G8B8A8_UNORM;
+        }
+        return desc->pixelFormat;
+    }
+
+    // @NOTE depth targets store a plain float per texel, the stencil bits of D32_FLOAT_S8X24_UINT only exist in copies
+    static uint32_t GetTexelSize(PixelFormat format)
+    {
+        switch (format) {
+        case PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT:
+        case PixelFormat::PIXEL_FORMAT_R16G16B16A16_UINT:
+            return 8;
+        case PixelFormat::PIXEL_FORMAT_R32G32B32A32_FLOAT:
+            return 16;
+        default:
+            return 4;
+        }
+    }
+
+    static uint32_t GetExternalTexelSize(PixelFormat format)
+    {
+        return format == PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT ? 8 : GetTexelSize(format);
+    }
+
+    static void LoadTexel(PixelFormat format, const char* texel, float* outColor)
+    {
+        switch (format) {
+        case PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT: {
+            uint16_t halfs[4];
+            memcpy(halfs, texel, sizeof(halfs));
+            for (int i = 0; i < 4; ++i) { outColor[i] = HalfToFloat(halfs[i]); }
+        } break;
+        case PixelFormat::PIXEL_FORMAT_R32G32B32A32_FLOAT: {
+            memcpy(outColor, texel, sizeof(float) * 4);
+        } break;
+        case PixelFormat::PIXEL_FORMAT_R8G8B8A8_UINT: {
+            for (int i = 0; i < 4; ++i) { outColor[i] = (float)(uint8_t)texel[i]; }
+        } break;
+        case PixelFormat::PIXEL_FORMAT_R16G16B16A16_UINT: {
+            uint16_t values[4];
+            memcpy(values, texel, sizeof(values));
+            for (int i = 0; i < 4; ++i) { outColor[i] = (float)values[i]; }
+        } break;
+        case PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT: {
+            memcpy(outColor, texel, sizeof(float));
+            outColor[1] = outColor[2] = 0.0f;
+            outColor[3] = 1.0f;
+        } break;
+        default: {
+            for (int i = 0; i < 4; ++i) { outColor[i] = (float)(uint8_t)texel[i] * (1.0f / 255.0f); }
+        } break;
+        }
+    }
+
+    static void StoreTexel(PixelFormat format, char* texel, const float* color)
+    {
+        switch (format) {
+        case PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT: {
+            uint16_t halfs[4];
+            for (int i = 0; i < 4; ++i) { halfs[i] = FloatToHalf(color[i]); }
+            memcpy(texel, halfs, sizeof(halfs));
+        } break;
+        case PixelFormat::PIXEL_FORMAT_R32G32B32A32_FLOAT: {
+            memcpy(texel, color, sizeof(float) * 4);
+        } break;
+        case PixelFormat::PIXEL_FORMAT_R8G8B8A8_UINT: {
+            for (int i = 0; i < 4; ++i) { texel[i] = (char)(uint8_t)Clamp(color[i], 0.0f, 255.0f); }
+        } break;
+        case PixelFormat::PIXEL_FORMAT_R16G16B16A16_UINT: {
+            uint16_t values[4];
+            for (int i = 0; i < 4; ++i) { values[i] = (uint16_t)Clamp(color[i], 0.0f, 65535.0f); }
+            memcpy(texel, values, sizeof(values));
+        } break;
+        case PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT: {
+            memcpy(texel, color, sizeof(float));
+        } break;
+        default: {
+            for (int i = 0; i < 4; ++i) { texel[i] = (char)(uint8_t)(Clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f); }
+        } break;
+        }
+    }
+
+    static void GetMipSize(SoftImage* image, uint32_t mip, uint32_t* outWidth, uint32_t* outHeight)
+    {
+        uint32_t width = image->desc.width >> mip;
+        uint32_t height = image->desc.height >> mip;
+        *outWidth = width > 0 ? width : 1;
+        *outHeight = height > 0 ? height : 1;
+    }
+
+    static uint32_t GetNumMipmaps(const SoftImage* image)
+    {
+        return image->desc.numMipmaps > 0 ? image->desc.numMipmaps : 1;
+    }
+
+    static uint32_t GetNumSlices(const SoftImage* image)
+    {
+        if (image->desc.type == ImageType::IMAGE_TYPE_CUBE) { return 6; }
+        return image->desc.numSlices > 0 ? image->desc.numSlices : 1;
+    }
+
+    static void AllocateImageData(fnd::memory::MemoryArenaBase* memoryArena, SoftImage* image)
+    {
+        image->texelSize = GetTexelSize(image->format);
+        uint32_t numMipmaps = GetNumMipmaps(image);
+        image->numSubresources = GetNumSlices(image) * numMipmaps;
+        image->subresourceOffsets = GT_NEW_ARRAY(size_t, image->numSubresources, memoryArena);
+        size_t size = 0;
+        for (uint32_t i = 0; i < image->numSubresources; ++i) {
+            uint32_t width, height;
+            GetMipSize(image, i % numMipmaps, &width, &height);
+            image->subresourceOffsets[i] = size;
+            size += (size_t)width * height * image->texelSize;
+        }
+        image->data = GT_NEW_ARRAY(char, size, memoryArena);
+    }
+
+    static bool GetRenderTarget(SoftImage* image, uint32_t mip, uint32_t slice, RenderTarget* outTarget, uint32_t* outWidth, uint32_t* outHeight)
+    {
+        uint32_t numMipmaps = GetNumMipmaps(image);
+        if (mip >= numMipmaps || slice >= GetNumSlices(image)) { return false; }
+        GetMipSize(image, mip, outWidth, outHeight);
+        outTarget->data = image->data + image->subresourceOffsets[slice * numMipmaps + mip];
+        outTarget->format = image->format;
+        outTarget->texelSize = image->texelSize;
+        outTarget->pitch = *outWidth * image->texelSize;
+        return true;
+    }
+
+    //
+    //
+
+    static void RasterizeTiles(Device* device);
+
+    static void* WorkerThread(void* data)
+    {
+        Device* device = (Device*)data;
+        uint32_t generation = 0;
+        for (;;) {
+            pthread_mutex_lock(&device->mutex);
+            while (device->jobGeneration == generation) {
+                pthread_cond_wait(&device->wakeCondition, &device->mutex);
+            }
+            generation = device->jobGeneration;
+            pthread_mutex_unlock(&device->mutex);
+
+            RasterizeTiles(device);
+
+            pthread_mutex_lock(&device->mutex);
+            if (--device->numBusyThreads == 0) {
+                pthread_cond_signal(&device->doneCondition);
+            }
+            pthread_mutex_unlock(&device->mutex);
+        }
+        return nullptr;
+    }
+
+    static void StartWorkers(Device* device)
+    {
+        pthread_mutex_init(&device->mutex, nullptr);
+        pthread_cond_init(&device->wakeCondition, nullptr);
+        pthread_cond_init(&device->doneCondition, nullptr);
+
+        // the submitting thread rasterizes as well
+        long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+        uint32_t numWorkers = numCores > 1 ? (uint32_t)(numCores - 1) : 0;
+        if (numWorkers > SOFT_GFX_MAX_WORKERS) { numWorkers = SOFT_GFX_MAX_WORKERS; }
+        device->numThreads = 0;
+        for (uint32_t i = 0; i < numWorkers; ++i) {
+            if (pthread_create(&device->threads[device->numThreads], nullptr, WorkerThread, device) != 0) {
+                GT_LOG_ERROR("SoftGfx", "Failed to start worker thread %u, continuing with %u", i, device->numThreads);
+                break;
+            }
+            device->numThreads++;
+        }
+        device->stats.numThreads = device->numThreads + 1;
+    }
+
+    // rasterizes everything binned so far, the render pass stays active
+    static void FlushRenderPass(Device* device)
+    {
+        if (!device->isInRenderPass || (device->triangles.size == 0 && !device->hasPendingClear)) {
+            return;
+        }
+        device->stats.numFlushes++;
+        device->nextTile = 0;
+
+        pthread_mutex_lock(&device->mutex);
+        device->jobGeneration++;
+        device->numBusyThreads = device->numThreads;
+        pthread_cond_broadcast(&device->wakeCondition);
+        pthread_mutex_unlock(&device->mutex);
+
+        RasterizeTiles(device);
+
+        pthread_mutex_lock(&device->mutex);
+        while (device->numBusyThreads > 0) {
+            pthread_cond_wait(&device->doneCondition, &device->mutex);
+        }
+        pthread_mutex_unlock(&device->mutex);
+
+        device->hasPendingClear = false;
+        device->draws.size = 0;
+        device->triangles.size = 0;
+        device->varyings.size = 0;
+    }
+
+    //
+    //
+
+    bool CreateInterface(Interface** outInterface, InterfaceDesc* desc, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        Interface* interf = GT_NEW(Interface, memoryArena);
+        *outInterface = interf;
+
+        interf->memoryArena = memoryArena;
+
+        interf->deviceList = GT_NEW_ARRAY(Device, 1, memoryArena);
+        interf->deviceList[0].interf = interf;
+        interf->deviceList[0].info.index = 0;
+        strncpy(interf->deviceList[0].info.friendlyName, "Software rasterizer", GFX_DEVICE_INFO_NAME_LEN - 1);
+        interf->numDevices = 1;
+
+        bool poolsInitialized = interf->bufferPool.Initialize(desc->bufferPoolSize, memoryArena, "Buffer")
+            && interf->imagePool.Initialize(desc->imagePoolSize, memoryArena, "Image")
+            && interf->pipelineStatePool.Initialize(desc->pipelinePoolSize, memoryArena, "Pipeline state")
+            && interf->shaderPool.Initialize(desc->shaderPoolSize, memoryArena, "Shader")
+            && interf->passPool.Initialize(desc->renderPassPoolSize, memoryArena, "Render pass")
+            && interf->cmdBufferPool.Initialize(desc->cmdBufferPoolSize, memoryArena, "Command buffer")
+            && interf->bindGroupPool.Initialize(desc->bindGroupPoolSize, memoryArena, "Bind group")
+            && interf->swapChainPool.Initialize(desc->maxNumSwapChains, memoryArena, "Swap chain");
+
+        return poolsInitialized;
+    }
+
+    void EnumerateDevices(Interface* interf, DeviceInfo* outInfo, uint32_t* numDevices)
+    {
+        *numDevices = interf->numDevices;
+        for (uint32_t i = 0; i < *numDevices; ++i) {
+            outInfo[i] = interf->deviceList[i].info;
+        }
+    }
+
+    Device* GetDevice(Interface* interf, uint32_t index)
+    {
+        if (index >= interf->numDevices) { return nullptr; }
+        Device* device = &interf->deviceList[index];
+        if (device->isCreated) { return device; }
+
+        SoftCommandBuffer* immediateBuffer;
+        if (!interf->cmdBufferPool.Allocate(&immediateBuffer, &device->immediateCmdBuffer.id)) {
+            return nullptr;
+        }
+        immediateBuffer->associatedDevice = device;
+        immediateBuffer->resState = _ResourceState::STATE_VALID;
+        InvalidateStateCache(&immediateBuffer->stateCache);
+        InvalidateResolvedDrawInputs(&device->resolvedDrawInputs);
+        InitializePipelineCache(&device->pipelineCache, interf->memoryArena);
+
+        StartWorkers(device);
+        device->isCreated = true;
+        return device;
+    }
+
+    CommandBuffer GetImmediateCommandBuffer(Device* device)
+    {
+        return device->immediateCmdBuffer;
+    }
+
+    void GetSoftDeviceStats(Device* device, SoftDeviceStats* outStats)
+    {
+        *outStats = device->stats;
+    }
+
+    void ResetSoftDeviceStats(Device* device)
+    {
+        uint32_t numThreads = device->stats.numThreads;
+        device->stats = SoftDeviceStats();
+        device->stats.numThreads = numThreads;
+    }
+
+    //
+    //
+
+    Buffer CreateBuffer(Device* device, BufferDesc* desc)
+    {
+        ResourceUsage usage = desc->usage == ResourceUsage::_DEFAULT ? ResourceUsage::USAGE_IMMUTABLE : desc->usage;
+        if (desc->byteWidth == 0 || (usage == ResourceUsage::USAGE_IMMUTABLE && desc->initialData == nullptr)) {
+            GT_LOG_ERROR("SoftGfx", "Invalid buffer of %llu bytes", (unsigned long long)desc->byteWidth);
+            return { INVALID_ID };
+        }
+
+        SoftBuffer* buffer = nullptr;
+        Buffer result;
+        if (!device->interf->bufferPool.Allocate(&buffer, &result.id)) {
+            return { INVALID_ID };
+        }
+        buffer->desc = *desc;
+        buffer->desc.usage = usage;
+        buffer->desc.initialData = nullptr;
+        buffer->desc.initialDataSize = 0;
+        buffer->data = GT_NEW_ARRAY(char, desc->byteWidth, device->interf->memoryArena);
+        if (desc->initialData != nullptr) {
+            size_t size = desc->initialDataSize < desc->byteWidth ? desc->initialDataSize : desc->byteWidth;
+            memcpy(buffer->data, desc->initialData, size);
+        }
+        buffer->associatedDevice = device;
+        buffer->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    // converts texels of the external format, at most size bytes of them
+    static void WriteSubresource(SoftImage* image, uint32_t subresource, const void* data, size_t size)
+    {
+        uint32_t width, height;
+        GetMipSize(image, subresource % GetNumMipmaps(image), &width, &height);
+        uint32_t externalTexelSize = GetExternalTexelSize(image->format);
+        size_t numTexels = (size_t)width * height;
+        if (size / externalTexelSize < numTexels) {
+            numTexels = size / externalTexelSize;
+        }
+        char* dst = image->data + image->subresourceOffsets[subresource];
+        const char* src = (const char*)data;
+        if (externalTexelSize == image->texelSize) {
+            memcpy(dst, src, numTexels * image->texelSize);
+        }
+        else {
+            for (size_t j = 0; j < numTexels; ++j) {
+                memcpy(dst + j * image->texelSize, src + j * externalTexelSize, image->texelSize);
+            }
+        }
+    }
+
+    Image CreateImage(Device* device, ImageDesc* desc)
+    {
+        if (desc->width == 0 || desc->height == 0) {
+            GT_LOG_ERROR("SoftGfx", "Invalid image of %ix%i", desc->width, desc->height);
+            return { INVALID_ID };
+        }
+        if (desc->isStreamed && (desc->type != ImageType::IMAGE_TYPE_2D || desc->numSlices != 1 || desc->isRenderTarget
+            || desc->isDepthStencilTarget || desc->firstResidentMip >= desc->numMipmaps)) {
+            GT_LOG_ERROR("SoftGfx", "Streamed image of %ix%i has to be a 2D image with resident mips", desc->width, desc->height);
+            return { INVALID_ID };
+        }
+
+        SoftImage* image = nullptr;
+        Image result;
+        if (!device->interf->imagePool.Allocate(&image, &result.id)) {
+            return { INVALID_ID };
+        }
+        image->desc = *desc;
+        image->desc.samplerDesc = nullptr;
+        image->desc.numDataItems = 0;
+        image->desc.initialData = nullptr;
+        image->desc.initialDataSizes = nullptr;
+        image->sampler = desc->samplerDesc != nullptr ? *desc->samplerDesc : SamplerDesc();
+        image->format = GetStorageFormat(desc);
+        AllocateImageData(device->interf->memoryArena, image);
+
+        // @NOTE streamed images keep all mips in memory here, only sampling is limited to the resident ones
+        image->desc.firstResidentMip = desc->isStreamed ? desc->firstResidentMip : 0;
+        uint32_t firstSubresource = image->desc.firstResidentMip;
+        size_t numDataItems = desc->numDataItems < image->numSubresources - firstSubresource ? desc->numDataItems : image->numSubresources - firstSubresource;
+        for (size_t i = 0; i < numDataItems; ++i) {
+            if (desc->initialData[i] == nullptr) { continue; }
+            size_t size = desc->initialDataSizes != nullptr ? desc->initialDataSizes[i] : (size_t)-1;
+            WriteSubresource(image, firstSubresource + (uint32_t)i, desc->initialData[i], size);
+        }
+        image->associatedDevice = device;
+        image->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    Shader CreateShader(Device* device, ShaderDesc* desc)
+    {
+        SoftShader* shader = nullptr;
+        Shader result;
+        if (!device->interf->shaderPool.Allocate(&shader, &result.id)) {
+            return { INVALID_ID };
+        }
+        shader->desc = *desc;
+        shader->desc.code = nullptr;
+        shader->associatedDevice = device;
+        shader->resState = _ResourceState::STATE_VALID;
+        // @NOTE the code is ignored, shaders created from the same code can run different callbacks. the pipeline
+        // cache tells them apart by handle instead, so only draws with the same Shader objects share pipeline states
+        ShaderDesc cacheDesc = *desc;
+        cacheDesc.code = (char*)&result.id;
+        cacheDesc.codeSize = sizeof(result.id);
+        RegisterShader(&device->pipelineCache, result, &cacheDesc);
+        return result;
+    }
+
+    bool RegisterVertexShader(Device* device, Shader shader, SoftVertexShaderFunc func, uint32_t numVaryings, void* userData)
+    {
+        SoftShader* shaderObj = device->interf->shaderPool.Get(shader.id);
+        if (shaderObj == nullptr || shaderObj->desc.type != ShaderType::SHADER_TYPE_VS || numVaryings > SOFT_GFX_MAX_VARYINGS) {
+            GT_LOG_ERROR("SoftGfx", "Can't register vertex shader for shader 0x%08x", shader.id);
+            return false;
+        }
+        shaderObj->vertexFunc = func;
+        shaderObj->numVaryings = numVaryings;
+        shaderObj->userData = userData;
+        return true;
+    }
+
+    bool RegisterPixelShader(Device* device, Shader shader, SoftPixelShaderFunc func, void* userData)
+    {
+        SoftShader* shaderObj = device->interf->shaderPool.Get(shader.id);
+        if (shaderObj == nullptr || shaderObj->desc.type != ShaderType::SHADER_TYPE_PS) {
+            GT_LOG_ERROR("SoftGfx", "Can't register pixel shader for shader 0x%08x", shader.id);
+            return false;
+        }
+        shaderObj->pixelFunc = func;
+        shaderObj->userData = userData;
+        return true;
+    }
+
+    PipelineState CreatePipelineState(Device* device, PipelineStateDesc* desc)
+    {
+        if (device->interf->shaderPool.Get(desc->vertexShader.id) == nullptr || device->interf->shaderPool.Get(desc->pixelShader.id) == nullptr) {
+            GT_LOG_ERROR("SoftGfx", "Pipeline state needs a vertex and a pixel shader, got 0x%08x and 0x%08x", desc->vertexShader.id, desc->pixelShader.id);
+            return { INVALID_ID };
+        }
+
+        PipelineKey key;
+        bool isCacheable = BuildPipelineKey(&device->pipelineCache, desc, &key);
+        if (isCacheable) {
+            PipelineState cached = FindPipelineState(&device->pipelineCache, &key);
+            if (GFX_CHECK_RESOURCE(cached)) { return cached; }
+        }
+
+        SoftPipelineState* pipelineState = nullptr;
+        PipelineState result;
+        if (!device->interf->pipelineStatePool.Allocate(&pipelineState, &result.id)) {
+            return { INVALID_ID };
+        }
+        pipelineState->desc = *desc;
+        pipelineState->associatedDevice = device;
+        pipelineState->resState = _ResourceState::STATE_VALID;
+
+        PipelineState cached = isCacheable ? AddPipelineState(&device->pipelineCache, &key, result) : result;
+        if (cached.id != result.id) {
+            device->interf->pipelineStatePool.Free(result.id);   // another thread created the same one
+        }
+        return cached;
+    }
+
+    RenderPass CreateRenderPass(Device* device, RenderPassDesc* desc)
+    {
+        for (size_t i = 0; i < GFX_MAX_COLOR_ATTACHMENTS + 1; ++i) {
+            Image image = i < GFX_MAX_COLOR_ATTACHMENTS ? desc->colorAttachments[i].image : desc->depthStencilAttachment.image;
+            if (GFX_CHECK_RESOURCE(image) && device->interf->imagePool.Get(image.id) == nullptr) {
+                GT_LOG_ERROR("SoftGfx", "Render pass attachment %i is invalid image 0x%08x", (int)i, image.id);
+                return { INVALID_ID };
+            }
+        }
+
+        SoftRenderPass* renderPass = nullptr;
+        RenderPass result;
+        if (!device->interf->passPool.Allocate(&renderPass, &result.id)) {
+            return { INVALID_ID };
+        }
+        renderPass->desc = *desc;
+        renderPass->associatedDevice = device;
+        renderPass->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    CommandBuffer CreateCommandBuffer(Device* device, CommandBufferDesc* desc)
+    {
+        SoftCommandBuffer* cmdBuffer = nullptr;
+        CommandBuffer result;
+        if (!device->interf->cmdBufferPool.Allocate(&cmdBuffer, &result.id)) {
+            return { INVALID_ID };
+        }
+        if (!InitializeCommandStream(&cmdBuffer->stream, desc->memorySize, device->interf->memoryArena)) {
+            GT_LOG_ERROR("SoftGfx", "Command buffer with %llu bytes of memory", (unsigned long long)desc->memorySize);
+            device->interf->cmdBufferPool.Free(result.id);
+            return { INVALID_ID };
+        }
+        cmdBuffer->isDeferred = true;
+        cmdBuffer->associatedDevice = device;
+        cmdBuffer->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    BindGroup CreateBindGroup(Device* device, BindGroupDesc* desc)
+    {
+        if (!ValidateBindGroupDesc(device, desc)) {
+            return { INVALID_ID };
+        }
+
+        SoftBindGroup* bindGroup = nullptr;
+        BindGroup result;
+        if (!device->interf->bindGroupPool.Allocate(&bindGroup, &result.id)) {
+            return { INVALID_ID };
+        }
+        InitializeBindGroupData(&bindGroup->data, desc);
+        bindGroup->associatedDevice = device;
+        bindGroup->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    static void AllocateSwapChainImages(Device* device, SoftSwapChain* swapChain)
+    {
+        SoftImage* images[] = { &swapChain->backBuffer, &swapChain->depthBuffer };
+        for (SoftImage* image : images) {
+            image->desc.type = ImageType::IMAGE_TYPE_2D;
+            image->desc.width = (uint16_t)swapChain->desc.width;
+            image->desc.height = (uint16_t)swapChain->desc.height;
+            image->desc.isRenderTarget = image == &swapChain->backBuffer;
+            image->desc.isDepthStencilTarget = image == &swapChain->depthBuffer;
+            image->desc.pixelFormat = image->desc.isDepthStencilTarget ? PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT : PixelFormat::PIXEL_FORMAT_R8G8B8A8_UNORM;
+            image->format = GetStorageFormat(&image->desc);
+            AllocateImageData(device->interf->memoryArena, image);
+        }
+    }
+
+    SwapChain CreateSwapChain(Device* device, SwapChainDesc* desc)
+    {
+        if (desc->width == 0 || desc->height == 0 || desc->width > 0xffff || desc->height > 0xffff) {
+            GT_LOG_ERROR("SoftGfx", "Invalid swap chain of %ux%u", desc->width, desc->height);
+            return { INVALID_ID };
+        }
+
+        SoftSwapChain* swapChain = nullptr;
+        SwapChain result;
+        if (!device->interf->swapChainPool.Allocate(&swapChain, &result.id)) {
+            return { INVALID_ID };
+        }
+        swapChain->desc = *desc;
+        AllocateSwapChainImages(device, swapChain);
+        swapChain->associatedDevice = device;
+        swapChain->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    void ResizeSwapChain(Device* device, SwapChain handle, uint32_t width, uint32_t height)
+    {
+        SoftSwapChain* swapChain = device->interf->swapChainPool.Get(handle.id);
+        if (swapChain == nullptr || width == 0 || height == 0 || width > 0xffff || height > 0xffff) {
+            GT_LOG_ERROR("SoftGfx", "Can't resize swap chain 0x%08x to %ux%u", handle.id, width, height);
+            return;
+        }
+        assert(!device->isInRenderPass);
+        FreeImageData(device->interf->memoryArena, &swapChain->backBuffer);
+        FreeImageData(device->interf->memoryArena, &swapChain->depthBuffer);
+        swapChain->desc.width = width;
+        swapChain->desc.height = height;
+        AllocateSwapChainImages(device, swapChain);
+    }
+
+    void DestroyBuffer(Device* device, Buffer buffer)
+    {
+        FlushRenderPass(device);
+        if (!device->interf->bufferPool.Free(buffer.id)) {
+            GT_LOG_ERROR("SoftGfx", "Destroying invalid buffer 0x%08x", buffer.id);
+        }
+    }
+
+    void DestroyImage(Device* device, Image image)
+    {
+        FlushRenderPass(device);
+        if (!device->interf->imagePool.Free(image.id)) {
+            GT_LOG_ERROR("SoftGfx", "Destroying invalid image 0x%08x", image.id);
+        }
+    }
+
+    void DestroyCommandBuffer(Device* device, CommandBuffer cmdBuffer)
+    {
+        SoftCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (cmdBuf == nullptr || !cmdBuf->isDeferred) {
+            GT_LOG_ERROR("SoftGfx", "Destroying invalid or immediate command buffer 0x%08x", cmdBuffer.id);
+            return;
+        }
+        device->interf->cmdBufferPool.Free(cmdBuffer.id);
+    }
+
+    void DestroyBindGroup(Device* device, BindGroup bindGroup)
+    {
+        if (!device->interf->bindGroupPool.Free(bindGroup.id)) {
+            GT_LOG_ERROR("SoftGfx", "Destroying invalid bind group 0x%08x", bindGroup.id);
+        }
+    }
+
+    BufferDesc GetBufferDesc(Device* device, Buffer buffer)
+    {
+        SoftBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        return bufferObj != nullptr ? bufferObj->desc : BufferDesc();
+    }
+
+    ImageDesc GetImageDesc(Device* device, Image image)
+    {
+        SoftImage* imageObj = device->interf->imagePool.Get(image.id);
+        return imageObj != nullptr ? imageObj->desc : ImageDesc();
+    }
+
+    PipelineStateDesc GetPipelineStateDesc(Device* device, PipelineState pipelineState)
+    {
+        SoftPipelineState* pipelineStateObj = device->interf->pipelineStatePool.Get(pipelineState.id);
+        return pipelineStateObj != nullptr ? pipelineStateObj->desc : PipelineStateDesc();
+    }
+
+    ShaderDesc GetShaderDesc(Device* device, Shader shader)
+    {
+        SoftShader* shaderObj = device->interf->shaderPool.Get(shader.id);
+        return shaderObj != nullptr ? shaderObj->desc : ShaderDesc();
+    }
+
+    RenderPass GetRenderPassDesc(Device* device, RenderPass pass)
+    {
+        return device->interf->passPool.Get(pass.id) != nullptr ? pass : RenderPass();
+    }
+
+    SwapChainDesc GetSwapChainDesc(Device* device, SwapChain swapChain)
+    {
+        SoftSwapChain* swapChainObj = device->interf->swapChainPool.Get(swapChain.id);
+        return swapChainObj != nullptr ? swapChainObj->desc : SwapChainDesc();
+    }
+
+    //
+    //
+
+    // commands on deferred command buffers are only recorded, this may run on any thread so it touches nothing else
+    static CommandStream* GetDeferredStream(Device* device, CommandBuffer cmdBuffer)
+    {
+        SoftCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        return cmdBuf != nullptr && cmdBuf->isDeferred ? &cmdBuf->stream : nullptr;
+    }
+
+    static bool BeginPass(Device* device, CommandBuffer cmdBuffer, RenderPassAction* action)
+    {
+        SoftCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (cmdBuf == nullptr || device->isInRenderPass) {
+            GT_LOG_ERROR("SoftGfx", "Can't begin render pass on command buffer 0x%08x, is another one active?", cmdBuffer.id);
+            return false;
+        }
+        cmdBuf->isInRenderPass = true;
+        InvalidateImageInputs(&cmdBuf->stateCache);
+        device->stateChangeStats.numRenderTargetChanges++;
+        device->isInRenderPass = true;
+        device->action = *action;
+        device->numColorTargets = 0;
+        device->depthTarget = RenderTarget();
+        return true;
+    }
+
+    static void SetupTiles(Device* device)
+    {
+        device->numTilesX = (device->width + SOFT_GFX_TILE_SIZE - 1) / SOFT_GFX_TILE_SIZE;
+        device->numTilesY = (device->height + SOFT_GFX_TILE_SIZE - 1) / SOFT_GFX_TILE_SIZE;
+        uint32_t numTiles = device->numTilesX * device->numTilesY;
+        if (numTiles > device->binCapacity) {
+            GrowableArray<uint32_t>* bins = GT_NEW_ARRAY(GrowableArray<uint32_t>, numTiles, device->interf->memoryArena);
+            if (device->bins != nullptr) {
+                memcpy(bins, device->bins, sizeof(GrowableArray<uint32_t>) * device->binCapacity);
+                GT_DELETE_ARRAY(device->bins, device->interf->memoryArena);
+            }
+            device->bins = bins;
+            device->binCapacity = numTiles;
+        }
+
+        device->hasPendingClear = device->depthTarget.data != nullptr && device->action.depth.action == Action::ACTION_CLEAR;
+        for (uint32_t i = 0; i < device->numColorTargets; ++i) {
+            device->hasPendingClear = device->hasPendingClear || device->action.colors[i].action == Action::ACTION_CLEAR;
+        }
+    }
+
+    void BeginDefaultRenderPass(Device* device, CommandBuffer cmdBuffer, SwapChain swapChain, RenderPassAction* action)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordBeginDefaultRenderPass(stream, swapChain, action);
+            return;
+        }
+        SoftSwapChain* swapChainObj = device->interf->swapChainPool.Get(swapChain.id);
+        if (swapChainObj == nullptr) {
+            GT_LOG_ERROR("SoftGfx", "Beginning render pass on invalid swap chain 0x%08x", swapChain.id);
+            return;
+        }
+        if (!BeginPass(device, cmdBuffer, action)) { return; }
+        GetRenderTarget(&swapChainObj->backBuffer, 0, 0, &device->colorTargets[0], &device->width, &device->height);
+        GetRenderTarget(&swapChainObj->depthBuffer, 0, 0, &device->depthTarget, &device->width, &device->height);
+        device->numColorTargets = 1;
+        SetupTiles(device);
+    }
+
+    void BeginRenderPass(Device* device, CommandBuffer cmdBuffer, RenderPass renderPass, RenderPassAction* action)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordBeginRenderPass(stream, renderPass, action);
+            return;
+        }
+        SoftRenderPass* pass = device->interf->passPool.Get(renderPass.id);
+        if (pass == nullptr) {
+            GT_LOG_ERROR("SoftGfx", "Beginning invalid render pass 0x%08x", renderPass.id);
+            return;
+        }
+        if (!BeginPass(device, cmdBuffer, action)) { return; }
+
+        // all attachments are rendered to in the size of the first one, like D3D11 does with the viewport
+        device->width = device->height = 0;
+        for (uint32_t i = 0; i < GFX_MAX_COLOR_ATTACHMENTS + 1; ++i) {
+            AttachmentDesc* attachment = i < GFX_MAX_COLOR_ATTACHMENTS ? &pass->desc.colorAttachments[i] : &pass->desc.depthStencilAttachment;
+            if (!GFX_CHECK_RESOURCE(attachment->image)) {
+                if (i < GFX_MAX_COLOR_ATTACHMENTS) { i = GFX_MAX_COLOR_ATTACHMENTS - 1; }
+                continue;
+            }
+            SoftImage* image = device->interf->imagePool.Get(attachment->image.id);
+            RenderTarget* target = i < GFX_MAX_COLOR_ATTACHMENTS ? &device->colorTargets[device->numColorTargets] : &device->depthTarget;
+            uint32_t width, height;
+            if (image == nullptr || !GetRenderTarget(image, attachment->mipmapLevel, attachment->slice, target, &width, &height)) {
+                GT_LOG_ERROR("SoftGfx", "Render pass 0x%08x uses invalid image 0x%08x", renderPass.id, attachment->image.id);
+                *target = RenderTarget();
+                continue;
+            }
+            if (device->width == 0) {
+                device->width = width;
+                device->height = height;
+            }
+            else if (width < device->width || height < device->height) {
+                GT_LOG_ERROR("SoftGfx", "Render pass 0x%08x attachment %u is smaller than the first one", renderPass.id, i);
+                *target = RenderTarget();
+                continue;
+            }
+            if (i < GFX_MAX_COLOR_ATTACHMENTS) {
+                device->numColorTargets++;
+            }
+        }
+        SetupTiles(device);
+    }
+
+    void EndRenderPass(Device* device, CommandBuffer cmdBuffer)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordEndRenderPass(stream);
+            return;
+        }
+        SoftCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (cmdBuf == nullptr || !cmdBuf->isInRenderPass) {
+            GT_LOG_ERROR("SoftGfx", "Ending render pass on command buffer 0x%08x that wasn't begun", cmdBuffer.id);
+            return;
+        }
+        FlushRenderPass(device);
+        cmdBuf->isInRenderPass = false;
+        device->isInRenderPass = false;
+    }
+
+    //
+    //
+
+    static void GatherResources(Device* device, Buffer* constantInputs, uint32_t* constantOffsets, Image* imageInputs, SoftShaderResources* outResources)
+    {
+        for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+            SoftBuffer* buffer = device->interf->bufferPool.Get(constantInputs[i].id);
+            outResources->constants[i] = nullptr;
+            if (buffer != nullptr && constantOffsets[i] < buffer->desc.byteWidth) {
+                outResources->constants[i] = buffer->data + constantOffsets[i];
+            }
+        }
+        for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+            outResources->images[i] = device->interf->imagePool.Get(imageInputs[i].id);
+        }
+    }
+
+    struct VertexAttribStream
+    {
+        const char*     data;       // first vertex
+        size_t          size;       // bytes from there to the end of the buffer
+        uint32_t        stride;
+        VertexFormat    format;
+    };
+
+    static const uint32_t g_vertexFormatSize[] = { 0, 4, 8, 12, 16, 4 };
+
+    static void FetchVertex(VertexAttribStream* streams, uint32_t numStreams, uint32_t vertexIndex, SoftVertexInput* input)
+    {
+        for (uint32_t i = 0; i < numStreams; ++i) {
+            float* attrib = input->attribs[i];
+            attrib[0] = attrib[1] = attrib[2] = 0.0f;
+            attrib[3] = 1.0f;
+            size_t offset = (size_t)vertexIndex * streams[i].stride;
+            uint32_t formatSize = g_vertexFormatSize[(uint8_t)streams[i].format];
+            if (offset + formatSize > streams[i].size) { continue; }
+            const char* src = streams[i].data + offset;
+            if (streams[i].format == VertexFormat::VERTEX_FORMAT_R8G8B8A8_UNNORM) {
+                for (int j = 0; j < 4; ++j) { attrib[j] = (float)(uint8_t)src[j] * (1.0f / 255.0f); }
+            }
+            else {
+                memcpy(attrib, src, formatSize);
+            }
+        }
+    }
+
+    struct ClipVertex
+    {
+        float   position[4];
+        float   varyings[SOFT_GFX_MAX_VARYINGS];
+    };
+
+    struct TriangleSetup
+    {
+        const PipelineStateDesc*    pipelineState;
+        uint32_t                    drawIndex;
+        uint32_t                    numVaryings;
+        float                       viewportWidth;
+        float                       viewportHeight;
+        int32_t                     minX, minY, maxX, maxY;    // inclusive pixel bounds of viewport and scissor
+    };
+
+    static void BinTriangle(Device* device, Triangle* triangle, uint32_t triangleIndex)
+    {
+        int32_t firstTileX = triangle->minX / SOFT_GFX_TILE_SIZE;
+        int32_t lastTileX = triangle->maxX / SOFT_GFX_TILE_SIZE;
+        int32_t firstTileY = triangle->minY / SOFT_GFX_TILE_SIZE;
+        int32_t lastTileY = triangle->maxY / SOFT_GFX_TILE_SIZE;
+        for (int32_t tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+            float minY = (float)(tileY * SOFT_GFX_TILE_SIZE > triangle->minY ? tileY * SOFT_GFX_TILE_SIZE : triangle->minY) + 0.5f;
+            float maxY = (float)((tileY + 1) * SOFT_GFX_TILE_SIZE - 1 < triangle->maxY ? (tileY + 1) * SOFT_GFX_TILE_SIZE - 1 : triangle->maxY) + 0.5f;
+            for (int32_t tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+                float minX = (float)(tileX * SOFT_GFX_TILE_SIZE > triangle->minX ? tileX * SOFT_GFX_TILE_SIZE : triangle->minX) + 0.5f;
+                float maxX = (float)((tileX + 1) * SOFT_GFX_TILE_SIZE - 1 < triangle->maxX ? (tileX + 1) * SOFT_GFX_TILE_SIZE - 1 : triangle->maxX) + 0.5f;
+                // skip tiles entirely outside of one edge, tested at the pixel center furthest inside
+                bool isOutside = false;
+                for (int i = 0; i < 3 && !isOutside; ++i) {
+                    float x = triangle->edgeA[i] > 0.0f ? maxX : minX;
+                    float y = triangle->edgeB[i] > 0.0f ? maxY : minY;
+                    isOutside = triangle->edgeA[i] * x + triangle->edgeB[i] * y + triangle->edgeC[i] < 0.0f;
+                }
+                if (isOutside) { continue; }
+                GrowableArray<uint32_t>* bin = &device->bins[tileY * device->numTilesX + tileX];
+                *Push(bin, 1, device->interf->memoryArena) = triangleIndex;
+                device->stats.numBinnedTriangles++;
+            }
+        }
+    }
+
+    static void SetupTriangle(Device* device, TriangleSetup* setup, const ClipVertex** vertices)
+    {
+        float screenX[3], screenY[3], z[3], invW[3];
+        for (int i = 0; i < 3; ++i) {
+            const float* position = vertices[i]->position;
+            invW[i] = 1.0f / position[3];
+            float x = (position[0] * invW[i] * 0.5f + 0.5f) * setup->viewportWidth;
+            float y = (0.5f - position[1] * invW[i] * 0.5f) * setup->viewportHeight;
+            screenX[i] = floorf(x * SUBPIXEL_STEPS + 0.5f) * (1.0f / SUBPIXEL_STEPS);
+            screenY[i] = floorf(y * SUBPIXEL_STEPS + 0.5f) * (1.0f / SUBPIXEL_STEPS);
+            z[i] = position[2] * invW[i];
+        }
+
+        // positive for clockwise triangles, y points down
+        float area = (screenX[1] - screenX[0]) * (screenY[2] - screenY[0]) - (screenX[2] - screenX[0]) * (screenY[1] - screenY[0]);
+        const RasterizerStateDesc& rasterState = setup->pipelineState->rasterState;
+        bool isFrontFace = (area > 0.0f) == (rasterState.cullOrder == CullOrder::CULL_ORDER_CLOCKWISE);
+        if (area == 0.0f
+            || (rasterState.cullMode == CullMode::CULL_BACK && !isFrontFace)
+            || (rasterState.cullMode == CullMode::CULL_FRONT && isFrontFace)) {
+            device->stats.numTrianglesCulled++;
+            return;
+        }
+        int order[3] = { 0, 1, 2 };
+        if (area < 0.0f) {
+            order[1] = 2;
+            order[2] = 1;
+            area = -area;
+        }
+
+        float minX = screenX[0], maxX = screenX[0], minY = screenY[0], maxY = screenY[0];
+        for (int i = 1; i < 3; ++i) {
+            minX = screenX[i] < minX ? screenX[i] : minX;
+            maxX = screenX[i] > maxX ? screenX[i] : maxX;
+            minY = screenY[i] < minY ? screenY[i] : minY;
+            maxY = screenY[i] > maxY ? screenY[i] : maxY;
+        }
+        // clip space clipping keeps these within a few viewports
+        int32_t pixelMinX = (int32_t)floorf(minX);
+        int32_t pixelMaxX = (int32_t)ceilf(maxX);
+        int32_t pixelMinY = (int32_t)floorf(minY);
+        int32_t pixelMaxY = (int32_t)ceilf(maxY);
+        pixelMinX = pixelMinX > setup->minX ? pixelMinX : setup->minX;
+        pixelMaxX = pixelMaxX < setup->maxX ? pixelMaxX : setup->maxX;
+        pixelMinY = pixelMinY > setup->minY ? pixelMinY : setup->minY;
+        pixelMaxY = pixelMaxY < setup->maxY ? pixelMaxY : setup->maxY;
+        if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY) {
+            device->stats.numTrianglesCulled++;
+            return;
+        }
+
+        uint32_t triangleIndex = device->triangles.size;
+        Triangle* triangle = Push(&device->triangles, 1, device->interf->memoryArena);
+        triangle->invArea = 1.0f / area;
+        triangle->topLeftMask = 0;
+        for (int i = 0; i < 3; ++i) {
+            int a = order[(i + 1) % 3];
+            int b = order[(i + 2) % 3];
+            float edgeA = screenY[a] - screenY[b];
+            float edgeB = screenX[b] - screenX[a];
+            triangle->edgeA[i] = edgeA;
+            triangle->edgeB[i] = edgeB;
+            triangle->edgeC[i] = -(edgeA * screenX[a] + edgeB * screenY[a]);
+            if (edgeA > 0.0f || (edgeA == 0.0f && edgeB > 0.0f)) {
+                triangle->topLeftMask |= 1 << i;
+            }
+            triangle->z[i] = z[order[i]];
+            triangle->invW[i] = invW[order[i]];
+        }
+        triangle->minX = pixelMinX;
+        triangle->maxX = pixelMaxX;
+        triangle->minY = pixelMinY;
+        triangle->maxY = pixelMaxY;
+        triangle->drawIndex = setup->drawIndex;
+        triangle->isFrontFace = isFrontFace;
+        triangle->firstVarying = device->varyings.size;
+
+        uint32_t numVaryings = setup->numVaryings;
+        float* varyings = Push(&device->varyings, numVaryings * 3, device->interf->memoryArena);
+        for (int i = 0; i < 3; ++i) {
+            for (uint32_t j = 0; j < numVaryings; ++j) {
+                varyings[i * numVaryings + j] = vertices[order[i]]->varyings[j] * invW[order[i]];
+            }
+        }
+
+        BinTriangle(device, triangle, triangleIndex);
+    }
+
+    static float GetClipDistance(const float* position, int plane)
+    {
+        switch (plane) {
+        case 0: return position[3] - MIN_CLIP_W;
+        case 1: return position[2];                     // near, depth is 0 to w like in D3D
+        default: return position[3] - position[2];      // far
+        }
+    }
+
+    static void ClipAndSetupTriangle(Device* device, TriangleSetup* setup, const ClipVertex* triangle)
+    {
+        int numPlanes = setup->pipelineState->rasterState.enableDepthClip ? 3 : 2;
+        bool isInside = true;
+        for (int plane = 0; plane < numPlanes; ++plane) {
+            float d0 = GetClipDistance(triangle[0].position, plane);
+            float d1 = GetClipDistance(triangle[1].position, plane);
+            float d2 = GetClipDistance(triangle[2].position, plane);
+            if (d0 < 0.0f && d1 < 0.0f && d2 < 0.0f) {
+                device->stats.numTrianglesCulled++;
+                return;
+            }
+            isInside = isInside && d0 >= 0.0f && d1 >= 0.0f && d2 >= 0.0f;
+        }
+        if (isInside) {
+            const ClipVertex* vertices[3] = { &triangle[0], &triangle[1], &triangle[2] };
+            SetupTriangle(device, setup, vertices);
+            return;
+        }
+
+        // sutherland hodgman against the planes the triangle crosses, then fan out the polygon
+        ClipVertex buffers[2][MAX_CLIP_VERTICES];
+        uint32_t numVertices = 3;
+        memcpy(buffers[0], triangle, sizeof(ClipVertex) * 3);
+        int current = 0;
+        uint32_t numComponents = 4 + setup->numVaryings;
+        for (int plane = 0; plane < numPlanes && numVertices >= 3; ++plane) {
+            ClipVertex* in = buffers[current];
+            ClipVertex* out = buffers[current ^ 1];
+            uint32_t numOut = 0;
+            for (uint32_t i = 0; i < numVertices; ++i) {
+                const ClipVertex* a = &in[i];
+                const ClipVertex* b = &in[(i + 1) % numVertices];
+                float da = GetClipDistance(a->position, plane);
+                float db = GetClipDistance(b->position, plane);
+                if (da >= 0.0f) {
+                    out[numOut++] = *a;
+                }
+                if ((da >= 0.0f) != (db >= 0.0f)) {
+                    float t = da / (da - db);
+                    ClipVertex* v = &out[numOut++];
+                    // position and varyings are contiguous
+                    const float* fa = a->position;
+                    const float* fb = b->position;
+                    float* fv = v->position;
+                    for (uint32_t j = 0; j < numComponents; ++j) {
+                        fv[j] = fa[j] + (fb[j] - fa[j]) * t;
+                    }
+                }
+            }
+            numVertices = numOut;
+            current ^= 1;
+        }
+        if (numVertices < 3) {
+            device->stats.numTrianglesCulled++;
+            return;
+        }
+        for (uint32_t i = 1; i + 1 < numVertices; ++i) {
+            const ClipVertex* vertices[3] = { &buffers[current][0], &buffers[current][i], &buffers[current][i + 1] };
+            SetupTriangle(device, setup, vertices);
+        }
+    }
+
+    struct VertexCacheEntry
+    {
+        uint32_t    vertexIndex;
+        ClipVertex  vertex;
+    };
+
+    static SoftCommandBuffer* GetDrawCommandBuffer(Device* device, CommandBuffer cmdBuffer)
+    {
+        SoftCommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (cmdBuf == nullptr || !cmdBuf->isInRenderPass) {
+            GT_LOG_ERROR("SoftGfx", "Draw call on command buffer 0x%08x outside of a render pass", cmdBuffer.id);
+            return nullptr;
+        }
+        return cmdBuf;
+    }
+
+    static void ExecuteDrawCall(Device* device, SoftCommandBuffer* cmdBuf, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    {
+        SoftPipelineState* pipelineState = device->interf->pipelineStatePool.Get(drawCall->pipelineState.id);
+        if (pipelineState == nullptr) {
+            GT_LOG_ERROR("SoftGfx", "Draw call uses invalid pipeline state 0x%08x", drawCall->pipelineState.id);
+            return;
+        }
+        Viewport passViewport = { (float)device->width, (float)device->height };
+        Rect passRect;
+        passRect.right = device->width;
+        passRect.bottom = device->height;
+        StateChanges changes;
+        UpdateStateCache(&cmdBuf->stateCache, drawCall, pipelineState->desc.indexFormat, viewport != nullptr ? viewport : &passViewport,
+            scissorRect != nullptr ? scissorRect : &passRect, &changes, &device->stateChangeStats);
+
+        const PipelineStateDesc* desc = &pipelineState->desc;
+        SoftShader* vertexShader = device->interf->shaderPool.Get(desc->vertexShader.id);
+        SoftShader* pixelShader = device->interf->shaderPool.Get(desc->pixelShader.id);
+        if (vertexShader == nullptr || vertexShader->vertexFunc == nullptr || pixelShader == nullptr || pixelShader->pixelFunc == nullptr) {
+            GT_LOG_ERROR("SoftGfx", "Pipeline state 0x%08x has no shader callbacks registered", drawCall->pipelineState.id);
+            return;
+        }
+        bool isStrip = desc->primitiveType == PrimitiveType::PRIMITIVE_TYPE_TRIANGLE_STRIP;
+        if (!isStrip && desc->primitiveType != PrimitiveType::PRIMITIVE_TYPE_TRIANGLES && desc->primitiveType != PrimitiveType::_DEFAULT) {
+            GT_LOG_ERROR("SoftGfx", "Primitive type %i is not supported", (int)desc->primitiveType);
+            return;
+        }
+
+        const char* indices = nullptr;
+        uint32_t indexSize = 0;
+        if (desc->indexFormat == IndexFormat::INDEX_FORMAT_UINT16 || desc->indexFormat == IndexFormat::INDEX_FORMAT_UINT32) {
+            SoftBuffer* indexBuffer = device->interf->bufferPool.Get(drawCall->indexBuffer.id);
+            indexSize = desc->indexFormat == IndexFormat::INDEX_FORMAT_UINT16 ? 2 : 4;
+            if (indexBuffer == nullptr || ((size_t)drawCall->elementOffset + drawCall->numElements) * indexSize > indexBuffer->desc.byteWidth) {
+                GT_LOG_ERROR("SoftGfx", "Draw call reads %u indices past the end of index buffer 0x%08x", drawCall->numElements, drawCall->indexBuffer.id);
+                return;
+            }
+            indices = indexBuffer->data + (size_t)drawCall->elementOffset * indexSize;
+        }
+
+        VertexAttribStream streams[GFX_MAX_VERTEX_ATTRIBS];
+        uint32_t numStreams = 0;
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_ATTRIBS; ++i) {
+            const VertexAttribDesc& attrib = desc->vertexLayout.attribs[i];
+            if (attrib.format == VertexFormat::VERTEX_FORMAT_INVALID) { break; }
+            VertexAttribStream* stream = &streams[numStreams++];
+            *stream = { nullptr, 0, 0, attrib.format };
+            SoftBuffer* vertexBuffer = attrib.slot < GFX_MAX_VERTEX_STREAMS ? device->interf->bufferPool.Get(drawCall->vertexBuffers[attrib.slot].id) : nullptr;
+            size_t offset = vertexBuffer != nullptr ? (size_t)drawCall->vertexOffsets[attrib.slot] + attrib.offset : 0;
+            if (vertexBuffer == nullptr || offset >= vertexBuffer->desc.byteWidth) {
+                GT_LOG_ERROR("SoftGfx", "Vertex attribute %u reads from invalid vertex buffer", i);
+                continue;
+            }
+            stream->data = vertexBuffer->data + offset;
+            stream->size = vertexBuffer->desc.byteWidth - offset;
+            stream->stride = drawCall->vertexStrides[attrib.slot];
+        }
+
+        uint32_t drawIndex = device->draws.size;
+        DrawState* draw = Push(&device->draws, 1, device->interf->memoryArena);
+        draw->pipelineState = desc;
+        draw->pixelFunc = pixelShader->pixelFunc;
+        draw->pixelUserData = pixelShader->userData;
+        draw->numVaryings = vertexShader->numVaryings;
+        GatherResources(device, drawCall->psConstantInputs, drawCall->psConstantOffsets, drawCall->psImageInputs, &draw->resources);
+        SoftShaderResources vertexResources;
+        GatherResources(device, drawCall->vsConstantInputs, drawCall->vsConstantOffsets, drawCall->vsImageInputs, &vertexResources);
+
+        TriangleSetup setup;
+        setup.pipelineState = desc;
+        setup.drawIndex = drawIndex;
+        setup.numVaryings = vertexShader->numVaryings;
+        setup.viewportWidth = viewport != nullptr ? viewport->width : (float)device->width;
+        setup.viewportHeight = viewport != nullptr ? viewport->height : (float)device->height;
+        setup.minX = 0;
+        setup.minY = 0;
+        setup.maxX = (int32_t)device->width - 1;
+        setup.maxY = (int32_t)device->height - 1;
+        if (desc->rasterState.enableScissor && scissorRect != nullptr) {
+            setup.minX = (int32_t)scissorRect->left > setup.minX ? (int32_t)scissorRect->left : setup.minX;
+            setup.minY = (int32_t)scissorRect->top > setup.minY ? (int32_t)scissorRect->top : setup.minY;
+            setup.maxX = (int32_t)scissorRect->right - 1 < setup.maxX ? (int32_t)scissorRect->right - 1 : setup.maxX;
+            setup.maxY = (int32_t)scissorRect->bottom - 1 < setup.maxY ? (int32_t)scissorRect->bottom - 1 : setup.maxY;
+        }
+
+        uint32_t numTriangles = isStrip ? (drawCall->numElements >= 3 ? drawCall->numElements - 2 : 0) : drawCall->numElements / 3;
+        uint32_t numInstances = drawCall->numInstances > 0 ? drawCall->numInstances : 1;
+        device->stats.numDrawCalls++;
+        device->stats.numTriangles += (uint64_t)numTriangles * numInstances;
+
+        // @NOTE small direct mapped cache, indexed meshes mostly reuse vertices of the last few triangles
+        VertexCacheEntry cache[VERTEX_CACHE_SIZE];
+        SoftVertexInput input;
+        input.resources = &vertexResources;
+        for (uint32_t instance = 0; instance < numInstances; ++instance) {
+            input.instanceID = drawCall->startInstanceLocation + instance;
+            for (uint32_t i = 0; i < VERTEX_CACHE_SIZE; ++i) {
+                cache[i].vertexIndex = 0xffffffff;
+            }
+            for (uint32_t i = 0; i < numTriangles; ++i) {
+                uint32_t elements[3] = { isStrip ? i : i * 3, isStrip ? i + 1 : i * 3 + 1, isStrip ? i + 2 : i * 3 + 2 };
+                if (isStrip && (i & 1)) {
+                    elements[0] = i + 1;
+                    elements[1] = i;
+                }
+                ClipVertex triangle[3];
+                for (int j = 0; j < 3; ++j) {
+                    uint32_t vertexIndex = elements[j];
+                    if (indexSize == 2) {
+                        uint16_t index;
+                        memcpy(&index, indices + vertexIndex * 2, sizeof(index));
+                        vertexIndex = index;
+                    }
+                    else if (indexSize == 4) {
+                        memcpy(&vertexIndex, indices + vertexIndex * 4, sizeof(vertexIndex));
+                    }
+                    vertexIndex += drawCall->startVertexLocation;
+
+                    VertexCacheEntry* entry = &cache[vertexIndex % VERTEX_CACHE_SIZE];
+                    if (entry->vertexIndex != vertexIndex) {
+                        input.vertexID = vertexIndex;
+                        FetchVertex(streams, numStreams, vertexIndex, &input);
+                        SoftVertexOutput output;
+                        memset(&output, 0, sizeof(output));
+                        vertexShader->vertexFunc(&input, &output, vertexShader->userData);
+                        memcpy(entry->vertex.position, output.position, sizeof(output.position));
+                        memcpy(entry->vertex.varyings, output.varyings, sizeof(output.varyings));
+                        entry->vertexIndex = vertexIndex;
+                    }
+                    triangle[j] = entry->vertex;
+                }
+                ClipAndSetupTriangle(device, &setup, triangle);
+            }
+        }
+    }
+
+    void SubmitDrawCall(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawCall(stream, drawCall, viewport, scissorRect);
+            return;
+        }
+        if (SoftCommandBuffer* cmdBuf = GetDrawCommandBuffer(device, cmdBuffer)) {
+            ExecuteDrawCall(device, cmdBuf, drawCall, viewport, scissorRect);
+        }
+    }
+
+    void SubmitDrawCalls(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCalls, uint32_t numDrawCalls, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            for (uint32_t i = 0; i < numDrawCalls; ++i) {
+                RecordDrawCall(stream, &drawCalls[i], viewport, scissorRect);
+            }
+            return;
+        }
+        SoftCommandBuffer* cmdBuf = GetDrawCommandBuffer(device, cmdBuffer);
+        if (cmdBuf == nullptr) { return; }
+        for (uint32_t i = 0; i < numDrawCalls; ++i) {
+            ExecuteDrawCall(device, cmdBuf, &drawCalls[i], viewport, scissorRect);
+        }
+    }
+
+    void SubmitDrawIndirect(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Buffer argsBuffer, uint32_t argsOffset, uint32_t numDraws,
+        Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawIndirect(stream, drawCall, argsBuffer, argsOffset, numDraws, viewport, scissorRect);
+            return;
+        }
+        SoftCommandBuffer* cmdBuf = GetDrawCommandBuffer(device, cmdBuffer);
+        if (cmdBuf == nullptr) { return; }
+        SoftPipelineState* pipelineState = device->interf->pipelineStatePool.Get(drawCall->pipelineState.id);
+        if (pipelineState == nullptr) {
+            GT_LOG_ERROR("SoftGfx", "Indirect draw uses invalid pipeline state 0x%08x", drawCall->pipelineState.id);
+            return;
+        }
+        bool isIndexed = pipelineState->desc.indexFormat != IndexFormat::INDEX_FORMAT_NONE;
+        size_t stride = isIndexed ? sizeof(DrawIndexedIndirectArgs) : sizeof(DrawIndirectArgs);
+        SoftBuffer* args = device->interf->bufferPool.Get(argsBuffer.id);
+        if (args == nullptr || args->desc.type != BufferType::BUFFER_TYPE_INDIRECT_ARGS
+            || argsOffset % 4 != 0 || argsOffset + numDraws * stride > args->desc.byteWidth) {
+            GT_LOG_ERROR("SoftGfx", "Indirect draw reads %u draws at offset %u from invalid buffer 0x%08x", numDraws, argsOffset, argsBuffer.id);
+            return;
+        }
+
+        // the arguments are read right away, draws are rasterized from their own copies
+        DrawCall indirectDraw = *drawCall;
+        const char* record = args->data + argsOffset;
+        for (uint32_t i = 0; i < numDraws; ++i, record += stride) {
+            if (isIndexed) {
+                DrawIndexedIndirectArgs indexedArgs;
+                memcpy(&indexedArgs, record, sizeof(indexedArgs));
+                indirectDraw.numElements = indexedArgs.numElements;
+                indirectDraw.numInstances = indexedArgs.numInstances;
+                indirectDraw.elementOffset = indexedArgs.elementOffset;
+                indirectDraw.startVertexLocation = (uint32_t)indexedArgs.startVertexLocation;
+                indirectDraw.startInstanceLocation = indexedArgs.startInstanceLocation;
+            }
+            else {
+                DrawIndirectArgs drawArgs;
+                memcpy(&drawArgs, record, sizeof(drawArgs));
+                indirectDraw.numElements = drawArgs.numElements;
+                indirectDraw.numInstances = drawArgs.numInstances;
+                indirectDraw.elementOffset = 0;
+                indirectDraw.startVertexLocation = drawArgs.startVertexLocation;
+                indirectDraw.startInstanceLocation = drawArgs.startInstanceLocation;
+            }
+            if (indirectDraw.numInstances == 0) { continue; }
+            ExecuteDrawCall(device, cmdBuf, &indirectDraw, viewport, scissorRect);
+        }
+    }
+
+    //
+    //
+
+    static void ClearTile(Device* device, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY)
+    {
+        for (uint32_t i = 0; i < device->numColorTargets + 1; ++i) {
+            RenderTarget* target = i < device->numColorTargets ? &device->colorTargets[i] : &device->depthTarget;
+            bool isDepth = i == device->numColorTargets;
+            if (target->data == nullptr) { continue; }
+            if ((isDepth ? device->action.depth.action : device->action.colors[i].action) != Action::ACTION_CLEAR) { continue; }
+
+            char texel[16];
+            float depthColor[4] = { device->action.depth.value, 0.0f, 0.0f, 0.0f };
+            StoreTexel(target->format, texel, isDepth ? depthColor : device->action.colors[i].color);
+            for (int32_t y = minY; y <= maxY; ++y) {
+                char* row = target->data + (size_t)y * target->pitch;
+                for (int32_t x = minX; x <= maxX; ++x) {
+                    memcpy(row + (size_t)x * target->texelSize, texel, target->texelSize);
+                }
+            }
+        }
+    }
+
+    static float GetBlendFactor(BlendFactor factor, const float* src, const float* dst, const float* constant, int channel)
+    {
+        switch (factor) {
+        case BlendFactor::BLEND_ZERO: return 0.0f;
+        case BlendFactor::BLEND_ONE: return 1.0f;
+        case BlendFactor::BLEND_SRC_COLOR: return src[channel];
+        case BlendFactor::BLEND_INV_SRC_COLOR: return 1.0f - src[channel];
+        case BlendFactor::BLEND_SRC_ALPHA: return src[3];
+        case BlendFactor::BLEND_INV_SRC_ALPHA: return 1.0f - src[3];
+        case BlendFactor::BLEND_DEST_ALPHA: return dst[3];
+        case BlendFactor::BLEND_INV_DEST_ALPHA: return 1.0f - dst[3];
+        case BlendFactor::BLEND_DEST_COLOR: return dst[channel];
+        case BlendFactor::BLEND_INV_DEST_COLOR: return 1.0f - dst[channel];
+        case BlendFactor::BLEND_SRC_ALPHA_SAT: return channel == 3 ? 1.0f : (src[3] < 1.0f - dst[3] ? src[3] : 1.0f - dst[3]);
+        case BlendFactor::BLEND_BLEND_FACTOR: return constant[channel];
+        case BlendFactor::BLEND_INV_BLEND_FACTOR: return 1.0f - constant[channel];
+        // @TODO dual source blending, pixel shaders only have one output per target
+        case BlendFactor::BLEND_SRC1_COLOR: return src[channel];
+        case BlendFactor::BLEND_INV_SRC1_COLOR: return 1.0f - src[channel];
+        case BlendFactor::BLEND_SRC1_ALPHA: return src[3];
+        case BlendFactor::BLEND_INV_SRC1_ALPHA: return 1.0f - src[3];
+        default: return 1.0f;
+        }
+    }
+
+    static float Blend(BlendOp op, float src, float srcFactor, float dst, float dstFactor)
+    {
+        switch (op) {
+        case BlendOp::BLEND_OP_SUBTRACT: return src * srcFactor - dst * dstFactor;
+        case BlendOp::BLEND_OP_REV_SUBTRACT: return dst * dstFactor - src * srcFactor;
+        case BlendOp::BLEND_OP_MIN: return src < dst ? src : dst;
+        case BlendOp::BLEND_OP_MAX: return src > dst ? src : dst;
+        default: return src * srcFactor + dst * dstFactor;
+        }
+    }
+
+    static void WritePixel(RenderTarget* target, int32_t x, int32_t y, const float* color, const BlendStateDesc* blendState)
+    {
+        char* texel = target->data + (size_t)y * target->pitch + (size_t)x * target->texelSize;
+        if (!blendState->enableBlend && blendState->writeMask == COLOR_WRITE_MASK_ALL) {
+            StoreTexel(target->format, texel, color);
+            return;
+        }
+        float dst[4];
+        float result[4];
+        LoadTexel(target->format, texel, dst);
+        for (int i = 0; i < 4; ++i) {
+            result[i] = color[i];
+            if (blendState->enableBlend) {
+                bool isAlpha = i == 3;
+                float srcFactor = GetBlendFactor(isAlpha ? blendState->srcBlendAlpha : blendState->srcBlend, color, dst, blendState->color, i);
+                float dstFactor = GetBlendFactor(isAlpha ? blendState->dstBlendAlpha : blendState->dstBlend, color, dst, blendState->color, i);
+                result[i] = Blend(isAlpha ? blendState->blendOpAlpha : blendState->blendOp, color[i], srcFactor, dst[i], dstFactor);
+            }
+            if (!(blendState->writeMask & (1 << i))) {
+                result[i] = dst[i];
+            }
+        }
+        StoreTexel(target->format, texel, result);
+    }
+
+    // coverage of up to four pixels in a row, barycentrics and depth of each, returns a bit per covered pixel
+    static uint32_t CoverPixels(const Triangle* triangle, int32_t x, float py, int32_t numPixels, float* outBarycentrics, float* outZ)
+    {
+#ifdef SOFT_GFX_SSE
+        __m128 px = _mm_add_ps(_mm_set1_ps((float)x + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+        __m128 pyv = _mm_set1_ps(py);
+        __m128 zero = _mm_setzero_ps();
+        __m128 invArea = _mm_set1_ps(triangle->invArea);
+        __m128 covered = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(numPixels)));
+        __m128 z = zero;
+        for (int i = 0; i < 3; ++i) {
+            __m128 edge = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle->edgeA[i]), px), _mm_mul_ps(_mm_set1_ps(triangle->edgeB[i]), pyv)), _mm_set1_ps(triangle->edgeC[i]));
+            __m128 inside = (triangle->topLeftMask & (1 << i)) ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero);
+            covered = _mm_and_ps(covered, inside);
+            __m128 barycentric = _mm_mul_ps(edge, invArea);
+            _mm_storeu_ps(outBarycentrics + i * 4, barycentric);
+            z = _mm_add_ps(z, _mm_mul_ps(barycentric, _mm_set1_ps(triangle->z[i])));
+        }
+        z = _mm_min_ps(_mm_max_ps(z, zero), _mm_set1_ps(1.0f));
+        _mm_storeu_ps(outZ, z);
+        return (uint32_t)_mm_movemask_ps(covered);
+#else
+        uint32_t mask = 0;
+        for (int32_t j = 0; j < 4; ++j) {
+            float px = (float)(x + j) + 0.5f;
+            bool isCovered = j < numPixels;
+            float z = 0.0f;
+            for (int i = 0; i < 3; ++i) {
+                float edge = triangle->edgeA[i] * px + triangle->edgeB[i] * py + triangle->edgeC[i];
+                isCovered = isCovered && (edge > 0.0f || (edge == 0.0f && (triangle->topLeftMask & (1 << i))));
+                outBarycentrics[i * 4 + j] = edge * triangle->invArea;
+                z += outBarycentrics[i * 4 + j] * triangle->z[i];
+            }
+            outZ[j] = Clamp(z, 0.0f, 1.0f);
+            mask |= isCovered ? 1 << j : 0;
+        }
+        return mask;
+#endif
+    }
+
+    static bool DepthTest(CompareFunc func, float z, float depth)
+    {
+        switch (func) {
+        case CompareFunc::COMPARE_NEVER: return false;
+        case CompareFunc::COMPARE_LESS: return z < depth;
+        case CompareFunc::COMPARE_EQUAL: return z == depth;
+        case CompareFunc::COMPARE_LESS_EQUAL: return z <= depth;
+        case CompareFunc::COMPARE_GREATER: return z > depth;
+        case CompareFunc::COMPARE_NOT_EQUAL: return z != depth;
+        case CompareFunc::COMPARE_GREATER_EQUAL: return z >= depth;
+        default: return true;
+        }
+    }
+
+    static uint32_t DepthTestPixels(CompareFunc func, const float* z, const float* depth, int32_t numPixels, uint32_t mask)
+    {
+#ifdef SOFT_GFX_SSE
+        if (numPixels == 4) {
+            __m128 zv = _mm_loadu_ps(z);
+            __m128 depthv = _mm_loadu_ps(depth);
+            __m128 pass;
+            switch (func) {
+            case CompareFunc::COMPARE_NEVER: pass = _mm_setzero_ps(); break;
+            case CompareFunc::COMPARE_LESS: pass = _mm_cmplt_ps(zv, depthv); break;
+            case CompareFunc::COMPARE_EQUAL: pass = _mm_cmpeq_ps(zv, depthv); break;
+            case CompareFunc::COMPARE_LESS_EQUAL: pass = _mm_cmple_ps(zv, depthv); break;
+            case CompareFunc::COMPARE_GREATER: pass = _mm_cmpgt_ps(zv, depthv); break;
+            case CompareFunc::COMPARE_NOT_EQUAL: pass = _mm_cmpneq_ps(zv, depthv); break;
+            case CompareFunc::COMPARE_GREATER_EQUAL: pass = _mm_cmpge_ps(zv, depthv); break;
+            default: return mask;
+            }
+            return mask & (uint32_t)_mm_movemask_ps(pass);
+        }
+#endif
+        for (int32_t j = 0; j < numPixels; ++j) {
+            if ((mask & (1 << j)) && !DepthTest(func, z[j], depth[j])) {
+                mask &= ~(1u << j);
+            }
+        }
+        return mask;
+    }
+
+    static void RasterizeTriangle(Device* device, const Triangle* triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY, TileStats* stats)
+    {
+        int32_t minX = triangle->minX > tileMinX ? triangle->minX : tileMinX;
+        int32_t maxX = triangle->maxX < tileMaxX ? triangle->maxX : tileMaxX;
+        int32_t minY = triangle->minY > tileMinY ? triangle->minY : tileMinY;
+        int32_t maxY = triangle->maxY < tileMaxY ? triangle->maxY : tileMaxY;
+        if (minX > maxX || minY > maxY) { return; }
+
+        const DrawState* draw = &device->draws.data[triangle->drawIndex];
+        const DepthStencilStateDesc& depthState = draw->pipelineState->depthStencilState;
+        RenderTarget* depthTarget = &device->depthTarget;
+        bool isDepthTested = depthTarget->data != nullptr && depthState.enableDepth;
+        bool isDepthWritten = isDepthTested && depthState.depthWriteMask == DepthWriteMask::DEPTH_WRITE_MASK_ALL;
+        uint32_t numVaryings = draw->numVaryings;
+        const float* varyings[3];
+        for (int i = 0; i < 3; ++i) {
+            varyings[i] = &device->varyings.data[triangle->firstVarying + i * numVaryings];
+        }
+
+        SoftPixelInput input;
+        input.isFrontFace = triangle->isFrontFace;
+        input.resources = &draw->resources;
+        SoftPixelOutput output;
+        float barycentrics[3 * 4];
+        float z[4];
+        for (int32_t y = minY; y <= maxY; ++y) {
+            float py = (float)y + 0.5f;
+            float* depthRow = isDepthTested ? (float*)(depthTarget->data + (size_t)y * depthTarget->pitch) : nullptr;
+            for (int32_t x = minX; x <= maxX; x += 4) {
+                int32_t numPixels = maxX - x + 1 < 4 ? maxX - x + 1 : 4;
+                uint32_t mask = CoverPixels(triangle, x, py, numPixels, barycentrics, z);
+                if (mask == 0) { continue; }
+                stats->numPixelsTested += __builtin_popcount(mask);
+                if (isDepthTested) {
+                    mask = DepthTestPixels(depthState.depthFunc, z, depthRow + x, numPixels, mask);
+                }
+                for (int32_t j = 0; j < numPixels; ++j) {
+                    if (!(mask & (1 << j))) { continue; }
+                    float l0 = barycentrics[j], l1 = barycentrics[4 + j], l2 = barycentrics[8 + j];
+                    float invW = l0 * triangle->invW[0] + l1 * triangle->invW[1] + l2 * triangle->invW[2];
+                    float w = 1.0f / invW;
+                    input.position[0] = (float)(x + j) + 0.5f;
+                    input.position[1] = py;
+                    input.position[2] = z[j];
+                    input.position[3] = invW;
+                    for (uint32_t k = 0; k < numVaryings; ++k) {
+                        input.varyings[k] = (l0 * varyings[0][k] + l1 * varyings[1][k] + l2 * varyings[2][k]) * w;
+                    }
+                    output.discard = false;
+                    draw->pixelFunc(&input, &output, draw->pixelUserData);
+                    stats->numPixelsShaded++;
+                    if (output.discard) { continue; }
+
+                    if (isDepthWritten) {
+                        depthRow[x + j] = z[j];
+                    }
+                    for (uint32_t k = 0; k < device->numColorTargets; ++k) {
+                        if (device->colorTargets[k].data != nullptr) {
+                            WritePixel(&device->colorTargets[k], x + j, y, output.colors[k], &draw->pipelineState->blendState);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    static void RasterizeTile(Device* device, uint32_t tileIndex, TileStats* stats)
+    {
+        int32_t minX = (int32_t)(tileIndex % device->numTilesX) * SOFT_GFX_TILE_SIZE;
+        int32_t minY = (int32_t)(tileIndex / device->numTilesX) * SOFT_GFX_TILE_SIZE;
+        int32_t maxX = minX + SOFT_GFX_TILE_SIZE - 1 < (int32_t)device->width - 1 ? minX + SOFT_GFX_TILE_SIZE - 1 : (int32_t)device->width - 1;
+        int32_t maxY = minY + SOFT_GFX_TILE_SIZE - 1 < (int32_t)device->height - 1 ? minY + SOFT_GFX_TILE_SIZE - 1 : (int32_t)device->height - 1;
+        if (device->hasPendingClear) {
+            ClearTile(device, minX, minY, maxX, maxY);
+        }
+        GrowableArray<uint32_t>* bin = &device->bins[tileIndex];
+        for (uint32_t i = 0; i < bin->size; ++i) {
+            RasterizeTriangle(device, &device->triangles.data[bin->data[i]], minX, minY, maxX, maxY, stats);
+        }
+        bin->size = 0;
+    }
+
+    static void RasterizeTiles(Device* device)
+    {
+        uint32_t numTiles = device->numTilesX * device->numTilesY;
+        TileStats stats;
+        for (;;) {
+            uint32_t tileIndex = __atomic_fetch_add(&device->nextTile, 1, __ATOMIC_RELAXED);
+            if (tileIndex >= numTiles) { break; }
+            RasterizeTile(device, tileIndex, &stats);
+        }
+        __atomic_fetch_add(&device->stats.numPixelsTested, stats.numPixelsTested, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&device->stats.numPixelsShaded, stats.numPixelsShaded, __ATOMIC_RELAXED);
+    }
+
+    //
+    //
+
+    void SubmitDrawItem(Device* device, CommandBuffer cmdBuffer, DrawItem* drawItem, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawItem(stream, drawItem, viewport, scissorRect);
+            return;
+        }
+
+        BindGroupData* groups[GFX_MAX_BIND_GROUPS];
+        for (uint32_t i = 0; i < GFX_MAX_BIND_GROUPS; ++i) {
+            groups[i] = nullptr;
+            if (!GFX_CHECK_RESOURCE(drawItem->bindGroups[i])) { continue; }
+            SoftBindGroup* bindGroup = device->interf->bindGroupPool.Get(drawItem->bindGroups[i].id);
+            if (bindGroup == nullptr) {
+                GT_LOG_ERROR("SoftGfx", "Draw item uses invalid bind group 0x%08x", drawItem->bindGroups[i].id);
+                return;
+            }
+            groups[i] = &bindGroup->data;
+        }
+        DrawCall* drawCall = ResolveDrawItem(&device->resolvedDrawInputs, drawItem, groups);
+        if (drawCall == nullptr) { return; }
+        SubmitDrawCall(device, cmdBuffer, drawCall, viewport, scissorRect);
+    }
+
+    void SubmitCommandBuffers(Device* device, CommandBuffer* cmdBuffers, uint32_t numCmdBuffers)
+    {
+        for (uint32_t i = 0; i < numCmdBuffers; ++i) {
+            CommandStream* stream = GetDeferredStream(device, cmdBuffers[i]);
+            if (stream == nullptr) {
+                GT_LOG_ERROR("SoftGfx", "Submitting invalid or immediate command buffer 0x%08x", cmdBuffers[i].id);
+                continue;
+            }
+            ReplayCommandStream(device, device->immediateCmdBuffer, stream);
+        }
+    }
+
+    void PresentSwapChain(Device* device, SwapChain swapChain)
+    {
+        if (device->interf->swapChainPool.Get(swapChain.id) == nullptr) {
+            GT_LOG_ERROR("SoftGfx", "Presenting invalid swap chain 0x%08x", swapChain.id);
+        }
+        // @NOTE nothing to show the image on, it stays in the back buffer for ReadSwapChainPixels
+        EndStateChangeFrame(&device->stateChangeStats, &device->lastFrameStateChangeStats);
+    }
+
+    void GetStateChangeStats(Device* device, StateChangeStats* outStats)
+    {
+        *outStats = device->lastFrameStateChangeStats;
+    }
+
+    void GetResourceStats(Device* device, ResourceStats* outStats)
+    {
+        Interface* interf = device->interf;
+        outStats->buffers = interf->bufferPool.GetStats();
+        outStats->images = interf->imagePool.GetStats();
+        outStats->pipelineStates = interf->pipelineStatePool.GetStats();
+        outStats->shaders = interf->shaderPool.GetStats();
+        outStats->renderPasses = interf->passPool.GetStats();
+        outStats->cmdBuffers = interf->cmdBufferPool.GetStats();
+        outStats->bindGroups = interf->bindGroupPool.GetStats();
+        outStats->swapChains = interf->swapChainPool.GetStats();
+    }
+
+    void GetPipelineCacheStats(Device* device, PipelineCacheStats* outStats)
+    {
+        *outStats = ReadPipelineCacheStats(&device->pipelineCache);
+    }
+
+    size_t SavePipelineCache(Device* device, void* buffer, size_t bufferSize)
+    {
+        return SavePipelineCacheKeys(&device->pipelineCache, buffer, bufferSize);
+    }
+
+    uint32_t WarmPipelineCache(Device* device, const void* data, size_t size)
+    {
+        return WarmPipelineCacheKeys(device, &device->pipelineCache, data, size);
+    }
+
+    void* MapBuffer(Device* device, Buffer buffer, MapType)
+    {
+        SoftBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj == nullptr || bufferObj->isMapped || bufferObj->desc.usage == ResourceUsage::USAGE_IMMUTABLE
+            || bufferObj->desc.usage == ResourceUsage::USAGE_COPY_DESTINATION) {
+            GT_LOG_ERROR("SoftGfx", "Can't map buffer 0x%08x", buffer.id);
+            return nullptr;
+        }
+        // binned triangles still read constants from the buffer memory, there's no renaming
+        FlushRenderPass(device);
+        bufferObj->isMapped = true;
+        return bufferObj->data;
+    }
+
+    void UnmapBuffer(Device* device, Buffer buffer)
+    {
+        SoftBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj == nullptr || !bufferObj->isMapped) {
+            GT_LOG_ERROR("SoftGfx", "Unmapping buffer 0x%08x that isn't mapped", buffer.id);
+            return;
+        }
+        bufferObj->isMapped = false;
+    }
+
+    bool SetImageResidentMips(Device* device, Image image, uint32_t firstResidentMip)
+    {
+        SoftImage* imageObj = device->interf->imagePool.Get(image.id);
+        if (imageObj == nullptr || !imageObj->desc.isStreamed || firstResidentMip >= GetNumMipmaps(imageObj)) {
+            GT_LOG_ERROR("SoftGfx", "Can't make mips from %u on of image 0x%08x resident", firstResidentMip, image.id);
+            return false;
+        }
+        // binned triangles may still sample the image
+        FlushRenderPass(device);
+        imageObj->desc.firstResidentMip = (uint16_t)firstResidentMip;
+        return true;
+    }
+
+    bool CopyBufferToImage(Device* device, Buffer source, size_t sourceOffset, Image image, uint32_t mip)
+    {
+        SoftBuffer* bufferObj = device->interf->bufferPool.Get(source.id);
+        SoftImage* imageObj = device->interf->imagePool.Get(image.id);
+        if (bufferObj == nullptr || bufferObj->desc.usage != ResourceUsage::USAGE_STAGING || bufferObj->isMapped
+            || imageObj == nullptr || !imageObj->desc.isStreamed || mip < imageObj->desc.firstResidentMip || mip >= GetNumMipmaps(imageObj)
+            || sourceOffset + GetImageMipSize(&imageObj->desc, mip) > bufferObj->desc.byteWidth) {
+            GT_LOG_ERROR("SoftGfx", "Can't copy buffer 0x%08x to mip %u of image 0x%08x", source.id, mip, image.id);
+            return false;
+        }
+        FlushRenderPass(device);
+        WriteSubresource(imageObj, mip, bufferObj->data + sourceOffset, GetImageMipSize(&imageObj->desc, mip));
+        return true;
+    }
+
+    bool UpdateBuffer(Device* device, Buffer buffer, size_t offset, const void* data, size_t size)
+    {
+        SoftBuffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj == nullptr || bufferObj->desc.usage != ResourceUsage::USAGE_COPY_DESTINATION || bufferObj->isMapped
+            || offset + size > bufferObj->desc.byteWidth) {
+            GT_LOG_ERROR("SoftGfx", "Can't update %llu bytes of buffer 0x%08x", (unsigned long long)size, buffer.id);
+            return false;
+        }
+        // binned triangles may still read the buffer
+        FlushRenderPass(device);
+        memcpy(bufferObj->data + offset, data, size);
+        return true;
+    }
+
+    bool UpdateImage(Device* device, Image image, uint32_t mip, const void* data, size_t size)
+    {
+        SoftImage* imageObj = device->interf->imagePool.Get(image.id);
+        if (imageObj == nullptr || (imageObj->desc.usage != ResourceUsage::USAGE_COPY_DESTINATION && !imageObj->desc.isStreamed)
+            || imageObj->desc.type != ImageType::IMAGE_TYPE_2D || imageObj->desc.numSlices != 1
+            || mip < imageObj->desc.firstResidentMip || mip >= GetNumMipmaps(imageObj) || size != GetImageMipSize(&imageObj->desc, mip)) {
+            GT_LOG_ERROR("SoftGfx", "Can't update mip %u of image 0x%08x", mip, image.id);
+            return false;
+        }
+        FlushRenderPass(device);
+        WriteSubresource(imageObj, mip, data, size);
+        return true;
+    }
+
+    //
+    //
+
+    static void SampleMipmap(const SoftImage* image, uint32_t mip, uint32_t slice, float u, float v, bool isLinear, float* outColor);
+
+    static int32_t WrapCoordinate(int32_t coordinate, int32_t size, WrapMode mode)
+    {
+        switch (mode) {
+        case WrapMode::WRAP_CLAMP_TO_EDGE: {
+            return coordinate < 0 ? 0 : (coordinate >= size ? size - 1 : coordinate);
+        }
+        case WrapMode::WRAP_MIRRORED_REPEAT: {
+            int32_t period = size * 2;
+            int32_t wrapped = coordinate % period;
+            wrapped = wrapped < 0 ? wrapped + period : wrapped;
+            return wrapped < size ? wrapped : period - 1 - wrapped;
+        }
+        default: {
+            int32_t wrapped = coordinate % size;
+            return wrapped < 0 ? wrapped + size : wrapped;
+        }
+        }
+    }
+
+    static void SampleMipmap(const SoftImage* image, uint32_t mip, uint32_t slice, float u, float v, bool isLinear, float* outColor)
+    {
+        uint32_t numMipmaps = GetNumMipmaps(image);
+        int32_t width = (int32_t)(image->desc.width >> mip);
+        int32_t height = (int32_t)(image->desc.height >> mip);
+        width = width > 0 ? width : 1;
+        height = height > 0 ? height : 1;
+        const char* data = image->data + image->subresourceOffsets[slice * numMipmaps + mip];
+        // keeps the float to int conversions below defined
+        u = Clamp(u, -65536.0f, 65536.0f);
+        v = Clamp(v, -65536.0f, 65536.0f);
+
+        if (!isLinear) {
+            int32_t x = WrapCoordinate((int32_t)floorf(u * width), width, image->sampler.wrapU);
+            int32_t y = WrapCoordinate((int32_t)floorf(v * height), height, image->sampler.wrapV);
+            LoadTexel(image->format, data + ((size_t)y * width + x) * image->texelSize, outColor);
+            return;
+        }
+        float fx = u * width - 0.5f;
+        float fy = v * height - 0.5f;
+        float floorX = floorf(fx);
+        float floorY = floorf(fy);
+        float tx = fx - floorX;
+        float ty = fy - floorY;
+        int32_t x0 = WrapCoordinate((int32_t)floorX, width, image->sampler.wrapU);
+        int32_t x1 = WrapCoordinate((int32_t)floorX + 1, width, image->sampler.wrapU);
+        int32_t y0 = WrapCoordinate((int32_t)floorY, height, image->sampler.wrapV);
+        int32_t y1 = WrapCoordinate((int32_t)floorY + 1, height, image->sampler.wrapV);
+        float c00[4], c10[4], c01[4], c11[4];
+        LoadTexel(image->format, data + ((size_t)y0 * width + x0) * image->texelSize, c00);
+        LoadTexel(image->format, data + ((size_t)y0 * width + x1) * image->texelSize, c10);
+        LoadTexel(image->format, data + ((size_t)y1 * width + x0) * image->texelSize, c01);
+        LoadTexel(image->format, data + ((size_t)y1 * width + x1) * image->texelSize, c11);
+        for (int i = 0; i < 4; ++i) {
+            float top = c00[i] + (c10[i] - c00[i]) * tx;
+            float bottom = c01[i] + (c11[i] - c01[i]) * tx;
+            outColor[i] = top + (bottom - top) * ty;
+        }
+    }
+
+    void SampleImage(const SoftImage* image, float u, float v, uint32_t slice, float lod, float* outColor)
+    {
+        if (image == nullptr) {
+            outColor[0] = outColor[1] = outColor[2] = outColor[3] = 0.0f;
+            return;
+        }
+        const SamplerDesc& sampler = image->sampler;
+        uint32_t numMipmaps = GetNumMipmaps(image);
+        uint32_t numSlices = GetNumSlices(image);
+        slice = slice < numSlices ? slice : numSlices - 1;
+        lod = Clamp(lod, (float)image->desc.firstResidentMip, (float)(numMipmaps - 1));
+
+        FilterMode filter = lod > 0.0f ? sampler.minFilter : sampler.magFilter;
+        bool isLinear = filter == FilterMode::FILTER_LINEAR || filter == FilterMode::FILTER_LINEAR_MIPMAP_NEAREST || filter == FilterMode::FILTER_LINEAR_MIPMAP_LINEAR || filter == FilterMode::_DEFAULT;
+        bool isMipLinear = sampler.minFilter == FilterMode::FILTER_NEAREST_MIPMAP_LINEAR || sampler.minFilter == FilterMode::FILTER_LINEAR_MIPMAP_LINEAR;
+        if (!isMipLinear || numMipmaps == 1) {
+            SampleMipmap(image, (uint32_t)(lod + 0.5f), slice, u, v, isLinear, outColor);
+            return;
+        }
+        uint32_t mip0 = (uint32_t)lod;
+        uint32_t mip1 = mip0 + 1 < numMipmaps ? mip0 + 1 : mip0;
+        float t = lod - (float)mip0;
+        float color0[4], color1[4];
+        SampleMipmap(image, mip0, slice, u, v, isLinear, color0);
+        SampleMipmap(image, mip1, slice, u, v, isLinear, color1);
+        for (int i = 0; i < 4; ++i) {
+            outColor[i] = color0[i] + (color1[i] - color0[i]) * t;
+        }
+    }
+
+    static bool CopySubresource(SoftImage* image, uint32_t mip, uint32_t slice, void* outData, size_t size)
+    {
+        RenderTarget subresource;
+        uint32_t width, height;
+        if (!GetRenderTarget(image, mip, slice, &subresource, &width, &height)) { return false; }
+        uint32_t externalTexelSize = GetExternalTexelSize(image->format);
+        size_t numTexels = (size_t)width * height;
+        if (size != numTexels * externalTexelSize) { return false; }
+        if (externalTexelSize == image->texelSize) {
+            memcpy(outData, subresource.data, size);
+            return true;
+        }
+        memset(outData, 0, size);
+        for (size_t i = 0; i < numTexels; ++i) {
+            memcpy((char*)outData + i * externalTexelSize, subresource.data + i * image->texelSize, image->texelSize);
+        }
+        return true;
+    }
+
+    bool ReadImagePixels(Device* device, Image image, uint16_t mipmapLevel, uint16_t slice, void* outData, size_t size)
+    {
+        FlushRenderPass(device);
+        SoftImage* imageObj = device->interf->imagePool.Get(image.id);
+        if (imageObj == nullptr || !CopySubresource(imageObj, mipmapLevel, slice, outData, size)) {
+            GT_LOG_ERROR("SoftGfx", "Can't read %llu bytes from image 0x%08x, mipmap %u, slice %u", (unsigned long long)size, image.id, mipmapLevel, slice);
+            return false;
+        }
+        return true;
+    }
+
+    bool ReadSwapChainPixels(Device* device, SwapChain swapChain, void* outData, size_t size)
+    {
+        FlushRenderPass(device);
+        SoftSwapChain* swapChainObj = device->interf->swapChainPool.Get(swapChain.id);
+        if (swapChainObj == nullptr || !CopySubresource(&swapChainObj->backBuffer, 0, 0, outData, size)) {
+            GT_LOG_ERROR("SoftGfx", "Can't read %llu bytes from swap chain 0x%08x", (unsigned long long)size, swapChain.id);
+            return false;
+        }
+        return true;
+    }
+}
+
+#endif // GT_GFX_SOFTWARE
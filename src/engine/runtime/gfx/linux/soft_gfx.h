@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../gfx.h"
+
+#ifndef SOFT_GFX_MAX_VARYINGS
+#define SOFT_GFX_MAX_VARYINGS 16
+#endif
+
+#ifndef SOFT_GFX_MAX_WORKERS
+#define SOFT_GFX_MAX_WORKERS 32
+#endif
+
+// edge length of the square screen tiles triangles are binned into
+#define SOFT_GFX_TILE_SIZE 64
+
+/**
+    Software rasterizer backend, for pixel output on machines without a GPU (thumbnails, golden image tests).
+    Built instead of the null backend when GT_GFX_SOFTWARE is defined.
+
+    Draw calls are shaded, clipped and set up when they are submitted, their triangles are binned into screen tiles.
+    A render pass is rasterized when it ends, or earlier if a buffer it uses is about to be mapped, with the tiles
+    spread over worker threads. Every tile draws its triangles in submission order, so the output is the same for
+    any number of threads.
+
+    Shaders are C++ callbacks registered for Shader objects, whatever code the Shader was created with is ignored.
+    Not supported yet: points and lines, wireframe fill, stencil, depth bias, dual source blending.
+*/
+
+namespace gfx
+{
+    struct SoftImage;
+
+    struct SoftShaderResources
+    {
+        const char*         constants[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];   // at the bound offsets, nullptr if unbound
+        const SoftImage*    images[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+    };
+
+    struct SoftVertexInput
+    {
+        float       attribs[GFX_MAX_VERTEX_ATTRIBS][4];     // in vertex layout order, missing components are (0, 0, 0, 1)
+        uint32_t    vertexID;
+        uint32_t    instanceID;
+        const SoftShaderResources* resources;
+    };
+
+    struct SoftVertexOutput
+    {
+        float       position[4];                            // clip space
+        float       varyings[SOFT_GFX_MAX_VARYINGS];
+    };
+
+    struct SoftPixelInput
+    {
+        float       position[4];                            // pixel center, depth, 1/w
+        float       varyings[SOFT_GFX_MAX_VARYINGS];        // perspective correct
+        bool        isFrontFace;
+        const SoftShaderResources* resources;
+    };
+
+    struct SoftPixelOutput
+    {
+        float       colors[GFX_MAX_COLOR_ATTACHMENTS][4];
+        bool        discard;
+    };
+
+    // called from worker threads, must not touch shared state
+    typedef void(*SoftVertexShaderFunc)(const SoftVertexInput* input, SoftVertexOutput* output, void* userData);
+    typedef void(*SoftPixelShaderFunc)(const SoftPixelInput* input, SoftPixelOutput* output, void* userData);
+
+    // numVaryings is how many varyings the vertex shader writes, only those are interpolated
+    bool RegisterVertexShader(Device* device, Shader shader, SoftVertexShaderFunc func, uint32_t numVaryings, void* userData);
+    bool RegisterPixelShader(Device* device, Shader shader, SoftPixelShaderFunc func, void* userData);
+
+    // for shaders, filtering and wrapping follow the sampler the image was created with, cube faces are slices
+    void SampleImage(const SoftImage* image, float u, float v, uint32_t slice, float lod, float* outColor);
+
+    // both rasterize pending work first, subresources are copied tightly packed in their pixel format
+    bool ReadImagePixels(Device* device, Image image, uint16_t mipmapLevel, uint16_t slice, void* outData, size_t size);
+    // the back buffer is R8G8B8A8_UNORM
+    bool ReadSwapChainPixels(Device* device, SwapChain swapChain, void* outData, size_t size);
+
+    struct SoftDeviceStats
+    {
+        uint64_t    numDrawCalls = 0;
+        uint64_t    numTriangles = 0;           // assembled from draw calls
+        uint64_t    numTrianglesCulled = 0;     // back facing, degenerate or clipped away
+        uint64_t    numBinnedTriangles = 0;     // one per tile a triangle touches
+        uint64_t    numPixelsTested = 0;        // covered pixels
+        uint64_t    numPixelsShaded = 0;        // covered pixels that passed the depth test
+        uint64_t    numFlushes = 0;
+        uint32_t    numThreads = 0;             // rasterizing threads including the submitting one
+    };
+
+    void GetSoftDeviceStats(Device* device, SoftDeviceStats* outStats);
+    void ResetSoftDeviceStats(Device* device);
+}
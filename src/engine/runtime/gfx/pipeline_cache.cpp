@@ -0,0 +1,450 @@
+#include "pipeline_cache.h"
+#include <foundation/logging/logging.h>
+#include <cassert>
+#include <string.h>
+
+#define PIPELINE_CACHE_MAGIC    0x43505447      // "GTPC"
+// @NOTE bump whenever the key layout changes, saved keys of other versions are ignored
+#define PIPELINE_CACHE_VERSION  1
+
+namespace gfx
+{
+    struct PipelineCacheHeader
+    {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    keySize;
+        uint32_t    numKeys;
+        uint64_t    checksum;   // of the keys, they are read back into enums and indices
+    };
+
+    // FNV-1a
+    static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+    {
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // the following are called with the lock held
+
+    // @NOTE linear, there are a few hundred shaders at most and pipeline states aren't created per frame
+    static uint64_t FindShaderHash(PipelineCache* cache, Shader shader)
+    {
+        for (uint32_t i = 0; i < cache->numShaders; ++i) {
+            if (cache->shaders[i].shader.id == shader.id) {
+                return cache->shaders[i].hash;
+            }
+        }
+        return 0;
+    }
+
+    static Shader FindShader(PipelineCache* cache, uint64_t hash)
+    {
+        for (uint32_t i = 0; i < cache->numShaders; ++i) {
+            if (cache->shaders[i].hash == hash) {
+                return cache->shaders[i].shader;
+            }
+        }
+        return { INVALID_ID };
+    }
+
+    static const char* InternName(PipelineCache* cache, const char* name)
+    {
+        for (InternedName* it = cache->names; it != nullptr; it = it->next) {
+            if (strcmp(it->name, name) == 0) {
+                return it->name;
+            }
+        }
+        InternedName* interned = GT_NEW(InternedName, cache->memoryArena);
+        strncpy(interned->name, name, GFX_PIPELINE_KEY_NAME_LEN - 1);
+        interned->name[GFX_PIPELINE_KEY_NAME_LEN - 1] = '\0';
+        interned->next = cache->names;
+        cache->names = interned;
+        return interned->name;
+    }
+
+    struct KeyWriter
+    {
+        PipelineCache*  cache;
+        PipelineKey*    key;
+        uint32_t        size;
+        bool            isValid;
+
+        void Section(PipelineKeySection section)
+        {
+            key->sections[section] = (uint16_t)size;
+        }
+
+        template <class T>
+        void Value(T& value)
+        {
+            assert(size + sizeof(T) <= GFX_PIPELINE_KEY_SIZE);
+            memcpy(key->data + size, &value, sizeof(T));
+            size += sizeof(T);
+        }
+
+        void ShaderHash(Shader& shader)
+        {
+            uint64_t hash = 0;
+            if (GFX_CHECK_RESOURCE(shader)) {
+                hash = FindShaderHash(cache, shader);
+                isValid = isValid && hash != 0;
+            }
+            Value(hash);
+        }
+
+        void Name(const char*& name)
+        {
+            char buffer[GFX_PIPELINE_KEY_NAME_LEN] = {};
+            size_t length = name != nullptr ? strlen(name) : 0;
+            if (length == 0) {
+                // unnamed
+            }
+            else if (length < GFX_PIPELINE_KEY_NAME_LEN) {
+                memcpy(buffer, name, length);
+            }
+            else {
+                isValid = false;
+            }
+            Value(buffer);
+        }
+    };
+
+    struct KeyReader
+    {
+        PipelineCache*  cache;
+        const uint8_t*  data;
+        uint32_t        size;
+        bool            isValid;
+
+        void Section(PipelineKeySection) {}
+
+        template <class T>
+        void Value(T& value)
+        {
+            memcpy(&value, data + size, sizeof(T));
+            size += sizeof(T);
+        }
+
+        void ShaderHash(Shader& shader)
+        {
+            uint64_t hash = 0;
+            Value(hash);
+            shader = hash != 0 ? FindShader(cache, hash) : Shader{ INVALID_ID };
+            isValid = isValid && (hash == 0 || GFX_CHECK_RESOURCE(shader));
+        }
+
+        void Name(const char*& name)
+        {
+            char buffer[GFX_PIPELINE_KEY_NAME_LEN];
+            Value(buffer);
+            buffer[GFX_PIPELINE_KEY_NAME_LEN - 1] = '\0';
+            name = InternName(cache, buffer);
+        }
+    };
+
+    // writes or reads the desc in key order, keep PIPELINE_CACHE_VERSION in sync
+    template <class TVisitor>
+    static void VisitPipelineDesc(TVisitor* v, PipelineStateDesc* desc)
+    {
+        v->Section(PIPELINE_KEY_VERTEX_LAYOUT);
+        v->ShaderHash(desc->vertexShader);
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_ATTRIBS; ++i) {
+            VertexAttribDesc* attrib = &desc->vertexLayout.attribs[i];
+            v->Name(attrib->name);
+            v->Value(attrib->index);
+            v->Value(attrib->offset);
+            v->Value(attrib->slot);
+            v->Value(attrib->format);
+        }
+
+        v->Section(PIPELINE_KEY_SHADERS);
+        v->ShaderHash(desc->pixelShader);
+        v->ShaderHash(desc->geometryShader);
+        v->ShaderHash(desc->hullShader);
+        v->ShaderHash(desc->domainShader);
+        v->Value(desc->primitiveType);
+        v->Value(desc->indexFormat);
+
+        BlendStateDesc* blend = &desc->blendState;
+        v->Section(PIPELINE_KEY_BLEND);
+        v->Value(blend->alphaToCoverage);
+        v->Value(blend->enableBlend);
+        v->Value(blend->srcBlend);
+        v->Value(blend->dstBlend);
+        v->Value(blend->blendOp);
+        v->Value(blend->srcBlendAlpha);
+        v->Value(blend->dstBlendAlpha);
+        v->Value(blend->blendOpAlpha);
+        v->Value(blend->writeMask);
+        v->Value(blend->color);
+
+        RasterizerStateDesc* raster = &desc->rasterState;
+        v->Section(PIPELINE_KEY_RASTER);
+        v->Value(raster->fillMode);
+        v->Value(raster->cullMode);
+        v->Value(raster->cullOrder);
+        v->Value(raster->depthBias);
+        v->Value(raster->depthBiasClamp);
+        v->Value(raster->slopeScaledDepthBias);
+        v->Value(raster->enableDepthClip);
+        v->Value(raster->enableScissor);
+        v->Value(raster->enableMultisample);
+        v->Value(raster->enableAALine);
+
+        DepthStencilStateDesc* depthStencil = &desc->depthStencilState;
+        v->Section(PIPELINE_KEY_DEPTH_STENCIL);
+        v->Value(depthStencil->enableDepth);
+        v->Value(depthStencil->enableStencil);
+        v->Value(depthStencil->depthWriteMask);
+        v->Value(depthStencil->depthFunc);
+        v->Value(depthStencil->stencilReadMask);
+        v->Value(depthStencil->stencilWriteMask);
+        DepthStencilOpDesc* faces[2] = { &depthStencil->frontFace, &depthStencil->backFace };
+        for (DepthStencilOpDesc* face : faces) {
+            v->Value(face->stencilFailOp);
+            v->Value(face->stencilDepthFailOp);
+            v->Value(face->stencilPassOp);
+            v->Value(face->stencilFunc);
+        }
+    }
+
+    static PipelineCacheEntry* FindEntry(PipelineCache* cache, uint8_t kind, const uint8_t* key, uint16_t size, uint64_t hash)
+    {
+        if (cache->tableSize == 0) {
+            return nullptr;
+        }
+        uint32_t mask = cache->tableSize - 1;
+        for (uint32_t slot = (uint32_t)hash & mask; cache->table[slot] != 0; slot = (slot + 1) & mask) {
+            PipelineCacheEntry* entry = &cache->entries[cache->table[slot] - 1];
+            if (entry->hash == hash && entry->kind == kind && entry->size == size && memcmp(entry->key, key, size) == 0) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    static void InsertIntoTable(PipelineCache* cache, uint32_t entryIndex)
+    {
+        uint32_t mask = cache->tableSize - 1;
+        uint32_t slot = (uint32_t)cache->entries[entryIndex].hash & mask;
+        while (cache->table[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        cache->table[slot] = entryIndex + 1;
+    }
+
+    static PipelineCacheEntry* InsertEntry(PipelineCache* cache, uint8_t kind, const uint8_t* key, uint16_t size, uint64_t hash)
+    {
+        if (cache->numEntries == cache->entryCapacity) {
+            uint32_t capacity = cache->entryCapacity > 0 ? cache->entryCapacity * 2 : 64;
+            PipelineCacheEntry* entries = GT_NEW_ARRAY(PipelineCacheEntry, capacity, cache->memoryArena);
+            if (cache->entries != nullptr) {
+                memcpy(entries, cache->entries, sizeof(PipelineCacheEntry) * cache->numEntries);
+                GT_DELETE_ARRAY(cache->entries, cache->memoryArena);
+            }
+            cache->entries = entries;
+            cache->entryCapacity = capacity;
+        }
+        // at most half full, so probe sequences stay short
+        if ((cache->numEntries + 1) * 2 > cache->tableSize) {
+            if (cache->table != nullptr) {
+                GT_DELETE_ARRAY(cache->table, cache->memoryArena);
+            }
+            cache->tableSize = cache->tableSize > 0 ? cache->tableSize * 2 : 128;
+            cache->table = GT_NEW_ARRAY(uint32_t, cache->tableSize, cache->memoryArena);
+            memset(cache->table, 0x0, sizeof(uint32_t) * cache->tableSize);
+            for (uint32_t i = 0; i < cache->numEntries; ++i) {
+                InsertIntoTable(cache, i);
+            }
+        }
+
+        PipelineCacheEntry* entry = &cache->entries[cache->numEntries];
+        entry->hash = hash;
+        entry->kind = kind;
+        entry->size = size;
+        memcpy(entry->key, key, size);
+        entry->pipelineState = { INVALID_ID };
+        entry->subState = nullptr;
+        InsertIntoTable(cache, cache->numEntries++);
+        return entry;
+    }
+
+    static uint64_t HashSection(PipelineKey* key, PipelineKeySection section)
+    {
+        uint8_t kind = (uint8_t)section;
+        uint16_t offset = key->sections[section];
+        return HashBytes(key->data + offset, key->sections[section + 1] - offset, HashBytes(&kind, sizeof(kind)));
+    }
+
+    //
+
+    void InitializePipelineCache(PipelineCache* cache, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        cache->memoryArena = memoryArena;
+    }
+
+    void RegisterShader(PipelineCache* cache, Shader shader, ShaderDesc* desc)
+    {
+        if (desc->code == nullptr || desc->codeSize == 0) {
+            return;     // can't be told apart from other shaders, pipeline states using it aren't cached
+        }
+        uint64_t hash = HashBytes(desc->code, desc->codeSize, HashBytes(&desc->type, sizeof(desc->type)));
+        hash = hash != 0 ? hash : 1;    // 0 is no shader in keys
+
+        cache->lock.Lock();
+        if (cache->numShaders == cache->shaderCapacity) {
+            uint32_t capacity = cache->shaderCapacity > 0 ? cache->shaderCapacity * 2 : 64;
+            CachedShader* shaders = GT_NEW_ARRAY(CachedShader, capacity, cache->memoryArena);
+            if (cache->shaders != nullptr) {
+                memcpy(shaders, cache->shaders, sizeof(CachedShader) * cache->numShaders);
+                GT_DELETE_ARRAY(cache->shaders, cache->memoryArena);
+            }
+            cache->shaders = shaders;
+            cache->shaderCapacity = capacity;
+        }
+        cache->shaders[cache->numShaders++] = { shader, hash };
+        cache->lock.Unlock();
+    }
+
+    bool BuildPipelineKey(PipelineCache* cache, PipelineStateDesc* desc, PipelineKey* outKey)
+    {
+        memset(outKey, 0x0, sizeof(PipelineKey));
+        KeyWriter writer = { cache, outKey, 0, true };
+        cache->lock.Lock();
+        VisitPipelineDesc(&writer, desc);
+        cache->lock.Unlock();
+        outKey->sections[NUM_PIPELINE_KEY_SECTIONS] = (uint16_t)writer.size;
+        return writer.isValid;
+    }
+
+    PipelineState FindPipelineState(PipelineCache* cache, PipelineKey* key)
+    {
+        uint64_t hash = HashBytes(key->data, GFX_PIPELINE_KEY_SIZE);
+        cache->lock.Lock();
+        PipelineCacheEntry* entry = FindEntry(cache, NUM_PIPELINE_KEY_SECTIONS, key->data, GFX_PIPELINE_KEY_SIZE, hash);
+        PipelineState result = entry != nullptr ? entry->pipelineState : PipelineState{ INVALID_ID };
+        cache->stats.numHits += entry != nullptr ? 1 : 0;
+        cache->lock.Unlock();
+        return result;
+    }
+
+    void* FindSubState(PipelineCache* cache, PipelineKey* key, PipelineKeySection section)
+    {
+        uint64_t hash = HashSection(key, section);
+        uint16_t offset = key->sections[section];
+        cache->lock.Lock();
+        PipelineCacheEntry* entry = FindEntry(cache, (uint8_t)section, key->data + offset, key->sections[section + 1] - offset, hash);
+        void* result = entry != nullptr ? entry->subState : nullptr;
+        cache->stats.numSharedSubStates += entry != nullptr ? 1 : 0;
+        cache->lock.Unlock();
+        return result;
+    }
+
+    PipelineState AddPipelineState(PipelineCache* cache, PipelineKey* key, PipelineState pipelineState)
+    {
+        uint64_t hash = HashBytes(key->data, GFX_PIPELINE_KEY_SIZE);
+        cache->lock.Lock();
+        PipelineCacheEntry* entry = FindEntry(cache, NUM_PIPELINE_KEY_SECTIONS, key->data, GFX_PIPELINE_KEY_SIZE, hash);
+        if (entry == nullptr) {
+            entry = InsertEntry(cache, NUM_PIPELINE_KEY_SECTIONS, key->data, GFX_PIPELINE_KEY_SIZE, hash);
+            entry->pipelineState = pipelineState;
+            cache->stats.numPipelineStates++;
+            cache->stats.numMisses++;
+        }
+        PipelineState result = entry->pipelineState;
+        cache->lock.Unlock();
+        return result;
+    }
+
+    void* AddSubState(PipelineCache* cache, PipelineKey* key, PipelineKeySection section, void* subState)
+    {
+        uint64_t hash = HashSection(key, section);
+        uint16_t offset = key->sections[section];
+        uint16_t size = key->sections[section + 1] - offset;
+        cache->lock.Lock();
+        PipelineCacheEntry* entry = FindEntry(cache, (uint8_t)section, key->data + offset, size, hash);
+        if (entry == nullptr) {
+            entry = InsertEntry(cache, (uint8_t)section, key->data + offset, size, hash);
+            entry->subState = subState;
+        }
+        void* result = entry->subState;
+        cache->lock.Unlock();
+        return result;
+    }
+
+    PipelineCacheStats ReadPipelineCacheStats(PipelineCache* cache)
+    {
+        cache->lock.Lock();
+        PipelineCacheStats stats = cache->stats;
+        cache->lock.Unlock();
+        return stats;
+    }
+
+    size_t SavePipelineCacheKeys(PipelineCache* cache, void* buffer, size_t bufferSize)
+    {
+        cache->lock.Lock();
+        PipelineCacheHeader header;
+        header.magic = PIPELINE_CACHE_MAGIC;
+        header.version = PIPELINE_CACHE_VERSION;
+        header.keySize = GFX_PIPELINE_KEY_SIZE;
+        header.numKeys = cache->stats.numPipelineStates;
+        header.checksum = HashBytes(nullptr, 0);
+
+        size_t size = sizeof(PipelineCacheHeader) + (size_t)header.numKeys * GFX_PIPELINE_KEY_SIZE;
+        if (size <= bufferSize) {
+            uint8_t* keys = (uint8_t*)buffer + sizeof(PipelineCacheHeader);
+            for (uint32_t i = 0; i < cache->numEntries; ++i) {
+                PipelineCacheEntry* entry = &cache->entries[i];
+                if (entry->kind != NUM_PIPELINE_KEY_SECTIONS) { continue; }
+                memcpy(keys, entry->key, GFX_PIPELINE_KEY_SIZE);
+                header.checksum = HashBytes(keys, GFX_PIPELINE_KEY_SIZE, header.checksum);
+                keys += GFX_PIPELINE_KEY_SIZE;
+            }
+            memcpy(buffer, &header, sizeof(PipelineCacheHeader));
+        }
+        cache->lock.Unlock();
+        return size;
+    }
+
+    uint32_t WarmPipelineCacheKeys(Device* device, PipelineCache* cache, const void* data, size_t size)
+    {
+        PipelineCacheHeader header;
+        if (size < sizeof(PipelineCacheHeader)) {
+            GT_LOG_ERROR("Gfx", "Saved pipeline cache of %llu bytes is too small", (unsigned long long)size);
+            return 0;
+        }
+        memcpy(&header, data, sizeof(PipelineCacheHeader));
+        if (header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_VERSION || header.keySize != GFX_PIPELINE_KEY_SIZE) {
+            GT_LOG_ERROR("Gfx", "Saved pipeline cache is of another version (%u), ignoring it", header.version);
+            return 0;
+        }
+        const uint8_t* keys = (const uint8_t*)data + sizeof(PipelineCacheHeader);
+        if (size != sizeof(PipelineCacheHeader) + (size_t)header.numKeys * GFX_PIPELINE_KEY_SIZE
+            || HashBytes(keys, (size_t)header.numKeys * GFX_PIPELINE_KEY_SIZE) != header.checksum) {
+            GT_LOG_ERROR("Gfx", "Saved pipeline cache with %u keys is corrupt, ignoring it", header.numKeys);
+            return 0;
+        }
+
+        uint32_t numCreated = 0;
+        for (uint32_t i = 0; i < header.numKeys; ++i) {
+            PipelineKey key;
+            memcpy(key.data, keys + (size_t)i * GFX_PIPELINE_KEY_SIZE, GFX_PIPELINE_KEY_SIZE);
+            if (GFX_CHECK_RESOURCE(FindPipelineState(cache, &key))) { continue; }
+
+            PipelineStateDesc desc;
+            KeyReader reader = { cache, key.data, 0, true };
+            cache->lock.Lock();
+            VisitPipelineDesc(&reader, &desc);
+            cache->lock.Unlock();
+            if (!reader.isValid) { continue; }  // a shader of it wasn't created in this run (yet)
+
+            numCreated += GFX_CHECK_RESOURCE(CreatePipelineState(device, &desc)) ? 1 : 0;
+        }
+        return numCreated;
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "gfx.h"
+#include "resource_pool.h"
+
+/**
+    Content addressed cache of pipeline states, shared by all backends.
+    Keys are PipelineStateDescs written out field by field, with shaders replaced by hashes of their code and attribute
+    names copied in, so identical descs map to the same key within a run and keys stay meaningful across runs.
+    Sections of the key also identify sub-state objects like blend states or input layouts, backends can share those
+    between pipeline states that differ elsewhere.
+    All functions lock the cache, pipeline states may be created from loader threads.
+*/
+
+#define GFX_PIPELINE_KEY_NAME_LEN   32
+#define GFX_PIPELINE_KEY_SIZE       (80 + GFX_MAX_VERTEX_ATTRIBS * (GFX_PIPELINE_KEY_NAME_LEN + 16))
+
+namespace gfx
+{
+    // in key order
+    enum PipelineKeySection : uint8_t
+    {
+        PIPELINE_KEY_VERTEX_LAYOUT,     // vertex shader and attributes, input layouts are created against the shader
+        PIPELINE_KEY_SHADERS,           // the remaining shaders, primitive type and index format
+        PIPELINE_KEY_BLEND,
+        PIPELINE_KEY_RASTER,
+        PIPELINE_KEY_DEPTH_STENCIL,
+        NUM_PIPELINE_KEY_SECTIONS
+    };
+
+    struct PipelineKey
+    {
+        uint8_t     data[GFX_PIPELINE_KEY_SIZE];
+        uint16_t    sections[NUM_PIPELINE_KEY_SECTIONS + 1];    // offsets into data, the last one is the size
+    };
+
+    struct PipelineCacheEntry
+    {
+        uint64_t        hash;
+        uint8_t         kind;           // PipelineKeySection of sub-states, NUM_PIPELINE_KEY_SECTIONS for pipeline states
+        uint16_t        size;
+        uint8_t         key[GFX_PIPELINE_KEY_SIZE];
+        PipelineState   pipelineState;
+        void*           subState;
+    };
+
+    struct CachedShader
+    {
+        Shader      shader;
+        uint64_t    hash;
+    };
+
+    struct InternedName
+    {
+        char            name[GFX_PIPELINE_KEY_NAME_LEN];
+        InternedName*   next;
+    };
+
+    struct PipelineCache
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+        PoolLock            lock;
+
+        CachedShader*       shaders = nullptr;
+        uint32_t            numShaders = 0;
+        uint32_t            shaderCapacity = 0;
+
+        PipelineCacheEntry* entries = nullptr;
+        uint32_t            numEntries = 0;
+        uint32_t            entryCapacity = 0;
+        uint32_t*           table = nullptr;        // open addressing, entry index + 1, 0 for empty slots
+        uint32_t            tableSize = 0;          // power of two
+
+        InternedName*       names = nullptr;        // attribute names of descs decoded from saved keys
+
+        PipelineCacheStats  stats;
+    };
+
+    void InitializePipelineCache(PipelineCache* cache, fnd::memory::MemoryArenaBase* memoryArena);
+
+    // backends register every shader they create, keys refer to shaders by the hash of their code
+    // shaders without code aren't registered, pipeline states using them aren't cached
+    void RegisterShader(PipelineCache* cache, Shader shader, ShaderDesc* desc);
+
+    // false if the desc can't be cached, e.g. because of unregistered shaders
+    bool BuildPipelineKey(PipelineCache* cache, PipelineStateDesc* desc, PipelineKey* outKey);
+
+    // INVALID_ID and nullptr on misses
+    PipelineState FindPipelineState(PipelineCache* cache, PipelineKey* key);
+    void* FindSubState(PipelineCache* cache, PipelineKey* key, PipelineKeySection section);
+
+    /**
+        Return what is cached for the key after adding, which is what another thread added first if both missed.
+        Callers release their own object then. The cache holds on to sub-state objects, backends keep a reference
+        for the cache if the objects are reference counted.
+    */
+    PipelineState AddPipelineState(PipelineCache* cache, PipelineKey* key, PipelineState pipelineState);
+    void* AddSubState(PipelineCache* cache, PipelineKey* key, PipelineKeySection section, void* subState);
+
+    PipelineCacheStats ReadPipelineCacheStats(PipelineCache* cache);
+
+    // implementations of SavePipelineCache and WarmPipelineCache
+    size_t SavePipelineCacheKeys(PipelineCache* cache, void* buffer, size_t bufferSize);
+    uint32_t WarmPipelineCacheKeys(Device* device, PipelineCache* cache, const void* data, size_t size);
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "gfx.h"
+#include <foundation/memory/memory.h>
+#include <foundation/logging/logging.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/**
+    Resource pools behind the gfx handles, shared by all backends.
+    A handle is a 20 bit slot index and a 12 bit generation that is bumped whenever the slot is freed, so handles of
+    destroyed resources stop resolving in every build instead of handing out whatever lives in the slot now.
+    Pools start out with the sizes in InterfaceDesc and grow by whole chunks when they run full. Chunks never move,
+    so pointers to resources stay valid while other threads create more of them.
+    Allocate and Free lock the pool and can be called from loader threads; growing allocates from the interface's
+    memory arena, which has to be thread safe as well then. Get doesn't lock: handles only exist once the create call
+    that returned them is done, and resolving a handle while another thread destroys it is a bug either way.
+*/
+
+#define HANDLE_INDEX_BITS           20
+#define HANDLE_INDEX_MASK           ((1u << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATION_MASK      (0xffffffffu >> HANDLE_INDEX_BITS)
+
+#define HANDLE_INDEX(handle)        ((uint32_t)(handle) & HANDLE_INDEX_MASK)
+#define HANDLE_GENERATION(handle)   (uint16_t)((uint32_t)(handle) >> HANDLE_INDEX_BITS)
+
+#define HANDLE_GENERATION_START 1
+
+#define MAKE_HANDLE(index, generation) (((uint32_t)(generation) << HANDLE_INDEX_BITS) | (uint32_t)(index))
+
+#define GFX_POOL_CHUNK_SIZE 256
+// one chunk short of the index range, so no handle has all index bits set and 0xffffffff never is a handle
+#define GFX_POOL_MAX_CHUNKS (HANDLE_INDEX_MASK / GFX_POOL_CHUNK_SIZE)
+
+namespace gfx
+{
+    struct PoolLock
+    {
+#ifdef _MSC_VER
+        SRWLOCK         lock = SRWLOCK_INIT;
+
+        void Lock() { AcquireSRWLockExclusive(&lock); }
+        void Unlock() { ReleaseSRWLockExclusive(&lock); }
+#else
+        pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+        void Lock() { pthread_mutex_lock(&mutex); }
+        void Unlock() { pthread_mutex_unlock(&mutex); }
+#endif
+    };
+
+    // TRelease frees whatever a resource holds besides its slot
+    template <class TResource, void (*TRelease)(fnd::memory::MemoryArenaBase*, TResource*)>
+    struct ResourcePool
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+        const char* name = "";
+
+        TResource** chunks = nullptr;       // GFX_POOL_MAX_CHUNKS entries, nullptr past numChunks
+        uint32_t    numChunks = 0;
+        uint32_t    capacity = 0;
+
+        // ring of free indices, the oldest one is reused first so a generation lasts as long as possible
+        uint32_t*   freeList = nullptr;
+        uint32_t    freeListHead = 0;
+        uint32_t    numFree = 0;
+
+        uint32_t    numUsed = 0;
+        uint32_t    peakUsed = 0;
+        PoolLock    lock;
+
+        bool Initialize(uint32_t initialSize, fnd::memory::MemoryArenaBase* arena, const char* poolName)
+        {
+            memoryArena = arena;
+            name = poolName;
+            chunks = GT_NEW_ARRAY(TResource*, GFX_POOL_MAX_CHUNKS, memoryArena);
+            memset(chunks, 0x0, sizeof(TResource*) * GFX_POOL_MAX_CHUNKS);
+
+            uint32_t numInitialChunks = (initialSize + GFX_POOL_CHUNK_SIZE - 1) / GFX_POOL_CHUNK_SIZE;
+            numInitialChunks = numInitialChunks > 0 ? numInitialChunks : 1;
+            for (uint32_t i = 0; i < numInitialChunks; ++i) {
+                if (!AddChunk()) {
+                    GT_LOG_ERROR("Gfx", "Initial size %u of %s pool is larger than the maximum of %u", initialSize, name, capacity);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // called with the lock held
+        bool AddChunk()
+        {
+            if (numChunks == GFX_POOL_MAX_CHUNKS) {
+                return false;
+            }
+            uint32_t newCapacity = capacity + GFX_POOL_CHUNK_SIZE;
+            uint32_t* newFreeList = GT_NEW_ARRAY(uint32_t, newCapacity, memoryArena);
+            for (uint32_t i = 0; i < numFree; ++i) {
+                newFreeList[i] = freeList[(freeListHead + i) % capacity];
+            }
+            for (uint32_t i = 0; i < GFX_POOL_CHUNK_SIZE; ++i) {
+                newFreeList[numFree + i] = capacity + i;
+            }
+            if (freeList != nullptr) {
+                GT_DELETE_ARRAY(freeList, memoryArena);
+            }
+            freeList = newFreeList;
+            freeListHead = 0;
+            numFree += GFX_POOL_CHUNK_SIZE;
+
+            chunks[numChunks++] = GT_NEW_ARRAY(TResource, GFX_POOL_CHUNK_SIZE, memoryArena);
+            capacity = newCapacity;
+            return true;
+        }
+
+        TResource* GetSlot(uint32_t index)
+        {
+            uint32_t chunk = index / GFX_POOL_CHUNK_SIZE;
+            if (chunk >= GFX_POOL_MAX_CHUNKS || chunks[chunk] == nullptr) {
+                return nullptr;
+            }
+            return &chunks[chunk][index % GFX_POOL_CHUNK_SIZE];
+        }
+
+        bool Allocate(TResource** resource, uint32_t* id)
+        {
+            lock.Lock();
+            if (numFree == 0 && !AddChunk()) {
+                uint32_t numInUse = numUsed;
+                lock.Unlock();
+                GT_LOG_ERROR("Gfx", "%s pool is full, all %u resources are in use", name, numInUse);
+                return false;
+            }
+            uint32_t index = freeList[freeListHead];
+            freeListHead = (freeListHead + 1) % capacity;
+            numFree--;
+            numUsed++;
+            peakUsed = numUsed > peakUsed ? numUsed : peakUsed;
+
+            TResource* res = GetSlot(index);
+            res->resState = _ResourceState::STATE_ALLOC;
+            *resource = res;
+            *id = MAKE_HANDLE(index, res->generation);
+            lock.Unlock();
+            return true;
+        }
+
+        // hands out resources that were completely created only, nullptr for stale or invalid handles
+        TResource* Get(uint32_t id)
+        {
+            if (id == INVALID_ID) { return nullptr; }
+            TResource* res = GetSlot(HANDLE_INDEX(id));
+            if (res == nullptr || res->generation != HANDLE_GENERATION(id) || res->resState != _ResourceState::STATE_VALID) {
+                return nullptr;
+            }
+            return res;
+        }
+
+        // also takes resources that failed to be created, false for stale or invalid handles
+        bool Free(uint32_t id)
+        {
+            if (id == INVALID_ID) { return false; }
+            lock.Lock();
+            uint32_t index = HANDLE_INDEX(id);
+            TResource* res = GetSlot(index);
+            if (res == nullptr || res->generation != HANDLE_GENERATION(id) || res->resState == _ResourceState::STATE_EMPTY) {
+                lock.Unlock();
+                return false;
+            }
+            TRelease(memoryArena, res);
+
+            TResource empty;
+            empty.generation = (res->generation + 1) & HANDLE_GENERATION_MASK;
+            if (empty.generation == 0) {
+                empty.generation = HANDLE_GENERATION_START;   // generation 0 could produce INVALID_ID
+            }
+            *res = empty;
+
+            freeList[(freeListHead + numFree) % capacity] = index;
+            numFree++;
+            numUsed--;
+            lock.Unlock();
+            return true;
+        }
+
+        ResourcePoolStats GetStats()
+        {
+            lock.Lock();
+            ResourcePoolStats stats;
+            stats.numUsed = numUsed;
+            stats.peakUsed = peakUsed;
+            stats.capacity = capacity;
+            stats.maxCapacity = GFX_POOL_MAX_CHUNKS * GFX_POOL_CHUNK_SIZE;
+            lock.Unlock();
+            return stats;
+        }
+    };
+}
@@ -0,0 +1,172 @@
+#include "state_cache.h"
+
+namespace gfx
+{
+    // no handle has this id, pools never hand out the index with all bits set
+    static const uint32_t UNKNOWN_ID = 0xffffffff;
+    static const uint32_t UNKNOWN_VALUE = 0xffffffff;
+
+    void InvalidateImageInputs(StateCache* cache)
+    {
+        for (uint32_t stage = 0; stage < NUM_CACHED_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                if (GFX_CHECK_RESOURCE(cache->images[stage][i])) {
+                    cache->images[stage][i].id = UNKNOWN_ID;
+                }
+            }
+        }
+    }
+
+    void InvalidateConstantInputs(StateCache* cache, Buffer buffer)
+    {
+        for (uint32_t stage = 0; stage < NUM_CACHED_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                if (cache->constants[stage][i].id == buffer.id) {
+                    cache->constants[stage][i].id = UNKNOWN_ID;
+                }
+            }
+        }
+    }
+
+    void InvalidateViewportAndScissor(StateCache* cache)
+    {
+        cache->viewport.width = -1.0f;
+        cache->viewport.height = -1.0f;
+        cache->scissorRect.left = cache->scissorRect.top = UNKNOWN_VALUE;
+        cache->scissorRect.right = cache->scissorRect.bottom = UNKNOWN_VALUE;
+    }
+
+    void InvalidateStateCache(StateCache* cache)
+    {
+        cache->pipelineState.id = UNKNOWN_ID;
+        InvalidateViewportAndScissor(cache);
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            cache->vertexBuffers[i].id = UNKNOWN_ID;
+            cache->vertexOffsets[i] = UNKNOWN_VALUE;
+            cache->vertexStrides[i] = UNKNOWN_VALUE;
+        }
+        cache->indexBuffer.id = UNKNOWN_ID;
+        cache->indexFormat = IndexFormat::INDEX_FORMAT_NONE;
+        for (uint32_t stage = 0; stage < NUM_CACHED_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                cache->constants[stage][i].id = UNKNOWN_ID;
+                cache->constantOffsets[stage][i] = UNKNOWN_VALUE;
+            }
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                cache->images[stage][i].id = UNKNOWN_ID;
+            }
+        }
+    }
+
+    // slots are visited in ascending order, so the range only ever grows at the end
+    static void AddChangedSlot(SlotRange* range, uint32_t slot)
+    {
+        if (range->count == 0) {
+            range->first = slot;
+        }
+        range->count = slot + 1 - range->first;
+    }
+
+    static bool IsInRange(SlotRange range, uint32_t slot)
+    {
+        return slot >= range.first && slot < range.first + range.count;
+    }
+
+    void UpdateStateCache(StateCache* cache, DrawCall* drawCall, IndexFormat indexFormat, Viewport* viewport, Rect* scissorRect,
+        StateChanges* outChanges, StateChangeStats* stats)
+    {
+        StateChanges changes = {};
+        uint32_t numSkipped = 0;
+
+        changes.pipelineState = drawCall->pipelineState.id != cache->pipelineState.id;
+        cache->pipelineState = drawCall->pipelineState;
+        numSkipped += changes.pipelineState ? 0 : 1;
+
+        changes.viewport = viewport->width != cache->viewport.width || viewport->height != cache->viewport.height;
+        cache->viewport = *viewport;
+        numSkipped += changes.viewport ? 0 : 1;
+
+        changes.scissorRect = scissorRect->left != cache->scissorRect.left || scissorRect->top != cache->scissorRect.top
+            || scissorRect->right != cache->scissorRect.right || scissorRect->bottom != cache->scissorRect.bottom;
+        cache->scissorRect = *scissorRect;
+        numSkipped += changes.scissorRect ? 0 : 1;
+
+        if (indexFormat != IndexFormat::INDEX_FORMAT_NONE) {
+            changes.indexBuffer = drawCall->indexBuffer.id != cache->indexBuffer.id || indexFormat != cache->indexFormat;
+            cache->indexBuffer = drawCall->indexBuffer;
+            cache->indexFormat = indexFormat;
+            numSkipped += changes.indexBuffer ? 0 : 1;
+        }
+
+        // offsets and strides of unbound streams are whatever the caller left in the draw call
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            Buffer buffer = drawCall->vertexBuffers[i];
+            uint32_t offset = GFX_CHECK_RESOURCE(buffer) ? drawCall->vertexOffsets[i] : 0;
+            uint32_t stride = GFX_CHECK_RESOURCE(buffer) ? drawCall->vertexStrides[i] : 0;
+            if (buffer.id != cache->vertexBuffers[i].id || offset != cache->vertexOffsets[i] || stride != cache->vertexStrides[i]) {
+                AddChangedSlot(&changes.vertexBuffers, i);
+                cache->vertexBuffers[i] = buffer;
+                cache->vertexOffsets[i] = offset;
+                cache->vertexStrides[i] = stride;
+            }
+        }
+        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
+            numSkipped += GFX_CHECK_RESOURCE(drawCall->vertexBuffers[i]) && !IsInRange(changes.vertexBuffers, i) ? 1 : 0;
+        }
+
+        Buffer* constants[NUM_CACHED_STAGES] = {
+            drawCall->vsConstantInputs, drawCall->psConstantInputs, drawCall->gsConstantInputs, drawCall->hsConstantInputs, drawCall->dsConstantInputs
+        };
+        uint32_t* constantOffsets[NUM_CACHED_STAGES] = {
+            drawCall->vsConstantOffsets, drawCall->psConstantOffsets, nullptr, nullptr, nullptr
+        };
+        Image* images[NUM_CACHED_STAGES] = {
+            drawCall->vsImageInputs, drawCall->psImageInputs, drawCall->gsImageInputs, drawCall->hsImageInputs, drawCall->dsImageInputs
+        };
+        uint32_t numConstantChanges = 0;
+        uint32_t numImageChanges = 0;
+        for (uint32_t stage = 0; stage < NUM_CACHED_STAGES; ++stage) {
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                Buffer buffer = constants[stage][i];
+                uint32_t offset = constantOffsets[stage] != nullptr && GFX_CHECK_RESOURCE(buffer) ? constantOffsets[stage][i] : 0;
+                if (buffer.id != cache->constants[stage][i].id || offset != cache->constantOffsets[stage][i]) {
+                    AddChangedSlot(&changes.constants[stage], i);
+                    cache->constants[stage][i] = buffer;
+                    cache->constantOffsets[stage][i] = offset;
+                }
+            }
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                if (images[stage][i].id != cache->images[stage][i].id) {
+                    AddChangedSlot(&changes.images[stage], i);
+                    cache->images[stage][i] = images[stage][i];
+                }
+            }
+            for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
+                numSkipped += GFX_CHECK_RESOURCE(constants[stage][i]) && !IsInRange(changes.constants[stage], i) ? 1 : 0;
+            }
+            for (uint32_t i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
+                numSkipped += GFX_CHECK_RESOURCE(images[stage][i]) && !IsInRange(changes.images[stage], i) ? 1 : 0;
+            }
+            numConstantChanges += changes.constants[stage].count;
+            numImageChanges += changes.images[stage].count;
+        }
+
+        stats->numDrawCalls++;
+        stats->numPipelineChanges += changes.pipelineState ? 1 : 0;
+        stats->numViewportChanges += changes.viewport ? 1 : 0;
+        stats->numScissorChanges += changes.scissorRect ? 1 : 0;
+        stats->numIndexBufferChanges += changes.indexBuffer ? 1 : 0;
+        stats->numVertexBufferChanges += changes.vertexBuffers.count;
+        stats->numConstantChanges += numConstantChanges;
+        stats->numImageChanges += numImageChanges;
+        stats->numSkippedBindings += numSkipped;
+
+        *outChanges = changes;
+    }
+
+    void EndStateChangeFrame(StateChangeStats* frameStats, StateChangeStats* lastFrameStats)
+    {
+        *lastFrameStats = *frameStats;
+        *frameStats = StateChangeStats();
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "gfx.h"
+
+/**
+    Shadow copy of the state a command buffer has bound, shared by all backends.
+    Draw calls are diffed against it so backends only emit the bindings that changed since the previous draw,
+    instead of resetting and rebinding everything. It compares handles, not what they point to: a destroyed and
+    recreated resource gets a new generation and therefore a different handle.
+    Backends have to invalidate whatever they change behind its back, e.g. when render targets are bound.
+*/
+
+namespace gfx
+{
+    // in DrawCall order
+    enum CachedStage : uint8_t
+    {
+        CACHED_STAGE_VS,
+        CACHED_STAGE_PS,
+        CACHED_STAGE_GS,
+        CACHED_STAGE_HS,
+        CACHED_STAGE_DS,
+        NUM_CACHED_STAGES
+    };
+
+    // slots [first, first + count) changed, count is 0 if nothing did
+    struct SlotRange
+    {
+        uint32_t    first = 0;
+        uint32_t    count = 0;
+    };
+
+    struct StateCache
+    {
+        PipelineState   pipelineState;
+        Viewport        viewport;
+        Rect            scissorRect;
+
+        Buffer          vertexBuffers[GFX_MAX_VERTEX_STREAMS];
+        uint32_t        vertexOffsets[GFX_MAX_VERTEX_STREAMS];
+        uint32_t        vertexStrides[GFX_MAX_VERTEX_STREAMS];
+        Buffer          indexBuffer;
+        IndexFormat     indexFormat;
+
+        Buffer          constants[NUM_CACHED_STAGES][GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+        uint32_t        constantOffsets[NUM_CACHED_STAGES][GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+        Image           images[NUM_CACHED_STAGES][GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+    };
+
+    struct StateChanges
+    {
+        bool        pipelineState;
+        bool        viewport;
+        bool        scissorRect;
+        bool        indexBuffer;            // buffer or format, never set for draws that aren't indexed
+        SlotRange   vertexBuffers;
+        SlotRange   constants[NUM_CACHED_STAGES];
+        SlotRange   images[NUM_CACHED_STAGES];
+    };
+
+    // forgets everything, the next draw rebinds all of its state
+    void InvalidateStateCache(StateCache* cache);
+    // for when bound images may have been unbound, slots that were empty stay empty
+    void InvalidateImageInputs(StateCache* cache);
+    // for when the contents of a buffer bound as constants have to be bound again
+    void InvalidateConstantInputs(StateCache* cache, Buffer buffer);
+    void InvalidateViewportAndScissor(StateCache* cache);
+
+    /**
+        Diffs the draw call against the cache and stores it as the new bound state. Viewport and scissor rect are
+        the resolved ones, not the optional arguments of SubmitDrawCall. indexFormat is the one of the draw's pipeline,
+        INDEX_FORMAT_NONE leaves the cached index buffer alone.
+        Unbound slots are cached as empty with zero offsets and strides, so clearing a slot counts as a change.
+    */
+    void UpdateStateCache(StateCache* cache, DrawCall* drawCall, IndexFormat indexFormat, Viewport* viewport, Rect* scissorRect,
+        StateChanges* outChanges, StateChangeStats* stats);
+
+    // stats of the frame that is being recorded become the ones of the last frame
+    void EndStateChangeFrame(StateChangeStats* frameStats, StateChangeStats* lastFrameStats);
+}
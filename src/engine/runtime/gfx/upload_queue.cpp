@@ -0,0 +1,235 @@
+#include "gfx.h"
+#include "resource_pool.h"
+#include <cassert>
+
+// backend independent, copies go through UpdateBuffer and UpdateImage
+
+#define UPLOAD_ALIGNMENT 16
+
+namespace gfx
+{
+    enum class UploadState : uint8_t
+    {
+        UPLOAD_WRITING,         // allocated, the data isn't complete yet
+        UPLOAD_SUBMITTED,
+        UPLOAD_CANCELED         // freed in order without a copy
+    };
+
+    struct Upload
+    {
+        UploadState state = UploadState::UPLOAD_WRITING;
+        bool        isImage = false;
+        uint32_t    resource = INVALID_ID;      // buffer or image handle
+        size_t      offset = 0;                 // into the buffer
+        uint32_t    firstMip = 0;
+        uint32_t    numMips = 0;
+        bool        isCopied = false;           // decided under the lock, a cancel during the copy comes too late
+
+        size_t      ringOffset = 0;
+        size_t      size = 0;
+        size_t      reservedSize = 0;           // aligned, plus the end of the ring if the upload wrapped around
+    };
+
+    struct UploadQueue
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+        Device*         device = nullptr;
+        UploadQueueDesc desc;
+        PoolLock        lock;
+
+        char*           ring = nullptr;
+        size_t          ringHead = 0;           // where the next allocation starts
+        size_t          ringUsed = 0;
+
+        // ring of uploads in fence order, the first one has fence completedFence + 1
+        Upload*         uploads = nullptr;
+        uint32_t        firstUpload = 0;
+        uint32_t        numUploads = 0;
+        UploadFence     completedFence = 0;
+
+        UploadQueueStats stats;
+    };
+
+    bool CreateUploadQueue(Device* device, UploadQueue** outQueue, UploadQueueDesc* desc, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        if (desc->ringSize < UPLOAD_ALIGNMENT || desc->maxUploads == 0) {
+            GT_LOG_ERROR("Gfx", "Upload queue with a ring of %llu bytes for %u uploads", (unsigned long long)desc->ringSize, desc->maxUploads);
+            return false;
+        }
+        UploadQueue* queue = GT_NEW(UploadQueue, memoryArena);
+        queue->memoryArena = memoryArena;
+        queue->device = device;
+        queue->desc = *desc;
+        queue->desc.ringSize = desc->ringSize & ~((size_t)UPLOAD_ALIGNMENT - 1);
+        queue->ring = GT_NEW_ARRAY(char, queue->desc.ringSize, memoryArena);
+        queue->uploads = GT_NEW_ARRAY(Upload, desc->maxUploads, memoryArena);
+        queue->stats.ringSize = queue->desc.ringSize;
+        *outQueue = queue;
+        return true;
+    }
+
+    void DestroyUploadQueue(UploadQueue* queue)
+    {
+        if (queue->numUploads > 0) {
+            GT_LOG_WARNING("Gfx", "Destroying upload queue with %u uploads that weren't processed", queue->numUploads);
+        }
+        GT_DELETE_ARRAY(queue->uploads, queue->memoryArena);
+        GT_DELETE_ARRAY(queue->ring, queue->memoryArena);
+        GT_DELETE(queue, queue->memoryArena);
+    }
+
+    void* AllocateUpload(UploadQueue* queue, size_t size, UploadFence* outFence)
+    {
+        size_t ringSize = queue->desc.ringSize;
+        size_t alignedSize = (size + UPLOAD_ALIGNMENT - 1) & ~((size_t)UPLOAD_ALIGNMENT - 1);
+        alignedSize = alignedSize > 0 ? alignedSize : UPLOAD_ALIGNMENT;
+
+        queue->lock.Lock();
+        // @NOTE allocations are contiguous, one that doesn't fit before the end of the ring skips the rest of it
+        size_t padding = queue->ringHead + alignedSize > ringSize ? ringSize - queue->ringHead : 0;
+        if (queue->numUploads == queue->desc.maxUploads || queue->ringUsed + padding + alignedSize > ringSize) {
+            queue->stats.numFailedAllocations++;
+            queue->lock.Unlock();
+            return nullptr;
+        }
+        Upload* upload = &queue->uploads[(queue->firstUpload + queue->numUploads) % queue->desc.maxUploads];
+        *upload = Upload();
+        upload->ringOffset = padding > 0 ? 0 : queue->ringHead;
+        upload->size = size;
+        upload->reservedSize = padding + alignedSize;
+        queue->ringHead = (upload->ringOffset + alignedSize) % ringSize;
+        queue->ringUsed += upload->reservedSize;
+        queue->numUploads++;
+        *outFence = queue->completedFence + queue->numUploads;
+        char* memory = queue->ring + upload->ringOffset;
+        queue->lock.Unlock();
+        return memory;
+    }
+
+    // called with the lock held
+    static Upload* GetUpload(UploadQueue* queue, UploadFence fence)
+    {
+        if (fence <= queue->completedFence || fence > queue->completedFence + queue->numUploads) {
+            return nullptr;
+        }
+        return &queue->uploads[(queue->firstUpload + (uint32_t)(fence - queue->completedFence - 1)) % queue->desc.maxUploads];
+    }
+
+    static void Submit(UploadQueue* queue, UploadFence fence, bool isImage, uint32_t resource, size_t offset, uint32_t firstMip, uint32_t numMips)
+    {
+        queue->lock.Lock();
+        Upload* upload = GetUpload(queue, fence);
+        if (upload == nullptr || upload->state != UploadState::UPLOAD_WRITING) {
+            queue->lock.Unlock();
+            GT_LOG_ERROR("Gfx", "Submitting upload %llu that wasn't allocated or was submitted before", (unsigned long long)fence);
+            return;
+        }
+        upload->isImage = isImage;
+        upload->resource = resource;
+        upload->offset = offset;
+        upload->firstMip = firstMip;
+        upload->numMips = numMips;
+        upload->state = UploadState::UPLOAD_SUBMITTED;
+        queue->lock.Unlock();
+    }
+
+    void SubmitBufferUpload(UploadQueue* queue, UploadFence fence, Buffer buffer, size_t offset)
+    {
+        Submit(queue, fence, false, buffer.id, offset, 0, 0);
+    }
+
+    void SubmitImageUpload(UploadQueue* queue, UploadFence fence, Image image, uint32_t firstMip, uint32_t numMips)
+    {
+        Submit(queue, fence, true, image.id, 0, firstMip, numMips);
+    }
+
+    void CancelUpload(UploadQueue* queue, UploadFence fence)
+    {
+        queue->lock.Lock();
+        Upload* upload = GetUpload(queue, fence);
+        if (upload != nullptr) {
+            upload->state = UploadState::UPLOAD_CANCELED;
+        }
+        queue->lock.Unlock();
+    }
+
+    static bool CopyUpload(UploadQueue* queue, Upload* upload)
+    {
+        const char* data = queue->ring + upload->ringOffset;
+        if (!upload->isImage) {
+            return UpdateBuffer(queue->device, { upload->resource }, upload->offset, data, upload->size);
+        }
+
+        ImageDesc desc = GetImageDesc(queue->device, { upload->resource });
+        if (desc.isStreamed && upload->firstMip < desc.firstResidentMip && !SetImageResidentMips(queue->device, { upload->resource }, upload->firstMip)) {
+            return false;
+        }
+        size_t offset = 0;
+        for (uint32_t mip = upload->firstMip; mip < upload->firstMip + upload->numMips; ++mip) {
+            size_t mipSize = GetImageMipSize(&desc, mip);
+            if (offset + mipSize > upload->size || !UpdateImage(queue->device, { upload->resource }, mip, data + offset, mipSize)) {
+                return false;
+            }
+            offset += mipSize;
+        }
+        return true;
+    }
+
+    uint32_t ProcessUploads(UploadQueue* queue)
+    {
+        // uploads are copied without the lock, their ring space isn't handed out again until they are freed below
+        queue->lock.Lock();
+        uint32_t numSubmitted = 0;     // including canceled ones
+        uint32_t numCopies = 0;
+        size_t numBytes = 0;
+        while (numSubmitted < queue->numUploads && (numSubmitted == 0 || numBytes < queue->desc.maxBytesPerFrame)) {
+            Upload* upload = &queue->uploads[(queue->firstUpload + numSubmitted) % queue->desc.maxUploads];
+            if (upload->state == UploadState::UPLOAD_WRITING) { break; }
+            upload->isCopied = upload->state == UploadState::UPLOAD_SUBMITTED;
+            numBytes += upload->isCopied ? upload->size : 0;
+            numCopies += upload->isCopied ? 1 : 0;
+            numSubmitted++;
+        }
+        queue->stats.numFailedAllocations = 0;
+        queue->lock.Unlock();
+
+        for (uint32_t i = 0; i < numSubmitted; ++i) {
+            Upload* upload = &queue->uploads[(queue->firstUpload + i) % queue->desc.maxUploads];
+            if (upload->isCopied && !CopyUpload(queue, upload)) {
+                GT_LOG_ERROR("Gfx", "Failed to upload %llu bytes to %s 0x%08x", (unsigned long long)upload->size, upload->isImage ? "image" : "buffer", upload->resource);
+            }
+        }
+
+        queue->lock.Lock();
+        for (uint32_t i = 0; i < numSubmitted; ++i) {
+            queue->ringUsed -= queue->uploads[queue->firstUpload].reservedSize;
+            queue->firstUpload = (queue->firstUpload + 1) % queue->desc.maxUploads;
+        }
+        queue->numUploads -= numSubmitted;
+        queue->completedFence += numSubmitted;
+        if (queue->numUploads == 0) {
+            queue->ringHead = 0;    // nothing left to wrap around
+        }
+        queue->stats.numCopies = numCopies;
+        queue->stats.copiedBytes = numBytes;
+        queue->lock.Unlock();
+        return numCopies;
+    }
+
+    bool IsUploadComplete(UploadQueue* queue, UploadFence fence)
+    {
+        queue->lock.Lock();
+        bool isComplete = fence <= queue->completedFence;
+        queue->lock.Unlock();
+        return isComplete;
+    }
+
+    void GetUploadQueueStats(UploadQueue* queue, UploadQueueStats* outStats)
+    {
+        queue->lock.Lock();
+        *outStats = queue->stats;
+        outStats->usedBytes = queue->ringUsed;
+        outStats->numPending = queue->numUploads;
+        queue->lock.Unlock();
+    }
+}
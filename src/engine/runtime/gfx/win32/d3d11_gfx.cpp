@@ -1,20 +1,19 @@
 #include "../gfx.h"
+#include "../command_stream.h"
+#include "../state_cache.h"
+#include "../bind_group.h"
+#include "../resource_pool.h"
+#include "../pipeline_cache.h"
 #include <foundation/memory/memory.h>
 #include <foundation/memory/allocators.h>
 #include <cassert>  // @TODO: override
 #include <math.h>
+#include <string.h>
 
-#include <d3d11.h>
+#include <d3d11_1.h>
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
 
-#define HANDLE_INDEX(handle)        (uint16_t)(handle)
-#define HANDLE_GENERATION(handle)   (uint16_t)(handle >> 16)
-
-#define HANDLE_GENERATION_START 1
-
-#define MAKE_HANDLE(index, generation) (uint32_t)(((uint32_t)generation) << 16 | index); 
-
 namespace gfx
 {
     struct D3D11Buffer 
@@ -25,6 +24,10 @@ namespace gfx
 
         BufferDesc desc;
         ID3D11Buffer*   buffer      = nullptr;
+
+        // streamed constant buffers on devices that can't bind constants with offsets live in CPU memory, see BindConstantInputs
+        char*           shadow      = nullptr;
+        uint32_t        numMaps     = 0;
     };
 
     struct D3D11Image
@@ -60,7 +63,7 @@ namespace gfx
         ShaderDesc      desc;
         // @NOTE
         union {
-            ID3D11VertexShader* as_vertexShader;
+            ID3D11VertexShader* as_vertexShader = nullptr;
             ID3D11PixelShader* as_pixelShader;
             ID3D11GeometryShader* as_geometryShader;
             ID3D11HullShader* as_hullShader;
@@ -121,9 +124,25 @@ namespace gfx
         _ResourceState  resState = _ResourceState::STATE_EMPTY;
 
         ID3D11DeviceContext*    d3dDC = nullptr;
+        ID3D11DeviceContext1*   d3dDC1 = nullptr;       // only set if constant buffers can be bound with offsets
 
         D3D11RenderPass*        renderPass = nullptr;
-        // @TODO
+
+        // what the context has bound, only used by the immediate command buffer
+        StateCache              stateCache;
+
+        // deferred command buffers record instead of owning a deferred context, see SubmitCommandBuffers
+        bool                    isDeferred = false;
+        CommandStream           stream;
+    };
+
+    struct D3D11BindGroup
+    {
+        Device*         associatedDevice = nullptr;
+        uint16_t        generation = HANDLE_GENERATION_START;
+        _ResourceState  resState = _ResourceState::STATE_EMPTY;
+
+        BindGroupData   data;
     };
 
     struct D3D11SwapChain
@@ -143,14 +162,16 @@ namespace gfx
     };
 
 
-    void D3D11ReleaseResource(D3D11Buffer* buffer)
+    void D3D11ReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, D3D11Buffer* buffer)
     {
         if (buffer->buffer != nullptr) {
             buffer->buffer->Release();
         }
+        memoryArena->Free(buffer->shadow);
+        buffer->shadow = nullptr;
     }
 
-    void D3D11ReleaseResource(D3D11Shader* shader)
+    void D3D11ReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, D3D11Shader* shader)
     {
         if (shader->as_vertexShader == nullptr) { return; }
         switch (shader->desc.type) {
@@ -172,104 +193,70 @@ namespace gfx
         }
     }
 
-    void D3D11ReleaseResource(D3D11Image* image)
+    void D3D11ReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, D3D11Image* image)
     {
         // @TODO don't leak the resource here
     }
 
-    void D3D11ReleaseResource(D3D11RenderPass* renderPass)
+    void D3D11ReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, D3D11RenderPass* renderPass)
     {
         // no-op, we hold no d3d11 resources
     }
 
-    void D3D11ReleaseResource(D3D11SwapChain* swapChain)
+    void D3D11ReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, D3D11PipelineState* state)
     {
-        if (swapChain->swapChain != nullptr) {
-            swapChain->swapChain->Release();
+        if (state->inputLayout != nullptr) {
+            state->inputLayout->Release();
         }
-    }
-
-    template <class TResource> 
-    struct ResourcePool
-    {
-        uint32_t    size        = 0;
-        TResource*  buffer      = nullptr;
-        uint16_t*   indexList   = nullptr;
-        uint32_t    indexListHead   = 0;
-        uint32_t    indexListTail   = 0;
-
-        void Initialize(uint32_t bufferSize, fnd::memory::MemoryArenaBase* memoryArena)
-        {
-            size = bufferSize;
-            buffer = GT_NEW_ARRAY(TResource, size, memoryArena);
-            indexList = GT_NEW_ARRAY(uint16_t, size, memoryArena);
-            indexListHead = indexListTail = 0;
-            for (uint32_t i = 0; i < size; ++i) {
-                indexList[i] = i;
-            }
-            indexListTail = size - 1;
+        if (state->blendState != nullptr) {
+            state->blendState->Release();
         }
-
-        bool GetNextIndex(uint16_t* outIndex)
-        {
-            if (indexListHead == indexListTail) { return false; }
-            *outIndex = indexList[indexListHead];
-            indexListHead = (indexListHead + 1) % size;
-            return true;
+        if (state->rasterizerState != nullptr) {
+            state->rasterizerState->Release();
         }
-
-        void ReleaseIndex(uint16_t index)
-        {
-            indexListTail = (indexListTail + 1) % size;
-            indexList[indexListTail] = index;
+        if (state->depthStencilState != nullptr) {
+            state->depthStencilState->Release();
         }
+    }
 
-        bool Allocate(TResource** resource, uint32_t* id)
-        {
-            uint16_t index = 0;
-            if (!GetNextIndex(&index)) {
-                return false;
-            }
-            TResource* res = &buffer[index];
-            res->resState = _ResourceState::STATE_ALLOC;
-            *resource = res;
-            *id = MAKE_HANDLE(index, res->generation);
-            return true;
-        }
-
-        void Free(uint32_t id)
-        {
-            uint16_t index = HANDLE_INDEX(id);
-            TResource* res = &buffer[index];
-            assert(res->generation == HANDLE_GENERATION(id));
-            D3D11ReleaseResource(res);
-            
-            res->generation++;
-            res->resState = _ResourceState::STATE_EMPTY;
+    void D3D11ReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, D3D11CommandBuffer* cmdBuffer)
+    {
+        ReleaseCommandStream(&cmdBuffer->stream, memoryArena);
+    }
 
-            ReleaseIndex(index);
-        }
+    void D3D11ReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, D3D11BindGroup* bindGroup)
+    {
+        // no-op, only references resources
+    }
 
-        TResource* Get(uint32_t id)
-        {
-            uint16_t index = HANDLE_INDEX(id);
-            TResource* res = &buffer[index];
-            assert(res->generation == HANDLE_GENERATION(id));
-            return res;
+    void D3D11ReleaseResource(fnd::memory::MemoryArenaBase* memoryArena, D3D11SwapChain* swapChain)
+    {
+        if (swapChain->rtv != nullptr) {
+            swapChain->rtv->Release();
         }
-    };
+        if (swapChain->dsv != nullptr) {
+            swapChain->dsv->Release();
+        }
+        if (swapChain->depthBuffer != nullptr) {
+            swapChain->depthBuffer->Release();
+        }
+        if (swapChain->swapChain != nullptr) {
+            swapChain->swapChain->Release();
+        }
+    }
 
     struct Interface
     {
         fnd::memory::MemoryArenaBase* memoryArena = nullptr;
 
-        ResourcePool<D3D11Buffer>           bufferPool;
-        ResourcePool<D3D11Image>            imagePool;
-        ResourcePool<D3D11PipelineState>    pipelineStatePool;
-        ResourcePool<D3D11Shader>           shaderPool;
-        ResourcePool<D3D11RenderPass>       passPool;
-        ResourcePool<D3D11CommandBuffer>    cmdBufferPool;
-        ResourcePool<D3D11SwapChain>        swapChainPool;
+        ResourcePool<D3D11Buffer, D3D11ReleaseResource>           bufferPool;
+        ResourcePool<D3D11Image, D3D11ReleaseResource>            imagePool;
+        ResourcePool<D3D11PipelineState, D3D11ReleaseResource>    pipelineStatePool;
+        ResourcePool<D3D11Shader, D3D11ReleaseResource>           shaderPool;
+        ResourcePool<D3D11RenderPass, D3D11ReleaseResource>       passPool;
+        ResourcePool<D3D11CommandBuffer, D3D11ReleaseResource>    cmdBufferPool;
+        ResourcePool<D3D11BindGroup, D3D11ReleaseResource>        bindGroupPool;
+        ResourcePool<D3D11SwapChain, D3D11ReleaseResource>        swapChainPool;
 
         Device*     deviceList = nullptr;
         uint32_t    numDevices = 0;
@@ -277,6 +264,16 @@ namespace gfx
         IDXGIFactory1*  idxgiFactory = nullptr;
     };
 
+    static const uint32_t CONSTANT_WINDOW_SIZE = D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16;
+
+    struct ConstantWindow
+    {
+        ID3D11Buffer*   buffer = nullptr;
+        Buffer          source;             // what the window holds a copy of
+        uint32_t        offset = 0;
+        uint32_t        numMaps = 0;
+    };
+
     struct Device
     {
         Interface*              interf = nullptr;
@@ -286,7 +283,14 @@ namespace gfx
         ID3D11DeviceContext*    d3dDC       = nullptr;
         CommandBuffer           dcAsCmdBuffer;
 
-        PipelineState           pipelineStateCache;
+        StateChangeStats        stateChangeStats;
+        StateChangeStats        lastFrameStateChangeStats;
+        ResolvedDrawInputs      resolvedDrawInputs;     // of the draw items submitted to the immediate command buffer
+        PipelineCache           pipelineCache;
+
+        // @NOTE without the 11.1 runtime constants bound with offsets are copied into a 64 KB window per slot before the draw
+        bool                    canOffsetConstants = false;
+        ConstantWindow          constantWindows[NUM_CACHED_STAGES][GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
     };
 
 
@@ -320,16 +324,16 @@ namespace gfx
         }
         
         /* Initialize resource pools*/
-        interf->bufferPool.Initialize(desc->bufferPoolSize, memoryArena);
-        interf->imagePool.Initialize(desc->imagePoolSize, memoryArena);
-        interf->pipelineStatePool.Initialize(desc->pipelinePoolSize, memoryArena);
-        interf->shaderPool.Initialize(desc->shaderPoolSize, memoryArena);
-        interf->passPool.Initialize(desc->renderPassPoolSize, memoryArena);
-        interf->cmdBufferPool.Initialize(desc->cmdBufferPoolSize, memoryArena);
-        interf->swapChainPool.Initialize(desc->maxNumSwapChains, memoryArena);
-
-
-        return true;
+        bool poolsInitialized = interf->bufferPool.Initialize(desc->bufferPoolSize, memoryArena, "Buffer")
+            && interf->imagePool.Initialize(desc->imagePoolSize, memoryArena, "Image")
+            && interf->pipelineStatePool.Initialize(desc->pipelinePoolSize, memoryArena, "Pipeline state")
+            && interf->shaderPool.Initialize(desc->shaderPoolSize, memoryArena, "Shader")
+            && interf->passPool.Initialize(desc->renderPassPoolSize, memoryArena, "Render pass")
+            && interf->cmdBufferPool.Initialize(desc->cmdBufferPoolSize, memoryArena, "Command buffer")
+            && interf->bindGroupPool.Initialize(desc->bindGroupPoolSize, memoryArena, "Bind group")
+            && interf->swapChainPool.Initialize(desc->maxNumSwapChains, memoryArena, "Swap chain");
+
+        return poolsInitialized;
     }
 
     void EnumerateDevices(Interface* interf, DeviceInfo* outInfo, uint32_t* numDevices)
@@ -359,9 +363,27 @@ namespace gfx
         }
 
         D3D11CommandBuffer* immediateBuffer;
-        assert(interf->cmdBufferPool.Allocate(&immediateBuffer, &device->dcAsCmdBuffer.id));
+        if (!interf->cmdBufferPool.Allocate(&immediateBuffer, &device->dcAsCmdBuffer.id)) {
+            device->d3dDC->Release();
+            device->d3dDevice->Release();
+            device->d3dDC = nullptr;
+            device->d3dDevice = nullptr;
+            return nullptr;
+        }
         immediateBuffer->associatedDevice = device;
         immediateBuffer->d3dDC = device->d3dDC;
+        InvalidateStateCache(&immediateBuffer->stateCache);
+        InvalidateResolvedDrawInputs(&device->resolvedDrawInputs);
+        InitializePipelineCache(&device->pipelineCache, interf->memoryArena);
+
+        // @NOTE binding constant buffers with offsets needs the 11.1 runtime, without it the offsets are ignored
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+        ZeroMemory(&options, sizeof(options));
+        res = device->d3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+        if (SUCCEEDED(res) && options.ConstantBufferOffsetting) {
+            device->d3dDC->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&immediateBuffer->d3dDC1);
+        }
+        device->canOffsetConstants = immediateBuffer->d3dDC1 != nullptr;
         immediateBuffer->resState = _ResourceState::STATE_VALID;
 
         return device;
@@ -384,7 +406,8 @@ namespace gfx
         D3D11_USAGE::D3D11_USAGE_IMMUTABLE,
         D3D11_USAGE::D3D11_USAGE_DYNAMIC,
         D3D11_USAGE::D3D11_USAGE_DYNAMIC,   // @NOTE D3d11 has no streaming buffers so no distiction here
-        D3D11_USAGE::D3D11_USAGE_STAGING
+        D3D11_USAGE::D3D11_USAGE_STAGING,
+        D3D11_USAGE::D3D11_USAGE_DEFAULT    // copy destinations are written with UpdateSubresource
     };
 
     Buffer CreateBuffer(Device* device, BufferDesc* desc)
@@ -398,11 +421,36 @@ namespace gfx
 
         ResourceUsage usage = desc->usage == ResourceUsage::_DEFAULT ? ResourceUsage::USAGE_IMMUTABLE : desc->usage;
 
+        if (desc->type == BufferType::BUFFER_TYPE_CONSTANT && !device->canOffsetConstants) {
+            if (usage == ResourceUsage::USAGE_STREAM) {
+                // @NOTE padded by a window so copying a whole window from any offset stays inside the allocation
+                buffer->shadow = (char*)device->interf->memoryArena->Allocate(desc->byteWidth + CONSTANT_WINDOW_SIZE, 16, GT_SOURCE_INFO);
+                if (buffer->shadow == nullptr) {
+                    device->interf->bufferPool.Free(result.id);
+                    return { gfx::INVALID_ID };
+                }
+                if (desc->initialData != nullptr) {
+                    memcpy(buffer->shadow, desc->initialData, desc->byteWidth);
+                }
+                buffer->numMaps = 0;
+                buffer->associatedDevice = device;
+                buffer->desc = *desc;
+                buffer->resState = _ResourceState::STATE_VALID;
+                return result;
+            }
+            if (desc->byteWidth > CONSTANT_WINDOW_SIZE) {
+                GT_LOG_ERROR("D3D11", "Constant buffer of %llu bytes is larger than the %u bytes a shader can see without the 11.1 runtime",
+                    (unsigned long long)desc->byteWidth, CONSTANT_WINDOW_SIZE);
+                device->interf->bufferPool.Free(result.id);
+                return { gfx::INVALID_ID };
+            }
+        }
+
         D3D11_BUFFER_DESC d3d11Desc;
         ZeroMemory(&d3d11Desc, sizeof(d3d11Desc));
         d3d11Desc.ByteWidth = (UINT)desc->byteWidth;
         d3d11Desc.Usage = g_resUsageTable[(uint8_t)usage];
-        if (usage != ResourceUsage::USAGE_IMMUTABLE) {
+        if (usage != ResourceUsage::USAGE_IMMUTABLE && usage != ResourceUsage::USAGE_COPY_DESTINATION) {
             d3d11Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
         }
         if (usage == ResourceUsage::USAGE_STAGING) {
@@ -418,6 +466,10 @@ namespace gfx
             case BufferType::BUFFER_TYPE_CONSTANT:
                 d3d11Desc.BindFlags = D3D11_BIND_FLAG::D3D11_BIND_CONSTANT_BUFFER;
             break;
+            case BufferType::BUFFER_TYPE_INDIRECT_ARGS:
+                d3d11Desc.BindFlags = 0;
+                d3d11Desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+            break;
             default:
                 d3d11Desc.BindFlags = 0;
             break;
@@ -483,6 +535,8 @@ namespace gfx
         }
         shader->associatedDevice = device;
         shader->desc = *desc;
+        shader->resState = _ResourceState::STATE_VALID;
+        RegisterShader(&device->pipelineCache, result, desc);
         return result;
     }
 
@@ -578,12 +632,20 @@ namespace gfx
         if (desc->type == ImageType::IMAGE_TYPE_CUBE) {
             texDesc.ArraySize = 6;
         }
+        uint16_t firstResidentMip = desc->isStreamed ? desc->firstResidentMip : 0;
+        if (desc->isStreamed) {
+            assert(desc->type == ImageType::IMAGE_TYPE_2D && desc->numSlices == 1 && !desc->isRenderTarget && !desc->isDepthStencilTarget);
+            assert(firstResidentMip < desc->numMipmaps);
+            texDesc.Width = desc->width >> firstResidentMip > 0 ? desc->width >> firstResidentMip : 1;
+            texDesc.Height = desc->height >> firstResidentMip > 0 ? desc->height >> firstResidentMip : 1;
+            texDesc.MipLevels = desc->numMipmaps - firstResidentMip;
+        }
         texDesc.Format = g_pixelFormatTable[(uint8_t)desc->pixelFormat];
 
         ResourceUsage usage = desc->usage == ResourceUsage::_DEFAULT ? ResourceUsage::USAGE_IMMUTABLE : desc->usage;
 
         texDesc.CPUAccessFlags = 0;
-        if (usage != ResourceUsage::USAGE_IMMUTABLE) {
+        if (usage != ResourceUsage::USAGE_IMMUTABLE && usage != ResourceUsage::USAGE_COPY_DESTINATION) {
             texDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
         }
         if (usage == ResourceUsage::USAGE_STAGING) {
@@ -606,6 +668,12 @@ namespace gfx
             // @TODO: specify if bindable as depth target?
         }
 
+        if (desc->isStreamed) {
+            // mips are filled by UpdateSubresource once they become resident
+            texDesc.Usage = D3D11_USAGE_DEFAULT;
+            texDesc.CPUAccessFlags = 0;
+        }
+
         texDesc.MiscFlags = 0;
         if (texDesc.MipLevels > 1) {
             //@HACK
@@ -623,7 +691,7 @@ namespace gfx
         D3D11_SUBRESOURCE_DATA* pDataPtr = numDataItems > 0 ? &pData[0] : nullptr;
         UINT numComponents = g_pixelFormatComponentCount[(uint8_t)desc->pixelFormat];
         UINT componentSize = g_pixelFormatComponentSize[(uint8_t)desc->pixelFormat];
-        auto width = desc->width;
+        UINT width = texDesc.Width;
         for (int i = 0; i < numDataItems; ++i) {
             pData[i].pSysMem = desc->initialData[i];
             pData[i].SysMemPitch = width * numComponents * componentSize;
@@ -633,7 +701,7 @@ namespace gfx
             }
             pData[i].SysMemSlicePitch = pData[i].SysMemPitch * desc->height;  // @TODO: Verify?
         }
-        assert((desc->isRenderTarget || desc->isDepthStencilTarget) || !(usage == ResourceUsage::USAGE_IMMUTABLE && pDataPtr == nullptr));
+        assert((desc->isRenderTarget || desc->isDepthStencilTarget || desc->isStreamed) || !(usage == ResourceUsage::USAGE_IMMUTABLE && pDataPtr == nullptr));
         
         // Create the texture
         HRESULT res = S_OK;
@@ -706,6 +774,7 @@ namespace gfx
         image->desc = *desc;
         image->desc.usage = usage;
         image->desc.numDataItems = numDataItems;
+        image->desc.firstResidentMip = firstResidentMip;
         return result;
     }
 
@@ -880,8 +949,46 @@ namespace gfx
         return out;
     }
 
+    // sub-state objects are shared through the pipeline cache, which keeps a reference of its own to each of them
+    template <class TObject, class TCreateFunc>
+    static TObject* GetSharedSubState(PipelineCache* cache, PipelineKey* key, PipelineKeySection section, TCreateFunc create)
+    {
+        if (key == nullptr) {
+            return create();
+        }
+        TObject* object = (TObject*)FindSubState(cache, key, section);
+        if (object == nullptr) {
+            TObject* created = create();
+            if (created == nullptr) {
+                return nullptr;
+            }
+            object = (TObject*)AddSubState(cache, key, section, created);
+            if (object != created) {
+                created->Release();     // another thread created the same one
+            }
+        }
+        object->AddRef();
+        return object;
+    }
+
     PipelineState CreatePipelineState(Device* device, PipelineStateDesc* desc)
     {
+        bool hasValidShaders = device->interf->shaderPool.Get(desc->vertexShader.id) != nullptr && device->interf->shaderPool.Get(desc->pixelShader.id) != nullptr;
+        hasValidShaders = hasValidShaders && (!GFX_CHECK_RESOURCE(desc->geometryShader) || device->interf->shaderPool.Get(desc->geometryShader.id) != nullptr);
+        hasValidShaders = hasValidShaders && (!GFX_CHECK_RESOURCE(desc->hullShader) || device->interf->shaderPool.Get(desc->hullShader.id) != nullptr);
+        hasValidShaders = hasValidShaders && (!GFX_CHECK_RESOURCE(desc->domainShader) || device->interf->shaderPool.Get(desc->domainShader.id) != nullptr);
+        if (!hasValidShaders) {
+            GT_LOG_ERROR("D3D11", "Pipeline state uses invalid shaders");
+            return { gfx::INVALID_ID };
+        }
+
+        PipelineKey key;
+        PipelineKey* cacheKey = BuildPipelineKey(&device->pipelineCache, desc, &key) ? &key : nullptr;
+        if (cacheKey != nullptr) {
+            PipelineState cached = FindPipelineState(&device->pipelineCache, cacheKey);
+            if (GFX_CHECK_RESOURCE(cached)) { return cached; }
+        }
+
         gfx::D3D11PipelineState* state = nullptr;
         PipelineState result{ gfx::INVALID_ID };
         if (!device->interf->pipelineStatePool.Allocate(&state, &result.id)) {
@@ -894,11 +1001,16 @@ namespace gfx
             state->desc.primitiveType = PrimitiveType::PRIMITIVE_TYPE_TRIANGLES;
         }
         
-        state->blendState = D3D11CreateBlendState(device->d3dDevice, &desc->blendState);
+        PipelineCache* cache = &device->pipelineCache;
+        ID3D11Device* d3dDevice = device->d3dDevice;
+        state->blendState = GetSharedSubState<ID3D11BlendState>(cache, cacheKey, PIPELINE_KEY_BLEND,
+            [&]() { return D3D11CreateBlendState(d3dDevice, &desc->blendState); });
         state->blendWriteMask = desc->blendState.writeMask;
         memcpy(state->blendColor, desc->blendState.color, sizeof(float) * 4);
-        state->rasterizerState = D3D11CreateRasterState(device->d3dDevice, &desc->rasterState);
-        state->depthStencilState = D3D11CreateDepthStencilState(device->d3dDevice, &desc->depthStencilState);
+        state->rasterizerState = GetSharedSubState<ID3D11RasterizerState>(cache, cacheKey, PIPELINE_KEY_RASTER,
+            [&]() { return D3D11CreateRasterState(d3dDevice, &desc->rasterState); });
+        state->depthStencilState = GetSharedSubState<ID3D11DepthStencilState>(cache, cacheKey, PIPELINE_KEY_DEPTH_STENCIL,
+            [&]() { return D3D11CreateDepthStencilState(d3dDevice, &desc->depthStencilState); });
 
         state->vertexShader = device->interf->shaderPool.Get(desc->vertexShader.id);
         state->pixelShader = device->interf->shaderPool.Get(desc->pixelShader.id);
@@ -925,16 +1037,27 @@ namespace gfx
             }
         }
         if (numInputElements > 0) {
-            HRESULT res = device->d3dDevice->CreateInputLayout(inputElements, numInputElements, state->vertexShader->desc.code, state->vertexShader->desc.codeSize, &state->inputLayout);
-            if (FAILED(res)) {
-                device->interf->pipelineStatePool.ReleaseIndex(result.id);
+            D3D11Shader* vertexShader = state->vertexShader;
+            state->inputLayout = GetSharedSubState<ID3D11InputLayout>(cache, cacheKey, PIPELINE_KEY_VERTEX_LAYOUT, [&]() {
+                ID3D11InputLayout* inputLayout = nullptr;
+                HRESULT res = d3dDevice->CreateInputLayout(inputElements, numInputElements, vertexShader->desc.code, vertexShader->desc.codeSize, &inputLayout);
+                return SUCCEEDED(res) ? inputLayout : nullptr;
+            });
+            if (state->inputLayout == nullptr) {
+                device->interf->pipelineStatePool.Free(result.id);
                 return { gfx::INVALID_ID };
             }
         }
         else {
             state->inputLayout = nullptr;
         }
-        return result;
+        state->resState = _ResourceState::STATE_VALID;
+
+        PipelineState cached = cacheKey != nullptr ? AddPipelineState(cache, cacheKey, result) : result;
+        if (cached.id != result.id) {
+            device->interf->pipelineStatePool.Free(result.id);   // another thread created the same one
+        }
+        return cached;
     }
 
     SwapChain CreateSwapChain(Device* device, SwapChainDesc* desc)
@@ -977,7 +1100,6 @@ namespace gfx
         render_target_view_desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
         res = swapChain->swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&pBackBuffer);
         if (res != S_OK) {
-            swapChain->swapChain->Release();
             device->interf->swapChainPool.Free(result.id);
             return { gfx::INVALID_ID };
         }
@@ -997,7 +1119,6 @@ namespace gfx
 
         res = device->d3dDevice->CreateTexture2D(&Desc, NULL, &swapChain->depthBuffer);
         if (FAILED(res)) {
-            swapChain->swapChain->Release();
             device->interf->swapChainPool.Free(result.id);
             return { gfx::INVALID_ID };
         }
@@ -1007,8 +1128,6 @@ namespace gfx
         dsvDesc.ViewDimension = D3D11_DSV_DIMENSION::D3D11_DSV_DIMENSION_TEXTURE2D;
         res = device->d3dDevice->CreateDepthStencilView(swapChain->depthBuffer, &dsvDesc, &swapChain->dsv);
         if (FAILED(res)) {
-            swapChain->swapChain->Release();
-            swapChain->rtv->Release();
             device->interf->swapChainPool.Free(result.id);
             return { gfx::INVALID_ID };
         }
@@ -1017,25 +1136,28 @@ namespace gfx
         //  create a default render pass for this swap chain
         uint32_t id = 0;
         if(!device->interf->passPool.Allocate(&swapChain->defaultRenderPass, &id)) {
-            swapChain->swapChain->Release();
-            swapChain->rtv->Release();
-            swapChain->dsv->Release();
             device->interf->swapChainPool.Free(result.id);
             return { gfx::INVALID_ID };
         }
         swapChain->defaultRenderPass->width = desc->width;
         swapChain->defaultRenderPass->height = desc->height;
         swapChain->defaultRenderPass->backbuffer = swapChain->rtv;
+        swapChain->defaultRenderPass->resState = _ResourceState::STATE_VALID;
 
         swapChain->associatedDevice = device;
         swapChain->desc = *desc;
         swapChain->desc.bufferCountHint = 2;    // @NOTE double buffering is the only supported mode in this backend
+        swapChain->resState = _ResourceState::STATE_VALID;
         return result;
     }
 
     void ResizeSwapChain(Device* device, SwapChain handle, uint32_t width, uint32_t height)
     {
         D3D11SwapChain* swapChain = device->interf->swapChainPool.Get(handle.id);
+        if (swapChain == nullptr) {
+            GT_LOG_ERROR("D3D11", "Resizing invalid swap chain 0x%08x", handle.id);
+            return;
+        }
         if (swapChain->rtv) {
             swapChain->rtv->Release();
             swapChain->rtv = nullptr;
@@ -1066,6 +1188,14 @@ namespace gfx
         if (!device->interf->passPool.Allocate(&renderPass, &result.id)) {
             return { gfx::INVALID_ID };
         }
+        for (size_t i = 0; i < GFX_MAX_COLOR_ATTACHMENTS + 1; ++i) {
+            Image attachment = i < GFX_MAX_COLOR_ATTACHMENTS ? desc->colorAttachments[i].image : desc->depthStencilAttachment.image;
+            if (GFX_CHECK_RESOURCE(attachment) && device->interf->imagePool.Get(attachment.id) == nullptr) {
+                GT_LOG_ERROR("D3D11", "Render pass uses invalid image 0x%08x", attachment.id);
+                device->interf->passPool.Free(result.id);
+                return { gfx::INVALID_ID };
+            }
+        }
         if (GFX_CHECK_RESOURCE(desc->depthStencilAttachment.image)) {
             D3D11Image* image = device->interf->imagePool.Get(desc->depthStencilAttachment.image.id);
             renderPass->width = image->desc.width;
@@ -1114,7 +1244,7 @@ namespace gfx
                 auto res = device->d3dDevice->CreateRenderTargetView(imgDesc->type == ImageType::IMAGE_TYPE_2D ? img->as_2DTexture : img->as_cubeTexture, &render_target_view_desc, &renderPass->colorAttachmentRTVs[i]);
 
                 if (FAILED(res)) {
-                    device->interf->imagePool.Free(result.id);
+                    device->interf->passPool.Free(result.id);
                     return { gfx::INVALID_ID };
                 }
             }
@@ -1126,16 +1256,136 @@ namespace gfx
         return result;
     }
 
+    CommandBuffer CreateCommandBuffer(Device* device, CommandBufferDesc* desc)
+    {
+        D3D11CommandBuffer* cmdBuffer = nullptr;
+        CommandBuffer result;
+        if (!device->interf->cmdBufferPool.Allocate(&cmdBuffer, &result.id)) {
+            return { INVALID_ID };
+        }
+        if (!InitializeCommandStream(&cmdBuffer->stream, desc->memorySize, device->interf->memoryArena)) {
+            device->interf->cmdBufferPool.Free(result.id);
+            return { INVALID_ID };
+        }
+        cmdBuffer->isDeferred = true;
+        cmdBuffer->renderPass = nullptr;
+        cmdBuffer->associatedDevice = device;
+        cmdBuffer->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    void DestroyCommandBuffer(Device* device, CommandBuffer cmdBuffer)
+    {
+        D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        assert(cmdBuf != nullptr && cmdBuf->isDeferred);
+        device->interf->cmdBufferPool.Free(cmdBuffer.id);
+    }
+
+    BindGroup CreateBindGroup(Device* device, BindGroupDesc* desc)
+    {
+        if (!ValidateBindGroupDesc(device, desc)) {
+            return { INVALID_ID };
+        }
+
+        D3D11BindGroup* bindGroup = nullptr;
+        BindGroup result;
+        if (!device->interf->bindGroupPool.Allocate(&bindGroup, &result.id)) {
+            return { INVALID_ID };
+        }
+        InitializeBindGroupData(&bindGroup->data, desc);
+        bindGroup->associatedDevice = device;
+        bindGroup->resState = _ResourceState::STATE_VALID;
+        return result;
+    }
+
+    void DestroyBindGroup(Device* device, BindGroup bindGroup)
+    {
+        device->interf->bindGroupPool.Free(bindGroup.id);
+    }
+
+    // empty descs for invalid handles, bind group validation relies on that to reject them
+    BufferDesc GetBufferDesc(Device* device, Buffer buffer)
+    {
+        D3D11Buffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        return bufferObj != nullptr ? bufferObj->desc : BufferDesc();
+    }
+
+    ImageDesc GetImageDesc(Device* device, Image image)
+    {
+        D3D11Image* imageObj = device->interf->imagePool.Get(image.id);
+        return imageObj != nullptr ? imageObj->desc : ImageDesc();
+    }
+
+    // commands on deferred command buffers are only recorded, this may run on any thread so it touches nothing else
+    static CommandStream* GetDeferredStream(Device* device, CommandBuffer cmdBuffer)
+    {
+        D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        return cmdBuf->isDeferred ? &cmdBuf->stream : nullptr;
+    }
+
+    // a render pass that failed to begin leaves the command buffer outside of one, its commands are skipped
+    static bool IsInRenderPass(D3D11CommandBuffer* cmdBuf, CommandBuffer cmdBuffer)
+    {
+        if (cmdBuf->renderPass != nullptr) { return true; }
+        GT_LOG_ERROR("D3D11", "Command on command buffer 0x%08x outside of a render pass", cmdBuffer.id);
+        return false;
+    }
+
+    // @NOTE replaying on the immediate context instead of using D3D11 deferred contexts keeps the pipeline state
+    // cache and the constant buffer offsets working, and most drivers emulate command lists anyway
+    void SubmitCommandBuffers(Device* device, CommandBuffer* cmdBuffers, uint32_t numCmdBuffers)
+    {
+        for (uint32_t i = 0; i < numCmdBuffers; ++i) {
+            CommandStream* stream = GetDeferredStream(device, cmdBuffers[i]);
+            assert(stream != nullptr);
+            ReplayCommandStream(device, device->dcAsCmdBuffer, stream);
+        }
+    }
+
+
+    // binding a resource as render target unbinds it from every shader input, so image inputs are rebound by the next draw
+    static void BindRenderTargets(Device* device, D3D11CommandBuffer* cmdBuf)
+    {
+        D3D11RenderPass* pass = cmdBuf->renderPass;
+        // @HACK
+        if (pass->backbuffer != nullptr) {
+            cmdBuf->d3dDC->OMSetRenderTargets(1, &pass->backbuffer, pass->depthBuffer);
+        }
+        else {
+            ID3D11RenderTargetView* renderTargets[GFX_MAX_COLOR_ATTACHMENTS];
+            UINT numRenderTargets = 0;
+            for (int i = 0; i < GFX_MAX_COLOR_ATTACHMENTS; ++i) {
+                if (!GFX_CHECK_RESOURCE(pass->desc.colorAttachments[i].image)) {
+                    break;
+                }
+                renderTargets[numRenderTargets++] = pass->colorAttachmentRTVs[i]; // @HACK @TODO mipmaplevel/slice
+            }
+            ID3D11DepthStencilView* dsv = nullptr;
+            if (GFX_CHECK_RESOURCE(pass->desc.depthStencilAttachment.image)) {
+                dsv = pass->depthStencilView;
+            }
+            cmdBuf->d3dDC->OMSetRenderTargets(numRenderTargets, renderTargets, dsv);
+        }
+        InvalidateImageInputs(&cmdBuf->stateCache);
+        device->stateChangeStats.numRenderTargetChanges++;
+    }
 
     void BeginDefaultRenderPass(Device* device, CommandBuffer cmdBuffer, SwapChain swapChain, RenderPassAction* action)
     {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordBeginDefaultRenderPass(stream, swapChain, action);
+            return;
+        }
         D3D11SwapChain* swpCh = device->interf->swapChainPool.Get(swapChain.id);
         D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
         assert(cmdBuf->renderPass == nullptr);
+        if (swpCh == nullptr) {
+            GT_LOG_ERROR("D3D11", "Beginning render pass on invalid swap chain 0x%08x", swapChain.id);
+            return;
+        }
         cmdBuf->renderPass = swpCh->defaultRenderPass;
         assert(cmdBuf->renderPass != nullptr);
 
-        //cmdBuf->d3dDC->OMSetRenderTargets(1, &swpCh->rtv, nullptr);
         if (action->colors[0].action == Action::ACTION_CLEAR) {
             cmdBuf->d3dDC->ClearRenderTargetView(swpCh->rtv, action->colors[0].color);
             
@@ -1151,13 +1401,22 @@ namespace gfx
             cmdBuf->d3dDC->ClearDepthStencilView(swpCh->dsv, dsClearFlags, action->depth.value, action->stencil.value);
             cmdBuf->renderPass->depthBuffer = swpCh->dsv;
         }
+        BindRenderTargets(device, cmdBuf);
     }
 
     void BeginRenderPass(Device* device, CommandBuffer cmdBuffer, RenderPass renderPass, RenderPassAction* action)
     {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordBeginRenderPass(stream, renderPass, action);
+            return;
+        }
         D3D11RenderPass* pass = device->interf->passPool.Get(renderPass.id);
         D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
         assert(cmdBuf->renderPass == nullptr);
+        if (pass == nullptr) {
+            GT_LOG_ERROR("D3D11", "Beginning invalid render pass 0x%08x", renderPass.id);
+            return;
+        }
         cmdBuf->renderPass = pass;
         assert(cmdBuf->renderPass != nullptr);
         // @TODO store D3D11Image pointers in render pass when creating it instead of looking them up here?
@@ -1184,12 +1443,17 @@ namespace gfx
             cmdBuf->d3dDC->ClearDepthStencilView(pass->depthStencilView, dsClearFlags, action->depth.value, action->stencil.value);
             cmdBuf->renderPass->depthBuffer = pass->depthStencilView;
         }
+        BindRenderTargets(device, cmdBuf);
     }
 
     void EndRenderPass(Device* device, CommandBuffer cmdBuffer)
     {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordEndRenderPass(stream);
+            return;
+        }
         D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
-        assert(cmdBuf->renderPass != nullptr);
+        if (!IsInRenderPass(cmdBuf, cmdBuffer)) { return; }
         cmdBuf->renderPass = nullptr;
     }
     
@@ -1200,152 +1464,218 @@ namespace gfx
         DXGI_FORMAT::DXGI_FORMAT_R32_UINT,
     };
 
-    void SubmitDrawCall(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    // nullptr for empty slots, stale handles leave the slot empty
+    static ID3D11Buffer* GetBoundBuffer(Device* device, Buffer buffer)
     {
-        D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
-        assert(cmdBuf->renderPass != nullptr);
-      
-        if (drawCall->pipelineState.id != device->pipelineStateCache.id) {
-            // @NOTE / @TODO: is this too expensive? can we just do that
-            // maybe only reset pipeline state actually
-            cmdBuf->d3dDC->ClearState();
-        }
-
-        // @TODO this is awkward to do, due to ClearState()....
-        D3D11_RECT scissor{ 0, 0, (LONG)cmdBuf->renderPass->width, (LONG)cmdBuf->renderPass->height };
-        D3D11_VIEWPORT vp;
-        ZeroMemory(&vp, sizeof(vp));
-        vp.Width = (float)cmdBuf->renderPass->width;
-        vp.Height = (float)cmdBuf->renderPass->height;
-        vp.MinDepth = 0.0f;
-        vp.MaxDepth = 1.0f;
-        if (viewport != nullptr) { vp.Width = viewport->width; vp.Height = viewport->height; }
-        if (scissorRect != nullptr) { 
-            scissor.top = scissorRect->top; scissor.bottom = scissorRect->bottom; 
-            scissor.left = scissorRect->left; scissor.right = scissorRect->right;
+        if (!GFX_CHECK_RESOURCE(buffer)) { return nullptr; }
+        D3D11Buffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj == nullptr) {
+            GT_LOG_ERROR("D3D11", "Binding invalid buffer 0x%08x", buffer.id);
+            return nullptr;
         }
+        return bufferObj->buffer;
+    }
 
-        cmdBuf->d3dDC->RSSetScissorRects(1, &scissor);
-        cmdBuf->d3dDC->RSSetViewports(1, &vp);
-        // @HACK 
-        if (cmdBuf->renderPass->backbuffer != nullptr) {
-            cmdBuf->d3dDC->OMSetRenderTargets(1, &cmdBuf->renderPass->backbuffer, cmdBuf->renderPass->depthBuffer);
-        }
-        else {
-            ID3D11RenderTargetView* renderTargets[GFX_MAX_COLOR_ATTACHMENTS];
-            UINT numRenderTargets = 0;
-            for (int i = 0; i < GFX_MAX_COLOR_ATTACHMENTS; ++i) {
-                if (!GFX_CHECK_RESOURCE(cmdBuf->renderPass->desc.colorAttachments[i].image)) {
-                    break;
-                }
-                //D3D11Image* colorAttachment = device->interf->imagePool.Get(cmdBuf->renderPass->desc.colorAttachments[i].image.id);
-                renderTargets[numRenderTargets++] = cmdBuf->renderPass->colorAttachmentRTVs[i]; // @HACK @TODO mipmaplevel/slice
-            }
-            ID3D11DepthStencilView* dsv = nullptr;
-            if (GFX_CHECK_RESOURCE(cmdBuf->renderPass->desc.depthStencilAttachment.image)) {
-                //D3D11Image* depthImage = device->interf->imagePool.Get(cmdBuf->renderPass->desc.depthStencilAttachment.image.id);
-                dsv = cmdBuf->renderPass->depthStencilView;
+    // copies the window the shader sees at offset into the slot's constant window unless it already holds it
+    static ID3D11Buffer* GetConstantWindow(Device* device, CachedStage stage, uint32_t slot, Buffer buffer, D3D11Buffer* bufferObj, uint32_t offset)
+    {
+        ConstantWindow* window = &device->constantWindows[stage][slot];
+        if (window->buffer == nullptr) {
+            D3D11_BUFFER_DESC desc;
+            ZeroMemory(&desc, sizeof(desc));
+            desc.ByteWidth = CONSTANT_WINDOW_SIZE;
+            desc.Usage = D3D11_USAGE_DEFAULT;
+            desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            HRESULT res = device->d3dDevice->CreateBuffer(&desc, nullptr, &window->buffer);
+            if (FAILED(res)) {
+                GT_LOG_ERROR("D3D11", "Failed to create the constant window for slot %u", slot);
+                window->buffer = nullptr;
+                return nullptr;
             }
-            cmdBuf->d3dDC->OMSetRenderTargets(numRenderTargets, renderTargets, dsv);
+            window->source = { gfx::INVALID_ID };
         }
+        if (window->source.id != buffer.id || window->offset != offset || window->numMaps != bufferObj->numMaps) {
+            device->d3dDC->UpdateSubresource(window->buffer, 0, nullptr, bufferObj->shadow + offset, 0, 0);
+            window->source = buffer;
+            window->offset = offset;
+            window->numMaps = bufferObj->numMaps;
+        }
+        return window->buffer;
+    }
 
-        D3D11PipelineState* pipelineState = device->interf->pipelineStatePool.Get(drawCall->pipelineState.id);
-
-        uint32_t numVertexBuffers = 0;
-        ID3D11Buffer* vertexBuffers[GFX_MAX_VERTEX_STREAMS];
-        for (uint32_t i = 0; i < GFX_MAX_VERTEX_STREAMS; ++i) {
-            if (GFX_CHECK_RESOURCE(drawCall->vertexBuffers[i])) {
-                numVertexBuffers++;
-                vertexBuffers[i] = device->interf->bufferPool.Get(drawCall->vertexBuffers[i].id)->buffer;
-            }
-            else {
-                break;
+    static void BindConstantInputs(Device* device, D3D11CommandBuffer* cmdBuf, CachedStage stage, SlotRange range)
+    {
+        Buffer* inputs = &cmdBuf->stateCache.constants[stage][range.first];
+        uint32_t* offsets = &cmdBuf->stateCache.constantOffsets[stage][range.first];
+
+        ID3D11Buffer* buffers[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+        bool useConstantOffsets = false;
+        for (uint32_t i = 0; i < range.count; ++i) {
+            D3D11Buffer* bufferObj = GFX_CHECK_RESOURCE(inputs[i]) ? device->interf->bufferPool.Get(inputs[i].id) : nullptr;
+            buffers[i] = nullptr;
+            if (bufferObj == nullptr) {
+                continue;
             }
-        }
-        cmdBuf->d3dDC->IASetVertexBuffers(0, numVertexBuffers, vertexBuffers, drawCall->vertexStrides, drawCall->vertexOffsets);
-        if (pipelineState->desc.indexFormat != IndexFormat::INDEX_FORMAT_NONE) {
-            ID3D11Buffer* indexBuffer = device->interf->bufferPool.Get(drawCall->indexBuffer.id)->buffer;
-            cmdBuf->d3dDC->IASetIndexBuffer(indexBuffer, g_indexFormatTable[(uint8_t)pipelineState->desc.indexFormat], 0);  // @NOTE allow offset here?
-        }
-        
-        cmdBuf->d3dDC->OMSetBlendState(pipelineState->blendState, pipelineState->blendColor, pipelineState->blendWriteMask);
-        cmdBuf->d3dDC->RSSetState(pipelineState->rasterizerState);
-        cmdBuf->d3dDC->OMSetDepthStencilState(pipelineState->depthStencilState, 0);
-
-        uint32_t numVSConstantBuffers = 0;
-        ID3D11Buffer* vsConstantBuffers[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
-        uint32_t numPSConstantBuffers = 0;
-        ID3D11Buffer* psConstantBuffers[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
-        uint32_t numGSConstantBuffers = 0;
-        ID3D11Buffer* gsConstantBuffers[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
-        uint32_t numHSConstantBuffers = 0;
-        ID3D11Buffer* hsConstantBuffers[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
-        uint32_t numDSConstantBuffers = 0;
-        ID3D11Buffer* dsConstantBuffers[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
-
-        for (uint32_t i = 0; i < GFX_MAX_CONSTANT_INPUTS_PER_STAGE; ++i) {
-            if (GFX_CHECK_RESOURCE(drawCall->vsConstantInputs[i])) {
-                numVSConstantBuffers++;
-                vsConstantBuffers[i] = device->interf->bufferPool.Get(drawCall->vsConstantInputs[i].id)->buffer;
+            if (bufferObj->shadow != nullptr) {
+                if (offsets[i] >= bufferObj->desc.byteWidth) {
+                    GT_LOG_ERROR("D3D11", "Constant offset %u is outside of the %llu byte buffer", offsets[i], (unsigned long long)bufferObj->desc.byteWidth);
+                    continue;
+                }
+                buffers[i] = GetConstantWindow(device, stage, range.first + i, inputs[i], bufferObj, offsets[i]);
+                continue;
             }
-            if (GFX_CHECK_RESOURCE(drawCall->psConstantInputs[i])) {
-                numPSConstantBuffers++;
-                psConstantBuffers[i] = device->interf->bufferPool.Get(drawCall->psConstantInputs[i].id)->buffer;
+            if (offsets[i] != 0 && !device->canOffsetConstants) {
+                // @NOTE only streamed constant buffers are shadowed, anything else can't be bound with an offset on 11.0
+                GT_LOG_ERROR("D3D11", "Constant buffer 0x%08x bound with offset %u needs the 11.1 runtime or USAGE_STREAM", inputs[i].id, offsets[i]);
+                continue;
             }
-            if (GFX_CHECK_RESOURCE(drawCall->gsConstantInputs[i])) {
-                numGSConstantBuffers++;
-                gsConstantBuffers[i] = device->interf->bufferPool.Get(drawCall->gsConstantInputs[i].id)->buffer;
+            buffers[i] = bufferObj->buffer;
+            useConstantOffsets = useConstantOffsets || offsets[i] != 0;
+        }
+
+        // @NOTE only vertex and pixel shader constants have offsets
+        if (useConstantOffsets) {
+            // ranges in units of 16 byte constants, up to the end of the buffer in multiples of 16 and at most the 4096 a shader can see
+            UINT firstConstants[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+            UINT numConstants[GFX_MAX_CONSTANT_INPUTS_PER_STAGE];
+            for (uint32_t i = 0; i < range.count; ++i) {
+                size_t byteWidth = buffers[i] != nullptr ? device->interf->bufferPool.Get(inputs[i].id)->desc.byteWidth : 0;
+                size_t num = offsets[i] < byteWidth ? ((byteWidth - offsets[i]) / 16 + 15) & ~(size_t)15 : 0;
+                firstConstants[i] = offsets[i] / 16;
+                numConstants[i] = (UINT)(num < D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT ? num : D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT);
             }
-            if (GFX_CHECK_RESOURCE(drawCall->hsConstantInputs[i])) {
-                numHSConstantBuffers++;
-                hsConstantBuffers[i] = device->interf->bufferPool.Get(drawCall->hsConstantInputs[i].id)->buffer;
+            if (stage == CACHED_STAGE_VS) {
+                cmdBuf->d3dDC1->VSSetConstantBuffers1(range.first, range.count, buffers, firstConstants, numConstants);
             }
-            if (GFX_CHECK_RESOURCE(drawCall->dsConstantInputs[i])) {
-                numDSConstantBuffers++;
-                dsConstantBuffers[i] = device->interf->bufferPool.Get(drawCall->dsConstantInputs[i].id)->buffer;
+            else {
+                assert(stage == CACHED_STAGE_PS);
+                cmdBuf->d3dDC1->PSSetConstantBuffers1(range.first, range.count, buffers, firstConstants, numConstants);
             }
+            return;
         }
-
-        if (numVSConstantBuffers > 0) {
-            cmdBuf->d3dDC->VSSetConstantBuffers(0, numVSConstantBuffers, vsConstantBuffers);
+        switch (stage) {
+            case CACHED_STAGE_VS: cmdBuf->d3dDC->VSSetConstantBuffers(range.first, range.count, buffers); break;
+            case CACHED_STAGE_PS: cmdBuf->d3dDC->PSSetConstantBuffers(range.first, range.count, buffers); break;
+            case CACHED_STAGE_GS: cmdBuf->d3dDC->GSSetConstantBuffers(range.first, range.count, buffers); break;
+            case CACHED_STAGE_HS: cmdBuf->d3dDC->HSSetConstantBuffers(range.first, range.count, buffers); break;
+            case CACHED_STAGE_DS: cmdBuf->d3dDC->DSSetConstantBuffers(range.first, range.count, buffers); break;
+            default: break;
         }
-        if (numPSConstantBuffers > 0) {
-            cmdBuf->d3dDC->PSSetConstantBuffers(0, numPSConstantBuffers, psConstantBuffers);
+    }
+
+    static void BindImageInputs(Device* device, D3D11CommandBuffer* cmdBuf, CachedStage stage, SlotRange range)
+    {
+        ID3D11ShaderResourceView* srvs[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+        ID3D11SamplerState* samplers[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+        for (uint32_t i = 0; i < range.count; ++i) {
+            Image image = cmdBuf->stateCache.images[stage][range.first + i];
+            D3D11Image* imageObj = GFX_CHECK_RESOURCE(image) ? device->interf->imagePool.Get(image.id) : nullptr;
+            srvs[i] = imageObj != nullptr ? imageObj->srv : nullptr;
+            samplers[i] = imageObj != nullptr ? imageObj->sampler : nullptr;
+        }
+        switch (stage) {
+            case CACHED_STAGE_VS:
+                cmdBuf->d3dDC->VSSetSamplers(range.first, range.count, samplers);
+                cmdBuf->d3dDC->VSSetShaderResources(range.first, range.count, srvs);
+                break;
+            case CACHED_STAGE_PS:
+                cmdBuf->d3dDC->PSSetSamplers(range.first, range.count, samplers);
+                cmdBuf->d3dDC->PSSetShaderResources(range.first, range.count, srvs);
+                break;
+            case CACHED_STAGE_GS:
+                cmdBuf->d3dDC->GSSetSamplers(range.first, range.count, samplers);
+                cmdBuf->d3dDC->GSSetShaderResources(range.first, range.count, srvs);
+                break;
+            case CACHED_STAGE_HS:
+                cmdBuf->d3dDC->HSSetSamplers(range.first, range.count, samplers);
+                cmdBuf->d3dDC->HSSetShaderResources(range.first, range.count, srvs);
+                break;
+            case CACHED_STAGE_DS:
+                cmdBuf->d3dDC->DSSetSamplers(range.first, range.count, samplers);
+                cmdBuf->d3dDC->DSSetShaderResources(range.first, range.count, srvs);
+                break;
+            default: break;
         }
-        if (numGSConstantBuffers > 0) {
-            cmdBuf->d3dDC->GSSetConstantBuffers(0, numGSConstantBuffers, gsConstantBuffers);
+    }
+
+    // binds what the draw call needs and the previous draw left different, returns the draw's pipeline state or
+    // nullptr without binding anything if it is invalid
+    static D3D11PipelineState* BindDrawState(Device* device, D3D11CommandBuffer* cmdBuf, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    {
+        D3D11PipelineState* pipelineState = device->interf->pipelineStatePool.Get(drawCall->pipelineState.id);
+        if (pipelineState == nullptr) {
+            GT_LOG_ERROR("D3D11", "Draw uses invalid pipeline state 0x%08x", drawCall->pipelineState.id);
+            return nullptr;
         }
-        if (numHSConstantBuffers > 0) {
-            cmdBuf->d3dDC->HSSetConstantBuffers(0, numHSConstantBuffers, hsConstantBuffers);
+
+        // draws without viewport or scissor rect cover the whole pass
+        Viewport passViewport = { (float)cmdBuf->renderPass->width, (float)cmdBuf->renderPass->height };
+        Rect passRect;
+        passRect.right = cmdBuf->renderPass->width;
+        passRect.bottom = cmdBuf->renderPass->height;
+
+        // only what differs from the previous draw is bound
+        StateChanges changes;
+        UpdateStateCache(&cmdBuf->stateCache, drawCall, pipelineState->desc.indexFormat, viewport != nullptr ? viewport : &passViewport,
+            scissorRect != nullptr ? scissorRect : &passRect, &changes, &device->stateChangeStats);
+        StateCache* bound = &cmdBuf->stateCache;
+
+        if (changes.pipelineState) {
+            // stages the pipeline doesn't use are unbound, the previous pipeline might have used them
+            cmdBuf->d3dDC->VSSetShader(pipelineState->vertexShader->as_vertexShader, nullptr, 0);
+            cmdBuf->d3dDC->PSSetShader(pipelineState->pixelShader->as_pixelShader, nullptr, 0);
+            cmdBuf->d3dDC->GSSetShader(pipelineState->geometryShader != nullptr ? pipelineState->geometryShader->as_geometryShader : nullptr, nullptr, 0);
+            cmdBuf->d3dDC->HSSetShader(pipelineState->hullShader != nullptr ? pipelineState->hullShader->as_hullShader : nullptr, nullptr, 0);
+            cmdBuf->d3dDC->DSSetShader(pipelineState->domainShader != nullptr ? pipelineState->domainShader->as_domainShader : nullptr, nullptr, 0);
+            cmdBuf->d3dDC->IASetPrimitiveTopology(g_primitiveTypeTable[(uint8_t)pipelineState->desc.primitiveType]);
+            cmdBuf->d3dDC->IASetInputLayout(pipelineState->inputLayout);
+            cmdBuf->d3dDC->OMSetBlendState(pipelineState->blendState, pipelineState->blendColor, pipelineState->blendWriteMask);
+            cmdBuf->d3dDC->RSSetState(pipelineState->rasterizerState);
+            cmdBuf->d3dDC->OMSetDepthStencilState(pipelineState->depthStencilState, 0);
+        }
+
+        if (changes.viewport) {
+            D3D11_VIEWPORT vp;
+            ZeroMemory(&vp, sizeof(vp));
+            vp.Width = bound->viewport.width;
+            vp.Height = bound->viewport.height;
+            vp.MinDepth = 0.0f;
+            vp.MaxDepth = 1.0f;
+            cmdBuf->d3dDC->RSSetViewports(1, &vp);
+        }
+        if (changes.scissorRect) {
+            D3D11_RECT scissor = { (LONG)bound->scissorRect.left, (LONG)bound->scissorRect.top, (LONG)bound->scissorRect.right, (LONG)bound->scissorRect.bottom };
+            cmdBuf->d3dDC->RSSetScissorRects(1, &scissor);
+        }
+
+        if (changes.vertexBuffers.count > 0) {
+            SlotRange range = changes.vertexBuffers;
+            ID3D11Buffer* vertexBuffers[GFX_MAX_VERTEX_STREAMS];
+            for (uint32_t i = 0; i < range.count; ++i) {
+                vertexBuffers[i] = GetBoundBuffer(device, bound->vertexBuffers[range.first + i]);
+            }
+            cmdBuf->d3dDC->IASetVertexBuffers(range.first, range.count, vertexBuffers, &bound->vertexStrides[range.first], &bound->vertexOffsets[range.first]);
         }
-        if (numDSConstantBuffers > 0) {
-            cmdBuf->d3dDC->DSSetConstantBuffers(0, numDSConstantBuffers, dsConstantBuffers);
+        if (changes.indexBuffer) {
+            ID3D11Buffer* indexBuffer = GetBoundBuffer(device, bound->indexBuffer);
+            cmdBuf->d3dDC->IASetIndexBuffer(indexBuffer, g_indexFormatTable[(uint8_t)bound->indexFormat], 0);  // @NOTE allow offset here?
         }
 
-        // @HACK - ish should do the same as with buffers (single bind call)
-        for (int i = 0; i < GFX_MAX_IMAGE_INPUTS_PER_STAGE; ++i) {
-            if (GFX_CHECK_RESOURCE(drawCall->psImageInputs[i])) {
-                auto imageObj = device->interf->imagePool.Get(drawCall->psImageInputs[i].id);
-                auto srv = imageObj->srv;
-                auto sampler = imageObj->sampler;
-                cmdBuf->d3dDC->PSSetSamplers(i, 1, &sampler);
-                cmdBuf->d3dDC->PSSetShaderResources(i, 1, &srv);
+        for (uint32_t stage = 0; stage < NUM_CACHED_STAGES; ++stage) {
+            if (changes.constants[stage].count > 0) {
+                BindConstantInputs(device, cmdBuf, (CachedStage)stage, changes.constants[stage]);
+            }
+            if (changes.images[stage].count > 0) {
+                BindImageInputs(device, cmdBuf, (CachedStage)stage, changes.images[stage]);
             }
         }
+        return pipelineState;
+    }
 
-        cmdBuf->d3dDC->VSSetShader(pipelineState->vertexShader->as_vertexShader, nullptr, 0);
-        cmdBuf->d3dDC->PSSetShader(pipelineState->pixelShader->as_pixelShader, nullptr, 0);
-        if (pipelineState->geometryShader != nullptr) {
-            cmdBuf->d3dDC->GSSetShader(pipelineState->geometryShader->as_geometryShader, nullptr, 0);
-        }
-        if (pipelineState->hullShader != nullptr) {
-            cmdBuf->d3dDC->HSSetShader(pipelineState->geometryShader->as_hullShader, nullptr, 0);
-        }
-        if (pipelineState->domainShader != nullptr) {
-            cmdBuf->d3dDC->DSSetShader(pipelineState->geometryShader->as_domainShader, nullptr, 0);
-        }
-        cmdBuf->d3dDC->IASetPrimitiveTopology(g_primitiveTypeTable[(uint8_t)pipelineState->desc.primitiveType]);
-        cmdBuf->d3dDC->IASetInputLayout(pipelineState->inputLayout);
+    static void ExecuteDrawCall(Device* device, D3D11CommandBuffer* cmdBuf, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    {
+        D3D11PipelineState* pipelineState = BindDrawState(device, cmdBuf, drawCall, viewport, scissorRect);
+        if (pipelineState == nullptr) { return; }
         if (pipelineState->desc.indexFormat != IndexFormat::INDEX_FORMAT_NONE) {
             if (drawCall->numInstances > 1) {
                 cmdBuf->d3dDC->DrawIndexedInstanced(drawCall->numElements, drawCall->numInstances, drawCall->elementOffset, drawCall->startVertexLocation, drawCall->startInstanceLocation);
@@ -1362,15 +1692,95 @@ namespace gfx
                 cmdBuf->d3dDC->Draw(drawCall->numElements, drawCall->startVertexLocation);
             }
         }
+    }
 
-    
+    void SubmitDrawCall(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawCall(stream, drawCall, viewport, scissorRect);
+            return;
+        }
+        D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (!IsInRenderPass(cmdBuf, cmdBuffer)) { return; }
+        ExecuteDrawCall(device, cmdBuf, drawCall, viewport, scissorRect);
+    }
+
+    void SubmitDrawCalls(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCalls, uint32_t numDrawCalls, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            for (uint32_t i = 0; i < numDrawCalls; ++i) {
+                RecordDrawCall(stream, &drawCalls[i], viewport, scissorRect);
+            }
+            return;
+        }
+        D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (!IsInRenderPass(cmdBuf, cmdBuffer)) { return; }
+        for (uint32_t i = 0; i < numDrawCalls; ++i) {
+            ExecuteDrawCall(device, cmdBuf, &drawCalls[i], viewport, scissorRect);
+        }
+    }
+
+    // @NOTE D3D11 has no multi draw indirect, the inputs are bound once and each argument record is its own draw
+    void SubmitDrawIndirect(Device* device, CommandBuffer cmdBuffer, DrawCall* drawCall, Buffer argsBuffer, uint32_t argsOffset, uint32_t numDraws,
+        Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawIndirect(stream, drawCall, argsBuffer, argsOffset, numDraws, viewport, scissorRect);
+            return;
+        }
+        D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
+        if (!IsInRenderPass(cmdBuf, cmdBuffer)) { return; }
+        D3D11Buffer* args = device->interf->bufferPool.Get(argsBuffer.id);
+        if (args == nullptr) {
+            GT_LOG_ERROR("D3D11", "Indirect draw reads invalid args buffer 0x%08x", argsBuffer.id);
+            return;
+        }
+        assert(args->desc.type == BufferType::BUFFER_TYPE_INDIRECT_ARGS && argsOffset % 4 == 0);
+
+        D3D11PipelineState* pipelineState = BindDrawState(device, cmdBuf, drawCall, viewport, scissorRect);
+        if (pipelineState == nullptr) { return; }
+        if (pipelineState->desc.indexFormat != IndexFormat::INDEX_FORMAT_NONE) {
+            assert(argsOffset + numDraws * sizeof(DrawIndexedIndirectArgs) <= args->desc.byteWidth);
+            for (uint32_t i = 0; i < numDraws; ++i) {
+                cmdBuf->d3dDC->DrawIndexedInstancedIndirect(args->buffer, argsOffset + i * (UINT)sizeof(DrawIndexedIndirectArgs));
+            }
+        }
+        else {
+            assert(argsOffset + numDraws * sizeof(DrawIndirectArgs) <= args->desc.byteWidth);
+            for (uint32_t i = 0; i < numDraws; ++i) {
+                cmdBuf->d3dDC->DrawInstancedIndirect(args->buffer, argsOffset + i * (UINT)sizeof(DrawIndirectArgs));
+            }
+        }
+    }
+
+    void SubmitDrawItem(Device* device, CommandBuffer cmdBuffer, DrawItem* drawItem, Viewport* viewport, Rect* scissorRect)
+    {
+        if (CommandStream* stream = GetDeferredStream(device, cmdBuffer)) {
+            RecordDrawItem(stream, drawItem, viewport, scissorRect);
+            return;
+        }
+
+        BindGroupData* groups[GFX_MAX_BIND_GROUPS];
+        for (uint32_t i = 0; i < GFX_MAX_BIND_GROUPS; ++i) {
+            groups[i] = nullptr;
+            if (!GFX_CHECK_RESOURCE(drawItem->bindGroups[i])) { continue; }
+            D3D11BindGroup* bindGroup = device->interf->bindGroupPool.Get(drawItem->bindGroups[i].id);
+            if (bindGroup == nullptr) {
+                GT_LOG_ERROR("D3D11", "Draw item uses invalid bind group 0x%08x", drawItem->bindGroups[i].id);
+                return;
+            }
+            groups[i] = &bindGroup->data;
+        }
+        DrawCall* drawCall = ResolveDrawItem(&device->resolvedDrawInputs, drawItem, groups);
+        if (drawCall == nullptr) { return; }
+        SubmitDrawCall(device, cmdBuffer, drawCall, viewport, scissorRect);
     }
 
 
     void SetViewport(Device* device, CommandBuffer cmdBuffer, Viewport viewport)
     {
         D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
-        assert(cmdBuf->renderPass != nullptr);
+        if (!IsInRenderPass(cmdBuf, cmdBuffer)) { return; }
 
         D3D11_VIEWPORT vp;
         ZeroMemory(&vp, sizeof(D3D11_VIEWPORT));
@@ -1380,22 +1790,62 @@ namespace gfx
         vp.MaxDepth = 1.0f;
         vp.TopLeftX = vp.TopLeftY = 0.0f;
         cmdBuf->d3dDC->RSSetViewports(1, &vp);
+        InvalidateViewportAndScissor(&cmdBuf->stateCache);
     }
 
     void SetScissor(Device* device, CommandBuffer cmdBuffer, Rect scissorRect)
     {
         D3D11CommandBuffer* cmdBuf = device->interf->cmdBufferPool.Get(cmdBuffer.id);
-        assert(cmdBuf->renderPass != nullptr);
+        if (!IsInRenderPass(cmdBuf, cmdBuffer)) { return; }
 
         D3D11_RECT r = { (LONG)scissorRect.left, (LONG)scissorRect.top, (LONG)scissorRect.right, (LONG)scissorRect.bottom };
         cmdBuf->d3dDC->RSSetScissorRects(1, &r);
+        InvalidateViewportAndScissor(&cmdBuf->stateCache);
     }
 
 
     void PresentSwapChain(Device* device, SwapChain swapChain) 
     {
         D3D11SwapChain* swpChn = device->interf->swapChainPool.Get(swapChain.id);
+        if (swpChn == nullptr) {
+            GT_LOG_ERROR("D3D11", "Presenting invalid swap chain 0x%08x", swapChain.id);
+            return;
+        }
         swpChn->swapChain->Present(1, 0);
+        EndStateChangeFrame(&device->stateChangeStats, &device->lastFrameStateChangeStats);
+    }
+
+    void GetStateChangeStats(Device* device, StateChangeStats* outStats)
+    {
+        *outStats = device->lastFrameStateChangeStats;
+    }
+
+    void GetResourceStats(Device* device, ResourceStats* outStats)
+    {
+        Interface* interf = device->interf;
+        outStats->buffers = interf->bufferPool.GetStats();
+        outStats->images = interf->imagePool.GetStats();
+        outStats->pipelineStates = interf->pipelineStatePool.GetStats();
+        outStats->shaders = interf->shaderPool.GetStats();
+        outStats->renderPasses = interf->passPool.GetStats();
+        outStats->cmdBuffers = interf->cmdBufferPool.GetStats();
+        outStats->bindGroups = interf->bindGroupPool.GetStats();
+        outStats->swapChains = interf->swapChainPool.GetStats();
+    }
+
+    void GetPipelineCacheStats(Device* device, PipelineCacheStats* outStats)
+    {
+        *outStats = ReadPipelineCacheStats(&device->pipelineCache);
+    }
+
+    size_t SavePipelineCache(Device* device, void* buffer, size_t bufferSize)
+    {
+        return SavePipelineCacheKeys(&device->pipelineCache, buffer, bufferSize);
+    }
+
+    uint32_t WarmPipelineCache(Device* device, const void* data, size_t size)
+    {
+        return WarmPipelineCacheKeys(device, &device->pipelineCache, data, size);
     }
 
     D3D11_MAP g_mapTypeTable[] = {
@@ -1411,6 +1861,13 @@ namespace gfx
     {
         D3D11Buffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
         if (!bufferObj) { return nullptr; }
+        if (bufferObj->shadow != nullptr) {
+            // @NOTE every map invalidates the windows holding copies, which is all MAP_WRITE_DISCARD needs, and
+            // the slots still bound to the buffer have to copy again even if their offsets don't change
+            bufferObj->numMaps++;
+            InvalidateConstantInputs(&device->interf->cmdBufferPool.Get(device->dcAsCmdBuffer.id)->stateCache, buffer);
+            return bufferObj->shadow;
+        }
         D3D11_MAPPED_SUBRESOURCE subres;
         ZeroMemory(&subres, sizeof(subres));
         HRESULT res = device->d3dDC->Map(bufferObj->buffer, 0, g_mapTypeTable[(uint8_t)mapType], 0, &subres);
@@ -1423,10 +1880,119 @@ namespace gfx
     void UnmapBuffer(Device* device, Buffer buffer)
     {
         D3D11Buffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
-        if (!bufferObj) { return; }
+        if (!bufferObj || bufferObj->shadow != nullptr) { return; }
+        device->d3dDC->Unmap(bufferObj->buffer, 0);
+    }
+
+
+    bool SetImageResidentMips(Device* device, Image image, uint32_t firstResidentMip)
+    {
+        D3D11Image* imageObj = device->interf->imagePool.Get(image.id);
+        if (imageObj == nullptr) { return false; }
+        assert(imageObj->desc.isStreamed && firstResidentMip < imageObj->desc.numMipmaps);
+        uint32_t oldFirstResidentMip = imageObj->desc.firstResidentMip;
+        if (firstResidentMip == oldFirstResidentMip) { return true; }
+
+        // @NOTE D3D11 has no partially resident textures, the image moves to a texture of the new size
+        D3D11_TEXTURE2D_DESC texDesc;
+        imageObj->as_2DTexture->GetDesc(&texDesc);
+        texDesc.Width = imageObj->desc.width >> firstResidentMip > 0 ? imageObj->desc.width >> firstResidentMip : 1;
+        texDesc.Height = imageObj->desc.height >> firstResidentMip > 0 ? imageObj->desc.height >> firstResidentMip : 1;
+        texDesc.MipLevels = imageObj->desc.numMipmaps - firstResidentMip;
+        ID3D11Texture2D* texture = nullptr;
+        HRESULT res = device->d3dDevice->CreateTexture2D(&texDesc, nullptr, &texture);
+        if (FAILED(res)) {
+            return false;
+        }
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        ZeroMemory(&srvDesc, sizeof(srvDesc));
+        srvDesc.Format = texDesc.Format;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MipLevels = texDesc.MipLevels;
+        srvDesc.Texture2D.MostDetailedMip = 0;
+        ID3D11ShaderResourceView* srv = nullptr;
+        res = device->d3dDevice->CreateShaderResourceView(texture, &srvDesc, &srv);
+        if (FAILED(res)) {
+            texture->Release();
+            return false;
+        }
+
+        uint32_t firstSharedMip = firstResidentMip > oldFirstResidentMip ? firstResidentMip : oldFirstResidentMip;
+        for (uint32_t mip = firstSharedMip; mip < imageObj->desc.numMipmaps; ++mip) {
+            device->d3dDC->CopySubresourceRegion(texture, mip - firstResidentMip, 0, 0, 0, imageObj->as_2DTexture, mip - oldFirstResidentMip, nullptr);
+        }
+        imageObj->srv->Release();
+        imageObj->as_2DTexture->Release();
+        imageObj->srv = srv;
+        imageObj->as_2DTexture = texture;
+        imageObj->desc.firstResidentMip = (uint16_t)firstResidentMip;
+
+        // the state cache compares handles, the image keeps its handle but not its view
+        D3D11CommandBuffer* immediateBuffer = device->interf->cmdBufferPool.Get(device->dcAsCmdBuffer.id);
+        InvalidateImageInputs(&immediateBuffer->stateCache);
+        return true;
+    }
+
+    bool CopyBufferToImage(Device* device, Buffer source, size_t sourceOffset, Image image, uint32_t mip)
+    {
+        D3D11Buffer* bufferObj = device->interf->bufferPool.Get(source.id);
+        D3D11Image* imageObj = device->interf->imagePool.Get(image.id);
+        if (bufferObj == nullptr || imageObj == nullptr) { return false; }
+        assert(bufferObj->desc.usage == ResourceUsage::USAGE_STAGING && imageObj->desc.isStreamed);
+        assert(mip >= imageObj->desc.firstResidentMip && mip < imageObj->desc.numMipmaps);
+        assert(sourceOffset + GetImageMipSize(&imageObj->desc, mip) <= bufferObj->desc.byteWidth);
+
+        // @NOTE buffers can't be copied to textures in D3D11, the staging memory is read back and uploaded instead
+        D3D11_MAPPED_SUBRESOURCE subres;
+        ZeroMemory(&subres, sizeof(subres));
+        HRESULT res = device->d3dDC->Map(bufferObj->buffer, 0, D3D11_MAP_READ, 0, &subres);
+        if (FAILED(res)) {
+            return false;
+        }
+        UINT width = imageObj->desc.width >> mip > 0 ? imageObj->desc.width >> mip : 1;
+        UINT rowPitch = width * g_pixelFormatComponentCount[(uint8_t)imageObj->desc.pixelFormat] * g_pixelFormatComponentSize[(uint8_t)imageObj->desc.pixelFormat];
+        UINT subresource = mip - imageObj->desc.firstResidentMip;
+        device->d3dDC->UpdateSubresource(imageObj->as_2DTexture, subresource, nullptr, (char*)subres.pData + sourceOffset, rowPitch, 0);
         device->d3dDC->Unmap(bufferObj->buffer, 0);
+        return true;
     }
 
+    bool UpdateBuffer(Device* device, Buffer buffer, size_t offset, const void* data, size_t size)
+    {
+        D3D11Buffer* bufferObj = device->interf->bufferPool.Get(buffer.id);
+        if (bufferObj == nullptr) { return false; }
+        assert(bufferObj->desc.usage == ResourceUsage::USAGE_COPY_DESTINATION && offset + size <= bufferObj->desc.byteWidth);
+        // @NOTE constant buffers can only be updated as a whole
+        assert(bufferObj->desc.type != BufferType::BUFFER_TYPE_CONSTANT || (offset == 0 && size == bufferObj->desc.byteWidth));
+
+        D3D11_BOX box;
+        box.left = (UINT)offset;
+        box.right = (UINT)(offset + size);
+        box.top = 0;
+        box.bottom = 1;
+        box.front = 0;
+        box.back = 1;
+        D3D11_BOX* boxPtr = bufferObj->desc.type != BufferType::BUFFER_TYPE_CONSTANT ? &box : nullptr;
+        device->d3dDC->UpdateSubresource(bufferObj->buffer, 0, boxPtr, data, 0, 0);
+        return true;
+    }
+
+    bool UpdateImage(Device* device, Image image, uint32_t mip, const void* data, size_t size)
+    {
+        D3D11Image* imageObj = device->interf->imagePool.Get(image.id);
+        if (imageObj == nullptr) { return false; }
+        assert(imageObj->desc.usage == ResourceUsage::USAGE_COPY_DESTINATION || imageObj->desc.isStreamed);
+        assert(imageObj->desc.type == ImageType::IMAGE_TYPE_2D && imageObj->desc.numSlices == 1);
+        assert(mip >= imageObj->desc.firstResidentMip && mip < imageObj->desc.numMipmaps);
+        assert(size == GetImageMipSize(&imageObj->desc, mip));
+
+        UINT width = imageObj->desc.width >> mip > 0 ? imageObj->desc.width >> mip : 1;
+        UINT rowPitch = width * g_pixelFormatComponentCount[(uint8_t)imageObj->desc.pixelFormat] * g_pixelFormatComponentSize[(uint8_t)imageObj->desc.pixelFormat];
+        UINT subresource = mip - imageObj->desc.firstResidentMip;
+        device->d3dDC->UpdateSubresource(imageObj->as_2DTexture, subresource, nullptr, data, rowPitch, 0);
+        return true;
+    }
 
     void DestroyBuffer(Device* device, Buffer buffer)
     {
@@ -0,0 +1,1012 @@
+#include <engine/runtime/runtime.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <foundation/int_types.h>
+#include <foundation/memory/memory.h>
+#include <foundation/memory/allocators.h>
+#include <foundation/logging/logging.h>
+#include <foundation/math/math.h>
+#include <foundation/filesystem/filesystem.h>
+
+#include <engine/runtime/gfx/gfx.h>
+#ifdef GT_GFX_SOFTWARE
+#include <engine/runtime/gfx/linux/soft_gfx.h>
+#endif
+#include <engine/runtime/entities/entities.h>
+#include <engine/runtime/renderer/renderer.h>
+#include <engine/runtime/spatial/spatial.h>
+#include <engine/runtime/recording/recording.h>
+
+/**
+    Headless runtime for machines without a window system: builds a grid of cubes, renders a number of frames into
+    an offscreen swap chain with whichever gfx backend was built (null or software) and reports the frame times.
+
+    --frames <n>        frames to render, default 100
+    --entities <n>      cubes in the scene, default 1024
+    --spatial-benchmark <n>
+                        times the spatial index on its own with n boxes instead, without gfx or entities
+    --entity-benchmark <n>
+                        times creating, looking up and destroying n entities instead, without gfx
+    --record <file>     runs a small simulation on the cubes every frame and records it
+    --replay <file>     runs the simulation with the input of a recording instead, one frame per recorded step, and
+                        fails if it doesn't make the same changes. --entities has to match the recording
+    --bind-group-checks creates bind groups from destroyed buffers and images instead and fails unless they are rejected
+    --golden <file>     software backend only, renders a fixed test scene and fails unless it matches the image in file,
+                        a binary PPM. src/engine/runtime/gfx/linux/soft_gfx_golden.ppm is the one for the current rasterizer
+    --write-golden <file>
+                        renders the test scene and writes it to file, to update the golden image after an intended change
+*/
+
+#define KILOBYTES(n) (n * 1024)
+#define MEGABYTES(n) (KILOBYTES(n) * 1024)
+#define GIGABYTES(n) (MEGABYTES(n) * (size_t)1024)
+
+static const uint32_t WINDOW_WIDTH = 1280;
+static const uint32_t WINDOW_HEIGHT = 720;
+
+typedef fnd::memory::SimpleMemoryArena<fnd::memory::LinearAllocator>  LinearArena;
+
+class SimpleFilterPolicy
+{
+public:
+    bool Filter(fnd::logging::LogCriteria criteria)
+    {
+        return criteria.channel.hash != fnd::logging::LogChannel("RenderProfile").hash;
+    }
+};
+
+class SimpleFormatPolicy
+{
+public:
+    void Format(char* buf, size_t bufSize, fnd::logging::LogCriteria criteria, const char* format, va_list args)
+    {
+        size_t offset = snprintf(buf, bufSize, "[%s]    ", criteria.channel.str);
+        vsnprintf(buf + offset, bufSize - offset, format, args);
+    }
+};
+
+class ConsoleWriter
+{
+public:
+    void Write(const char* msg)
+    {
+        printf("%s\n", msg);
+    }
+};
+
+typedef fnd::logging::Logger<SimpleFilterPolicy, SimpleFormatPolicy, ConsoleWriter> SimpleLogger;
+
+static double GetCounter()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+static uint32_t FindCommandLineValue(int argc, char* argv[], const char* option, uint32_t defaultValue)
+{
+    for (int i = 1; i < argc - 1; ++i) {
+        if (strcmp(argv[i], option) == 0) {
+            return (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+        }
+    }
+    return defaultValue;
+}
+
+static const char* FindCommandLineString(int argc, char* argv[], const char* option)
+{
+    for (int i = 1; i < argc - 1; ++i) {
+        if (strcmp(argv[i], option) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return nullptr;
+}
+
+static bool HasCommandLineFlag(int argc, char* argv[], const char* option)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], option) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// unit cube with one quad per face so every face has its own normal
+static void MakeCube(renderer::DefaultVertex* vertices, uint16_t* indices)
+{
+    static const float normals[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for (int face = 0; face < 6; ++face) {
+        fnd::math::float3 n(normals[face][0], normals[face][1], normals[face][2]);
+        fnd::math::float3 u(n.y, n.z, n.x);     // any two axes perpendicular to the normal
+        fnd::math::float3 v(n.z, n.x, n.y);
+        for (int corner = 0; corner < 4; ++corner) {
+            float su = (corner == 1 || corner == 2) ? 0.5f : -0.5f;
+            float sv = (corner >= 2) ? 0.5f : -0.5f;
+            renderer::DefaultVertex* vertex = &vertices[face * 4 + corner];
+            vertex->position = n * 0.5f + u * su + v * sv;
+            vertex->normal = n;
+            vertex->uv = fnd::math::float2(su + 0.5f, sv + 0.5f);
+            vertex->tangent = u;
+        }
+        uint16_t base = (uint16_t)(face * 4);
+        uint16_t faceIndices[] = { 0, 1, 2, 0, 2, 3 };
+        for (int i = 0; i < 6; ++i) {
+            indices[face * 6 + i] = base + faceIndices[i];
+        }
+    }
+}
+
+static bool CreateScene(renderer::RenderWorld* renderWorld, entity_system::World* world, uint32_t numEntities)
+{
+    renderer::DefaultVertex vertices[24];
+    uint16_t indices[36];
+    MakeCube(vertices, indices);
+
+    renderer::MeshDesc meshDesc;
+    meshDesc.vertexLayout.attribs[0] = { "POSITION", 0, offsetof(renderer::DefaultVertex, position), 0, gfx::VertexFormat::VERTEX_FORMAT_FLOAT3 };
+    meshDesc.vertexLayout.attribs[1] = { "NORMAL", 0, offsetof(renderer::DefaultVertex, normal), 0, gfx::VertexFormat::VERTEX_FORMAT_FLOAT3 };
+    meshDesc.vertexLayout.attribs[2] = { "TEXCOORD", 0, offsetof(renderer::DefaultVertex, uv), 0, gfx::VertexFormat::VERTEX_FORMAT_FLOAT2 };
+    meshDesc.vertexLayout.attribs[3] = { "TEXCOORD", 1, offsetof(renderer::DefaultVertex, tangent), 0, gfx::VertexFormat::VERTEX_FORMAT_FLOAT3 };
+    meshDesc.indexFormat = gfx::IndexFormat::INDEX_FORMAT_UINT16;
+    meshDesc.vertexData = vertices;
+    meshDesc.vertexDataSize = sizeof(vertices);
+    meshDesc.indexData = indices;
+    meshDesc.indexDataSize = sizeof(indices);
+    meshDesc.numElements = 36;
+
+    core::Asset meshAsset = { 1 };
+    if (!renderer::UpdateMeshLibrary(renderWorld, meshAsset, &meshDesc, 1)) {
+        return false;
+    }
+
+    // white 4x4 texture for every map of the material
+    uint32_t pixels[16];
+    memset(pixels, 0xff, sizeof(pixels));
+    void* mipData[] = { pixels };
+    size_t mipSizes[] = { sizeof(pixels) };
+    gfx::SamplerDesc samplerDesc;
+    renderer::TextureDesc textureDesc;
+    textureDesc.desc.type = gfx::ImageType::IMAGE_TYPE_2D;
+    textureDesc.desc.width = 4;
+    textureDesc.desc.height = 4;
+    textureDesc.desc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_R8G8B8A8_UNORM;
+    textureDesc.desc.samplerDesc = &samplerDesc;
+    textureDesc.desc.numDataItems = 1;
+    textureDesc.desc.initialData = mipData;
+    textureDesc.desc.initialDataSizes = mipSizes;
+
+    core::Asset textureAsset = { 2 };
+    if (!renderer::UpdateTextureLibrary(renderWorld, textureAsset, &textureDesc)) {
+        return false;
+    }
+
+    renderer::MaterialDesc materialDesc;
+    materialDesc.baseColorMap = textureAsset;
+    materialDesc.roughnessMap = textureAsset;
+    materialDesc.metalnessMap = textureAsset;
+    materialDesc.normalVecMap = textureAsset;
+    materialDesc.occlusionMap = textureAsset;
+    core::Asset materialAsset = { 3 };
+    if (!renderer::UpdateMaterialLibrary(renderWorld, materialAsset, &materialDesc)) {
+        return false;
+    }
+
+    // square grid on the xz plane, two units apart
+    uint32_t gridSize = 1;
+    while (gridSize * gridSize < numEntities) { gridSize++; }
+    for (uint32_t i = 0; i < numEntities; ++i) {
+        entity_system::Entity entity = entity_system::CreateEntity(world);
+        if (entity.id == entity_system::INVALID_ID) {
+            GT_LOG_ERROR("Application", "Failed to create entity %u of %u", i, numEntities);
+            return false;
+        }
+        float transform[16];
+        fnd::math::float3 position(2.0f * (float)(i % gridSize) - (float)gridSize, 0.0f, 2.0f * (float)(i / gridSize));
+        util::Make4x4FloatTranslationMatrixCM(transform, position);
+        entity_system::SetEntityTransform(world, entity, transform);
+
+        renderer::StaticMesh mesh = renderer::CreateStaticMesh(renderWorld, entity.id, meshAsset, &materialAsset, 1);
+        if (mesh.id == renderer::INVALID_ID) {
+            GT_LOG_ERROR("Application", "Failed to create static mesh %u of %u", i, numEntities);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void UpdateWorldSnapshot(entity_system::World* world, renderer::RenderWorld* renderWorld, fnd::memory::LinearAllocator* frameAllocator)
+{
+    size_t numEntities = 0;
+    entity_system::GetAllEntities(world, nullptr, &numEntities);
+    entity_system::Entity* entityList = (entity_system::Entity*)frameAllocator->Allocate(sizeof(entity_system::Entity) * numEntities, alignof(entity_system::Entity));
+    entity_system::GetAllEntities(world, entityList, &numEntities);
+
+    renderer::WorldSnapshot worldSnapshot;
+    worldSnapshot.numTransforms = (uint32_t)numEntities;
+    worldSnapshot.transforms = (renderer::Transform*)frameAllocator->Allocate(sizeof(renderer::Transform) * numEntities, alignof(renderer::Transform));
+    for (size_t i = 0; i < numEntities; ++i) {
+        worldSnapshot.transforms[i].entityID = entityList[i].id;
+        util::Copy4x4FloatMatrixCM(entity_system::GetEntityTransform(world, entityList[i]), worldSnapshot.transforms[i].transform);
+    }
+    renderer::UpdateWorldState(renderWorld, &worldSnapshot);
+}
+
+// stand-in for game code, bobs a band of cubes that moves along the grid by one band every step
+static void SimulateStep(entity_system::World* world, const entity_system::Entity* entities, size_t numEntities, uint64_t step, double time)
+{
+    static const size_t BAND_SIZE = 64;
+    for (size_t i = 0; i < BAND_SIZE && i < numEntities; ++i) {
+        entity_system::Entity entity = entities[(step * BAND_SIZE + i) % numEntities];
+        float transform[16];
+        util::Copy4x4FloatMatrixCM(entity_system::GetEntityTransform(world, entity), transform);
+        transform[13] = sinf((float)time + 0.1f * (float)i);
+        entity_system::SetEntityTransform(world, entity, transform);
+    }
+}
+
+// xorshift, the benchmark only needs repeatable numbers in [0, 1)
+static float RandomFloat(uint32_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return (float)(*state >> 8) / 16777216.0f;
+}
+
+// looking down at (x, z) from above, like the camera of the headless scene
+static void MakeBenchmarkFrustum(float x, float z, spatial::Frustum* outFrustum)
+{
+    float projection[16], cameraRotation[16], cameraPosition[16], camera[16], view[16], viewProjection[16];
+    util::Make4x4FloatProjectionMatrixCMLH(projection, 1.0f, (float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+    util::Make4x4FloatRotationMatrixCMLH(cameraRotation, fnd::math::float3(1.0f, 0.0f, 0.0f), -0.6f);
+    util::Make4x4FloatTranslationMatrixCM(cameraPosition, fnd::math::float3(x, 10.0f, z));
+    util::MultiplyMatricesCM(cameraPosition, cameraRotation, camera);
+    util::Inverse4x4FloatMatrixCM(camera, view);
+    util::MultiplyMatricesCM(projection, view, viewProjection);
+    spatial::ExtractFrustumPlanes(viewProjection, outFrustum);
+}
+
+// boxes of 0.5 to 2 units scattered over a square with about one box per 16 square units
+static int RunSpatialBenchmark(uint32_t count, fnd::memory::MemoryArenaBase* memoryArena)
+{
+    static const uint32_t NUM_QUERIES = 1000;
+    static const size_t MAX_RESULTS = 1 << 20;
+
+    uint64_t* ids = (uint64_t*)memoryArena->Allocate(sizeof(uint64_t) * count, alignof(uint64_t), GT_SOURCE_INFO);
+    spatial::AABB* bounds = (spatial::AABB*)memoryArena->Allocate(sizeof(spatial::AABB) * count, alignof(spatial::AABB), GT_SOURCE_INFO);
+    uint64_t* results = (uint64_t*)memoryArena->Allocate(sizeof(uint64_t) * MAX_RESULTS, alignof(uint64_t), GT_SOURCE_INFO);
+    if (ids == nullptr || bounds == nullptr || results == nullptr) {
+        GT_LOG_ERROR("Spatial Index", "Failed to allocate %u boxes", count);
+        return 1;
+    }
+
+    float side = 4.0f * sqrtf((float)count);
+    uint32_t random = 0x9e3779b9;
+    for (uint32_t i = 0; i < count; ++i) {
+        float center[3] = { side * RandomFloat(&random), 0.5f + 4.0f * RandomFloat(&random), side * RandomFloat(&random) };
+        float extent = 0.25f + 0.75f * RandomFloat(&random);
+        ids[i] = i + 1;
+        for (int j = 0; j < 3; ++j) {
+            bounds[i].min[j] = center[j] - extent;
+            bounds[i].max[j] = center[j] + extent;
+        }
+    }
+
+    spatial::SpatialIndex* index = nullptr;
+    spatial::SpatialIndexConfig config;
+    config.initialCapacity = count;
+    if (!spatial::CreateSpatialIndex(&index, memoryArena, &config)) {
+        GT_LOG_ERROR("Spatial Index", "Failed to create spatial index");
+        return 1;
+    }
+
+    double start = GetCounter();
+    spatial::UpdateProxies(index, ids, bounds, count);
+    double insertTime = GetCounter() - start;
+
+    // a tenth of the boxes moves a little, within the fat margin for most of them, and a hundredth jumps anywhere
+    uint32_t numMoved = count / 10 > 0 ? count / 10 : 1;
+    for (uint32_t i = 0; i < numMoved; ++i) {
+        float offset = (i % 10 == 0) ? side * (RandomFloat(&random) - 0.5f) : 0.2f * (RandomFloat(&random) - 0.5f);
+        bounds[i].min[0] += offset;
+        bounds[i].max[0] += offset;
+    }
+    start = GetCounter();
+    spatial::UpdateProxies(index, ids, bounds, numMoved);
+    double moveTime = GetCounter() - start;
+
+    size_t numFrustumResults = 0;
+    start = GetCounter();
+    for (uint32_t i = 0; i < NUM_QUERIES; ++i) {
+        spatial::Frustum frustum;
+        MakeBenchmarkFrustum(side * RandomFloat(&random), side * RandomFloat(&random), &frustum);
+        numFrustumResults += spatial::QueryFrustum(index, &frustum, results, MAX_RESULTS);
+    }
+    double frustumTime = GetCounter() - start;
+
+    size_t numBoxResults = 0;
+    start = GetCounter();
+    for (uint32_t i = 0; i < NUM_QUERIES; ++i) {
+        spatial::AABB box;
+        box.min[0] = side * RandomFloat(&random);
+        box.min[1] = 0.0f;
+        box.min[2] = side * RandomFloat(&random);
+        box.max[0] = box.min[0] + 20.0f;
+        box.max[1] = 5.0f;
+        box.max[2] = box.min[2] + 20.0f;
+        numBoxResults += spatial::QueryAABB(index, &box, results, MAX_RESULTS);
+    }
+    double boxTime = GetCounter() - start;
+
+    uint32_t numHits = 0;
+    start = GetCounter();
+    for (uint32_t i = 0; i < NUM_QUERIES; ++i) {
+        float origin[3] = { side * RandomFloat(&random), 20.0f, side * RandomFloat(&random) };
+        float direction[3] = { RandomFloat(&random) - 0.5f, -1.0f, RandomFloat(&random) - 0.5f };
+        spatial::RayHit hit;
+        numHits += spatial::Raycast(index, origin, direction, 100.0f, &hit) ? 1 : 0;
+    }
+    double rayTime = GetCounter() - start;
+
+    GT_LOG_INFO("Spatial Index", "%u boxes: inserted in %f ms, moved %u in %f ms", count, 1000.0 * insertTime, numMoved, 1000.0 * moveTime);
+    GT_LOG_INFO("Spatial Index", "%u frustum queries: %f ms each, %llu results on average", NUM_QUERIES, 1000.0 * frustumTime / NUM_QUERIES, (unsigned long long)(numFrustumResults / NUM_QUERIES));
+    GT_LOG_INFO("Spatial Index", "%u box queries: %f ms each, %llu results on average", NUM_QUERIES, 1000.0 * boxTime / NUM_QUERIES, (unsigned long long)(numBoxResults / NUM_QUERIES));
+    GT_LOG_INFO("Spatial Index", "%u raycasts: %f ms each, %u hits", NUM_QUERIES, 1000.0 * rayTime / NUM_QUERIES, numHits);
+
+    spatial::DestroySpatialIndex(index);
+    return 0;
+}
+
+// one by one and batched, half of the entities is destroyed and created again to reuse their slots
+static int RunEntityBenchmark(uint32_t count, fnd::memory::MemoryArenaBase* memoryArena)
+{
+    entity_system::World* world = nullptr;
+    entity_system::WorldConfig worldConfig;
+    worldConfig.maxNumEntities = count;
+    entity_system::Entity* entities = (entity_system::Entity*)memoryArena->Allocate(sizeof(entity_system::Entity) * count, alignof(entity_system::Entity), GT_SOURCE_INFO);
+    entity_system::Entity* staleEntities = (entity_system::Entity*)memoryArena->Allocate(sizeof(entity_system::Entity) * (count / 2), alignof(entity_system::Entity), GT_SOURCE_INFO);
+    if (entities == nullptr || staleEntities == nullptr || !entity_system::CreateWorld(&world, memoryArena, &worldConfig)) {
+        GT_LOG_ERROR("Entity System", "Failed to create a world for %u entities", count);
+        return 1;
+    }
+
+    double start = GetCounter();
+    for (uint32_t i = 0; i < count; ++i) {
+        entities[i] = entity_system::CreateEntity(world);
+        if (entities[i].id == entity_system::INVALID_ID) {
+            GT_LOG_ERROR("Entity System", "Failed to create entity %u of %u", i, count);
+            return 1;
+        }
+    }
+    double createTime = GetCounter() - start;
+
+    uint32_t numAlive = 0;
+    start = GetCounter();
+    for (uint32_t i = 0; i < count; ++i) {
+        numAlive += entity_system::IsEntityAlive(world, entities[i]) ? 1 : 0;
+    }
+    double lookupTime = GetCounter() - start;
+
+    // every other one, so the free slots are scattered over the whole pool
+    uint32_t numHalf = count / 2;
+    start = GetCounter();
+    for (uint32_t i = 0; i < numHalf; ++i) {
+        staleEntities[i] = entities[i * 2];
+        entity_system::DestroyEntity(world, entities[i * 2]);
+    }
+    double destroyTime = GetCounter() - start;
+
+    start = GetCounter();
+    for (uint32_t i = 0; i < numHalf; ++i) {
+        entities[i * 2] = entity_system::CreateEntity(world);
+    }
+    double recreateTime = GetCounter() - start;
+
+    uint32_t numStaleAlive = 0;
+    for (uint32_t i = 0; i < numHalf; ++i) {
+        numStaleAlive += entity_system::IsEntityAlive(world, staleEntities[i]) ? 1 : 0;
+    }
+
+    start = GetCounter();
+    entity_system::DestroyEntities(world, entities, count);
+    double batchDestroyTime = GetCounter() - start;
+
+    start = GetCounter();
+    bool isBatchCreated = entity_system::CreateEntities(world, count, entities);
+    double batchCreateTime = GetCounter() - start;
+
+    // copies half of them in place, the copies overwrite the handles they were made from
+    uint32_t numBadCopies = 0;
+    if (isBatchCreated) {
+        entity_system::DestroyEntities(world, entities + numHalf, count - numHalf);
+        for (uint32_t i = 0; i < numHalf; ++i) {
+            entity_system::GetEntityTransform(world, entities[i])[12] = (float)i;
+            staleEntities[i] = entities[i];
+        }
+        if (!entity_system::CopyEntities(world, entities, numHalf, entities)) {
+            numBadCopies = numHalf;
+        }
+        for (uint32_t i = 0; i < numHalf && numBadCopies == 0; ++i) {
+            bool isCopy = entities[i].id != staleEntities[i].id && entity_system::IsEntityAlive(world, entities[i])
+                && entity_system::IsEntityAlive(world, staleEntities[i]) && entity_system::GetEntityTransform(world, entities[i])[12] == (float)i;
+            numBadCopies += isCopy ? 0 : 1;
+        }
+    }
+
+    GT_LOG_INFO("Entity System", "%u entities: created in %f ms (%f ns each), %u alive, checked in %f ms (%f ns each)",
+        count, 1000.0 * createTime, 1e9 * createTime / count, numAlive, 1000.0 * lookupTime, 1e9 * lookupTime / count);
+    GT_LOG_INFO("Entity System", "%u destroyed in %f ms (%f ns each), created in their slots in %f ms (%f ns each), %u stale handles alive",
+        numHalf, 1000.0 * destroyTime, 1e9 * destroyTime / (numHalf > 0 ? numHalf : 1), 1000.0 * recreateTime, 1e9 * recreateTime / (numHalf > 0 ? numHalf : 1), numStaleAlive);
+    GT_LOG_INFO("Entity System", "batched: destroyed all in %f ms (%f ns each), created all in %f ms (%f ns each)",
+        1000.0 * batchDestroyTime, 1e9 * batchDestroyTime / count, 1000.0 * batchCreateTime, 1e9 * batchCreateTime / count);
+    GT_LOG_INFO("Entity System", "copied %u in place, %u copies wrong", numHalf, numBadCopies);
+
+    entity_system::DestroyWorld(world);
+    return numAlive == count && numStaleAlive == 0 && isBatchCreated && numBadCopies == 0 ? 0 : 1;
+}
+
+#ifdef GT_GFX_SOFTWARE
+static const uint32_t GOLDEN_WIDTH = 160;
+static const uint32_t GOLDEN_HEIGHT = 120;
+// @NOTE vertices are snapped to subpixels, so only differences in float rounding between compilers are expected,
+// they shift the odd edge pixel or change a channel by one
+static const int GOLDEN_TOLERANCE = 2;
+static const uint32_t GOLDEN_MAX_MISMATCHED_PIXELS = 32;
+
+struct GoldenVertex
+{
+    float position[4];      // clip space
+    float varyings[4];      // color, or texture coordinates
+};
+
+static void GoldenVertexShader(const gfx::SoftVertexInput* input, gfx::SoftVertexOutput* output, void* userData)
+{
+    memcpy(output->position, input->attribs[0], sizeof(float) * 4);
+    memcpy(output->varyings, input->attribs[1], sizeof(float) * 4);
+}
+
+static void GoldenColorShader(const gfx::SoftPixelInput* input, gfx::SoftPixelOutput* output, void* userData)
+{
+    memcpy(output->colors[0], input->varyings, sizeof(float) * 4);
+}
+
+static void GoldenTextureShader(const gfx::SoftPixelInput* input, gfx::SoftPixelOutput* output, void* userData)
+{
+    gfx::SampleImage(input->resources->images[0], input->varyings[0], input->varyings[1], 0, 0.0f, output->colors[0]);
+}
+
+/**
+    Covers what the backend does per draw: a linearly filtered, repeating texture behind everything, an indexed quad
+    blended additively over it, two triangles depth tested against each other, a triangle with a vertex behind the
+    camera that has to be clipped and one whose colors are interpolated with different w per vertex.
+*/
+static bool RenderGoldenScene(gfx::Device* device, gfx::SwapChain swapChain)
+{
+    GoldenVertex vertices[] = {
+        // background, uvs repeat the checker twice
+        { { -1.0f, -1.0f, 0.9f, 1.0f }, { 0.0f, 2.0f, 0.0f, 0.0f } }, { { -1.0f, 3.0f, 0.9f, 1.0f }, { 0.0f, -2.0f, 0.0f, 0.0f } },
+        { { 3.0f, -1.0f, 0.9f, 1.0f }, { 4.0f, 2.0f, 0.0f, 0.0f } },
+        // additive quad
+        { { -0.8f, -0.8f, 0.5f, 1.0f }, { 0.25f, 0.0f, 0.0f, 0.0f } }, { { 0.8f, -0.8f, 0.5f, 1.0f }, { 0.25f, 0.0f, 0.0f, 0.0f } },
+        { { 0.8f, 0.8f, 0.5f, 1.0f }, { 0.25f, 0.0f, 0.0f, 0.0f } }, { { -0.8f, 0.8f, 0.5f, 1.0f }, { 0.25f, 0.0f, 0.0f, 0.0f } },
+        // green in front of blue
+        { { -0.5f, -0.5f, 0.2f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } }, { { 0.5f, -0.5f, 0.2f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+        { { 0.0f, 0.5f, 0.2f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+        { { -0.2f, -0.7f, 0.4f, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } }, { { 0.9f, -0.7f, 0.4f, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+        { { 0.9f, 0.3f, 0.4f, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+        // one vertex behind the camera
+        { { -0.3f, 0.95f, 0.1f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } }, { { 0.3f, 0.95f, 0.1f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } },
+        { { 0.0f, 0.5f, -1.0f, -0.5f }, { 1.0f, 0.0f, 1.0f, 1.0f } },
+        // perspective, the left vertex is four times as far away as the others
+        { { -3.6f, -3.6f, 1.6f, 4.0f }, { 1.0f, 0.0f, 0.0f, 1.0f } }, { { -0.6f, -0.9f, 0.1f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+        { { -0.6f, -0.1f, 0.1f, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+    };
+    uint16_t quadIndices[] = { 3, 4, 5, 3, 5, 6 };
+
+    // 4x4 checker of two grays
+    uint32_t pixels[16];
+    for (uint32_t i = 0; i < 16; ++i) {
+        pixels[i] = ((i + i / 4) % 2 == 0) ? 0xff404040 : 0xffc0c0c0;
+    }
+    void* mipData[] = { pixels };
+    size_t mipSizes[] = { sizeof(pixels) };
+    gfx::SamplerDesc samplerDesc;
+    gfx::ImageDesc imageDesc;
+    imageDesc.width = 4;
+    imageDesc.height = 4;
+    imageDesc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_R8G8B8A8_UNORM;
+    imageDesc.samplerDesc = &samplerDesc;
+    imageDesc.numDataItems = 1;
+    imageDesc.initialData = mipData;
+    imageDesc.initialDataSizes = mipSizes;
+    gfx::Image checker = gfx::CreateImage(device, &imageDesc);
+
+    gfx::BufferDesc vertexBufferDesc;
+    vertexBufferDesc.type = gfx::BufferType::BUFFER_TYPE_VERTEX;
+    vertexBufferDesc.byteWidth = sizeof(vertices);
+    vertexBufferDesc.initialData = vertices;
+    vertexBufferDesc.initialDataSize = sizeof(vertices);
+    gfx::Buffer vertexBuffer = gfx::CreateBuffer(device, &vertexBufferDesc);
+    gfx::BufferDesc indexBufferDesc;
+    indexBufferDesc.type = gfx::BufferType::BUFFER_TYPE_INDEX;
+    indexBufferDesc.byteWidth = sizeof(quadIndices);
+    indexBufferDesc.initialData = quadIndices;
+    indexBufferDesc.initialDataSize = sizeof(quadIndices);
+    gfx::Buffer indexBuffer = gfx::CreateBuffer(device, &indexBufferDesc);
+
+    // the code is ignored by the software backend, the registered functions run instead
+    char code[4] = {};
+    gfx::ShaderDesc shaderDesc;
+    shaderDesc.type = gfx::ShaderType::SHADER_TYPE_VS;
+    shaderDesc.code = code;
+    shaderDesc.codeSize = sizeof(code);
+    gfx::Shader vertexShader = gfx::CreateShader(device, &shaderDesc);
+    shaderDesc.type = gfx::ShaderType::SHADER_TYPE_PS;
+    gfx::Shader colorShader = gfx::CreateShader(device, &shaderDesc);
+    gfx::Shader textureShader = gfx::CreateShader(device, &shaderDesc);
+    if (!GFX_CHECK_RESOURCE(checker) || !GFX_CHECK_RESOURCE(vertexBuffer) || !GFX_CHECK_RESOURCE(indexBuffer) ||
+        !gfx::RegisterVertexShader(device, vertexShader, GoldenVertexShader, 4, nullptr) ||
+        !gfx::RegisterPixelShader(device, colorShader, GoldenColorShader, nullptr) ||
+        !gfx::RegisterPixelShader(device, textureShader, GoldenTextureShader, nullptr)) {
+        GT_LOG_ERROR("Renderer", "Failed to create the golden image scene");
+        return false;
+    }
+
+    gfx::PipelineStateDesc pipelineDesc;
+    pipelineDesc.vertexShader = vertexShader;
+    pipelineDesc.pixelShader = colorShader;
+    pipelineDesc.vertexLayout.attribs[0] = { "POSITION", 0, offsetof(GoldenVertex, position), 0, gfx::VertexFormat::VERTEX_FORMAT_FLOAT4 };
+    pipelineDesc.vertexLayout.attribs[1] = { "TEXCOORD", 0, offsetof(GoldenVertex, varyings), 0, gfx::VertexFormat::VERTEX_FORMAT_FLOAT4 };
+    pipelineDesc.rasterState.cullMode = gfx::CullMode::CULL_NONE;
+    pipelineDesc.depthStencilState.enableDepth = true;
+    pipelineDesc.depthStencilState.depthWriteMask = gfx::DepthWriteMask::DEPTH_WRITE_MASK_ALL;
+    pipelineDesc.depthStencilState.depthFunc = gfx::CompareFunc::COMPARE_LESS;
+    gfx::PipelineState depthTested = gfx::CreatePipelineState(device, &pipelineDesc);
+
+    gfx::PipelineStateDesc texturedDesc = pipelineDesc;
+    texturedDesc.pixelShader = textureShader;
+    gfx::PipelineState textured = gfx::CreatePipelineState(device, &texturedDesc);
+
+    gfx::PipelineStateDesc additiveDesc = pipelineDesc;
+    additiveDesc.indexFormat = gfx::IndexFormat::INDEX_FORMAT_UINT16;
+    additiveDesc.depthStencilState.enableDepth = false;
+    additiveDesc.blendState.enableBlend = true;
+    additiveDesc.blendState.srcBlend = gfx::BlendFactor::BLEND_ONE;
+    additiveDesc.blendState.dstBlend = gfx::BlendFactor::BLEND_ONE;
+    gfx::PipelineState additive = gfx::CreatePipelineState(device, &additiveDesc);
+
+    gfx::RenderPassAction action;
+    action.colors[0].action = gfx::Action::ACTION_CLEAR;
+    action.colors[0].color[0] = action.colors[0].color[1] = action.colors[0].color[2] = 0.1f;
+    action.colors[0].color[3] = 1.0f;
+    action.depth.action = gfx::Action::ACTION_CLEAR;
+    action.depth.value = 1.0f;
+
+    gfx::CommandBuffer cmdBuffer = gfx::GetImmediateCommandBuffer(device);
+    gfx::BeginDefaultRenderPass(device, cmdBuffer, swapChain, &action);
+    gfx::DrawCall drawCall;
+    drawCall.vertexBuffers[0] = vertexBuffer;
+    drawCall.vertexOffsets[0] = 0;
+    drawCall.vertexStrides[0] = sizeof(GoldenVertex);
+    drawCall.pipelineState = textured;
+    drawCall.psImageInputs[0] = checker;
+    drawCall.numElements = 3;
+    gfx::SubmitDrawCall(device, cmdBuffer, &drawCall);
+
+    drawCall.pipelineState = additive;
+    drawCall.indexBuffer = indexBuffer;
+    drawCall.numElements = 6;
+    gfx::SubmitDrawCall(device, cmdBuffer, &drawCall);
+
+    drawCall.pipelineState = depthTested;
+    drawCall.indexBuffer = gfx::Buffer();
+    drawCall.numElements = 3;
+    for (uint32_t startVertex = 7; startVertex < sizeof(vertices) / sizeof(GoldenVertex); startVertex += 3) {
+        drawCall.startVertexLocation = startVertex;
+        gfx::SubmitDrawCall(device, cmdBuffer, &drawCall);
+    }
+    gfx::EndRenderPass(device, cmdBuffer);
+    return true;
+}
+
+// binary PPM, RGB without alpha
+static bool WritePPM(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) { return false; }
+    bool success = fprintf(file, "P6\n%u %u\n255\n", width, height) > 0;
+    for (uint32_t i = 0; success && i < width * height; ++i) {
+        success = fwrite(rgba + i * 4, 1, 3, file) == 3;
+    }
+    return fclose(file) == 0 && success;
+}
+
+// only reads what WritePPM writes
+static bool ReadPPM(const char* path, uint8_t* outRGBA, uint32_t width, uint32_t height)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) { return false; }
+    unsigned int fileWidth = 0, fileHeight = 0, maxValue = 0;
+    bool success = fscanf(file, "P6 %u %u %u", &fileWidth, &fileHeight, &maxValue) == 3 && fgetc(file) == '\n' &&
+        fileWidth == width && fileHeight == height && maxValue == 255;
+    for (uint32_t i = 0; success && i < width * height; ++i) {
+        success = fread(outRGBA + i * 4, 1, 3, file) == 3;
+        outRGBA[i * 4 + 3] = 0xff;
+    }
+    fclose(file);
+    return success;
+}
+
+static int RunGoldenImageCheck(gfx::Device* device, const char* path, bool write, fnd::memory::MemoryArenaBase* memoryArena)
+{
+    gfx::SwapChainDesc swapChainDesc;
+    swapChainDesc.width = GOLDEN_WIDTH;
+    swapChainDesc.height = GOLDEN_HEIGHT;
+    gfx::SwapChain swapChain = gfx::CreateSwapChain(device, &swapChainDesc);
+    if (!GFX_CHECK_RESOURCE(swapChain) || !RenderGoldenScene(device, swapChain)) {
+        return 1;
+    }
+
+    size_t imageSize = GOLDEN_WIDTH * GOLDEN_HEIGHT * 4;
+    uint8_t* rendered = (uint8_t*)memoryArena->Allocate(imageSize, 16, GT_SOURCE_INFO);
+    uint8_t* golden = (uint8_t*)memoryArena->Allocate(imageSize, 16, GT_SOURCE_INFO);
+    if (!gfx::ReadSwapChainPixels(device, swapChain, rendered, imageSize)) {
+        GT_LOG_ERROR("Renderer", "Failed to read back the golden image scene");
+        return 1;
+    }
+    if (write) {
+        if (!WritePPM(path, rendered, GOLDEN_WIDTH, GOLDEN_HEIGHT)) {
+            GT_LOG_ERROR("Renderer", "Failed to write golden image %s", path);
+            return 1;
+        }
+        GT_LOG_INFO("Renderer", "Wrote golden image %s", path);
+        return 0;
+    }
+    if (!ReadPPM(path, golden, GOLDEN_WIDTH, GOLDEN_HEIGHT)) {
+        GT_LOG_ERROR("Renderer", "Failed to read golden image %s, it has to be a %ux%u binary PPM", path, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+        return 1;
+    }
+
+    uint32_t numMismatches = 0;
+    int maxDifference = 0;
+    for (uint32_t i = 0; i < GOLDEN_WIDTH * GOLDEN_HEIGHT; ++i) {
+        int pixelDifference = 0;
+        for (uint32_t channel = 0; channel < 3; ++channel) {
+            int difference = abs((int)rendered[i * 4 + channel] - (int)golden[i * 4 + channel]);
+            pixelDifference = difference > pixelDifference ? difference : pixelDifference;
+        }
+        maxDifference = pixelDifference > maxDifference ? pixelDifference : maxDifference;
+        if (pixelDifference > GOLDEN_TOLERANCE) {
+            if (numMismatches == 0) {
+                GT_LOG_ERROR("Renderer", "First mismatch at (%u, %u): rendered %u %u %u, golden %u %u %u", i % GOLDEN_WIDTH, i / GOLDEN_WIDTH,
+                    rendered[i * 4], rendered[i * 4 + 1], rendered[i * 4 + 2], golden[i * 4], golden[i * 4 + 1], golden[i * 4 + 2]);
+            }
+            numMismatches++;
+        }
+    }
+    gfx::SoftDeviceStats stats;
+    gfx::GetSoftDeviceStats(device, &stats);
+    if (numMismatches > GOLDEN_MAX_MISMATCHED_PIXELS) {
+        GT_LOG_ERROR("Renderer", "Golden image check failed: %u pixels differ by more than %i, up to %i", numMismatches, GOLDEN_TOLERANCE, maxDifference);
+        return 1;
+    }
+    GT_LOG_INFO("Renderer", "Golden image check passed: %u pixels differ by more than %i, up to %i. %llu triangles, %llu pixels shaded on %u threads",
+        numMismatches, GOLDEN_TOLERANCE, maxDifference, (unsigned long long)stats.numTriangles, (unsigned long long)stats.numPixelsShaded, stats.numThreads);
+    return 0;
+}
+#endif
+
+static bool IsBindGroupAccepted(gfx::Device* device, gfx::BindGroupDesc* desc)
+{
+    gfx::BindGroup bindGroup = gfx::CreateBindGroup(device, desc);
+    if (!GFX_CHECK_RESOURCE(bindGroup)) { return false; }
+    gfx::DestroyBindGroup(device, bindGroup);
+    return true;
+}
+
+// creates a bind group from resources, destroys them and fails unless the same desc is rejected, also after the
+// freed slots have been reused by new resources
+static int RunBindGroupChecks(gfx::Device* device)
+{
+    uint32_t pixels[4] = {};
+    void* mipData[] = { pixels };
+    size_t mipSizes[] = { sizeof(pixels) };
+    gfx::SamplerDesc samplerDesc;
+    gfx::ImageDesc imageDesc;
+    imageDesc.width = 2;
+    imageDesc.height = 2;
+    imageDesc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_R8G8B8A8_UNORM;
+    imageDesc.samplerDesc = &samplerDesc;
+    imageDesc.numDataItems = 1;
+    imageDesc.initialData = mipData;
+    imageDesc.initialDataSizes = mipSizes;
+
+    gfx::BufferDesc vertexBufferDesc;
+    vertexBufferDesc.type = gfx::BufferType::BUFFER_TYPE_VERTEX;
+    vertexBufferDesc.usage = gfx::ResourceUsage::USAGE_DYNAMIC;
+    vertexBufferDesc.byteWidth = 64;
+    gfx::BufferDesc constantBufferDesc;
+    constantBufferDesc.type = gfx::BufferType::BUFFER_TYPE_CONSTANT;
+    constantBufferDesc.usage = gfx::ResourceUsage::USAGE_DYNAMIC;
+    constantBufferDesc.byteWidth = 256;
+
+    gfx::BindGroupDesc bindGroupDesc;
+    bindGroupDesc.vertexBuffers[0] = gfx::CreateBuffer(device, &vertexBufferDesc);
+    bindGroupDesc.vertexStrides[0] = 16;
+    bindGroupDesc.psConstantInputs[0] = gfx::CreateBuffer(device, &constantBufferDesc);
+    bindGroupDesc.psImageInputs[0] = gfx::CreateImage(device, &imageDesc);
+    bool isLiveAccepted = IsBindGroupAccepted(device, &bindGroupDesc);
+
+    gfx::Buffer* buffers[] = { &bindGroupDesc.vertexBuffers[0], &bindGroupDesc.psConstantInputs[0] };
+    gfx::BufferDesc* bufferDescs[] = { &vertexBufferDesc, &constantBufferDesc };
+    uint32_t numAccepted = 0;
+    for (uint32_t i = 0; i < 2; ++i) {
+        gfx::Buffer buffer = *buffers[i];
+        gfx::DestroyBuffer(device, buffer);
+        numAccepted += IsBindGroupAccepted(device, &bindGroupDesc) ? 1 : 0;
+        // a new buffer of the same kind may get the destroyed one's slot, the stale handle has to stay invalid
+        gfx::Buffer replacement = gfx::CreateBuffer(device, bufferDescs[i]);
+        numAccepted += IsBindGroupAccepted(device, &bindGroupDesc) ? 1 : 0;
+        *buffers[i] = replacement;
+    }
+    gfx::DestroyImage(device, bindGroupDesc.psImageInputs[0]);
+    numAccepted += IsBindGroupAccepted(device, &bindGroupDesc) ? 1 : 0;
+
+    gfx::DestroyBuffer(device, bindGroupDesc.vertexBuffers[0]);
+    gfx::DestroyBuffer(device, bindGroupDesc.psConstantInputs[0]);
+    if (!isLiveAccepted || numAccepted > 0) {
+        GT_LOG_ERROR("Renderer", "Bind group checks failed: live resources %s, %u bind groups with destroyed resources accepted",
+            isLiveAccepted ? "accepted" : "rejected", numAccepted);
+        return 1;
+    }
+    GT_LOG_INFO("Renderer", "Bind group checks passed: bind groups with destroyed buffers and images are rejected");
+    return 0;
+}
+
+int linux_main(int argc, char* argv[])
+{
+    using namespace fnd;
+
+    SimpleLogger logger;
+
+    const uint32_t numFrames = FindCommandLineValue(argc, argv, "--frames", 100);
+    const uint32_t numEntities = FindCommandLineValue(argc, argv, "--entities", 1024);
+
+    const size_t reservedMemorySize = GIGABYTES(2);
+    void* reservedMemory = malloc(reservedMemorySize);
+    if (reservedMemory == nullptr) {
+        GT_LOG_ERROR("Application", "Failed to reserve %llu bytes", (unsigned long long)reservedMemorySize);
+        return 1;
+    }
+    memory::LinearAllocator applicationAllocator(reservedMemory, reservedMemorySize);
+    LinearArena applicationArena(&applicationAllocator);
+
+    static const size_t frameAllocatorSize = MEGABYTES(64);
+    memory::LinearAllocator frameAllocator(applicationArena.Allocate(frameAllocatorSize, 16, GT_SOURCE_INFO), frameAllocatorSize);
+
+    GT_LOG_INFO("Application", "Initialized memory systems");
+
+    const uint32_t numBenchmarkBoxes = FindCommandLineValue(argc, argv, "--spatial-benchmark", 0);
+    if (numBenchmarkBoxes > 0) {
+        int result = RunSpatialBenchmark(numBenchmarkBoxes, &applicationArena);
+        free(reservedMemory);
+        return result;
+    }
+
+    const uint32_t numBenchmarkEntities = FindCommandLineValue(argc, argv, "--entity-benchmark", 0);
+    if (numBenchmarkEntities > 0) {
+        int result = RunEntityBenchmark(numBenchmarkEntities, &applicationArena);
+        free(reservedMemory);
+        return result;
+    }
+
+    gfx::Interface* gfxInterface = nullptr;
+    gfx::InterfaceDesc interfaceDesc;
+    if (!gfx::CreateInterface(&gfxInterface, &interfaceDesc, &applicationArena)) {
+        GT_LOG_ERROR("Renderer", "Failed to initialize graphics interface");
+        return 1;
+    }
+    gfx::DeviceInfo deviceInfo[GFX_DEFAULT_MAX_NUM_DEVICES];
+    uint32_t numDevices = 0;
+    gfx::EnumerateDevices(gfxInterface, deviceInfo, &numDevices);
+    gfx::Device* gfxDevice = numDevices > 0 ? gfx::GetDevice(gfxInterface, deviceInfo[0].index) : nullptr;
+    if (gfxDevice == nullptr) {
+        GT_LOG_ERROR("Renderer", "No graphics device");
+        return 1;
+    }
+    GT_LOG_INFO("Renderer", "Selected graphics device: %s", deviceInfo[0].friendlyName);
+
+    const char* goldenPath = FindCommandLineString(argc, argv, "--golden");
+    const char* writeGoldenPath = FindCommandLineString(argc, argv, "--write-golden");
+    if (goldenPath != nullptr || writeGoldenPath != nullptr) {
+#ifdef GT_GFX_SOFTWARE
+        int result = RunGoldenImageCheck(gfxDevice, writeGoldenPath != nullptr ? writeGoldenPath : goldenPath, writeGoldenPath != nullptr, &applicationArena);
+#else
+        GT_LOG_ERROR("Renderer", "Golden images need the software gfx backend, build with --gfx-software");
+        int result = 1;
+#endif
+        free(reservedMemory);
+        return result;
+    }
+
+    if (HasCommandLineFlag(argc, argv, "--bind-group-checks")) {
+        int result = RunBindGroupChecks(gfxDevice);
+        free(reservedMemory);
+        return result;
+    }
+
+    gfx::SwapChainDesc swapChainDesc;
+    swapChainDesc.width = WINDOW_WIDTH;
+    swapChainDesc.height = WINDOW_HEIGHT;
+    gfx::SwapChain swapChain = gfx::CreateSwapChain(gfxDevice, &swapChainDesc);
+    if (!GFX_CHECK_RESOURCE(swapChain)) {
+        GT_LOG_ERROR("Renderer", "Failed to create swap chain");
+        return 1;
+    }
+
+    renderer::Renderer* renderer = nullptr;
+    renderer::RendererConfig rendererConfig;
+    rendererConfig.gfxDevice = gfxDevice;
+    rendererConfig.windowWidth = WINDOW_WIDTH;
+    rendererConfig.windowHeight = WINDOW_HEIGHT;
+    if (!renderer::CreateRenderer(&renderer, &applicationArena, &rendererConfig)) {
+        GT_LOG_ERROR("Renderer", "Failed to create a renderer");
+        return 1;
+    }
+
+    renderer::RenderWorld* renderWorld = nullptr;
+    renderer::RenderWorldConfig renderWorldConfig;
+    renderWorldConfig.renderer = renderer;
+    // @NOTE one more than the entities, the handle pool never hands out its first slot
+    renderWorldConfig.renderablePoolSize = numEntities + 1 > renderer::DEFAULT_RENDERABLE_POOL_SIZE ? numEntities + 1 : renderer::DEFAULT_RENDERABLE_POOL_SIZE;
+    if (!renderer::CreateRenderWorld(&renderWorld, &applicationArena, &renderWorldConfig)) {
+        GT_LOG_ERROR("Renderer", "Failed to create render world");
+        return 1;
+    }
+
+    entity_system::World* world = nullptr;
+    entity_system::WorldConfig worldConfig;
+    worldConfig.maxNumEntities = numEntities > worldConfig.maxNumEntities ? numEntities : worldConfig.maxNumEntities;
+    if (!entity_system::CreateWorld(&world, &applicationArena, &worldConfig)) {
+        GT_LOG_ERROR("Application", "Failed to create entity world");
+        return 1;
+    }
+
+    double setupStart = GetCounter();
+    if (!CreateScene(renderWorld, world, numEntities)) {
+        GT_LOG_ERROR("Application", "Failed to create the scene");
+        return 1;
+    }
+    GT_LOG_INFO("Application", "Created %u entities in %f ms", numEntities, 1000.0 * (GetCounter() - setupStart));
+
+    // --replay starts from the world of the recording, --record from the scene as created
+    const char* recordPath = FindCommandLineString(argc, argv, "--record");
+    const char* replayPath = FindCommandLineString(argc, argv, "--replay");
+    fnd::filesystem::MappedFile replayFile;
+    sim_recording::Replay* replay = nullptr;
+    sim_recording::Recorder* recorder = nullptr;
+    if (replayPath != nullptr) {
+        if (!fnd::filesystem::MapFile(replayPath, &replayFile)) {
+            GT_LOG_ERROR("Recording", "Failed to open recording %s", replayPath);
+            return 1;
+        }
+        if (!sim_recording::OpenReplay(&replay, &applicationArena, replayFile.data, replayFile.size, world)) {
+            return 1;
+        }
+        GT_LOG_INFO("Recording", "Replaying %llu steps from %s", (unsigned long long)sim_recording::GetNumReplaySteps(replay), replayPath);
+    }
+    else if (recordPath != nullptr) {
+        sim_recording::RecordingConfig recordingConfig;
+        recordingConfig.path = recordPath;
+        if (!sim_recording::BeginRecording(&recorder, &applicationArena, world, &recordingConfig)) {
+            return 1;
+        }
+    }
+    size_t numSimulatedEntities = 0;
+    entity_system::Entity* simulatedEntities = nullptr;
+    if (replay != nullptr || recorder != nullptr) {
+        entity_system::GetAllEntities(world, nullptr, &numSimulatedEntities);
+        simulatedEntities = (entity_system::Entity*)applicationArena.Allocate(sizeof(entity_system::Entity) * numSimulatedEntities, alignof(entity_system::Entity), GT_SOURCE_INFO);
+        entity_system::GetAllEntities(world, simulatedEntities, &numSimulatedEntities);
+    }
+
+    // looking down the grid from above its near edge
+    float projection[16];
+    util::Make4x4FloatProjectionMatrixCMLH(projection, 1.0f, (float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, 0.1f, 1000.0f);
+    renderer::SetCameraProjection(renderWorld, projection);
+    float cameraRotation[16], cameraPosition[16], camera[16], view[16];
+    util::Make4x4FloatRotationMatrixCMLH(cameraRotation, fnd::math::float3(1.0f, 0.0f, 0.0f), -0.6f);
+    util::Make4x4FloatTranslationMatrixCM(cameraPosition, fnd::math::float3(0.0f, 10.0f, -10.0f));
+    util::MultiplyMatricesCM(cameraPosition, cameraRotation, camera);
+    util::Inverse4x4FloatMatrixCM(camera, view);
+    renderer::SetCameraTransform(renderWorld, view);
+
+    double minFrameTime = 1e9;
+    double maxFrameTime = 0.0;
+    double totalTime = 0.0;
+    double simulatedTime = 0.0;
+    double frameTime = 1.0 / 60.0;
+    bool hasDiverged = false;
+    uint32_t numFramesRendered = 0;
+    renderer::RenderStats stats;
+    for (uint32_t frame = 0; replay != nullptr || frame < numFrames; ++frame) {
+        double frameStart = GetCounter();
+        if (replay != nullptr || recorder != nullptr) {
+            sim_recording::StepInput input;
+            input.dt = frameTime;
+            input.displaySize[0] = (float)WINDOW_WIDTH;
+            input.displaySize[1] = (float)WINDOW_HEIGHT;
+            if (replay != nullptr && !sim_recording::BeginReplayStep(replay, &input)) { break; }
+
+            simulatedTime += input.dt;
+            SimulateStep(world, simulatedEntities, numSimulatedEntities, frame, simulatedTime);
+            entity_system::CommitJournalStep(world);
+
+            if (recorder != nullptr) {
+                sim_recording::RecordStep(recorder, &input);
+            }
+            if (replay != nullptr && !sim_recording::VerifyReplayStep(replay)) {
+                hasDiverged = true;
+                break;
+            }
+        }
+        UpdateWorldSnapshot(world, renderWorld, &frameAllocator);
+        renderer::Render(renderWorld, swapChain);
+        gfx::PresentSwapChain(gfxDevice, swapChain);
+        frameAllocator.Reset();
+        frameTime = GetCounter() - frameStart;
+
+        minFrameTime = frameTime < minFrameTime ? frameTime : minFrameTime;
+        maxFrameTime = frameTime > maxFrameTime ? frameTime : maxFrameTime;
+        totalTime += frameTime;
+        numFramesRendered++;
+        renderer::GetRenderStats(renderWorld, &stats);
+    }
+
+    double framesDivisor = numFramesRendered > 0 ? (double)numFramesRendered : 1.0;
+    GT_LOG_INFO("Application", "Rendered %u frames in %f ms: %f ms average, %f ms min, %f ms max", numFramesRendered, 1000.0 * totalTime, 1000.0 * totalTime / framesDivisor, 1000.0 * minFrameTime, 1000.0 * maxFrameTime);
+    GT_LOG_INFO("Application", "Last frame: %u renderables, %u culled by the spatial index, %u submeshes tested, %u culled, %u draw calls for %u instances, culling took %f ms",
+        stats.numRenderables, stats.numRenderablesCulled, stats.numSubmeshes, stats.numSubmeshesCulled, stats.numDrawCalls, stats.numInstances, stats.cullingTime);
+
+    int result = 0;
+    if (recorder != nullptr) {
+        uint64_t recordingSize = sim_recording::GetRecordingSize(recorder);
+        if (sim_recording::EndRecording(recorder)) {
+            GT_LOG_INFO("Recording", "Recorded %u steps, %.2f s of simulation, %llu bytes to %s", numFramesRendered, simulatedTime, (unsigned long long)recordingSize, recordPath);
+        }
+        else {
+            result = 1;
+        }
+    }
+    if (replay != nullptr) {
+        uint64_t numSteps = sim_recording::GetNumReplaySteps(replay);
+        if (hasDiverged || numFramesRendered != numSteps) {
+            GT_LOG_ERROR("Recording", "Replay matched the recording for %u of %llu steps", numFramesRendered, (unsigned long long)numSteps);
+            result = 1;
+        }
+        else {
+            GT_LOG_INFO("Recording", "Replay matched the recording for all %llu steps, %.2f s of simulation", (unsigned long long)numSteps, simulatedTime);
+        }
+        sim_recording::CloseReplay(replay);
+        fnd::filesystem::UnmapFile(&replayFile);
+    }
+
+    entity_system::DestroyWorld(world);
+    renderer::DestroyRenderWorld(renderWorld);
+    renderer::DestroyRenderer(renderer);
+    free(reservedMemory);
+    return result;
+}
+
+#ifndef GT_SHARED_LIB
+int main(int argc, char* argv[])
+{
+    return linux_main(argc, argv);
+}
+#endif
@@ -0,0 +1,466 @@
+#include "recording.h"
+#include <engine/runtime/entities/entities.h>
+#include <foundation/memory/memory.h>
+#include <foundation/logging/logging.h>
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace sim_recording
+{
+    /**
+        Recording stream, version 1. Integers are written in the byte order of the recording machine.
+        The stream is written front to back while recording, header.numSteps is filled in once the recording ends.
+
+        Memory layout:
+        {
+            RecordingHeader
+            char[header.worldSize]          <- world at the start of the recording, as written by SerializeWorld
+            for every step:
+                StepHeader
+                StepInput                   <- only if STEP_INPUT_CHANGED is set, the previous input repeats otherwise
+                uint64_t, char[]            <- only if STEP_WORLD_RELOADED is set, size and contents of a world
+                                               that replaces the current one before the changes are applied
+                char[step.deltaSize]        <- entity changes made during the step, as written by SerializeJournal
+        }
+    */
+    static const uint32_t RECORDING_MAGIC = 0x43455253; // 'SREC'
+    static const uint16_t RECORDING_VERSION = 1;
+    static const uint16_t RECORDING_ENDIAN_TAG = 0x0102;
+
+    struct RecordingHeader
+    {
+        uint32_t magic = RECORDING_MAGIC;
+        uint16_t version = RECORDING_VERSION;
+        uint16_t endianTag = RECORDING_ENDIAN_TAG;
+        uint64_t worldSize = 0;
+        uint64_t numSteps = 0;
+    };
+
+    enum : uint16_t
+    {
+        STEP_INPUT_CHANGED = 1 << 0,
+        STEP_WORLD_RELOADED = 1 << 1
+    };
+
+    struct StepHeader
+    {
+        uint16_t flags = 0;
+        uint16_t reserved = 0;
+        uint32_t deltaSize = 0;
+    };
+
+    static_assert(sizeof(StepInput) == 128, "StepInput is compared bytewise and must not contain padding");
+
+    struct Recorder
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+        entity_system::World* world = nullptr;
+
+#ifdef _MSC_VER
+        HANDLE      file = INVALID_HANDLE_VALUE;
+#else
+        FILE*       file = nullptr;
+#endif
+        uint64_t    fileSize = 0;
+        uint64_t    numStepsWritten = 0;
+        bool        hasWriteFailed = false;
+
+        // bytes not written to the file yet
+        char*       buffer = nullptr;
+        size_t      size = 0;
+        size_t      capacity = 0;
+        size_t      flushSize = 0;
+
+        uint64_t    worldSize = 0;
+        uint64_t    journalPosition = 0;
+        uint64_t    numSteps = 0;
+        StepInput   lastInput;
+        bool        hasInput = false;
+    };
+
+    struct Replay
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+        entity_system::World* world = nullptr;
+
+        const char* data = nullptr;
+        size_t      size = 0;
+        size_t      offset = 0;
+
+        uint64_t    numSteps = 0;
+        uint64_t    currentStep = 0;
+        StepInput   input;
+
+        // the step read by BeginReplayStep
+        bool        isStepOpen = false;
+        uint16_t    stepFlags = 0;
+        uint64_t    stepWorldSize = 0;
+        const char* stepWorld = nullptr;
+        uint32_t    stepDeltaSize = 0;
+        const char* stepDelta = nullptr;
+
+        uint64_t    journalPosition = 0;
+        char*       verifyBuffer = nullptr;
+        size_t      verifyBufferSize = 0;
+    };
+
+    static bool OpenRecordingFile(Recorder* recorder, const char* path)
+    {
+#ifdef _MSC_VER
+        recorder->file = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        return recorder->file != INVALID_HANDLE_VALUE;
+#else
+        recorder->file = fopen(path, "wb");
+        return recorder->file != nullptr;
+#endif
+    }
+
+    static void CloseRecordingFile(Recorder* recorder)
+    {
+#ifdef _MSC_VER
+        CloseHandle(recorder->file);
+#else
+        fclose(recorder->file);
+#endif
+    }
+
+    // positioned, so the header can be rewritten once the number of steps is known
+    static bool WriteRecordingFile(Recorder* recorder, uint64_t offset, const void* data, size_t size)
+    {
+#ifdef _MSC_VER
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD bytesWritten = 0;
+        return WriteFile(recorder->file, data, (DWORD)size, &bytesWritten, &overlapped) && bytesWritten == size;
+#else
+        return pwrite(fileno(recorder->file), data, size, (off_t)offset) == (ssize_t)size;
+#endif
+    }
+
+    static bool FlushRecording(Recorder* recorder)
+    {
+        if (recorder->size == 0 || recorder->hasWriteFailed) { return !recorder->hasWriteFailed; }
+        if (!WriteRecordingFile(recorder, recorder->fileSize, recorder->buffer, recorder->size)) {
+            GT_LOG_ERROR("Recording", "Failed to write %llu bytes to the recording, it ends after step %llu",
+                (unsigned long long)recorder->size, (unsigned long long)recorder->numSteps);
+            recorder->hasWriteFailed = true;
+            return false;
+        }
+        recorder->fileSize += recorder->size;
+        recorder->size = 0;
+        recorder->numStepsWritten = recorder->numSteps;
+        return true;
+    }
+
+    static char* ReserveRecording(Recorder* recorder, size_t numBytes)
+    {
+        if (recorder->size + numBytes > recorder->capacity) {
+            size_t capacity = recorder->capacity * 2;
+            while (capacity < recorder->size + numBytes) {
+                capacity *= 2;
+            }
+            char* buffer = GT_NEW_ARRAY(char, capacity, recorder->memoryArena);
+            memcpy(buffer, recorder->buffer, recorder->size);
+            GT_DELETE_ARRAY(recorder->buffer, recorder->memoryArena);
+            recorder->buffer = buffer;
+            recorder->capacity = capacity;
+        }
+        char* out = recorder->buffer + recorder->size;
+        recorder->size += numBytes;
+        return out;
+    }
+
+    static void AppendWorld(Recorder* recorder, bool withSize)
+    {
+        size_t worldSize = 0;
+        entity_system::SerializeWorld(recorder->world, nullptr, 0, &worldSize);
+        if (withSize) {
+            uint64_t size = worldSize;
+            memcpy(ReserveRecording(recorder, sizeof(uint64_t)), &size, sizeof(uint64_t));
+        }
+        entity_system::SerializeWorld(recorder->world, ReserveRecording(recorder, worldSize), worldSize, nullptr);
+        recorder->journalPosition = entity_system::GetJournalPosition(recorder->world);
+    }
+
+    bool BeginRecording(Recorder** outRecorder, fnd::memory::MemoryArenaBase* memoryArena, entity_system::World* world, const RecordingConfig* config)
+    {
+        entity_system::JournalConfig journalConfig;
+        if (!entity_system::EnableJournal(world, &journalConfig)) {
+            GT_LOG_ERROR("Recording", "Failed to enable the change journal");
+            return false;
+        }
+
+        Recorder* recorder = GT_NEW(Recorder, memoryArena);
+        recorder->memoryArena = memoryArena;
+        recorder->world = world;
+        if (config->path == nullptr || !OpenRecordingFile(recorder, config->path)) {
+            GT_LOG_ERROR("Recording", "Failed to open %s for recording", config->path != nullptr ? config->path : "(null)");
+            GT_DELETE(recorder, memoryArena);
+            return false;
+        }
+        recorder->flushSize = config->flushSize > 0 ? config->flushSize : 1;
+        recorder->capacity = recorder->flushSize;
+        recorder->buffer = GT_NEW_ARRAY(char, recorder->capacity, memoryArena);
+
+        ReserveRecording(recorder, sizeof(RecordingHeader));
+        AppendWorld(recorder, false);
+        recorder->worldSize = recorder->size - sizeof(RecordingHeader);
+        RecordingHeader header;
+        header.worldSize = recorder->worldSize;
+        memcpy(recorder->buffer, &header, sizeof(RecordingHeader));
+        if (!FlushRecording(recorder)) {
+            CloseRecordingFile(recorder);
+            GT_DELETE_ARRAY(recorder->buffer, memoryArena);
+            GT_DELETE(recorder, memoryArena);
+            return false;
+        }
+
+        *outRecorder = recorder;
+        return true;
+    }
+
+    bool RecordStep(Recorder* recorder, const StepInput* input)
+    {
+        if (recorder->hasWriteFailed) { return false; }
+
+        size_t stepOffset = recorder->size;
+        StepHeader step;
+        ReserveRecording(recorder, sizeof(StepHeader));
+
+        if (!recorder->hasInput || memcmp(&recorder->lastInput, input, sizeof(StepInput)) != 0) {
+            step.flags |= STEP_INPUT_CHANGED;
+            memcpy(ReserveRecording(recorder, sizeof(StepInput)), input, sizeof(StepInput));
+            recorder->lastInput = *input;
+            recorder->hasInput = true;
+        }
+
+        size_t deltaSize = 0;
+        if (entity_system::SerializeJournal(recorder->world, recorder->journalPosition, nullptr, 0, &deltaSize, nullptr)) {
+            char* delta = ReserveRecording(recorder, deltaSize);
+            entity_system::SerializeJournal(recorder->world, recorder->journalPosition, delta, deltaSize, nullptr, &recorder->journalPosition);
+            step.deltaSize = (uint32_t)deltaSize;
+        }
+        else {
+            // @NOTE the changes since the last step are gone, either a world was loaded or there were more than
+            // the journal holds, so the whole world goes into the stream instead
+            step.flags |= STEP_WORLD_RELOADED;
+            AppendWorld(recorder, true);
+        }
+
+        memcpy(recorder->buffer + stepOffset, &step, sizeof(StepHeader));
+        recorder->numSteps++;
+        if (recorder->size >= recorder->flushSize) {
+            return FlushRecording(recorder);
+        }
+        return true;
+    }
+
+    uint64_t GetRecordingSize(Recorder* recorder)
+    {
+        return recorder->fileSize + recorder->size;
+    }
+
+    bool EndRecording(Recorder* recorder)
+    {
+        bool success = FlushRecording(recorder);
+        // @NOTE only steps that made it into the file are counted, so it stays readable after a failed write
+        RecordingHeader header;
+        header.worldSize = recorder->worldSize;
+        header.numSteps = recorder->numStepsWritten;
+        if (!WriteRecordingFile(recorder, 0, &header, sizeof(RecordingHeader))) {
+            GT_LOG_ERROR("Recording", "Failed to write the recording header");
+            success = false;
+        }
+        CloseRecordingFile(recorder);
+        GT_DELETE_ARRAY(recorder->buffer, recorder->memoryArena);
+        GT_DELETE(recorder, recorder->memoryArena);
+        return success;
+    }
+
+    static bool ReadReplay(Replay* replay, void* out, size_t numBytes)
+    {
+        if (replay->size - replay->offset < numBytes) { return false; }
+        memcpy(out, replay->data + replay->offset, numBytes);
+        replay->offset += numBytes;
+        return true;
+    }
+
+    static bool LoadReplayWorld(Replay* replay, const char* data, uint64_t worldSize)
+    {
+        // @NOTE DeserializeWorld copies everything out of the buffer and doesn't write to it
+        if (!entity_system::DeserializeWorld(replay->world, const_cast<char*>(data), (size_t)worldSize, nullptr)) {
+            return false;
+        }
+        replay->journalPosition = entity_system::GetJournalPosition(replay->world);
+        return true;
+    }
+
+    bool OpenReplay(Replay** outReplay, fnd::memory::MemoryArenaBase* memoryArena, const void* data, size_t size, entity_system::World* world)
+    {
+        RecordingHeader header;
+        if (size < sizeof(RecordingHeader)) {
+            GT_LOG_ERROR("Recording", "Recording is truncated");
+            return false;
+        }
+        memcpy(&header, data, sizeof(RecordingHeader));
+        if (header.magic != RECORDING_MAGIC || header.endianTag != RECORDING_ENDIAN_TAG) {
+            GT_LOG_ERROR("Recording", "Data is not a recording or was recorded with a different byte order");
+            return false;
+        }
+        if (header.version != RECORDING_VERSION) {
+            GT_LOG_ERROR("Recording", "Recording has version %i, supported is %i", header.version, RECORDING_VERSION);
+            return false;
+        }
+        entity_system::JournalConfig journalConfig;
+        if (!entity_system::EnableJournal(world, &journalConfig)) {
+            GT_LOG_ERROR("Recording", "Failed to enable the change journal");
+            return false;
+        }
+
+        Replay* replay = GT_NEW(Replay, memoryArena);
+        replay->memoryArena = memoryArena;
+        replay->world = world;
+        replay->data = (const char*)data;
+        replay->size = size;
+        replay->offset = sizeof(RecordingHeader);
+        replay->numSteps = header.numSteps;
+        if (size - replay->offset < header.worldSize || !LoadReplayWorld(replay, replay->data + replay->offset, header.worldSize)) {
+            GT_LOG_ERROR("Recording", "Failed to load the initial world of the recording");
+            GT_DELETE(replay, memoryArena);
+            return false;
+        }
+        replay->offset += (size_t)header.worldSize;
+        *outReplay = replay;
+        return true;
+    }
+
+    bool BeginReplayStep(Replay* replay, StepInput* outInput)
+    {
+        if (replay->currentStep >= replay->numSteps) { return false; }
+
+        StepHeader step;
+        uint64_t worldSize = 0;
+        bool isComplete = ReadReplay(replay, &step, sizeof(StepHeader));
+        if (isComplete && (step.flags & STEP_INPUT_CHANGED)) {
+            isComplete = ReadReplay(replay, &replay->input, sizeof(StepInput));
+        }
+        if (isComplete && (step.flags & STEP_WORLD_RELOADED)) {
+            isComplete = ReadReplay(replay, &worldSize, sizeof(uint64_t)) && replay->size - replay->offset >= worldSize;
+        }
+        replay->stepWorld = replay->data + replay->offset;
+        replay->stepWorldSize = worldSize;
+        if (isComplete) {
+            replay->offset += (size_t)worldSize;
+            isComplete = replay->size - replay->offset >= step.deltaSize;
+        }
+        if (!isComplete) {
+            GT_LOG_ERROR("Recording", "Recording is truncated at step %llu", (unsigned long long)replay->currentStep);
+            return false;
+        }
+        replay->stepFlags = step.flags;
+        replay->stepDelta = replay->data + replay->offset;
+        replay->stepDeltaSize = step.deltaSize;
+        replay->offset += step.deltaSize;
+        replay->journalPosition = entity_system::GetJournalPosition(replay->world);
+        replay->isStepOpen = true;
+
+        if (outInput != nullptr) {
+            *outInput = replay->input;
+        }
+        return true;
+    }
+
+    // a world stored with the step replaces whatever the step did to the world before
+    static bool LoadStepWorld(Replay* replay)
+    {
+        if (!(replay->stepFlags & STEP_WORLD_RELOADED)) { return true; }
+        if (!LoadReplayWorld(replay, replay->stepWorld, replay->stepWorldSize)) {
+            GT_LOG_ERROR("Recording", "Failed to load the world of step %llu", (unsigned long long)replay->currentStep);
+            return false;
+        }
+        return true;
+    }
+
+    bool ApplyReplayStep(Replay* replay)
+    {
+        assert(replay->isStepOpen);
+        replay->isStepOpen = false;
+        bool success = LoadStepWorld(replay);
+        if (success && !entity_system::ApplyJournal(replay->world, replay->stepDelta, replay->stepDeltaSize)) {
+            GT_LOG_ERROR("Recording", "Failed to apply the changes of step %llu", (unsigned long long)replay->currentStep);
+            success = false;
+        }
+        replay->journalPosition = entity_system::GetJournalPosition(replay->world);
+        replay->currentStep++;
+        return success;
+    }
+
+    bool VerifyReplayStep(Replay* replay)
+    {
+        assert(replay->isStepOpen);
+        replay->isStepOpen = false;
+        uint64_t step = replay->currentStep++;
+        // @NOTE the world was loaded from outside the simulation while recording, there's nothing to compare
+        if (replay->stepFlags & STEP_WORLD_RELOADED) {
+            return LoadStepWorld(replay);
+        }
+
+        size_t deltaSize = 0;
+        if (!entity_system::SerializeJournal(replay->world, replay->journalPosition, nullptr, 0, &deltaSize, nullptr)) {
+            GT_LOG_ERROR("Recording", "Replay diverged at step %llu, the world was reloaded or changed more than the journal holds", (unsigned long long)step);
+            return false;
+        }
+        if (deltaSize > replay->verifyBufferSize) {
+            if (replay->verifyBuffer != nullptr) {
+                GT_DELETE_ARRAY(replay->verifyBuffer, replay->memoryArena);
+            }
+            replay->verifyBuffer = GT_NEW_ARRAY(char, deltaSize, replay->memoryArena);
+            replay->verifyBufferSize = deltaSize;
+        }
+        entity_system::SerializeJournal(replay->world, replay->journalPosition, replay->verifyBuffer, deltaSize, nullptr, &replay->journalPosition);
+        if (deltaSize != replay->stepDeltaSize || memcmp(replay->verifyBuffer, replay->stepDelta, deltaSize) != 0) {
+            GT_LOG_ERROR("Recording", "Replay diverged at step %llu, %llu bytes of changes were recorded and %llu made", (unsigned long long)step,
+                (unsigned long long)replay->stepDeltaSize, (unsigned long long)deltaSize);
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t GetNumReplaySteps(Replay* replay)
+    {
+        return replay->numSteps;
+    }
+
+    void CloseReplay(Replay* replay)
+    {
+        if (replay->verifyBuffer != nullptr) {
+            GT_DELETE_ARRAY(replay->verifyBuffer, replay->memoryArena);
+        }
+        GT_DELETE(replay, replay->memoryArena);
+    }
+}
+
+bool sim_recording_get_interface(sim_recording::SimRecordingInterface* interface)
+{
+    interface->BeginRecording = &sim_recording::BeginRecording;
+    interface->RecordStep = &sim_recording::RecordStep;
+    interface->GetRecordingSize = &sim_recording::GetRecordingSize;
+    interface->EndRecording = &sim_recording::EndRecording;
+    interface->OpenReplay = &sim_recording::OpenReplay;
+    interface->BeginReplayStep = &sim_recording::BeginReplayStep;
+    interface->ApplyReplayStep = &sim_recording::ApplyReplayStep;
+    interface->VerifyReplayStep = &sim_recording::VerifyReplayStep;
+    interface->GetNumReplaySteps = &sim_recording::GetNumReplaySteps;
+    interface->CloseReplay = &sim_recording::CloseReplay;
+    return true;
+}
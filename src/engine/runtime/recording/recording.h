@@ -0,0 +1,95 @@
+#pragma once
+
+#include <foundation/int_types.h>
+
+namespace fnd { namespace memory { class MemoryArenaBase; } }
+namespace entity_system { struct World; }
+
+#define SIM_RECORDING_API_NAME "sim_recording"
+
+namespace sim_recording
+{
+    // input that drove one fixed simulation step, laid out without padding so it can be compared bytewise
+    struct StepInput
+    {
+        double      dt = 0.0;
+        float       mousePos[2] = { 0.0f, 0.0f };
+        float       displaySize[2] = { 0.0f, 0.0f };
+        float       mouseWheel = 0.0f;
+        uint8_t     mouseButtons = 0;           // bit per mouse button
+        uint8_t     modifiers = 0;              // MODIFIER_* bits
+        uint16_t    reserved = 0;
+        uint16_t    inputChars[16] = {};        // zero terminated unless full
+        uint8_t     keysDown[64] = {};          // bit per key index
+    };
+
+    enum
+    {
+        MODIFIER_CTRL = 1 << 0,
+        MODIFIER_SHIFT = 1 << 1,
+        MODIFIER_ALT = 1 << 2,
+        MODIFIER_SUPER = 1 << 3
+    };
+
+    struct Recorder;
+    struct Replay;
+
+    struct RecordingConfig
+    {
+        const char* path = nullptr;             // file the recording is streamed to
+        uint32_t    flushSize = 1 << 20;        // bytes buffered before they're written to the file
+    };
+
+    /**
+        Records a session as the serialized world at the start plus, for every simulation step, its input and the
+        entity changes made during it. Changes are taken from the world's change journal, which is enabled if it
+        isn't already, so only changes made through the entity system functions are captured.
+        The recording is written to config->path as it goes, so memory use stays at about flushSize no matter how
+        long the session runs, except for steps that have to store a whole world.
+    */
+    bool BeginRecording(Recorder** outRecorder, fnd::memory::MemoryArenaBase* memoryArena, entity_system::World* world, const RecordingConfig* config);
+    // call once per simulation step, after everything that changes the world has run
+    bool RecordStep(Recorder* recorder, const StepInput* input);
+    // bytes recorded so far, including those not written to the file yet
+    uint64_t GetRecordingSize(Recorder* recorder);
+    // writes the rest of the recording, returns false if any of it couldn't be written
+    bool EndRecording(Recorder* recorder);
+
+    /**
+        A recording can be used in two ways, both start every step with BeginReplayStep:
+        - playback applies the recorded changes with ApplyReplayStep, no simulation has to run
+        - replay runs the simulation with the recorded input and checks with VerifyReplayStep that it made the
+          same changes as the recorded session, the world then stays exactly as the simulation left it
+    */
+    // loads the world a recording starts with into world, data has to stay valid until the replay is closed.
+    // the world's change journal is enabled, VerifyReplayStep reads the simulation's changes from it
+    bool OpenReplay(Replay** outReplay, fnd::memory::MemoryArenaBase* memoryArena, const void* data, size_t size, entity_system::World* world);
+    // reads the next step and returns its input, returns false after the last step or on corrupted data
+    bool BeginReplayStep(Replay* replay, StepInput* outInput);
+    // playback, applies the recorded changes of the current step to the world
+    bool ApplyReplayStep(Replay* replay);
+    // replay, compares the changes made since BeginReplayStep with the recorded ones. returns false if they differ,
+    // the world has diverged from the recorded session then and the following steps can't be verified anymore
+    bool VerifyReplayStep(Replay* replay);
+    uint64_t GetNumReplaySteps(Replay* replay);
+    void CloseReplay(Replay* replay);
+
+    struct SimRecordingInterface
+    {
+        decltype(sim_recording::BeginRecording)* BeginRecording = nullptr;
+        decltype(sim_recording::RecordStep)* RecordStep = nullptr;
+        decltype(sim_recording::GetRecordingSize)* GetRecordingSize = nullptr;
+        decltype(sim_recording::EndRecording)* EndRecording = nullptr;
+        decltype(sim_recording::OpenReplay)* OpenReplay = nullptr;
+        decltype(sim_recording::BeginReplayStep)* BeginReplayStep = nullptr;
+        decltype(sim_recording::ApplyReplayStep)* ApplyReplayStep = nullptr;
+        decltype(sim_recording::VerifyReplayStep)* VerifyReplayStep = nullptr;
+        decltype(sim_recording::GetNumReplaySteps)* GetNumReplaySteps = nullptr;
+        decltype(sim_recording::CloseReplay)* CloseReplay = nullptr;
+    };
+}
+
+extern "C"
+{
+    GT_DLL_EXPORT bool sim_recording_get_interface(sim_recording::SimRecordingInterface* interface);
+}
@@ -0,0 +1,498 @@
+#include "render_graph.h"
+#include <foundation/memory/memory.h>
+#include <foundation/logging/logging.h>
+#include <cassert>
+#include <string.h>
+
+#define NO_IMAGE 0xffffffff
+#define NO_PASS 0xffffffff
+
+namespace renderer
+{
+    enum class GraphImageType : uint8_t
+    {
+        IMAGE_TRANSIENT,
+        IMAGE_IMPORTED,
+        IMAGE_SWAP_CHAIN
+    };
+
+    struct GraphImage
+    {
+        const char*         name = "";
+        GraphImageType      type = GraphImageType::IMAGE_TRANSIENT;
+        TransientImageDesc  desc;
+        gfx::Image          image;          // for transients assigned when the graph is compiled
+        gfx::SwapChain      swapChain;
+
+        // positions in the execution order of the first and last pass using the image
+        uint32_t            firstUse = NO_PASS;
+        uint32_t            lastUse = 0;
+        uint32_t            lastWriter = NO_PASS;   // while compiling, pass index
+    };
+
+    struct GraphPass
+    {
+        const char*         name = "";
+        ExecutePassFunc     execute = nullptr;
+        void*               userData = nullptr;
+
+        uint32_t            reads[GFX_MAX_IMAGE_INPUTS_PER_STAGE];
+        uint32_t            numReads = 0;
+        uint32_t            colorWrites[GFX_MAX_COLOR_ATTACHMENTS];
+        uint32_t            numColorWrites = 0;
+        uint32_t            depthWrite = NO_IMAGE;
+        gfx::RenderPassAction action;
+
+        uint64_t            dependencies = 0;       // bit per pass whose output this one reads
+        bool                isCulled = false;
+    };
+
+    struct PooledImage
+    {
+        TransientImageDesc  desc;
+        gfx::Image          image;
+        uint32_t            busyUntil = 0;          // last execution position using it this frame, +1
+    };
+
+    struct CachedRenderPass
+    {
+        uint32_t            colors[GFX_MAX_COLOR_ATTACHMENTS];
+        uint32_t            depth = gfx::INVALID_ID;
+        gfx::RenderPass     pass;
+    };
+
+    /**
+        Pooled images and the render passes created for them live as long as the graph. Frames usually declare
+        the same images, so after the first frame nothing is created anymore.
+    */
+    struct RenderGraph
+    {
+        fnd::memory::MemoryArenaBase*   memoryArena = nullptr;
+        gfx::Device*                    device = nullptr;
+        gfx::SamplerDesc                samplerDesc;
+
+        GraphPass           passes[RENDER_GRAPH_MAX_PASSES];
+        uint32_t            numPasses = 0;
+        GraphImage          images[RENDER_GRAPH_MAX_IMAGES];
+        uint32_t            numImages = 0;
+
+        uint32_t            executionOrder[RENDER_GRAPH_MAX_PASSES];
+        uint32_t            numExecutedPasses = 0;
+
+        PooledImage         pool[RENDER_GRAPH_MAX_POOLED_IMAGES];
+        uint32_t            numPooledImages = 0;
+        CachedRenderPass    renderPasses[RENDER_GRAPH_MAX_RENDER_PASSES];
+        uint32_t            numRenderPasses = 0;
+
+        RenderGraphStats    stats;
+        bool                isCompiled = false;
+        bool                hasErrors = false;
+    };
+
+    bool CreateRenderGraph(RenderGraph** outGraph, fnd::memory::MemoryArenaBase* memoryArena, gfx::Device* device, gfx::SamplerDesc* samplerDesc)
+    {
+        RenderGraph* graph = GT_NEW(RenderGraph, memoryArena);
+        graph->memoryArena = memoryArena;
+        graph->device = device;
+        if (samplerDesc != nullptr) {
+            graph->samplerDesc = *samplerDesc;
+        }
+        *outGraph = graph;
+        return true;
+    }
+
+    void DestroyRenderGraph(RenderGraph* graph)
+    {
+        for (uint32_t i = 0; i < graph->numPooledImages; ++i) {
+            gfx::DestroyImage(graph->device, graph->pool[i].image);
+        }
+        GT_DELETE(graph, graph->memoryArena);
+    }
+
+    void BeginRenderGraph(RenderGraph* graph)
+    {
+        graph->numPasses = 0;
+        graph->numImages = 0;
+        graph->numExecutedPasses = 0;
+        graph->isCompiled = false;
+        graph->hasErrors = false;
+    }
+
+    static GraphImage* GetGraphImage(RenderGraph* graph, RenderGraphImage image)
+    {
+        if (image.id == gfx::INVALID_ID || image.id > graph->numImages) { return nullptr; }
+        return &graph->images[image.id - 1];
+    }
+
+    static GraphPass* GetGraphPass(RenderGraph* graph, RenderGraphPass pass)
+    {
+        if (pass.id == gfx::INVALID_ID || pass.id > graph->numPasses) { return nullptr; }
+        return &graph->passes[pass.id - 1];
+    }
+
+    static RenderGraphImage AddImage(RenderGraph* graph, const char* name, GraphImageType type)
+    {
+        if (graph->numImages >= RENDER_GRAPH_MAX_IMAGES) {
+            GT_LOG_ERROR("Renderer", "Render graph can't hold more than %i images, dropping %s", RENDER_GRAPH_MAX_IMAGES, name);
+            graph->hasErrors = true;
+            return { gfx::INVALID_ID };
+        }
+        GraphImage* image = &graph->images[graph->numImages++];
+        *image = GraphImage();
+        image->name = name;
+        image->type = type;
+        return { graph->numImages };
+    }
+
+    RenderGraphImage ImportImage(RenderGraph* graph, const char* name, gfx::Image image)
+    {
+        RenderGraphImage result = AddImage(graph, name, GraphImageType::IMAGE_IMPORTED);
+        if (result.id != gfx::INVALID_ID) {
+            GetGraphImage(graph, result)->image = image;
+        }
+        return result;
+    }
+
+    RenderGraphImage ImportSwapChain(RenderGraph* graph, const char* name, gfx::SwapChain swapChain)
+    {
+        RenderGraphImage result = AddImage(graph, name, GraphImageType::IMAGE_SWAP_CHAIN);
+        if (result.id != gfx::INVALID_ID) {
+            GetGraphImage(graph, result)->swapChain = swapChain;
+        }
+        return result;
+    }
+
+    RenderGraphImage CreateTransientImage(RenderGraph* graph, const char* name, TransientImageDesc* desc)
+    {
+        RenderGraphImage result = AddImage(graph, name, GraphImageType::IMAGE_TRANSIENT);
+        if (result.id != gfx::INVALID_ID) {
+            GetGraphImage(graph, result)->desc = *desc;
+        }
+        return result;
+    }
+
+    RenderGraphPass AddPass(RenderGraph* graph, const char* name, ExecutePassFunc execute, void* userData)
+    {
+        if (graph->numPasses >= RENDER_GRAPH_MAX_PASSES) {
+            GT_LOG_ERROR("Renderer", "Render graph can't hold more than %i passes, dropping %s", RENDER_GRAPH_MAX_PASSES, name);
+            graph->hasErrors = true;
+            return { gfx::INVALID_ID };
+        }
+        GraphPass* pass = &graph->passes[graph->numPasses++];
+        *pass = GraphPass();
+        pass->name = name;
+        pass->execute = execute;
+        pass->userData = userData;
+        return { graph->numPasses };
+    }
+
+    void ReadImage(RenderGraph* graph, RenderGraphPass pass, RenderGraphImage image)
+    {
+        GraphPass* graphPass = GetGraphPass(graph, pass);
+        GraphImage* graphImage = GetGraphImage(graph, image);
+        if (graphPass == nullptr || graphImage == nullptr) {
+            graph->hasErrors = true;
+            return;
+        }
+        if (graphImage->type == GraphImageType::IMAGE_SWAP_CHAIN || graphPass->numReads >= GFX_MAX_IMAGE_INPUTS_PER_STAGE) {
+            GT_LOG_ERROR("Renderer", "Pass %s can't read image %s", graphPass->name, graphImage->name);
+            graph->hasErrors = true;
+            return;
+        }
+        graphPass->reads[graphPass->numReads++] = image.id - 1;
+    }
+
+    void WriteColor(RenderGraph* graph, RenderGraphPass pass, RenderGraphImage image, gfx::ColorAttachmentAction* action)
+    {
+        GraphPass* graphPass = GetGraphPass(graph, pass);
+        GraphImage* graphImage = GetGraphImage(graph, image);
+        if (graphPass == nullptr || graphImage == nullptr) {
+            graph->hasErrors = true;
+            return;
+        }
+        if (graphImage->desc.isDepthStencilTarget || graphPass->numColorWrites >= GFX_MAX_COLOR_ATTACHMENTS) {
+            GT_LOG_ERROR("Renderer", "Pass %s can't write image %s as color attachment", graphPass->name, graphImage->name);
+            graph->hasErrors = true;
+            return;
+        }
+        graphPass->action.colors[graphPass->numColorWrites] = *action;
+        graphPass->colorWrites[graphPass->numColorWrites++] = image.id - 1;
+    }
+
+    void WriteDepthStencil(RenderGraph* graph, RenderGraphPass pass, RenderGraphImage image, gfx::DepthAttachmentAction* depthAction, gfx::StencilAttachmentAction* stencilAction)
+    {
+        GraphPass* graphPass = GetGraphPass(graph, pass);
+        GraphImage* graphImage = GetGraphImage(graph, image);
+        if (graphPass == nullptr || graphImage == nullptr) {
+            graph->hasErrors = true;
+            return;
+        }
+        if (graphImage->type == GraphImageType::IMAGE_SWAP_CHAIN || graphPass->depthWrite != NO_IMAGE) {
+            GT_LOG_ERROR("Renderer", "Pass %s can't write image %s as depth stencil attachment", graphPass->name, graphImage->name);
+            graph->hasErrors = true;
+            return;
+        }
+        if (depthAction != nullptr) {
+            graphPass->action.depth = *depthAction;
+        }
+        if (stencilAction != nullptr) {
+            graphPass->action.stencil = *stencilAction;
+        }
+        graphPass->depthWrite = image.id - 1;
+    }
+
+    static bool LoadsContents(gfx::Action action)
+    {
+        return action != gfx::Action::ACTION_CLEAR && action != gfx::Action::ACTION_DONTCARE;
+    }
+
+    static uint64_t GetImageSize(const TransientImageDesc* desc)
+    {
+        uint64_t bytesPerPixel = 0;
+        switch (desc->pixelFormat) {
+        case gfx::PixelFormat::PIXEL_FORMAT_R8G8B8A8_UNORM:
+        case gfx::PixelFormat::PIXEL_FORMAT_R8G8B8A8_UINT: bytesPerPixel = 4; break;
+        case gfx::PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT:
+        case gfx::PixelFormat::PIXEL_FORMAT_R16G16B16A16_UINT:
+        case gfx::PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT: bytesPerPixel = 8; break;
+        case gfx::PixelFormat::PIXEL_FORMAT_R32G32B32A32_FLOAT: bytesPerPixel = 16; break;
+        default: break;
+        }
+        return (uint64_t)desc->width * (uint64_t)desc->height * bytesPerPixel;
+    }
+
+    static bool IsCompatible(const TransientImageDesc* a, const TransientImageDesc* b)
+    {
+        return a->width == b->width && a->height == b->height && a->pixelFormat == b->pixelFormat
+            && a->isDepthStencilTarget == b->isDepthStencilTarget;
+    }
+
+    static PooledImage* AcquirePooledImage(RenderGraph* graph, const TransientImageDesc* desc, uint32_t firstUse)
+    {
+        for (uint32_t i = 0; i < graph->numPooledImages; ++i) {
+            PooledImage* pooled = &graph->pool[i];
+            if (pooled->busyUntil <= firstUse && IsCompatible(&pooled->desc, desc)) {
+                return pooled;
+            }
+        }
+        if (graph->numPooledImages >= RENDER_GRAPH_MAX_POOLED_IMAGES) {
+            GT_LOG_ERROR("Renderer", "Render graph image pool is full");
+            return nullptr;
+        }
+
+        gfx::ImageDesc imageDesc;
+        imageDesc.type = gfx::ImageType::IMAGE_TYPE_2D;
+        imageDesc.isRenderTarget = !desc->isDepthStencilTarget;
+        imageDesc.isDepthStencilTarget = desc->isDepthStencilTarget;
+        imageDesc.width = desc->width;
+        imageDesc.height = desc->height;
+        imageDesc.pixelFormat = desc->pixelFormat;
+        imageDesc.samplerDesc = &graph->samplerDesc;
+        gfx::Image image = gfx::CreateImage(graph->device, &imageDesc);
+        if (!GFX_CHECK_RESOURCE(image)) {
+            GT_LOG_ERROR("Renderer", "Failed to create render graph image");
+            return nullptr;
+        }
+        PooledImage* pooled = &graph->pool[graph->numPooledImages++];
+        pooled->desc = *desc;
+        pooled->image = image;
+        pooled->busyUntil = 0;
+        return pooled;
+    }
+
+    bool CompileRenderGraph(RenderGraph* graph)
+    {
+        graph->isCompiled = false;
+        if (graph->hasErrors) { return false; }
+
+        for (uint32_t i = 0; i < graph->numImages; ++i) {
+            graph->images[i].firstUse = NO_PASS;
+            graph->images[i].lastUse = 0;
+            graph->images[i].lastWriter = NO_PASS;
+            if (graph->images[i].type == GraphImageType::IMAGE_TRANSIENT) {
+                graph->images[i].image.id = gfx::INVALID_ID;
+            }
+        }
+
+        // data dependencies, passes can only read what passes declared before them wrote
+        uint64_t keep = 0;
+        for (uint32_t p = 0; p < graph->numPasses; ++p) {
+            GraphPass* pass = &graph->passes[p];
+            pass->dependencies = 0;
+            for (uint32_t i = 0; i < pass->numReads; ++i) {
+                GraphImage* image = &graph->images[pass->reads[i]];
+                if (image->lastWriter != NO_PASS) {
+                    pass->dependencies |= 1ull << image->lastWriter;
+                }
+                else if (image->type == GraphImageType::IMAGE_TRANSIENT) {
+                    GT_LOG_ERROR("Renderer", "Pass %s reads image %s before anything writes it", pass->name, image->name);
+                    return false;
+                }
+            }
+
+            bool writesSwapChain = false;
+            for (uint32_t i = 0; i < pass->numColorWrites + 1; ++i) {
+                uint32_t index = i < pass->numColorWrites ? pass->colorWrites[i] : pass->depthWrite;
+                if (index == NO_IMAGE) { continue; }
+                GraphImage* image = &graph->images[index];
+                gfx::Action action = i < pass->numColorWrites ? pass->action.colors[i].action : pass->action.depth.action;
+                for (uint32_t r = 0; r < pass->numReads; ++r) {
+                    if (pass->reads[r] == index) {
+                        GT_LOG_ERROR("Renderer", "Pass %s reads and writes image %s", pass->name, image->name);
+                        return false;
+                    }
+                }
+                if (LoadsContents(action) && image->lastWriter != NO_PASS) {
+                    pass->dependencies |= 1ull << image->lastWriter;
+                }
+                if (image->type != GraphImageType::IMAGE_TRANSIENT) {
+                    keep |= 1ull << p;
+                }
+                writesSwapChain |= image->type == GraphImageType::IMAGE_SWAP_CHAIN;
+                image->lastWriter = p;
+            }
+            if (writesSwapChain && (pass->numColorWrites > 1 || pass->depthWrite != NO_IMAGE)) {
+                GT_LOG_ERROR("Renderer", "Pass %s writes a swap chain together with other images", pass->name);
+                return false;
+            }
+        }
+
+        // walking backwards visits every pass after all passes depending on it
+        for (uint32_t p = graph->numPasses; p-- > 0;) {
+            if (keep & (1ull << p)) {
+                keep |= graph->passes[p].dependencies;
+            }
+        }
+
+        graph->numExecutedPasses = 0;
+        for (uint32_t p = 0; p < graph->numPasses; ++p) {
+            GraphPass* pass = &graph->passes[p];
+            pass->isCulled = (keep & (1ull << p)) == 0;
+            if (pass->isCulled) { continue; }
+
+            uint32_t position = graph->numExecutedPasses++;
+            graph->executionOrder[position] = p;
+            for (uint32_t i = 0; i < pass->numReads + pass->numColorWrites + 1; ++i) {
+                uint32_t index = i < pass->numReads ? pass->reads[i]
+                    : i < pass->numReads + pass->numColorWrites ? pass->colorWrites[i - pass->numReads]
+                    : pass->depthWrite;
+                if (index == NO_IMAGE) { continue; }
+                GraphImage* image = &graph->images[index];
+                image->firstUse = image->firstUse < position ? image->firstUse : position;
+                image->lastUse = image->lastUse > position ? image->lastUse : position;
+            }
+        }
+
+        RenderGraphStats* stats = &graph->stats;
+        *stats = RenderGraphStats();
+        stats->numPasses = graph->numPasses;
+        stats->numPassesCulled = graph->numPasses - graph->numExecutedPasses;
+
+        // assign pooled images in order of first use, an image is free again once the last pass using it ran
+        for (uint32_t i = 0; i < graph->numPooledImages; ++i) {
+            graph->pool[i].busyUntil = 0;
+        }
+        bool isPooledImageUsed[RENDER_GRAPH_MAX_POOLED_IMAGES] = {};
+        for (uint32_t position = 0; position < graph->numExecutedPasses; ++position) {
+            for (uint32_t i = 0; i < graph->numImages; ++i) {
+                GraphImage* image = &graph->images[i];
+                if (image->type != GraphImageType::IMAGE_TRANSIENT || image->firstUse != position) { continue; }
+                PooledImage* pooled = AcquirePooledImage(graph, &image->desc, position);
+                if (pooled == nullptr) { return false; }
+                pooled->busyUntil = image->lastUse + 1;
+                image->image = pooled->image;
+
+                stats->numTransientImages++;
+                stats->transientBytes += GetImageSize(&image->desc);
+                size_t pooledIndex = (size_t)(pooled - graph->pool);
+                if (!isPooledImageUsed[pooledIndex]) {
+                    isPooledImageUsed[pooledIndex] = true;
+                    stats->numPhysicalImages++;
+                    stats->physicalBytes += GetImageSize(&pooled->desc);
+                }
+            }
+        }
+
+        graph->isCompiled = true;
+        return true;
+    }
+
+    static gfx::RenderPass GetRenderPass(RenderGraph* graph, GraphPass* pass)
+    {
+        CachedRenderPass key;
+        memset(key.colors, 0x0, sizeof(key.colors));
+        for (uint32_t i = 0; i < pass->numColorWrites; ++i) {
+            key.colors[i] = graph->images[pass->colorWrites[i]].image.id;
+        }
+        key.depth = pass->depthWrite != NO_IMAGE ? graph->images[pass->depthWrite].image.id : (uint32_t)gfx::INVALID_ID;
+
+        for (uint32_t i = 0; i < graph->numRenderPasses; ++i) {
+            CachedRenderPass* cached = &graph->renderPasses[i];
+            if (cached->depth == key.depth && memcmp(cached->colors, key.colors, sizeof(key.colors)) == 0) {
+                return cached->pass;
+            }
+        }
+        if (graph->numRenderPasses >= RENDER_GRAPH_MAX_RENDER_PASSES) {
+            GT_LOG_ERROR("Renderer", "Render graph render pass cache is full");
+            return { gfx::INVALID_ID };
+        }
+
+        gfx::RenderPassDesc desc;
+        for (uint32_t i = 0; i < pass->numColorWrites; ++i) {
+            desc.colorAttachments[i].image.id = key.colors[i];
+        }
+        desc.depthStencilAttachment.image.id = key.depth;
+        key.pass = gfx::CreateRenderPass(graph->device, &desc);
+        if (!GFX_CHECK_RESOURCE(key.pass)) {
+            GT_LOG_ERROR("Renderer", "Failed to create render pass for %s", pass->name);
+            return { gfx::INVALID_ID };
+        }
+        graph->renderPasses[graph->numRenderPasses++] = key;
+        return key.pass;
+    }
+
+    void ExecuteRenderGraph(RenderGraph* graph, gfx::CommandBuffer commandBuffer)
+    {
+        assert(graph->isCompiled);
+        if (!graph->isCompiled) { return; }
+
+        RenderGraphContext context;
+        context.graph = graph;
+        context.device = graph->device;
+        context.commandBuffer = commandBuffer;
+
+        for (uint32_t position = 0; position < graph->numExecutedPasses; ++position) {
+            GraphPass* pass = &graph->passes[graph->executionOrder[position]];
+            bool hasRenderPass = pass->numColorWrites > 0 || pass->depthWrite != NO_IMAGE;
+            if (hasRenderPass) {
+                GraphImage* first = pass->numColorWrites > 0 ? &graph->images[pass->colorWrites[0]] : nullptr;
+                if (first != nullptr && first->type == GraphImageType::IMAGE_SWAP_CHAIN) {
+                    gfx::BeginDefaultRenderPass(graph->device, commandBuffer, first->swapChain, &pass->action);
+                }
+                else {
+                    gfx::RenderPass renderPass = GetRenderPass(graph, pass);
+                    if (!GFX_CHECK_RESOURCE(renderPass)) { continue; }
+                    gfx::BeginRenderPass(graph->device, commandBuffer, renderPass, &pass->action);
+                }
+            }
+            if (pass->execute != nullptr) {
+                pass->execute(&context, pass->userData);
+            }
+            if (hasRenderPass) {
+                gfx::EndRenderPass(graph->device, commandBuffer);
+            }
+        }
+    }
+
+    gfx::Image GetImage(RenderGraph* graph, RenderGraphImage image)
+    {
+        GraphImage* graphImage = GetGraphImage(graph, image);
+        if (graphImage == nullptr) { return { gfx::INVALID_ID }; }
+        return graphImage->image;
+    }
+
+    void GetRenderGraphStats(RenderGraph* graph, RenderGraphStats* outStats)
+    {
+        *outStats = graph->stats;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <engine/runtime/gfx/gfx.h>
+
+namespace fnd { namespace memory { class MemoryArenaBase; } }
+
+#define RENDER_GRAPH_MAX_PASSES         64
+#define RENDER_GRAPH_MAX_IMAGES         64
+#define RENDER_GRAPH_MAX_POOLED_IMAGES  64
+#define RENDER_GRAPH_MAX_RENDER_PASSES  128
+
+namespace renderer
+{
+    /**
+        Render graph for one frame. Every frame the passes are declared together with the images they read and
+        write, then the graph is compiled: passes whose output never reaches an imported image are culled and every
+        transient image is assigned a physical image from a pool, shared with other transients whose lifetimes don't
+        overlap. Passes run in the order they were declared, which is always a valid order since a pass can only
+        depend on passes declared before it.
+
+        Imported images (the swap chain, images written outside the graph) are never aliased, and passes writing them
+        are always kept.
+    */
+    struct RenderGraph;
+
+    // only valid for the frame they were declared in
+    typedef struct { uint32_t id = gfx::INVALID_ID; } RenderGraphImage;
+    typedef struct { uint32_t id = gfx::INVALID_ID; } RenderGraphPass;
+
+    struct TransientImageDesc
+    {
+        uint16_t            width = 0;
+        uint16_t            height = 0;
+        gfx::PixelFormat    pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT;
+        bool                isDepthStencilTarget = false;
+    };
+
+    struct RenderGraphContext
+    {
+        RenderGraph*        graph = nullptr;
+        gfx::Device*        device = nullptr;
+        gfx::CommandBuffer  commandBuffer;
+    };
+
+    // called between begin and end of the pass' render pass
+    typedef void(*ExecutePassFunc)(RenderGraphContext* context, void* userData);
+
+    struct RenderGraphStats
+    {
+        uint32_t    numPasses = 0;
+        uint32_t    numPassesCulled = 0;
+        uint32_t    numTransientImages = 0;     // transients used by passes that weren't culled
+        uint32_t    numPhysicalImages = 0;      // pooled images they were assigned to
+        uint64_t    transientBytes = 0;         // memory the transients would take without aliasing
+        uint64_t    physicalBytes = 0;
+    };
+
+    // samplerDesc is used for all pooled images
+    bool CreateRenderGraph(RenderGraph** outGraph, fnd::memory::MemoryArenaBase* memoryArena, gfx::Device* device, gfx::SamplerDesc* samplerDesc);
+    void DestroyRenderGraph(RenderGraph* graph);
+
+    // clears all passes and images of the previous frame, pooled images are kept
+    void BeginRenderGraph(RenderGraph* graph);
+
+    RenderGraphImage ImportImage(RenderGraph* graph, const char* name, gfx::Image image);
+    // the back buffer of a swap chain, it can only be written and only as the sole attachment of a pass
+    RenderGraphImage ImportSwapChain(RenderGraph* graph, const char* name, gfx::SwapChain swapChain);
+    RenderGraphImage CreateTransientImage(RenderGraph* graph, const char* name, TransientImageDesc* desc);
+
+    RenderGraphPass AddPass(RenderGraph* graph, const char* name, ExecutePassFunc execute, void* userData);
+    void ReadImage(RenderGraph* graph, RenderGraphPass pass, RenderGraphImage image);
+    // attachments are assigned in the order they are added, ACTION_LOAD makes the pass depend on the previous writer
+    void WriteColor(RenderGraph* graph, RenderGraphPass pass, RenderGraphImage image, gfx::ColorAttachmentAction* action);
+    void WriteDepthStencil(RenderGraph* graph, RenderGraphPass pass, RenderGraphImage image, gfx::DepthAttachmentAction* depthAction, gfx::StencilAttachmentAction* stencilAction);
+
+    // culls passes and assigns physical images, returns false if the graph is malformed
+    bool CompileRenderGraph(RenderGraph* graph);
+    void ExecuteRenderGraph(RenderGraph* graph, gfx::CommandBuffer commandBuffer);
+
+    // physical image of a graph image, only valid after the graph was compiled
+    gfx::Image GetImage(RenderGraph* graph, RenderGraphImage image);
+    void GetRenderGraphStats(RenderGraph* graph, RenderGraphStats* outStats);
+}
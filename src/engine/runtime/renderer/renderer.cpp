@@ -1,4 +1,7 @@
 #include "renderer.h"
+#include "render_graph.h"
+#include "texture_streaming.h"
+#include <engine/runtime/spatial/spatial.h>
 #include <foundation/memory/memory.h>
 #include <foundation/logging/logging.h>
 #include <foundation/math/math.h>
@@ -9,7 +12,9 @@
 #include <stb/stb_image.h>
 
 #include <engine/runtime/ImGui/imgui.h>
+#ifdef _MSC_VER
 #include <engine/runtime/win32/imgui_impl_dx11.h>
+#endif
 #include <math.h>
 
 #ifdef _MSC_VER
@@ -18,6 +23,9 @@
 #include <Windows.h>
 #undef near
 #undef far
+#else
+#include <time.h>
+#include <stdio.h>
 #endif
 
 // @NOTE include AFTER windows.h because of ARRAYSIZE 
@@ -38,6 +46,7 @@
 
 static void* LoadFileContents(const char* path, fnd::memory::MemoryArenaBase* memoryArena, size_t* fileSize = nullptr)
 {
+#ifdef _MSC_VER
     HANDLE handle = CreateFileA(path, GENERIC_READ, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     if (!handle) {
         GT_LOG_ERROR("FileSystem", "Failed to load %s\n", path);
@@ -55,6 +64,43 @@ static void* LoadFileContents(const char* path, fnd::memory::MemoryArenaBase* me
     if (fileSize) { *fileSize = bytesRead; }
     CloseHandle(handle);
     return buffer;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        GT_LOG_ERROR("FileSystem", "Failed to load %s\n", path);
+        return nullptr;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    void* buffer = memoryArena->Allocate(size, 16, GT_SOURCE_INFO);
+    size_t bytesRead = fread(buffer, 1, size, file);
+    fclose(file);
+    if (bytesRead != size) {
+        GT_LOG_ERROR("FileSystem", "Failed to read %s\n", path);
+        memoryArena->Free(buffer);
+        return nullptr;
+    }
+    if (fileSize) { *fileSize = bytesRead; }
+    return buffer;
+#endif
+}
+
+// @NOTE the linux backends never run the HLSL bytecode, without the compiled shaders around the file name stands in for it
+static void* LoadShaderCode(const char* path, fnd::memory::MemoryArenaBase* memoryArena, size_t* codeSize)
+{
+#ifndef _MSC_VER
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        size_t size = strlen(path) + 1;
+        char* code = static_cast<char*>(memoryArena->Allocate(size, 16, GT_SOURCE_INFO));
+        memcpy(code, path, size);
+        *codeSize = size;
+        return code;
+    }
+    fclose(file);
+#endif
+    return LoadFileContents(path, memoryArena, codeSize);
 }
 
 
@@ -143,9 +189,14 @@ namespace renderer
         uint32_t    numVertexBuffers = 0;
         gfx::Buffer vertexBuffers[GFX_MAX_VERTEX_STREAMS];
         gfx::Buffer indexBuffer;
+        gfx::BindGroup bindGroup;
 
         uint32_t    numElements = 0;
 
+        // object space bounds of the vertex positions
+        float       boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+        float       boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+
         core::Asset asset;
 
         MeshData*   nextSubmesh = nullptr;
@@ -161,6 +212,7 @@ namespace renderer
 
         gfx::ImageDesc  desc;
         gfx::Image      image;
+        StreamedTexture* streamed = nullptr;    // if the render world streams textures
     };
 
     struct MaterialData
@@ -174,6 +226,8 @@ namespace renderer
         TextureData*    metalnessMap    = nullptr;
         TextureData*    normalVecMap    = nullptr;
         TextureData*    occlusionMap    = nullptr;
+
+        gfx::BindGroup  bindGroup;
     };
 
     template <class TData>
@@ -183,11 +237,21 @@ namespace renderer
         TData*      data = nullptr;
     };
 
+    /**
+        The asset tables of the libraries are open addressing hash tables with linear probing, keyed by asset id.
+        Empty slots have key 0 (no asset has that id), removed ones ASSET_TABLE_TOMBSTONE so that probing continues
+        past them. Capacity is a power of two and the table is rebuilt before empty slots drop below a quarter.
+    */
+    static const uint32_t ASSET_TABLE_TOMBSTONE = 0xffffffff;
+
     struct MeshLibrary
     {
         ResourcePool<MeshData>  pool;
         AssetToData<MeshData>*  assetTable = nullptr;
         size_t                  assetTableSize = 0;
+        size_t                  numAssets = 0;
+        size_t                  numTombstones = 0;
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
     };
 
     struct TextureLibrary
@@ -195,6 +259,9 @@ namespace renderer
         ResourcePool<TextureData>   pool;
         AssetToData<TextureData>*   assetTable = nullptr;
         size_t                      assetTableSize = 0;
+        size_t                      numAssets = 0;
+        size_t                      numTombstones = 0;
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
     };
 
     struct MaterialLibrary
@@ -202,60 +269,244 @@ namespace renderer
         ResourcePool<MaterialData>  pool;
         AssetToData<MaterialData>*  assetTable = nullptr;
         size_t                      assetTableSize = 0;
+        size_t                      numAssets = 0;
+        size_t                      numTombstones = 0;
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
     };
 
+    static size_t HashAsset(core::Asset asset, size_t tableSize)
+    {
+        // asset ids are mostly sequential, mix them so that neighbours don't form long runs
+        uint32_t h = asset.id;
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return (size_t)h & (tableSize - 1);
+    }
+
+    // slot holding key, or nullptr if the asset isn't in the table
     template <class TLibrary, class TResource>
-    TResource* LookupResource(TLibrary* lib, core::Asset key)
+    AssetToData<TResource>* FindAsset(TLibrary* lib, core::Asset key)
     {
-        for (size_t i = 0; i < lib->assetTableSize; ++i) {
-            if (lib->assetTable[i].key == key) {
-                return lib->assetTable[i].data;
-            }
+        if (key.id == 0 || key.id == ASSET_TABLE_TOMBSTONE) { return nullptr; }
+        size_t mask = lib->assetTableSize - 1;
+        for (size_t i = HashAsset(key, lib->assetTableSize), n = 0; n < lib->assetTableSize; i = (i + 1) & mask, ++n) {
+            AssetToData<TResource>* slot = &lib->assetTable[i];
+            if (slot->key.id == key.id) { return slot; }
+            if (slot->key.id == 0) { return nullptr; }
         }
         return nullptr;
     }
 
+    template <class TLibrary, class TResource>
+    TResource* LookupResource(TLibrary* lib, core::Asset key)
+    {
+        AssetToData<TResource>* slot = FindAsset<TLibrary, TResource>(lib, key);
+        return slot != nullptr ? slot->data : nullptr;
+    }
+
+    template <class TLibrary, class TResource>
+    void AllocateAssetTable(TLibrary* lib, size_t minSize)
+    {
+        size_t tableSize = 16;
+        while (tableSize < minSize) {
+            tableSize *= 2;
+        }
+        lib->assetTable = GT_NEW_ARRAY(AssetToData<TResource>, tableSize, lib->memoryArena);
+        lib->assetTableSize = tableSize;
+        lib->numAssets = 0;
+        lib->numTombstones = 0;
+    }
+
     template <class TLibrary, class TResource>
     void InitializeResourceLibrary(TLibrary* lib, fnd::memory::MemoryArenaBase* memoryArena, size_t poolSize)
     {
         lib->pool.Initialize((uint32_t)poolSize, memoryArena);
-        lib->assetTable = GT_NEW_ARRAY(AssetToData<TResource>, poolSize, memoryArena);
-        lib->assetTableSize = poolSize;
+        lib->memoryArena = memoryArena;
+        // one asset per pool entry at most keeps the table at least half empty
+        AllocateAssetTable<TLibrary, TResource>(lib, poolSize * 2);
     }
 
+    // reinserts all assets into a table with room for numAssets more, dropping tombstones
+    template <class TLibrary, class TResource>
+    void RebuildAssetTable(TLibrary* lib, size_t numAssets)
+    {
+        AssetToData<TResource>* oldTable = lib->assetTable;
+        size_t oldTableSize = lib->assetTableSize;
+        AllocateAssetTable<TLibrary, TResource>(lib, (lib->numAssets + numAssets) * 2);
+        size_t mask = lib->assetTableSize - 1;
+        for (size_t i = 0; i < oldTableSize; ++i) {
+            core::Asset key = oldTable[i].key;
+            if (key.id == 0 || key.id == ASSET_TABLE_TOMBSTONE) { continue; }
+            size_t slot = HashAsset(key, lib->assetTableSize);
+            while (lib->assetTable[slot].key.id != 0) {
+                slot = (slot + 1) & mask;
+            }
+            lib->assetTable[slot] = oldTable[i];
+            lib->numAssets++;
+        }
+        GT_DELETE_ARRAY(oldTable, lib->memoryArena);
+    }
+
+    // slot for asset, the existing one if the asset is already in the table
     template <class TLibrary, class TResource>
     AssetToData<TResource>* PushAsset(TLibrary* lib, core::Asset asset)
     {
-        for (size_t i = 0; i < lib->assetTableSize; ++i) {
-            if (lib->assetTable[i].key.id == 0) {
-                lib->assetTable[i].key = asset;
-                return &lib->assetTable[i];
-            }
+        if (asset.id == 0 || asset.id == ASSET_TABLE_TOMBSTONE) { return nullptr; }
+        AssetToData<TResource>* existing = FindAsset<TLibrary, TResource>(lib, asset);
+        if (existing != nullptr) { return existing; }
+
+        if ((lib->numAssets + lib->numTombstones + 1) * 4 > lib->assetTableSize * 3) {
+            RebuildAssetTable<TLibrary, TResource>(lib, 1);
         }
-        return nullptr;
+        size_t mask = lib->assetTableSize - 1;
+        size_t i = HashAsset(asset, lib->assetTableSize);
+        while (lib->assetTable[i].key.id != 0 && lib->assetTable[i].key.id != ASSET_TABLE_TOMBSTONE) {
+            i = (i + 1) & mask;
+        }
+        if (lib->assetTable[i].key.id == ASSET_TABLE_TOMBSTONE) {
+            lib->numTombstones--;
+        }
+        lib->assetTable[i].key = asset;
+        lib->assetTable[i].data = nullptr;
+        lib->numAssets++;
+        return &lib->assetTable[i];
+    }
+
+    template <class TLibrary, class TResource>
+    void RemoveAsset(TLibrary* lib, core::Asset asset)
+    {
+        AssetToData<TResource>* slot = FindAsset<TLibrary, TResource>(lib, asset);
+        if (slot == nullptr) { return; }
+        slot->key.id = ASSET_TABLE_TOMBSTONE;
+        slot->data = nullptr;
+        lib->numAssets--;
+        lib->numTombstones++;
+    }
+
+    // a failed first update takes its entry out again, lookups would hand out its null data otherwise
+    template <class TLibrary, class TResource>
+    bool DropFailedAsset(TLibrary* lib, core::Asset asset, bool isNewAsset)
+    {
+        if (isNewAsset) {
+            RemoveAsset<TLibrary, TResource>(lib, asset);
+        }
+        return false;
     }
 
-    static const size_t MAX_NUM_SUBMESHES = 1024;  // @TODO @HACK
     struct StaticMeshRenderable
     {
         float           transform[16];
 
         MeshData*       firstSubmesh;
-        MaterialData*   materials[MAX_NUM_SUBMESHES];
 
-        uint32_t        entityID = 0;
+        uint64_t        entityID = 0;
         StaticMesh      handle;
 
         core::Asset     meshAssetHandle;
-        core::Asset     materialAssetHandles[MAX_NUM_SUBMESHES];
+
+        // range of the packed material arrays of the render world, one entry per submesh
+        uint32_t        firstMaterial = 0;
+        uint32_t        numMaterials = 0;
     };
 
+    // StaticMeshRenderable as render worlds were stored before materials were packed, only used to load old scenes
+    static const size_t LEGACY_MAX_NUM_SUBMESHES = 1024;
+    struct LegacyStaticMeshRenderable
+    {
+        float           transform[16];
+
+        MeshData*       firstSubmesh;
+        MaterialData*   materials[LEGACY_MAX_NUM_SUBMESHES];
+
+        uint64_t        entityID;
+        StaticMesh      handle;
+
+        core::Asset     meshAssetHandle;
+        core::Asset     materialAssetHandles[LEGACY_MAX_NUM_SUBMESHES];
+    };
+
+    /**
+        Draws of a frame are collected as packets and sorted by key before submission, so draws sharing a pipeline,
+        material and mesh end up next to each other and state only changes between groups.
+
+        Sort key layout, most significant bits first:
+        {
+            4 bits      pass
+            8 bits      pipeline
+            16 bits     material
+            16 bits     mesh
+            20 bits     view space depth, front to back
+        }
+    */
+    enum : uint32_t
+    {
+        DRAW_PASS_MAIN = 0
+    };
+
+    struct DrawPacket
+    {
+        uint64_t    key = 0;
+        uint32_t    submesh = 0;            // index into the per frame submesh arrays of the render world
+
+        // only set on the first packet of every draw, which also draws the numInstances - 1 packets after it
+        uint32_t    constantOffset = 0;     // of the object constants in the constant ring
+        uint32_t    numInstances = 0;
+    };
+
+    static uint64_t MakeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+    {
+        // @NOTE the bits of a non negative float order the same way as its value, the lowest mantissa bits are dropped
+        uint32_t depthBits = 0;
+        if (depth > 0.0f) {
+            memcpy(&depthBits, &depth, sizeof(uint32_t));
+        }
+        return ((uint64_t)(pass & 0xf) << 60)
+            | ((uint64_t)(pipeline & 0xff) << 52)
+            | ((uint64_t)(material & 0xffff) << 36)
+            | ((uint64_t)(mesh & 0xffff) << 20)
+            | (uint64_t)(depthBits >> 11);
+    }
+
+    // LSD radix sort on the key, one byte per pass, returns whichever of the two buffers holds the result
+    static DrawPacket* SortDrawPackets(DrawPacket* packets, DrawPacket* temp, size_t count)
+    {
+        DrawPacket* from = packets;
+        DrawPacket* to = temp;
+        for (uint32_t shift = 0; shift < 64; shift += 8) {
+            size_t offsets[256] = {};
+            for (size_t i = 0; i < count; ++i) {
+                offsets[(from[i].key >> shift) & 0xff]++;
+            }
+            // every key has the same byte here, the pass wouldn't change the order
+            if (count == 0 || offsets[(from[0].key >> shift) & 0xff] == count) { continue; }
+
+            size_t sum = 0;
+            for (size_t i = 0; i < 256; ++i) {
+                size_t numKeys = offsets[i];
+                offsets[i] = sum;
+                sum += numKeys;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                to[offsets[(from[i].key >> shift) & 0xff]++] = from[i];
+            }
+            DrawPacket* swap = from;
+            from = to;
+            to = swap;
+        }
+        return from;
+    }
+
     struct RenderableIndex
     {
         uint32_t    index = 0;
         uint16_t    generation = HANDLE_GENERATION_START;
     };
 
+    static const uint32_t NO_MATERIAL_OWNER = 0xffffffff;
+
     struct RenderWorld
     {
         RenderWorldConfig   config;
@@ -270,9 +521,36 @@ namespace renderer
         StaticMeshRenderable*           staticMeshes = nullptr;
         size_t                          firstFreeStaticMesh = 0;
 
+        // materials of all renderables, ranges of destroyed renderables stay behind as gaps until they are compacted
+        MaterialData**                  materials = nullptr;
+        core::Asset*                    materialAssets = nullptr;
+        uint32_t*                       materialOwners = nullptr;  // index of the renderable owning the range, NO_MATERIAL_OWNER in gaps
+        size_t                          numMaterials = 0;
+        size_t                          numFreedMaterials = 0;
+        size_t                          materialCapacity = 0;
+
         float           cameraTransform[16];
         float           cameraProjection[16];
 
+        // world space bounds of the renderables with a loaded mesh, keyed by their handle
+        spatial::SpatialIndex*  renderableIndex = nullptr;
+        uint64_t*               visibleRenderables = nullptr;
+        size_t                  visibleRenderableCapacity = 0;
+
+        // one entry per drawable submesh of the renderables inside the frustum, rebuilt by every call to Render
+        spatial::AABBArrays submeshBounds;          // world space
+        MeshData**          submeshes = nullptr;
+        MaterialData**      submeshMaterials = nullptr;
+        uint32_t*           submeshRenderables = nullptr;
+        uint32_t*           visibleSubmeshes = nullptr;
+        DrawPacket*         drawPackets = nullptr;
+        DrawPacket*         sortedDrawPackets = nullptr;
+        size_t              submeshCapacity = 0;
+
+        RenderStats     stats;
+
+        TextureStreamer* textureStreamer = nullptr;
+
         fnd::memory::MemoryArenaBase* creationArena = nullptr;
     };
 
@@ -308,10 +586,6 @@ namespace renderer
         gfx::PipelineState prefilterPipeline;
 
         gfx::Image uiRenderTarget;
-        gfx::Image mainRT;
-        gfx::Image luminanceRT;
-        gfx::Image bloomRT;
-        gfx::Image mainDepthBuffer;
         gfx::Image brdfLUT;
         static const size_t NUM_CONVOLUTION_MIPS = 11;
         static const size_t NUM_CUBEMAPS = 1;
@@ -322,17 +596,23 @@ namespace renderer
         gfx::Image prefilteredCubemap[NUM_CUBEMAPS];
         fnd::math::float2 prefilteredCubemapDimensions[NUM_CUBEMAPS];
 
-        gfx::RenderPass mainPass;
         gfx::RenderPass uiPass;
-        gfx::RenderPass luminancePass;
-        gfx::RenderPass bloomPass;
-        gfx::RenderPass bloomBlitPass;
         gfx::RenderPass brdfLUTPass;
+
+        // frame targets are transient images of the render graph
+        RenderGraph* renderGraph = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
        
         gfx::Buffer cubeVertexBuffer;
         gfx::Buffer cubeIndexBuffer;
-        gfx::Buffer cBuffer;
+        gfx::ConstantRing constantRing;
+        gfx::UploadQueue* uploadQueue = nullptr;     // created for the first render world that streams textures
+        size_t uploadRingSize = 0;
         gfx::Buffer prefilterCBuffer;
+
+        // view and object constants in the ring plus the image based lighting inputs, per cubemap
+        gfx::BindGroup mainPassBindGroup[NUM_CUBEMAPS];
     };
 
 
@@ -352,6 +632,42 @@ namespace renderer
         float _padding0[1];
     };
 
+    // constants of the mesh shaders, b0 is shared by all meshes of a view, b1 is per object
+    struct ViewConstants {
+        float VP[16];
+        float view[16];
+        float inverseView[16];
+        float projection[16];
+        fnd::math::float4 lightDir = { 1.0f, -1.0f, 0.0f, 0.0f };
+    };
+
+    // has to match the size of the model matrix array of the mesh shaders
+    static const uint32_t MAX_INSTANCES_PER_DRAW = 256;
+
+    // only as much of the model matrix array as there are instances in a draw is allocated
+    struct ObjectConstants {
+        fnd::math::float4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+        float metallic = 0.0f;
+        float roughness = 1.0f;
+        uint32_t  useTextures = 1;
+        float _padding0[1];
+        float models[MAX_INSTANCES_PER_DRAW][16];
+    };
+
+    // the ring only holds streamed mips, worlds without texture streaming don't need it
+    static gfx::UploadQueue* GetUploadQueue(Renderer* renderer)
+    {
+        if (renderer->uploadQueue == nullptr) {
+            gfx::UploadQueueDesc uploadQueueDesc;
+            uploadQueueDesc.ringSize = renderer->uploadRingSize;
+            if (!gfx::CreateUploadQueue(renderer->gfxDevice, &renderer->uploadQueue, &uploadQueueDesc, renderer->creationArena)) {
+                GT_LOG_ERROR("Renderer", "Failed to create upload queue");
+                renderer->uploadQueue = nullptr;
+            }
+        }
+        return renderer->uploadQueue;
+    }
+
     bool CreateRenderWorld(RenderWorld** outWorld, fnd::memory::MemoryArenaBase* memoryArena, RenderWorldConfig* config)
     {
         RenderWorld* world = GT_NEW(RenderWorld, memoryArena);
@@ -364,27 +680,237 @@ namespace renderer
         assert(world->renderer);
         world->staticMeshes = GT_NEW_ARRAY(StaticMeshRenderable, config->renderablePoolSize, memoryArena);
         world->staticMeshIndices.Initialize((uint32_t)config->renderablePoolSize, memoryArena);
+        world->materialCapacity = config->renderablePoolSize;
+        world->materials = GT_NEW_ARRAY(MaterialData*, world->materialCapacity, memoryArena);
+        world->materialAssets = GT_NEW_ARRAY(core::Asset, world->materialCapacity, memoryArena);
+        world->materialOwners = GT_NEW_ARRAY(uint32_t, world->materialCapacity, memoryArena);
 
         world->config = *config;
         world->creationArena = memoryArena;
 
+        spatial::SpatialIndexConfig indexConfig;
+        indexConfig.initialCapacity = (uint32_t)config->renderablePoolSize;
+        spatial::CreateSpatialIndex(&world->renderableIndex, memoryArena, &indexConfig);
+
         util::Make4x4FloatMatrixIdentity(world->cameraTransform);
         util::Make4x4FloatMatrixIdentity(world->cameraProjection);
 
+        if (config->textureStreamingBudget > 0) {
+            TextureStreamingConfig streamingConfig;
+            streamingConfig.budget = config->textureStreamingBudget;
+            streamingConfig.numWorkerThreads = config->numTextureStreamingThreads;
+            gfx::UploadQueue* uploadQueue = GetUploadQueue(world->renderer);
+            if (uploadQueue == nullptr || !CreateTextureStreamer(&world->textureStreamer, memoryArena, world->renderer->gfxDevice, uploadQueue, &streamingConfig)) {
+                GT_LOG_ERROR("Renderer", "Failed to create texture streamer, textures will be fully resident");
+            }
+        }
+
         *outWorld = world;
         return true;
     }
 
+    static void FreeSubmeshBuffers(RenderWorld* world)
+    {
+        if (world->submeshCapacity == 0) { return; }
+        GT_DELETE_ARRAY(world->submeshBounds.minX, world->creationArena);
+        GT_DELETE_ARRAY(world->submeshes, world->creationArena);
+        GT_DELETE_ARRAY(world->submeshMaterials, world->creationArena);
+        GT_DELETE_ARRAY(world->submeshRenderables, world->creationArena);
+        GT_DELETE_ARRAY(world->visibleSubmeshes, world->creationArena);
+        GT_DELETE_ARRAY(world->drawPackets, world->creationArena);
+        GT_DELETE_ARRAY(world->sortedDrawPackets, world->creationArena);
+        world->submeshBounds = spatial::AABBArrays();
+        world->submeshCapacity = 0;
+    }
+
+    // contents are not preserved when the buffers grow
+    static void ReserveSubmeshBuffers(RenderWorld* world, size_t numSubmeshes)
+    {
+        if (numSubmeshes <= world->submeshCapacity) { return; }
+        size_t capacity = world->submeshCapacity > 0 ? world->submeshCapacity : 256;
+        while (capacity < numSubmeshes) {
+            capacity *= 2;
+        }
+        FreeSubmeshBuffers(world);
+
+        float* bounds = GT_NEW_ARRAY(float, capacity * 6, world->creationArena);
+        world->submeshBounds.minX = bounds;
+        world->submeshBounds.minY = bounds + capacity;
+        world->submeshBounds.minZ = bounds + capacity * 2;
+        world->submeshBounds.maxX = bounds + capacity * 3;
+        world->submeshBounds.maxY = bounds + capacity * 4;
+        world->submeshBounds.maxZ = bounds + capacity * 5;
+        world->submeshes = GT_NEW_ARRAY(MeshData*, capacity, world->creationArena);
+        world->submeshMaterials = GT_NEW_ARRAY(MaterialData*, capacity, world->creationArena);
+        world->submeshRenderables = GT_NEW_ARRAY(uint32_t, capacity, world->creationArena);
+        world->visibleSubmeshes = GT_NEW_ARRAY(uint32_t, capacity, world->creationArena);
+        world->drawPackets = GT_NEW_ARRAY(DrawPacket, capacity, world->creationArena);
+        world->sortedDrawPackets = GT_NEW_ARRAY(DrawPacket, capacity, world->creationArena);
+        world->submeshCapacity = capacity;
+    }
+
+    static void ReserveMaterials(RenderWorld* world, size_t numMaterials)
+    {
+        if (numMaterials <= world->materialCapacity) { return; }
+        size_t capacity = world->materialCapacity > 0 ? world->materialCapacity : 256;
+        while (capacity < numMaterials) {
+            capacity *= 2;
+        }
+        MaterialData** materials = GT_NEW_ARRAY(MaterialData*, capacity, world->creationArena);
+        core::Asset* materialAssets = GT_NEW_ARRAY(core::Asset, capacity, world->creationArena);
+        uint32_t* materialOwners = GT_NEW_ARRAY(uint32_t, capacity, world->creationArena);
+        if (world->materials != nullptr) {
+            memcpy(materials, world->materials, sizeof(MaterialData*) * world->numMaterials);
+            memcpy(materialAssets, world->materialAssets, sizeof(core::Asset) * world->numMaterials);
+            memcpy(materialOwners, world->materialOwners, sizeof(uint32_t) * world->numMaterials);
+            GT_DELETE_ARRAY(world->materials, world->creationArena);
+            GT_DELETE_ARRAY(world->materialAssets, world->creationArena);
+            GT_DELETE_ARRAY(world->materialOwners, world->creationArena);
+        }
+        world->materials = materials;
+        world->materialAssets = materialAssets;
+        world->materialOwners = materialOwners;
+        world->materialCapacity = capacity;
+    }
+
+    // moves the ranges of live renderables down over the gaps, in one pass over all materials
+    static void CompactMaterials(RenderWorld* world)
+    {
+        if (world->numFreedMaterials == 0) { return; }
+        size_t numLive = 0;
+        for (size_t i = 0; i < world->numMaterials; ++i) {
+            uint32_t owner = world->materialOwners[i];
+            if (owner == NO_MATERIAL_OWNER) { continue; }
+            StaticMeshRenderable* renderable = &world->staticMeshes[owner];
+            if (renderable->firstMaterial == i) {
+                renderable->firstMaterial = (uint32_t)numLive;
+            }
+            world->materials[numLive] = world->materials[i];
+            world->materialAssets[numLive] = world->materialAssets[i];
+            world->materialOwners[numLive] = owner;
+            numLive++;
+        }
+        world->numMaterials = numLive;
+        world->numFreedMaterials = 0;
+    }
+
+    static uint32_t AllocateMaterials(RenderWorld* world, size_t numMaterials, uint32_t owner)
+    {
+        if (world->numMaterials + numMaterials > world->materialCapacity) {
+            CompactMaterials(world);
+        }
+        ReserveMaterials(world, world->numMaterials + numMaterials);
+        uint32_t first = (uint32_t)world->numMaterials;
+        for (size_t i = 0; i < numMaterials; ++i) {
+            world->materialOwners[first + i] = owner;
+        }
+        world->numMaterials += numMaterials;
+        return first;
+    }
+
+    static void SetMaterialOwner(RenderWorld* world, uint32_t owner)
+    {
+        StaticMeshRenderable* renderable = &world->staticMeshes[owner];
+        for (uint32_t i = 0; i < renderable->numMaterials; ++i) {
+            world->materialOwners[renderable->firstMaterial + i] = owner;
+        }
+    }
+
+    // @NOTE leaves a gap instead of moving the ranges behind it, destroying many renderables would be quadratic otherwise
+    static void FreeMaterials(RenderWorld* world, uint32_t first, uint32_t numMaterials)
+    {
+        for (uint32_t i = 0; i < numMaterials; ++i) {
+            world->materialOwners[first + i] = NO_MATERIAL_OWNER;
+        }
+        world->numFreedMaterials += numMaterials;
+        if (world->numFreedMaterials * 2 > world->numMaterials) {
+            CompactMaterials(world);
+        }
+    }
+
     void DestroyRenderWorld(RenderWorld* world)
     {
+        if (world->textureStreamer != nullptr) {
+            DestroyTextureStreamer(world->textureStreamer);
+        }
+        FreeSubmeshBuffers(world);
+        if (world->visibleRenderables != nullptr) {
+            GT_DELETE_ARRAY(world->visibleRenderables, world->creationArena);
+        }
+        spatial::DestroySpatialIndex(world->renderableIndex);
+        GT_DELETE_ARRAY(world->materials, world->creationArena);
+        GT_DELETE_ARRAY(world->materialAssets, world->creationArena);
+        GT_DELETE_ARRAY(world->materialOwners, world->creationArena);
         GT_DELETE(world, world->creationArena);
     }
 
 
 
+    // bounds of all submeshes of the renderable in world space, false if its mesh isn't loaded
+    static bool GetRenderableBounds(StaticMeshRenderable* renderable, spatial::AABB* outBounds)
+    {
+        if (renderable->firstSubmesh == nullptr) { return false; }
+        spatial::AABB localBounds;
+        memcpy(localBounds.min, renderable->firstSubmesh->boundsMin, sizeof(float) * 3);
+        memcpy(localBounds.max, renderable->firstSubmesh->boundsMax, sizeof(float) * 3);
+        for (MeshData* it = renderable->firstSubmesh->nextSubmesh; it != nullptr; it = it->nextSubmesh) {
+            for (int i = 0; i < 3; ++i) {
+                localBounds.min[i] = it->boundsMin[i] < localBounds.min[i] ? it->boundsMin[i] : localBounds.min[i];
+                localBounds.max[i] = it->boundsMax[i] > localBounds.max[i] ? it->boundsMax[i] : localBounds.max[i];
+            }
+        }
+        spatial::TransformAABB(&localBounds, renderable->transform, outBounds);
+        return true;
+    }
+
+    // has to be called whenever the mesh or the transform of a renderable change
+    static void UpdateRenderableProxy(RenderWorld* world, StaticMeshRenderable* renderable)
+    {
+        uint64_t id = renderable->handle.id;
+        spatial::AABB bounds;
+        if (GetRenderableBounds(renderable, &bounds)) {
+            spatial::UpdateProxies(world->renderableIndex, &id, &bounds, 1);
+        }
+        else {
+            spatial::RemoveProxies(world->renderableIndex, &id, 1);
+        }
+    }
+
+    static void RebuildRenderableIndex(RenderWorld* world)
+    {
+        spatial::DestroySpatialIndex(world->renderableIndex);
+        spatial::SpatialIndexConfig indexConfig;
+        indexConfig.initialCapacity = (uint32_t)world->staticMeshIndices.size;
+        spatial::CreateSpatialIndex(&world->renderableIndex, world->creationArena, &indexConfig);
+        for (size_t i = 0; i < world->firstFreeStaticMesh; ++i) {
+            UpdateRenderableProxy(world, &world->staticMeshes[i]);
+        }
+    }
+
+    static const uint32_t RENDER_WORLD_MAGIC = 0x444c5752; // 'RWLD'
+    static const uint32_t RENDER_WORLD_VERSION = 1;
+
+    static double GetTimeMilliseconds()
+    {
+#ifdef _MSC_VER
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#else
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+#endif
+    }
+
     bool SerializeRenderWorld(RenderWorld* world, void* buffer, size_t bufferSize, size_t* requiredBufferSize)
     {
-        size_t requiredSize = world->config.renderablePoolSize * (sizeof(StaticMeshRenderable)) + world->staticMeshIndices.size * (sizeof(RenderableIndex) + sizeof(uint16_t)) + sizeof(ResourcePool<RenderableIndex>);
+        CompactMaterials(world);
+        size_t requiredSize = sizeof(uint64_t) + sizeof(uint32_t) * 2 + sizeof(ResourcePool<RenderableIndex>)
+            + world->staticMeshIndices.size * (sizeof(RenderableIndex) + sizeof(uint16_t))
+            + sizeof(uint32_t) + world->firstFreeStaticMesh * sizeof(StaticMeshRenderable)
+            + sizeof(uint32_t) + world->numMaterials * sizeof(core::Asset);
         if (requiredBufferSize != nullptr) {
             *requiredBufferSize = requiredSize;
         }
@@ -395,6 +921,7 @@ namespace renderer
                 StaticMeshRenderable* as_static_renderable;
                 ResourcePool<RenderableIndex>* as_pool;
                 RenderableIndex* as_index;
+                core::Asset* as_asset;
                 uint16_t* as_uint16_t;
                 uint32_t* as_uint32_t;
                 uint64_t* as_uint64_t;
@@ -404,11 +931,15 @@ namespace renderer
             Memory layout on disk:
             {
                 uint64_t                                <- size in bytes
+                uint32_t                                <- RENDER_WORLD_MAGIC, absent in old scenes
+                uint32_t                                <- RENDER_WORLD_VERSION
                 ResourcePool                            <-
                 RenderableIndex[resource pool size]     <- index table into renderables
                 uint16_t[resource pool size]            <- index table into renderable index table (yeah)
                 uint32_t                                <- numRenderables
                 StaticMeshRenderable[num renderables]   <- 
+                uint32_t                                <- numMaterials
+                core::Asset[numMaterials]               <- materials the renderables' ranges refer to
             */
 
             as_void = buffer;
@@ -416,6 +947,9 @@ namespace renderer
             uint64_t requiredSizeU64 = requiredSize;
             memcpy(as_uint64_t, &requiredSizeU64, sizeof(uint64_t));
             as_uint64_t++;
+            uint32_t magic[2] = { RENDER_WORLD_MAGIC, RENDER_WORLD_VERSION };
+            memcpy(as_uint32_t, magic, sizeof(magic));
+            as_uint32_t += 2;
             memcpy(as_pool, &world->staticMeshIndices, sizeof(ResourcePool<RenderableIndex>));
             as_pool++;
             memcpy(as_index, world->staticMeshIndices.buffer, sizeof(RenderableIndex) * world->staticMeshIndices.size);
@@ -426,22 +960,69 @@ namespace renderer
             memcpy(as_uint32_t, &numRenderables, sizeof(uint32_t));
             as_uint32_t++;
             memcpy(as_static_renderable, world->staticMeshes, sizeof(StaticMeshRenderable) * numRenderables);
+            as_static_renderable += numRenderables;
+            uint32_t numMaterials = (uint32_t)world->numMaterials;
+            memcpy(as_uint32_t, &numMaterials, sizeof(uint32_t));
+            as_uint32_t++;
+            memcpy(as_asset, world->materialAssets, sizeof(core::Asset) * numMaterials);
         }
         return true;
     }
 
+    static size_t CountSubmeshes(MeshData* mesh)
+    {
+        size_t numSubmeshes = 0;
+        for (auto it = mesh; it != nullptr; it = it->nextSubmesh) {
+            numSubmeshes++;
+        }
+        return numSubmeshes;
+    }
+
+    // old scenes stored every renderable with room for the materials of 1024 submeshes
+    static void LoadLegacyRenderables(RenderWorld* world, LegacyStaticMeshRenderable* legacyRenderables, uint32_t numRenderables)
+    {
+        world->numMaterials = 0;
+        world->numFreedMaterials = 0;
+        for (uint32_t i = 0; i < numRenderables; ++i) {
+            LegacyStaticMeshRenderable legacy;
+            memcpy(&legacy, &legacyRenderables[i], sizeof(LegacyStaticMeshRenderable));
+
+            auto renderable = &world->staticMeshes[i];
+            memcpy(renderable->transform, legacy.transform, sizeof(float) * 16);
+            renderable->entityID = legacy.entityID;
+            renderable->handle = legacy.handle;
+            renderable->meshAssetHandle = legacy.meshAssetHandle;
+            renderable->firstSubmesh = LookupResource<MeshLibrary, MeshData>(&world->meshLibrary, renderable->meshAssetHandle);
+
+            size_t numMaterials = CountSubmeshes(renderable->firstSubmesh);
+            if (renderable->firstSubmesh == nullptr) {
+                // without the mesh, keep everything up to the last material that was set
+                for (size_t j = 0; j < LEGACY_MAX_NUM_SUBMESHES; ++j) {
+                    numMaterials = legacy.materialAssetHandles[j].id != 0 ? j + 1 : numMaterials;
+                }
+            }
+            numMaterials = numMaterials < LEGACY_MAX_NUM_SUBMESHES ? numMaterials : LEGACY_MAX_NUM_SUBMESHES;
+            renderable->firstMaterial = AllocateMaterials(world, numMaterials, i);
+            renderable->numMaterials = (uint32_t)numMaterials;
+            memcpy(world->materialAssets + renderable->firstMaterial, legacy.materialAssetHandles, sizeof(core::Asset) * numMaterials);
+        }
+    }
+
     bool DeserializeRenderWorld(RenderWorld* world, void* buffer, size_t bufferSize, size_t* bytesRead)
     {
         union {
             void* as_void;
             StaticMeshRenderable* as_static_renderable;
+            LegacyStaticMeshRenderable* as_legacy_renderable;
             ResourcePool<RenderableIndex>* as_pool;
             RenderableIndex* as_index;
+            core::Asset* as_asset;
             uint16_t* as_uint16_t;
             uint32_t* as_uint32_t;
             uint64_t* as_uint64_t;
         };
         as_void = buffer;
+        double startTime = GetTimeMilliseconds();
 
         uint64_t bytesReadU64 = 0;
         memcpy(&bytesReadU64, as_uint64_t, sizeof(uint64_t));
@@ -451,6 +1032,18 @@ namespace renderer
             *bytesRead = (size_t)bytesReadU64;
         }
 
+        // @NOTE old scenes continue with the pool, whose first member is its size and never equals the magic
+        uint32_t magic[2] = { 0, 0 };
+        memcpy(magic, as_uint32_t, sizeof(magic));
+        bool isLegacy = magic[0] != RENDER_WORLD_MAGIC;
+        if (!isLegacy) {
+            if (magic[1] != RENDER_WORLD_VERSION) {
+                GT_LOG_ERROR("Renderer", "Render world has version %u, supported is %u", magic[1], RENDER_WORLD_VERSION);
+                return false;
+            }
+            as_uint32_t += 2;
+        }
+
         if (world->staticMeshIndices.buffer != nullptr) {
             GT_DELETE_ARRAY(world->staticMeshIndices.buffer, world->creationArena);
             GT_DELETE_ARRAY(world->staticMeshIndices.indexList, world->creationArena);
@@ -475,16 +1068,33 @@ namespace renderer
             GT_DELETE_ARRAY(world->staticMeshes, world->creationArena);
         }
         world->staticMeshes = GT_NEW_ARRAY(StaticMeshRenderable, world->staticMeshIndices.size, world->creationArena);
-        memcpy(world->staticMeshes, as_static_renderable, sizeof(StaticMeshRenderable) * world->firstFreeStaticMesh);
-        for (auto i = 0; i < world->firstFreeStaticMesh; ++i) {
-            {   // patch resource pointers
+        if (isLegacy) {
+            LoadLegacyRenderables(world, as_legacy_renderable, numRenderables);
+        }
+        else {
+            memcpy(world->staticMeshes, as_static_renderable, sizeof(StaticMeshRenderable) * world->firstFreeStaticMesh);
+            as_static_renderable += numRenderables;
+            for (size_t i = 0; i < world->firstFreeStaticMesh; ++i) {   // patch resource pointers
                 auto renderable = &world->staticMeshes[i];
                 renderable->firstSubmesh = LookupResource<MeshLibrary, MeshData>(&world->meshLibrary, renderable->meshAssetHandle);
-                for (size_t i = 0; i < MAX_NUM_SUBMESHES; ++i) {
-                    renderable->materials[i] = LookupResource<MaterialLibrary, MaterialData>(&world->materialLibrary, renderable->materialAssetHandles[i]);
-                }
             }
+
+            uint32_t numMaterials = 0;
+            memcpy(&numMaterials, as_uint32_t, sizeof(uint32_t));
+            as_uint32_t++;
+            world->numMaterials = 0;
+            world->numFreedMaterials = 0;
+            AllocateMaterials(world, numMaterials, NO_MATERIAL_OWNER);
+            memcpy(world->materialAssets, as_asset, sizeof(core::Asset) * numMaterials);
+            for (uint32_t i = 0; i < numRenderables; ++i) {
+                SetMaterialOwner(world, i);
+            }
+        }
+        for (size_t i = 0; i < world->numMaterials; ++i) {
+            world->materials[i] = LookupResource<MaterialLibrary, MaterialData>(&world->materialLibrary, world->materialAssets[i]);
         }
+        RebuildRenderableIndex(world);
+        GT_LOG_INFO("Renderer", "Deserialized %u renderables and %u materials in %.2f ms", numRenderables, (uint32_t)world->numMaterials, GetTimeMilliseconds() - startTime);
 
         return true;
     }
@@ -515,13 +1125,16 @@ namespace renderer
     void UpdateWorldState(RenderWorld* world, WorldSnapshot* snapshot)
     {
         for (size_t i = 0; i < snapshot->numTransforms; ++i) {
-            uint32_t id = snapshot->transforms[i].entityID;
+            uint64_t id = snapshot->transforms[i].entityID;
 
             for (size_t j = 0; j < world->firstFreeStaticMesh; ++j) {
                 if (world->staticMeshes[j].entityID == id) {
                     //auto pos = util::Get4x4FloatMatrixColumnCM(snapshot->transforms[i].transform, 3).xyz;
                     //GT_LOG_DEBUG("Renderer", "Updating entity #%i to position (%f, %f, %f)", id, pos.x, pos.y, pos.z);
+                    // @NOTE only renderables that moved touch the spatial index
+                    if (memcmp(snapshot->transforms[i].transform, world->staticMeshes[j].transform, sizeof(float) * 16) == 0) { continue; }
                     util::Copy4x4FloatMatrixCM(snapshot->transforms[i].transform, world->staticMeshes[j].transform);
+                    UpdateRenderableProxy(world, &world->staticMeshes[j]);
                 }
             }
         }
@@ -532,91 +1145,92 @@ namespace renderer
         Renderer* renderer = GT_NEW(Renderer, memoryArena);
 
         renderer->creationArena = memoryArena;
+        renderer->uploadRingSize = config->uploadRingSize;
         renderer->gfxDevice = config->gfxDevice;
         renderer->commandBuffer = gfx::GetImmediateCommandBuffer(renderer->gfxDevice);
 
         {   // load shaders
             size_t vCubeShaderCodeSize = 0;
-            char* vCubeShaderCode = static_cast<char*>(LoadFileContents("VertexShaderCube.cso", memoryArena, &vCubeShaderCodeSize));
+            char* vCubeShaderCode = static_cast<char*>(LoadShaderCode("VertexShaderCube.cso", memoryArena, &vCubeShaderCodeSize));
             if (!vCubeShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load vertex shader\n");
             }
 
             size_t pShaderCodeSize = 0;
-            char* pShaderCode = static_cast<char*>(LoadFileContents("PixelShader.cso", memoryArena, &pShaderCodeSize));
+            char* pShaderCode = static_cast<char*>(LoadShaderCode("PixelShader.cso", memoryArena, &pShaderCodeSize));
             if (!pShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load pixel shader\n");
             }
 
             size_t vBlitShaderCodeSize = 0;
-            char* vBlitShaderCode = static_cast<char*>(LoadFileContents("BlitVertexShader.cso", memoryArena, &vBlitShaderCodeSize));
+            char* vBlitShaderCode = static_cast<char*>(LoadShaderCode("BlitVertexShader.cso", memoryArena, &vBlitShaderCodeSize));
             if (!vBlitShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load vertex shader\n");
             }
 
             size_t pBlitShaderCodeSize = 0;
-            char* pBlitShaderCode = static_cast<char*>(LoadFileContents("BlitPixelShader.cso", memoryArena, &pBlitShaderCodeSize));
+            char* pBlitShaderCode = static_cast<char*>(LoadShaderCode("BlitPixelShader.cso", memoryArena, &pBlitShaderCodeSize));
             if (!pBlitShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load pixel shader\n");
             }
 
             size_t pTonemapShaderCodeSize = 0;
-            char* pTonemapShaderCode = static_cast<char*>(LoadFileContents("TonemapPixelShader.cso", memoryArena, &pTonemapShaderCodeSize));
+            char* pTonemapShaderCode = static_cast<char*>(LoadShaderCode("TonemapPixelShader.cso", memoryArena, &pTonemapShaderCodeSize));
             if (!pTonemapShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load pixel shader\n");
             }
 
             size_t pBlurShaderCodeSize = 0;
-            char* pBlurShaderCode = static_cast<char*>(LoadFileContents("SelectiveBlurPixelShader.cso", memoryArena, &pBlurShaderCodeSize));
+            char* pBlurShaderCode = static_cast<char*>(LoadShaderCode("SelectiveBlurPixelShader.cso", memoryArena, &pBlurShaderCodeSize));
             if (!pBlurShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load pixel shader\n");
             }
 
             size_t pBloomShaderCodeSize = 0;
-            char* pBloomShaderCode = static_cast<char*>(LoadFileContents("BloomBlurPixelShader.cso", memoryArena, &pBloomShaderCodeSize));
+            char* pBloomShaderCode = static_cast<char*>(LoadShaderCode("BloomBlurPixelShader.cso", memoryArena, &pBloomShaderCodeSize));
             if (!pBloomShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load pixel shader\n");
             }
 
             size_t pLuminanceShaderCodeSize = 0;
-            char* pLuminanceShaderCode = static_cast<char*>(LoadFileContents("LuminancePixelShader.cso", memoryArena, &pLuminanceShaderCodeSize));
+            char* pLuminanceShaderCode = static_cast<char*>(LoadShaderCode("LuminancePixelShader.cso", memoryArena, &pLuminanceShaderCodeSize));
             if (!pLuminanceShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load pixel shader\n");
             }
 
             size_t vPaintShaderCodeSize = 0;
-            char* vPaintShaderCode = static_cast<char*>(LoadFileContents("PaintVertexShader.cso", memoryArena, &vPaintShaderCodeSize));
+            char* vPaintShaderCode = static_cast<char*>(LoadShaderCode("PaintVertexShader.cso", memoryArena, &vPaintShaderCodeSize));
             if (!vPaintShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load vertex shader\n");
             }
 
             size_t pPaintShaderCodeSize = 0;
-            char* pPaintShaderCode = static_cast<char*>(LoadFileContents("PaintPixelShader.cso", memoryArena, &pPaintShaderCodeSize));
+            char* pPaintShaderCode = static_cast<char*>(LoadShaderCode("PaintPixelShader.cso", memoryArena, &pPaintShaderCodeSize));
             if (!pPaintShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load p shader\n");
             }
 
 
             size_t vCubemapShaderCodeSize = 0;
-            char* vCubemapShaderCode = static_cast<char*>(LoadFileContents("CubemapVertexShader.cso", memoryArena, &vCubemapShaderCodeSize));
+            char* vCubemapShaderCode = static_cast<char*>(LoadShaderCode("CubemapVertexShader.cso", memoryArena, &vCubemapShaderCodeSize));
             if (!vCubemapShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load vertex shader\n");
             }
 
             size_t pCubemapShaderCodeSize = 0;
-            char* pCubemapShaderCode = static_cast<char*>(LoadFileContents("CubemapPixelShader.cso", memoryArena, &pCubemapShaderCodeSize));
+            char* pCubemapShaderCode = static_cast<char*>(LoadShaderCode("CubemapPixelShader.cso", memoryArena, &pCubemapShaderCodeSize));
             if (!pCubemapShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load p shader\n");
             }
 
             size_t pPrefilterCubemapShaderCodeSize = 0;
-            char* pPrefilterCubemapShaderCode = static_cast<char*>(LoadFileContents("PrefilterCubemapPixelShader.cso", memoryArena, &pPrefilterCubemapShaderCodeSize));
+            char* pPrefilterCubemapShaderCode = static_cast<char*>(LoadShaderCode("PrefilterCubemapPixelShader.cso", memoryArena, &pPrefilterCubemapShaderCodeSize));
             if (!pPrefilterCubemapShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load p shader\n");
             }
 
             size_t pBRDFLUTShaderCodeSize = 0;
-            char* pBRDFLUTShaderCode = static_cast<char*>(LoadFileContents("BRDFLUT.cso", memoryArena, &pBRDFLUTShaderCodeSize));
+            char* pBRDFLUTShaderCode = static_cast<char*>(LoadShaderCode("BRDFLUT.cso", memoryArena, &pBRDFLUTShaderCodeSize));
             if (!pBRDFLUTShaderCode) {
                 GT_LOG_ERROR("D3D11", "Failed to load brdflut shader\n");
             }
@@ -940,55 +1554,11 @@ namespace renderer
                 GT_LOG_ERROR("Renderer", "Failed to create render target for UI");
             }
 
-            gfx::ImageDesc mainRTDesc;
-            mainRTDesc.isRenderTarget = true;
-            mainRTDesc.type = gfx::ImageType::IMAGE_TYPE_2D;
-            mainRTDesc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT;
-            mainRTDesc.width = config->windowWidth;
-            mainRTDesc.height = config->windowHeight;
-            mainRTDesc.samplerDesc = &defaultSamplerStateDesc;
-            renderer->mainRT = gfx::CreateImage(renderer->gfxDevice, &mainRTDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->mainRT)) {
-                GT_LOG_ERROR("Renderer", "Failed to create main render target");
-            }
-
-            gfx::ImageDesc luminanceRTDesc;
-            luminanceRTDesc.isRenderTarget = true;
-            luminanceRTDesc.type = gfx::ImageType::IMAGE_TYPE_2D;
-            luminanceRTDesc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT;
-            luminanceRTDesc.width = config->windowWidth;
-            luminanceRTDesc.height = config->windowHeight;
-            luminanceRTDesc.samplerDesc = &defaultSamplerStateDesc;
-            renderer->luminanceRT = gfx::CreateImage(renderer->gfxDevice, &luminanceRTDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->luminanceRT)) {
-                GT_LOG_ERROR("Renderer", "Failed to create main render target");
-            }
-
-            gfx::ImageDesc bloomRTDesc;
-            bloomRTDesc.isRenderTarget = true;
-            bloomRTDesc.type = gfx::ImageType::IMAGE_TYPE_2D;
-            bloomRTDesc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT;
-            bloomRTDesc.width = config->windowWidth;
-            bloomRTDesc.height = config->windowHeight;
-            bloomRTDesc.samplerDesc = &defaultSamplerStateDesc;
-            renderer->bloomRT = gfx::CreateImage(renderer->gfxDevice, &bloomRTDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->bloomRT)) {
-                GT_LOG_ERROR("Renderer", "Failed to create main render target");
-            }
-
-            //
-            gfx::ImageDesc mainDepthBufferDesc;
-            //mainDepthBufferDesc.isRenderTarget = true;
-            mainDepthBufferDesc.isDepthStencilTarget = true;
-            mainDepthBufferDesc.type = gfx::ImageType::IMAGE_TYPE_2D;
-            mainDepthBufferDesc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT;
-            mainDepthBufferDesc.width = config->windowWidth;
-            mainDepthBufferDesc.height = config->windowHeight;
-            mainDepthBufferDesc.samplerDesc = &defaultSamplerStateDesc;
-            renderer->mainDepthBuffer = gfx::CreateImage(renderer->gfxDevice, &mainDepthBufferDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->mainDepthBuffer)) {
-                GT_LOG_ERROR("Renderer", "Failed to create main depth buffer target");
+            if (!CreateRenderGraph(&renderer->renderGraph, memoryArena, renderer->gfxDevice, &defaultSamplerStateDesc)) {
+                GT_LOG_ERROR("Renderer", "Failed to create render graph");
             }
+            renderer->width = config->windowWidth;
+            renderer->height = config->windowHeight;
 
             //
             gfx::SamplerDesc brdfLUTSamplerDesc;
@@ -1013,8 +1583,8 @@ namespace renderer
 
             for (size_t i = 0; i < Renderer::NUM_CUBEMAPS; ++i)
             {   // hdr cubemap
-                int width, height, numComponents;
-                snprintf(fileNameBuf, 512, "../../hdrCubemap%llu.hdr", i);
+                int width = 0, height = 0, numComponents = 0;
+                snprintf(fileNameBuf, 512, "../../hdrCubemap%llu.hdr", (unsigned long long)i);
 
                 stbi_set_flip_vertically_on_load(1);
                 auto image = stbi_loadf(fileNameBuf, &width, &height, &numComponents, 4);
@@ -1062,8 +1632,8 @@ namespace renderer
 
             for (size_t i = 0; i < Renderer::NUM_CUBEMAPS; ++i)
             {   // hdr cubemap
-                int width, height, numComponents;
-                snprintf(fileNameBuf, 512, "../../hdrConvolvedDiffuse%llu.hdr", i);
+                int width = 0, height = 0, numComponents = 0;
+                snprintf(fileNameBuf, 512, "../../hdrConvolvedDiffuse%llu.hdr", (unsigned long long)i);
 
                 stbi_set_flip_vertically_on_load(1);
                 auto image = stbi_loadf(fileNameBuf, &width, &height, &numComponents, 4);
@@ -1096,18 +1666,10 @@ namespace renderer
 
         {   // create constant buffers
 
-            gfx::BufferDesc cBufferDesc;
-            cBufferDesc.type = gfx::BufferType::BUFFER_TYPE_CONSTANT;
-            cBufferDesc.byteWidth = sizeof(ConstantData);
-            cBufferDesc.initialData = nullptr;
-            cBufferDesc.initialDataSize = 0;
-            cBufferDesc.usage = gfx::ResourceUsage::USAGE_STREAM;
-            renderer->cBuffer = gfx::CreateBuffer(renderer->gfxDevice, &cBufferDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->cBuffer)) {
-                GT_LOG_ERROR("Renderer", "Failed to create constant buffer");
+            if (!gfx::CreateConstantRing(renderer->gfxDevice, &renderer->constantRing, config->constantRingSize)) {
+                GT_LOG_ERROR("Renderer", "Failed to create constant ring");
             }
 
-
             gfx::BufferDesc prefilterCBufferDesc;
             prefilterCBufferDesc.type = gfx::BufferType::BUFFER_TYPE_CONSTANT;
             prefilterCBufferDesc.byteWidth = sizeof(fnd::math::float4);
@@ -1120,16 +1682,27 @@ namespace renderer
             }
         }
 
-
-        {   // create render passes
-            gfx::RenderPassDesc mainRenderPassDesc;
-            mainRenderPassDesc.colorAttachments[0].image = renderer->mainRT;
-            mainRenderPassDesc.depthStencilAttachment.image = renderer->mainDepthBuffer;
-            renderer->mainPass = gfx::CreateRenderPass(renderer->gfxDevice, &mainRenderPassDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->mainPass)) {
-                GT_LOG_ERROR("Renderer", "Failed to create main render pass");
+        {   // create bind groups
+            for (size_t i = 0; i < Renderer::NUM_CUBEMAPS; ++i) {
+                gfx::BindGroupDesc mainPassDesc;
+                for (uint32_t slot = 0; slot < 2; ++slot) {     // view constants, object constants
+                    mainPassDesc.vsConstantInputs[slot] = renderer->constantRing.buffer;
+                    mainPassDesc.psConstantInputs[slot] = renderer->constantRing.buffer;
+                    mainPassDesc.vsDynamicConstants[slot] = true;
+                    mainPassDesc.psDynamicConstants[slot] = true;
+                }
+                mainPassDesc.psImageInputs[9] = renderer->prefilteredCubemap[i];
+                mainPassDesc.psImageInputs[10] = renderer->hdrDiffuse[i];
+                mainPassDesc.psImageInputs[11] = renderer->brdfLUT;
+                renderer->mainPassBindGroup[i] = gfx::CreateBindGroup(renderer->gfxDevice, &mainPassDesc);
+                if (!GFX_CHECK_RESOURCE(renderer->mainPassBindGroup[i])) {
+                    GT_LOG_ERROR("Renderer", "Failed to create main pass bind group");
+                }
             }
+        }
 
+
+        {   // create render passes
             gfx::RenderPassDesc uiPassDesc;
             uiPassDesc.colorAttachments[0].image = renderer->uiRenderTarget;
             renderer->uiPass = gfx::CreateRenderPass(renderer->gfxDevice, &uiPassDesc);
@@ -1137,27 +1710,6 @@ namespace renderer
                 GT_LOG_ERROR("Renderer", "Failed to create render pass for UI");
             }
 
-            gfx::RenderPassDesc luminancePassDesc;
-            luminancePassDesc.colorAttachments[0].image = renderer->luminanceRT;
-            renderer->luminancePass = gfx::CreateRenderPass(renderer->gfxDevice, &luminancePassDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->luminancePass)) {
-                GT_LOG_ERROR("Renderer", "Failed to create render pass for UI");
-            }
-
-            gfx::RenderPassDesc bloomPassDesc;
-            bloomPassDesc.colorAttachments[0].image = renderer->bloomRT;
-            renderer->bloomPass = gfx::CreateRenderPass(renderer->gfxDevice, &bloomPassDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->bloomPass)) {
-                GT_LOG_ERROR("Renderer", "Failed to create render pass for UI");
-            }
-
-            gfx::RenderPassDesc bloomBlitPassDesc;
-            bloomBlitPassDesc.colorAttachments[0].image = renderer->mainRT;
-            renderer->bloomBlitPass = gfx::CreateRenderPass(renderer->gfxDevice, &bloomBlitPassDesc);
-            if (!GFX_CHECK_RESOURCE(renderer->bloomBlitPass)) {
-                GT_LOG_ERROR("Renderer", "Failed to create render pass for UI");
-            }
-
             gfx::RenderPassDesc brdfLUTPassDesc;
             brdfLUTPassDesc.colorAttachments[0].image = renderer->brdfLUT;
             renderer->brdfLUTPass = gfx::CreateRenderPass(renderer->gfxDevice, &brdfLUTPassDesc);
@@ -1226,36 +1778,95 @@ namespace renderer
 
     void DestroyRenderer(Renderer* renderer)
     {
+        if (renderer->renderGraph != nullptr) {
+            DestroyRenderGraph(renderer->renderGraph);
+        }
+        if (renderer->uploadQueue != nullptr) {
+            gfx::DestroyUploadQueue(renderer->uploadQueue);
+        }
         GT_DELETE(renderer, renderer->creationArena);
     }
 
+    static void ComputeMeshBounds(MeshData* mesh, MeshDesc* desc)
+    {
+        // @NOTE vertices are interleaved in a single stream, so the stride is the end of the last attribute
+        uint32_t positionOffset = 0;
+        uint32_t stride = 0;
+        bool hasPosition = false;
+        for (size_t i = 0; i < GFX_MAX_VERTEX_ATTRIBS; ++i) {
+            auto& attrib = desc->vertexLayout.attribs[i];
+            uint32_t size = 0;
+            switch (attrib.format) {
+            case gfx::VertexFormat::VERTEX_FORMAT_FLOAT: size = sizeof(float); break;
+            case gfx::VertexFormat::VERTEX_FORMAT_FLOAT2: size = sizeof(float) * 2; break;
+            case gfx::VertexFormat::VERTEX_FORMAT_FLOAT3: size = sizeof(float) * 3; break;
+            case gfx::VertexFormat::VERTEX_FORMAT_FLOAT4: size = sizeof(float) * 4; break;
+            case gfx::VertexFormat::VERTEX_FORMAT_R8G8B8A8_UNNORM: size = sizeof(uint32_t); break;
+            default: continue;
+            }
+            stride = attrib.offset + size > stride ? attrib.offset + size : stride;
+            if (!hasPosition && strcmp(attrib.name, "POSITION") == 0 && attrib.format == gfx::VertexFormat::VERTEX_FORMAT_FLOAT3) {
+                positionOffset = attrib.offset;
+                hasPosition = true;
+            }
+        }
+
+        size_t numVertices = stride > 0 ? desc->vertexDataSize / stride : 0;
+        if (!hasPosition || numVertices == 0) {
+            // @NOTE without positions there's nothing to go by, so the mesh gets bounds it can't be culled with,
+            // large but finite so they stay finite after transformation
+            for (int i = 0; i < 3; ++i) {
+                mesh->boundsMin[i] = -1.0e18f;
+                mesh->boundsMax[i] = 1.0e18f;
+            }
+            return;
+        }
+
+        const char* vertex = (const char*)desc->vertexData + positionOffset;
+        memcpy(mesh->boundsMin, vertex, sizeof(float) * 3);
+        memcpy(mesh->boundsMax, vertex, sizeof(float) * 3);
+        for (size_t i = 1; i < numVertices; ++i) {
+            vertex += stride;
+            float position[3];
+            memcpy(position, vertex, sizeof(float) * 3);
+            for (int j = 0; j < 3; ++j) {
+                mesh->boundsMin[j] = position[j] < mesh->boundsMin[j] ? position[j] : mesh->boundsMin[j];
+                mesh->boundsMax[j] = position[j] > mesh->boundsMax[j] ? position[j] : mesh->boundsMax[j];
+            }
+        }
+    }
+
     // @TODO these routines don't actually update existing entries
 
     bool UpdateMeshLibrary(RenderWorld* world, core::Asset assetID, MeshDesc* meshDesc, size_t numSubmeshes)
     {
         AssetToData<MeshData>* assetToData = PushAsset<MeshLibrary, MeshData>(&world->meshLibrary, assetID);
+        if (assetToData == nullptr) {
+            GT_LOG_ERROR("Renderer", "Invalid asset id %u", assetID.id);
+            return false;
+        }
+        bool isNewAsset = assetToData->data == nullptr;
         
         MeshData*   first;
         uint32_t    id = 0;
         
-        if (!world->meshLibrary.pool.Allocate(&first, &id)) { return false; }
+        if (!world->meshLibrary.pool.Allocate(&first, &id)) { return DropFailedAsset<MeshLibrary, MeshData>(&world->meshLibrary, assetID, isNewAsset); }
         MeshData* it = first;
         first->asset = assetID;
         for (size_t i = 1; i < numSubmeshes; ++i) {
             MeshData* next; 
-            if (!world->meshLibrary.pool.Allocate(&next, &id)) { return false; }    // @TODO error handling
+            if (!world->meshLibrary.pool.Allocate(&next, &id)) { return DropFailedAsset<MeshLibrary, MeshData>(&world->meshLibrary, assetID, isNewAsset); }    // @TODO error handling
             next->asset = assetID;
             it->nextSubmesh = next;
             it = next;
         }
 
-        assetToData->data = first;
-        
         it = first;
         for (size_t i = 0; i < numSubmeshes && it != nullptr; ++i) {
             auto desc = meshDesc[i];
             
             it->numElements = (uint32_t)desc.numElements;
+            ComputeMeshBounds(it, &desc);
 
             gfx::BufferDesc indexDesc;
             indexDesc.byteWidth = desc.indexDataSize;
@@ -1267,7 +1878,7 @@ namespace renderer
             it->indexFormat = desc.indexFormat;
             it->indexBuffer = gfx::CreateBuffer(world->renderer->gfxDevice, &indexDesc);
             if (!GFX_CHECK_RESOURCE(it->indexBuffer)) {
-                return false;
+                return DropFailedAsset<MeshLibrary, MeshData>(&world->meshLibrary, assetID, isNewAsset);
             }
 
             gfx::BufferDesc vertexDesc;
@@ -1281,11 +1892,21 @@ namespace renderer
             it->vertexLayout = desc.vertexLayout;
             it->vertexBuffers[0] = gfx::CreateBuffer(world->renderer->gfxDevice, &vertexDesc);
             if (!GFX_CHECK_RESOURCE(it->vertexBuffers[0])) {
-                return false;
+                return DropFailedAsset<MeshLibrary, MeshData>(&world->meshLibrary, assetID, isNewAsset);
+            }
+
+            gfx::BindGroupDesc bindGroupDesc;
+            bindGroupDesc.vertexBuffers[0] = it->vertexBuffers[0];
+            bindGroupDesc.vertexStrides[0] = sizeof(DefaultVertex);
+            bindGroupDesc.indexBuffer = it->indexBuffer;
+            it->bindGroup = gfx::CreateBindGroup(world->renderer->gfxDevice, &bindGroupDesc);
+            if (!GFX_CHECK_RESOURCE(it->bindGroup)) {
+                return DropFailedAsset<MeshLibrary, MeshData>(&world->meshLibrary, assetID, isNewAsset);
             }
 
             it = it->nextSubmesh;
         }
+        assetToData->data = first;
 
         return true;
     }
@@ -1294,15 +1915,29 @@ namespace renderer
     bool UpdateTextureLibrary(RenderWorld* world, core::Asset assetID, TextureDesc* textureDesc)
     {
         AssetToData<TextureData>* assetToData = PushAsset<TextureLibrary, TextureData>(&world->textureLibrary, assetID);
+        if (assetToData == nullptr) {
+            GT_LOG_ERROR("Renderer", "Invalid asset id %u", assetID.id);
+            return false;
+        }
+        bool isNewAsset = assetToData->data == nullptr;
         TextureData* texture;
         uint32_t id = 0;
 
-        if (!world->textureLibrary.pool.Allocate(&texture, &id)) { return false; }
+        if (!world->textureLibrary.pool.Allocate(&texture, &id)) { return DropFailedAsset<TextureLibrary, TextureData>(&world->textureLibrary, assetID, isNewAsset); }
         texture->desc = textureDesc->desc;
-        texture->image = gfx::CreateImage(world->renderer->gfxDevice, &texture->desc);
         texture->asset = assetID;
-        if (!GFX_CHECK_RESOURCE(texture->image)) {
-            return false;
+        if (world->textureStreamer != nullptr) {
+            texture->streamed = CreateStreamedTexture(world->textureStreamer, &texture->desc, textureDesc->readMip, textureDesc->readMipUserData);
+            if (texture->streamed == nullptr) {
+                return DropFailedAsset<TextureLibrary, TextureData>(&world->textureLibrary, assetID, isNewAsset);
+            }
+            texture->image = GetStreamedImage(texture->streamed);
+        }
+        else {
+            texture->image = gfx::CreateImage(world->renderer->gfxDevice, &texture->desc);
+            if (!GFX_CHECK_RESOURCE(texture->image)) {
+                return DropFailedAsset<TextureLibrary, TextureData>(&world->textureLibrary, assetID, isNewAsset);
+            }
         }
         assetToData->data = texture;
 
@@ -1312,10 +1947,15 @@ namespace renderer
     bool UpdateMaterialLibrary(RenderWorld* world, core::Asset assetID, MaterialDesc* materialDesc)
     {
         AssetToData<MaterialData>* assetToData = PushAsset<MaterialLibrary, MaterialData>(&world->materialLibrary, assetID);
+        if (assetToData == nullptr) {
+            GT_LOG_ERROR("Renderer", "Invalid asset id %u", assetID.id);
+            return false;
+        }
+        bool isNewAsset = assetToData->data == nullptr;
 
         MaterialData* material;
         uint32_t id = 0;
-        if(!world->materialLibrary.pool.Allocate(&material, &id)) { return false; }
+        if(!world->materialLibrary.pool.Allocate(&material, &id)) { return DropFailedAsset<MaterialLibrary, MaterialData>(&world->materialLibrary, assetID, isNewAsset); }
 
         material->asset = assetID;
         material->baseColorMap = LookupResource<TextureLibrary, TextureData>(&world->textureLibrary, materialDesc->baseColorMap);
@@ -1324,6 +1964,17 @@ namespace renderer
         material->normalVecMap = LookupResource<TextureLibrary, TextureData>(&world->textureLibrary, materialDesc->normalVecMap);
         material->occlusionMap = LookupResource<TextureLibrary, TextureData>(&world->textureLibrary, materialDesc->occlusionMap);
 
+        gfx::BindGroupDesc bindGroupDesc;
+        bindGroupDesc.psImageInputs[0] = material->baseColorMap->image;
+        bindGroupDesc.psImageInputs[1] = material->roughnessMap->image;
+        bindGroupDesc.psImageInputs[2] = material->metalnessMap->image;
+        bindGroupDesc.psImageInputs[3] = material->normalVecMap->image;
+        bindGroupDesc.psImageInputs[4] = material->occlusionMap->image;
+        material->bindGroup = gfx::CreateBindGroup(world->renderer->gfxDevice, &bindGroupDesc);
+        if (!GFX_CHECK_RESOURCE(material->bindGroup)) {
+            return DropFailedAsset<MaterialLibrary, MaterialData>(&world->materialLibrary, assetID, isNewAsset);
+        }
+
         assetToData->data = material;
 
         return true;
@@ -1354,8 +2005,9 @@ namespace renderer
         while (it) {
             if (outMaterials != nullptr) {
                 outMaterials[numMaterials].id = 0;
-                if (source->materials[numMaterials] != nullptr) {
-                    outMaterials[numMaterials] = source->materials[numMaterials]->asset;
+                MaterialData* material = numMaterials < source->numMaterials ? world->materials[source->firstMaterial + numMaterials] : nullptr;
+                if (material != nullptr) {
+                    outMaterials[numMaterials] = material->asset;
                 }
             }
             numMaterials++;
@@ -1378,7 +2030,7 @@ namespace renderer
         return &world->staticMeshes[index->index];
     }
 
-    StaticMesh CreateStaticMesh(RenderWorld* world, uint32_t entityID, core::Asset mesh, core::Asset* materials, size_t numMaterials)
+    StaticMesh CreateStaticMesh(RenderWorld* world, uint64_t entityID, core::Asset mesh, core::Asset* materials, size_t numMaterials)
     {
         StaticMesh meshID;
         StaticMeshRenderable* renderable = AllocateStaticMesh(world, &meshID);
@@ -1389,13 +2041,19 @@ namespace renderer
         renderable->entityID = entityID;
         renderable->handle = meshID;
         renderable->firstSubmesh = LookupResource<MeshLibrary, MeshData>(&world->meshLibrary, mesh);
-        numMaterials = numMaterials <= MAX_NUM_SUBMESHES ? numMaterials : MAX_NUM_SUBMESHES;
-        for (size_t i = 0; i < numMaterials; ++i) {
-            renderable->materials[i] = LookupResource<MaterialLibrary, MaterialData>(&world->materialLibrary, materials[i]);
-            renderable->materialAssetHandles[i] = materials[i];
+
+        // one material per submesh, unless the mesh isn't loaded and there is nothing to go by
+        size_t numSubmeshes = renderable->firstSubmesh != nullptr ? CountSubmeshes(renderable->firstSubmesh) : numMaterials;
+        renderable->firstMaterial = AllocateMaterials(world, numSubmeshes, (uint32_t)(renderable - world->staticMeshes));
+        renderable->numMaterials = (uint32_t)numSubmeshes;
+        for (size_t i = 0; i < numSubmeshes; ++i) {
+            core::Asset material = i < numMaterials ? materials[i] : core::Asset();
+            world->materials[renderable->firstMaterial + i] = LookupResource<MaterialLibrary, MaterialData>(&world->materialLibrary, material);
+            world->materialAssets[renderable->firstMaterial + i] = material;
         }
 
         renderable->meshAssetHandle = mesh;
+        UpdateRenderableProxy(world, renderable);
 
         return meshID;
     }
@@ -1411,14 +2069,20 @@ namespace renderer
 
         StaticMeshRenderable* target = &world->staticMeshes[index->index];
 
+        uint64_t proxyID = mesh.id;
+        spatial::RemoveProxies(world->renderableIndex, &proxyID, 1);
+        FreeMaterials(world, target->firstMaterial, target->numMaterials);
         memcpy(target, swap, sizeof(StaticMeshRenderable));
         swapIndex->index = index->index;
+        if (target != swap) {
+            SetMaterialOwner(world, index->index);
+        }
         
         world->firstFreeStaticMesh--;
         world->staticMeshIndices.Free(mesh.id);
     }
 
-    StaticMesh GetStaticMesh(RenderWorld* world, uint32_t entityID)
+    StaticMesh GetStaticMesh(RenderWorld* world, uint64_t entityID)
     {
         for (size_t i = 0; i < world->firstFreeStaticMesh; ++i) {
             if (entityID == world->staticMeshes[i].entityID) {
@@ -1428,7 +2092,7 @@ namespace renderer
         return { INVALID_ID };
     }
 
-    StaticMesh CopyStaticMesh(RenderWorld* world, uint32_t entityID, StaticMesh mesh)
+    StaticMesh CopyStaticMesh(RenderWorld* world, uint64_t entityID, StaticMesh mesh)
     {
         auto* index = world->staticMeshIndices.Get(mesh.id);
         assert(HANDLE_GENERATION(mesh.id) == index->generation);
@@ -1442,6 +2106,11 @@ namespace renderer
         target->entityID = entityID;
         target->handle = meshID;
 
+        target->firstMaterial = AllocateMaterials(world, source->numMaterials, (uint32_t)(target - world->staticMeshes));
+        memcpy(world->materials + target->firstMaterial, world->materials + source->firstMaterial, sizeof(MaterialData*) * source->numMaterials);
+        memcpy(world->materialAssets + target->firstMaterial, world->materialAssets + source->firstMaterial, sizeof(core::Asset) * source->numMaterials);
+        UpdateRenderableProxy(world, target);
+
         return meshID;
     }
 
@@ -1467,51 +2136,153 @@ namespace renderer
         uiPassAction.colors[0].color[3] = 1.0f;
         uiPassAction.colors[0].action = gfx::Action::ACTION_CLEAR;
         gfx::BeginRenderPass(renderer->gfxDevice, renderer->commandBuffer, renderer->uiPass, &uiPassAction);
+#ifdef _MSC_VER
         ImGui_ImplDX11_RenderDrawLists(drawData, &renderer->commandBuffer);
+#else
+        // @NOTE no UI backend outside of D3D11 yet, headless builds just clear the UI target
+#endif
         gfx::EndRenderPass(renderer->gfxDevice, renderer->commandBuffer);
     }
 
+    static gfx::PipelineState GetMeshPipeline(Renderer* renderer, MeshData* mesh)
+    {
+        if (mesh->indexFormat == gfx::IndexFormat::INDEX_FORMAT_UINT16) {
+            return renderer->meshPipeline_16bit;
+        }
+        return renderer->meshPipeline_32bit;
+    }
+
+    struct MainPassData
+    {
+        RenderWorld*    world = nullptr;
+        DrawPacket*     drawPackets = nullptr;
+        size_t          numDrawnPackets = 0;
+        gfx::DrawCall   cubemapDrawCall;
+        gfx::DrawItem   meshDrawItem;
+    };
+
+    static void ExecuteMainPass(RenderGraphContext* context, void* userData)
+    {
+        MainPassData* data = (MainPassData*)userData;
+        RenderWorld* world = data->world;
+        Renderer* renderer = world->renderer;
+        DrawPacket* drawPackets = data->drawPackets;
+        gfx::DrawItem& meshDrawItem = data->meshDrawItem;
+
+        gfx::SubmitDrawCall(context->device, context->commandBuffer, &data->cubemapDrawCall);
+
+        // @NOTE packets are sorted, so consecutive draws mostly share their mesh and material bind groups
+        MeshData* currentMesh = nullptr;
+        MaterialData* currentMaterial = nullptr;
+        for (size_t i = 0; i < data->numDrawnPackets; i += drawPackets[i].numInstances) {
+            uint32_t submesh = drawPackets[i].submesh;
+
+            // dynamic constants of the pass group: vs view, vs object, ps view, ps object
+            meshDrawItem.dynamicConstantOffsets[1] = drawPackets[i].constantOffset;
+            meshDrawItem.dynamicConstantOffsets[3] = drawPackets[i].constantOffset;
+            meshDrawItem.numInstances = drawPackets[i].numInstances;
+
+            auto mesh = world->submeshes[submesh];
+            if (mesh != currentMesh) {
+                currentMesh = mesh;
+
+                meshDrawItem.bindGroups[1] = mesh->bindGroup;
+                meshDrawItem.numElements = mesh->numElements;
+
+                gfx::PipelineState pipeline = GetMeshPipeline(renderer, mesh);
+                if (pipeline.id != meshDrawItem.pipelineState.id) {
+                    meshDrawItem.pipelineState = pipeline;
+                    world->stats.numPipelineChanges++;
+                }
+            }
+
+            auto material = world->submeshMaterials[submesh];
+            if (material != currentMaterial) {
+                currentMaterial = material;
+
+                meshDrawItem.bindGroups[2] = material->bindGroup;
+                world->stats.numMaterialChanges++;
+            }
+
+            gfx::SubmitDrawItem(context->device, context->commandBuffer, &meshDrawItem);
+            world->stats.numDrawCalls++;
+            world->stats.numInstances += drawPackets[i].numInstances;
+        }
+    }
+
+    // a full screen triangle strip reading up to two images
+    struct FullscreenPassData
+    {
+        gfx::PipelineState  pipeline;
+        RenderGraphImage    inputs[2];
+    };
+
+    static void ExecuteFullscreenPass(RenderGraphContext* context, void* userData)
+    {
+        FullscreenPassData* data = (FullscreenPassData*)userData;
+        gfx::DrawCall drawCall;
+        drawCall.pipelineState = data->pipeline;
+        drawCall.numElements = 4;
+        drawCall.psImageInputs[0] = GetImage(context->graph, data->inputs[0]);
+        drawCall.psImageInputs[1] = GetImage(context->graph, data->inputs[1]);
+        gfx::SubmitDrawCall(context->device, context->commandBuffer, &drawCall);
+    }
+
+    static RenderGraphPass AddFullscreenPass(RenderGraph* graph, const char* name, FullscreenPassData* data, gfx::PipelineState pipeline, RenderGraphImage input0, RenderGraphImage input1 = RenderGraphImage())
+    {
+        data->pipeline = pipeline;
+        data->inputs[0] = input0;
+        data->inputs[1] = input1;
+        RenderGraphPass pass = AddPass(graph, name, &ExecuteFullscreenPass, data);
+        ReadImage(graph, pass, input0);
+        if (input1.id != gfx::INVALID_ID) {
+            ReadImage(graph, pass, input1);
+        }
+        return pass;
+    }
+
     void Render(RenderWorld* world, gfx::SwapChain swapChain)
     {
         Renderer* renderer = world->renderer;
-        
-        gfx::RenderPassAction clearAllAction;
-        clearAllAction.colors[0].action = gfx::Action::ACTION_CLEAR;
-        clearAllAction.depth.action = gfx::Action::ACTION_CLEAR;
-        float pink[] = { 1.0f, 192.0f / 255.0f, 203.0f / 255.0f, 1.0f };
-        memcpy(clearAllAction.colors[0].color, pink, sizeof(float) * 4);
 
         renderer->activeCubemap = renderer->activeCubemap < Renderer::NUM_CUBEMAPS ? renderer->activeCubemap : Renderer::NUM_CUBEMAPS - 1;
 
-        {   // initial cbuffer setup
-            void* cBufferMem = gfx::MapBuffer(renderer->gfxDevice, renderer->cBuffer, gfx::MapType::MAP_WRITE_DISCARD);
-            if (cBufferMem != nullptr) {
-                ConstantData object;
-                util::Make4x4FloatMatrixIdentity(object.MVP);
-                util::Make4x4FloatMatrixIdentity(object.MV);
-                util::Make4x4FloatMatrixIdentity(object.VP);
-                util::Make4x4FloatMatrixIdentity(object.view);
-                util::Make4x4FloatMatrixIdentity(object.projection);
-                util::Make4x4FloatMatrixIdentity(object.model);
-
-                float modelView[16];
-                util::MultiplyMatricesCM(world->cameraTransform, object.model, modelView);
-                util::MultiplyMatricesCM(world->cameraProjection, modelView, object.MVP);
-                util::Copy4x4FloatMatrixCM(world->cameraTransform, object.view);
-                util::Inverse4x4FloatMatrixCM(world->cameraTransform, object.inverseView);
-                util::Copy4x4FloatMatrixCM(object.model, object.model);
-                util::Copy4x4FloatMatrixCM(modelView, object.MV);
-                util::Copy4x4FloatMatrixCM(world->cameraProjection, object.projection);
-                util::MultiplyMatricesCM(world->cameraProjection, world->cameraTransform, object.VP);
-
-                object.color = fnd::math::float4();
-                object.lightDir = fnd::math::float4(1.0f, -1.0f, 0.0f, 0.0f);
-                object.roughness = 0.0f;
-                object.metallic = 0.0f;
-                object.useTextures = 1;
-                memcpy(cBufferMem, &object, sizeof(ConstantData));
-                gfx::UnmapBuffer(renderer->gfxDevice, renderer->cBuffer);
-            }
+        gfx::UploadQueueStats uploadStats;
+        if (renderer->uploadQueue != nullptr) {
+            gfx::ProcessUploads(renderer->uploadQueue);
+            gfx::GetUploadQueueStats(renderer->uploadQueue, &uploadStats);
+        }
+
+        // @NOTE all constants of the frame are written to the ring up front, between here and EndConstantRing
+        if (!gfx::BeginConstantRing(renderer->gfxDevice, &renderer->constantRing)) {
+            GT_LOG_ERROR("Renderer", "Failed to map the constant ring");
+            return;
+        }
+
+        uint32_t cubemapConstantsOffset = 0;
+        uint32_t viewConstantsOffset = 0;
+        {   // per view constants
+            ViewConstants* viewConstants = (ViewConstants*)gfx::AllocateConstants(&renderer->constantRing, sizeof(ViewConstants), &viewConstantsOffset);
+            util::MultiplyMatricesCM(world->cameraProjection, world->cameraTransform, viewConstants->VP);
+            util::Copy4x4FloatMatrixCM(world->cameraTransform, viewConstants->view);
+            util::Inverse4x4FloatMatrixCM(world->cameraTransform, viewConstants->inverseView);
+            util::Copy4x4FloatMatrixCM(world->cameraProjection, viewConstants->projection);
+            viewConstants->lightDir = fnd::math::float4(1.0f, -1.0f, 0.0f, 0.0f);
+
+            // the cubemap shaders still read the combined layout
+            ConstantData* object = (ConstantData*)gfx::AllocateConstants(&renderer->constantRing, sizeof(ConstantData), &cubemapConstantsOffset);
+            util::Copy4x4FloatMatrixCM(viewConstants->VP, object->MVP);
+            util::Copy4x4FloatMatrixCM(world->cameraTransform, object->MV);
+            util::Copy4x4FloatMatrixCM(viewConstants->VP, object->VP);
+            util::Copy4x4FloatMatrixCM(world->cameraTransform, object->view);
+            util::Copy4x4FloatMatrixCM(viewConstants->inverseView, object->inverseView);
+            util::Copy4x4FloatMatrixCM(world->cameraProjection, object->projection);
+            util::Make4x4FloatMatrixIdentity(object->model);
+            object->color = fnd::math::float4();
+            object->lightDir = viewConstants->lightDir;
+            object->roughness = 0.0f;
+            object->metallic = 0.0f;
+            object->useTextures = 1;
         }
 
         // if this is the first frame:
@@ -1521,192 +2292,258 @@ namespace renderer
             
         }
 
-        // Draw calls
-        gfx::DrawCall cubemapDrawCall;
-        gfx::DrawCall meshDrawCall;
+        size_t numVisible = 0;
+        {   // frustum culling, of the renderables through the spatial index first and then of their submeshes one by one
+            double cullingStart = GetTimeMilliseconds();
 
-        {   // prepare draw calls
-
-            cubemapDrawCall.vertexBuffers[0] = renderer->cubeVertexBuffer;
-            cubemapDrawCall.vertexOffsets[0] = 0;
-            cubemapDrawCall.vertexStrides[0] = sizeof(float) * 3;
-            cubemapDrawCall.indexBuffer = renderer->cubeIndexBuffer;
-            cubemapDrawCall.numElements = 36;
-            cubemapDrawCall.pipelineState = renderer->cubemapPipeline;
-            cubemapDrawCall.vsConstantInputs[0] = renderer->cBuffer;
-            cubemapDrawCall.psImageInputs[0] = renderer->prefilteredCubemap[renderer->activeCubemap];
-
-            meshDrawCall.psImageInputs[9] = renderer->prefilteredCubemap[renderer->activeCubemap];
-            meshDrawCall.psImageInputs[10] = renderer->hdrDiffuse[renderer->activeCubemap];
-            meshDrawCall.psImageInputs[11] = renderer->brdfLUT;
-        }
+            float viewProjection[16];
+            util::MultiplyMatricesCM(world->cameraProjection, world->cameraTransform, viewProjection);
+            spatial::Frustum frustum;
+            spatial::ExtractFrustumPlanes(viewProjection, &frustum);
 
-        {   // main render pass
-            gfx::BeginRenderPass(renderer->gfxDevice, renderer->commandBuffer, renderer->mainPass, &clearAllAction);
-
-            gfx::SubmitDrawCall(renderer->gfxDevice, renderer->commandBuffer, &cubemapDrawCall);
-            
+            size_t numRenderables = spatial::GetNumProxies(world->renderableIndex);
+            if (numRenderables > world->visibleRenderableCapacity) {
+                if (world->visibleRenderables != nullptr) {
+                    GT_DELETE_ARRAY(world->visibleRenderables, world->creationArena);
+                }
+                world->visibleRenderableCapacity = numRenderables * 2;
+                world->visibleRenderables = GT_NEW_ARRAY(uint64_t, world->visibleRenderableCapacity, world->creationArena);
+            }
+            size_t numVisibleRenderables = spatial::QueryFrustum(world->renderableIndex, &frustum, world->visibleRenderables, numRenderables);
 
-            for (size_t i = 0; i < world->firstFreeStaticMesh; ++i) {
-                auto staticMesh = &world->staticMeshes[i];
-                
-                //GT_LOG_DEBUG("Renderer", "Rendering mesh #%llu", i);
-
-                void* cBufferMem = gfx::MapBuffer(renderer->gfxDevice, renderer->cBuffer, gfx::MapType::MAP_WRITE_DISCARD);
-                if (cBufferMem != nullptr) {
-                    ConstantData object;
-                    util::Make4x4FloatMatrixIdentity(object.MVP);
-                    util::Make4x4FloatMatrixIdentity(object.MV);
-                    util::Make4x4FloatMatrixIdentity(object.VP);
-                    util::Make4x4FloatMatrixIdentity(object.view);
-                    util::Make4x4FloatMatrixIdentity(object.projection);
-                    util::Make4x4FloatMatrixIdentity(object.model);
-
-                    util::Copy4x4FloatMatrixCM(staticMesh->transform, object.model);
-
-                    float modelView[16];
-                    util::MultiplyMatricesCM(world->cameraTransform, object.model, modelView);
-                    util::MultiplyMatricesCM(world->cameraProjection, modelView, object.MVP);
-                    util::Copy4x4FloatMatrixCM(world->cameraTransform, object.view);
-                    util::Inverse4x4FloatMatrixCM(world->cameraTransform, object.inverseView);
-                    util::Copy4x4FloatMatrixCM(object.model, object.model);
-                    util::Copy4x4FloatMatrixCM(modelView, object.MV);
-                    util::Copy4x4FloatMatrixCM(world->cameraProjection, object.projection);
-                    util::MultiplyMatricesCM(world->cameraProjection, world->cameraTransform, object.VP);
-
-                    object.color = fnd::math::float4();
-                    object.lightDir = fnd::math::float4(1.0f, -1.0f, 0.0f, 0.0f);
-                    object.roughness = 0.0f;
-                    object.metallic = 0.0f;
-                    object.useTextures = 1;
-                    memcpy(cBufferMem, &object, sizeof(ConstantData));
-                    gfx::UnmapBuffer(renderer->gfxDevice, renderer->cBuffer);
+            size_t numSubmeshes = 0;
+            for (size_t i = 0; i < numVisibleRenderables; ++i) {
+                auto staticMesh = &world->staticMeshes[world->staticMeshIndices.Get(world->visibleRenderables[i])->index];
+                MaterialData** materials = world->materials + staticMesh->firstMaterial;
+                size_t materialIndex = 0;
+                for (auto it = staticMesh->firstSubmesh; it != nullptr && materialIndex < staticMesh->numMaterials; it = it->nextSubmesh) {
+                    if (materials[materialIndex++] != nullptr) { numSubmeshes++; }
                 }
-                meshDrawCall.vsConstantInputs[0] = renderer->cBuffer;
-                meshDrawCall.psConstantInputs[0] = renderer->cBuffer;
+            }
+            ReserveSubmeshBuffers(world, numSubmeshes);
 
+            spatial::AABBArrays* bounds = &world->submeshBounds;
+            size_t submesh = 0;
+            for (size_t i = 0; i < numVisibleRenderables; ++i) {
+                uint32_t renderableIndex = world->staticMeshIndices.Get(world->visibleRenderables[i])->index;
+                auto staticMesh = &world->staticMeshes[renderableIndex];
+                MaterialData** materials = world->materials + staticMesh->firstMaterial;
                 size_t materialIndex = 0;
-                auto it = staticMesh->firstSubmesh;
-                while (it != nullptr) {
-              
-                    if (staticMesh->materials[materialIndex++] != nullptr) {
-                        auto material = staticMesh->materials[materialIndex - 1];
-                        
-                        meshDrawCall.vertexBuffers[0] = it->vertexBuffers[0];
-                        meshDrawCall.vertexOffsets[0] = 0;
-                        meshDrawCall.vertexStrides[0] = sizeof(DefaultVertex);
-
-                        meshDrawCall.indexBuffer = it->indexBuffer;
-
-                        if (it->indexFormat == gfx::IndexFormat::INDEX_FORMAT_UINT16) {
-                            meshDrawCall.pipelineState = renderer->meshPipeline_16bit;
-                        }
-                        else {
-                            meshDrawCall.pipelineState = renderer->meshPipeline_32bit;
-                        }
-
-                        meshDrawCall.numElements = it->numElements;
-
-                        meshDrawCall.psImageInputs[0] = material->baseColorMap->image;
-                        meshDrawCall.psImageInputs[1] = material->roughnessMap->image;
-                        meshDrawCall.psImageInputs[2] = material->metalnessMap->image;
-                        meshDrawCall.psImageInputs[3] = material->normalVecMap->image;;
-                        meshDrawCall.psImageInputs[4] = material->occlusionMap->image;
-                        
-                        gfx::SubmitDrawCall(renderer->gfxDevice, renderer->commandBuffer, &meshDrawCall);
-                    }
-                    it = it->nextSubmesh;
+                for (auto it = staticMesh->firstSubmesh; it != nullptr && materialIndex < staticMesh->numMaterials; it = it->nextSubmesh) {
+                    auto material = materials[materialIndex++];
+                    if (material == nullptr) { continue; }
+
+                    spatial::AABB localBounds, worldBounds;
+                    memcpy(localBounds.min, it->boundsMin, sizeof(float) * 3);
+                    memcpy(localBounds.max, it->boundsMax, sizeof(float) * 3);
+                    spatial::TransformAABB(&localBounds, staticMesh->transform, &worldBounds);
+                    bounds->minX[submesh] = worldBounds.min[0];
+                    bounds->minY[submesh] = worldBounds.min[1];
+                    bounds->minZ[submesh] = worldBounds.min[2];
+                    bounds->maxX[submesh] = worldBounds.max[0];
+                    bounds->maxY[submesh] = worldBounds.max[1];
+                    bounds->maxZ[submesh] = worldBounds.max[2];
+
+                    world->submeshes[submesh] = it;
+                    world->submeshMaterials[submesh] = material;
+                    world->submeshRenderables[submesh] = renderableIndex;
+                    submesh++;
                 }
             }
-            gfx::EndRenderPass(renderer->gfxDevice, renderer->commandBuffer);
+            numVisible = spatial::CullAABBs(&frustum, bounds, 0, numSubmeshes, world->visibleSubmeshes);
+
+            world->stats = RenderStats();
+            world->stats.numRenderables = (uint32_t)numRenderables;
+            world->stats.numRenderablesCulled = (uint32_t)(numRenderables - numVisibleRenderables);
+            world->stats.numSubmeshes = (uint32_t)numSubmeshes;
+            world->stats.numSubmeshesCulled = (uint32_t)(numSubmeshes - numVisible);
+            world->stats.cullingTime = GetTimeMilliseconds() - cullingStart;
+            world->stats.numUploads = uploadStats.numCopies;
+            world->stats.uploadedBytes = uploadStats.copiedBytes;
         }
 
-        gfx::RenderPassAction blitAction;
+        DrawPacket* drawPackets = world->drawPackets;
+        {   // draw packets
+            const float* view = world->cameraTransform;
+            const spatial::AABBArrays* bounds = &world->submeshBounds;
+
+            for (size_t i = 0; i < numVisible; ++i) {
+                uint32_t submesh = world->visibleSubmeshes[i];
+                MeshData* mesh = world->submeshes[submesh];
+
+                float center[3] = {
+                    0.5f * (bounds->minX[submesh] + bounds->maxX[submesh]),
+                    0.5f * (bounds->minY[submesh] + bounds->maxY[submesh]),
+                    0.5f * (bounds->minZ[submesh] + bounds->maxZ[submesh])
+                };
+                float depth = view[2] * center[0] + view[6] * center[1] + view[10] * center[2] + view[14];
+
+                uint32_t pipeline = HANDLE_INDEX(GetMeshPipeline(renderer, mesh).id);
+                uint32_t material = (uint32_t)(world->submeshMaterials[submesh] - world->materialLibrary.pool.buffer);
+                uint32_t meshIndex = (uint32_t)(mesh - world->meshLibrary.pool.buffer);
+                drawPackets[i].key = MakeSortKey(DRAW_PASS_MAIN, pipeline, material, meshIndex, depth);
+                drawPackets[i].submesh = submesh;
+            }
+            drawPackets = SortDrawPackets(world->drawPackets, world->sortedDrawPackets, numVisible);
+        }
 
-        {   // luminance
-            blitAction.colors[0].action = gfx::Action::ACTION_CLEAR;
+        if (world->textureStreamer != nullptr) {   // texture streaming, by the size of the bounding sphere on screen
+            const float* view = world->cameraTransform;
+            const spatial::AABBArrays* bounds = &world->submeshBounds;
+            float pixelsPerUnit = 0.5f * world->cameraProjection[5] * (float)renderer->height;
+
+            for (size_t i = 0; i < numVisible; ++i) {
+                uint32_t submesh = world->visibleSubmeshes[i];
+                float extents[3] = {
+                    bounds->maxX[submesh] - bounds->minX[submesh],
+                    bounds->maxY[submesh] - bounds->minY[submesh],
+                    bounds->maxZ[submesh] - bounds->minZ[submesh]
+                };
+                float center[3] = {
+                    bounds->minX[submesh] + 0.5f * extents[0],
+                    bounds->minY[submesh] + 0.5f * extents[1],
+                    bounds->minZ[submesh] + 0.5f * extents[2]
+                };
+                float radius = 0.5f * sqrtf(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]);
+                float depth = view[2] * center[0] + view[6] * center[1] + view[10] * center[2] + view[14];
+                // @NOTE submeshes the camera is inside of get all mips
+                float screenSize = depth > radius ? 2.0f * radius * pixelsPerUnit / depth : 65536.0f;
+
+                MaterialData* material = world->submeshMaterials[submesh];
+                TextureData* textures[] = { material->baseColorMap, material->roughnessMap, material->metalnessMap, material->normalVecMap, material->occlusionMap };
+                for (TextureData* texture : textures) {
+                    if (texture != nullptr && texture->streamed != nullptr) {
+                        RequestTextureMips(world->textureStreamer, texture->streamed, screenSize);
+                    }
+                }
+            }
+            UpdateTextureStreaming(world->textureStreamer);
 
-            gfx::DrawCall luminanceDrawCall;
-            luminanceDrawCall.pipelineState = renderer->luminancePipeline;
-            luminanceDrawCall.numElements = 4;
-            luminanceDrawCall.psImageInputs[0] = renderer->mainRT;
+            TextureStreamingStats streamingStats;
+            GetTextureStreamingStats(world->textureStreamer, &streamingStats);
+            world->stats.streamedTextureBytes = streamingStats.residentBytes;
+            world->stats.numTextureUploads = streamingStats.numUploads;
+            world->stats.numTextureEvictions = streamingStats.numEvictions;
+        }
 
-            gfx::BeginRenderPass(renderer->gfxDevice, renderer->commandBuffer, renderer->luminancePass, &blitAction);
-            gfx::SubmitDrawCall(renderer->gfxDevice, renderer->commandBuffer, &luminanceDrawCall);
-            gfx::EndRenderPass(renderer->gfxDevice, renderer->commandBuffer);
+        size_t numDrawnPackets = 0;
+        {   // instancing, packets with the same mesh and material are adjacent after sorting and go out as one draw
+            for (size_t i = 0; i < numVisible; i += drawPackets[i].numInstances) {
+                MeshData* mesh = world->submeshes[drawPackets[i].submesh];
+                MaterialData* material = world->submeshMaterials[drawPackets[i].submesh];
+                uint32_t numInstances = 1;
+                while (i + numInstances < numVisible && numInstances < MAX_INSTANCES_PER_DRAW
+                    && world->submeshes[drawPackets[i + numInstances].submesh] == mesh
+                    && world->submeshMaterials[drawPackets[i + numInstances].submesh] == material) {
+                    numInstances++;
+                }
 
-            blitAction.colors[0].action = gfx::Action::ACTION_LOAD;
+                uint32_t size = (uint32_t)(offsetof(ObjectConstants, models) + sizeof(float) * 16 * numInstances);
+                ObjectConstants* object = (ObjectConstants*)gfx::AllocateConstants(&renderer->constantRing, size, &drawPackets[i].constantOffset);
+                if (object == nullptr) {
+                    GT_LOG_ERROR("Renderer", "Constant ring is full, skipping %llu of %llu visible submeshes", (unsigned long long)(numVisible - i), (unsigned long long)numVisible);
+                    break;
+                }
+                object->color = fnd::math::float4();
+                object->roughness = 0.0f;
+                object->metallic = 0.0f;
+                object->useTextures = 1;
+                for (uint32_t j = 0; j < numInstances; ++j) {
+                    uint32_t renderable = world->submeshRenderables[drawPackets[i + j].submesh];
+                    util::Copy4x4FloatMatrixCM(world->staticMeshes[renderable].transform, object->models[j]);
+                }
+                drawPackets[i].numInstances = numInstances;
+                numDrawnPackets = i + numInstances;
+            }
         }
 
-        {   // bloom blur
-            blitAction.colors[0].action = gfx::Action::ACTION_CLEAR;
-
-            gfx::DrawCall blurDrawCall;
-            blurDrawCall.pipelineState = renderer->bloomPipeline;
-            blurDrawCall.numElements = 4;
-            blurDrawCall.psImageInputs[0] = renderer->mainRT;
-            blurDrawCall.psImageInputs[1] = renderer->luminanceRT;
+        gfx::EndConstantRing(renderer->gfxDevice, &renderer->constantRing);
 
-            gfx::BeginRenderPass(renderer->gfxDevice, renderer->commandBuffer, renderer->bloomPass, &blitAction);
-            gfx::SubmitDrawCall(renderer->gfxDevice, renderer->commandBuffer, &blurDrawCall);
-            gfx::EndRenderPass(renderer->gfxDevice, renderer->commandBuffer);
-        }
+        MainPassData mainPass;
+        mainPass.world = world;
+        mainPass.drawPackets = drawPackets;
+        mainPass.numDrawnPackets = numDrawnPackets;
 
-        /*
-        {   // bloom blit
-            blitAction.colors[0].action = gfx::Action::ACTION_LOAD;
+        {   // prepare draw calls
+            gfx::DrawCall& cubemapDrawCall = mainPass.cubemapDrawCall;
+            gfx::DrawItem& meshDrawItem = mainPass.meshDrawItem;
 
-            gfx::DrawCall blitDrawCall;
-            blitDrawCall.pipelineState = renderer->blitPipeline;
-            blitDrawCall.numElements = 4;
-    
-            blitDrawCall.psImageInputs[0] = renderer->bloomRT;
-            gfx::BeginRenderPass(renderer->gfxDevice, renderer->commandBuffer, renderer->bloomBlitPass, &blitAction);
-            gfx::SubmitDrawCall(renderer->gfxDevice, renderer->commandBuffer, &blitDrawCall);
-            gfx::EndRenderPass(renderer->gfxDevice, renderer->commandBuffer);
-        }*/
+            cubemapDrawCall.vertexBuffers[0] = renderer->cubeVertexBuffer;
+            cubemapDrawCall.vertexOffsets[0] = 0;
+            cubemapDrawCall.vertexStrides[0] = sizeof(float) * 3;
+            cubemapDrawCall.indexBuffer = renderer->cubeIndexBuffer;
+            cubemapDrawCall.numElements = 36;
+            cubemapDrawCall.pipelineState = renderer->cubemapPipeline;
+            cubemapDrawCall.vsConstantInputs[0] = renderer->constantRing.buffer;
+            cubemapDrawCall.vsConstantOffsets[0] = cubemapConstantsOffset;
+            cubemapDrawCall.psImageInputs[0] = renderer->prefilteredCubemap[renderer->activeCubemap];
 
-        {   // tonemapping
-            blitAction.colors[0].action = gfx::Action::ACTION_CLEAR;
+            meshDrawItem.bindGroups[0] = renderer->mainPassBindGroup[renderer->activeCubemap];
+            meshDrawItem.dynamicConstantOffsets[0] = viewConstantsOffset;
+            meshDrawItem.dynamicConstantOffsets[2] = viewConstantsOffset;
+        }
 
-            gfx::DrawCall tonemapDrawCall;
-            tonemapDrawCall.pipelineState = renderer->tonemapPipeline;
-            tonemapDrawCall.numElements = 4;
-            tonemapDrawCall.psImageInputs[0] = renderer->mainRT;
+        RenderGraph* graph = renderer->renderGraph;
+        FullscreenPassData luminancePass, bloomPass, tonemapPass, uiBlurPass, uiBlitPass;
+        {   // frame graph
+            BeginRenderGraph(graph);
+
+            TransientImageDesc hdrDesc;
+            hdrDesc.width = (uint16_t)renderer->width;
+            hdrDesc.height = (uint16_t)renderer->height;
+            hdrDesc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_R16G16B16A16_FLOAT;
+            TransientImageDesc depthDesc = hdrDesc;
+            depthDesc.pixelFormat = gfx::PixelFormat::PIXEL_FORMAT_D32_FLOAT_S8X24_UINT;
+            depthDesc.isDepthStencilTarget = true;
+
+            RenderGraphImage backbuffer = ImportSwapChain(graph, "backbuffer", swapChain);
+            RenderGraphImage ui = ImportImage(graph, "ui", renderer->uiRenderTarget);     // written by RenderUI
+            RenderGraphImage hdr = CreateTransientImage(graph, "hdr", &hdrDesc);
+            RenderGraphImage depth = CreateTransientImage(graph, "depth", &depthDesc);
+            RenderGraphImage luminance = CreateTransientImage(graph, "luminance", &hdrDesc);
+            RenderGraphImage bloom = CreateTransientImage(graph, "bloom", &hdrDesc);
+
+            gfx::ColorAttachmentAction clearColor;
+            clearColor.action = gfx::Action::ACTION_CLEAR;
+            gfx::ColorAttachmentAction loadColor;
+            loadColor.action = gfx::Action::ACTION_LOAD;
+            gfx::ColorAttachmentAction clearPink = clearColor;
+            float pink[] = { 1.0f, 192.0f / 255.0f, 203.0f / 255.0f, 1.0f };
+            memcpy(clearPink.color, pink, sizeof(float) * 4);
+            gfx::DepthAttachmentAction clearDepth;
+            clearDepth.action = gfx::Action::ACTION_CLEAR;
 
-            gfx::BeginDefaultRenderPass(renderer->gfxDevice, renderer->commandBuffer, swapChain, &blitAction);
-            gfx::SubmitDrawCall(renderer->gfxDevice, renderer->commandBuffer, &tonemapDrawCall);
-            gfx::EndRenderPass(renderer->gfxDevice, renderer->commandBuffer);
+            RenderGraphPass pass = AddPass(graph, "main", &ExecuteMainPass, &mainPass);
+            WriteColor(graph, pass, hdr, &clearPink);
+            WriteDepthStencil(graph, pass, depth, &clearDepth, nullptr);
 
+            pass = AddFullscreenPass(graph, "luminance", &luminancePass, renderer->luminancePipeline, hdr);
+            WriteColor(graph, pass, luminance, &clearColor);
 
-            blitAction.colors[0].action = gfx::Action::ACTION_LOAD;
-        }
+            pass = AddFullscreenPass(graph, "bloom", &bloomPass, renderer->bloomPipeline, hdr, luminance);
+            WriteColor(graph, pass, bloom, &clearColor);
 
-        {   // UI blur
-            gfx::DrawCall blurDrawCall;
-            blurDrawCall.pipelineState = renderer->blurPipeline;
-            blurDrawCall.numElements = 4;
-            blurDrawCall.psImageInputs[0] = renderer->mainRT;
-            blurDrawCall.psImageInputs[1] = renderer->uiRenderTarget;
+            // @NOTE the bloom composite is disabled, so nothing reads bloom and the graph culls it along with luminance
 
-            gfx::BeginDefaultRenderPass(renderer->gfxDevice, renderer->commandBuffer, swapChain, &blitAction);
-            gfx::SubmitDrawCall(renderer->gfxDevice, renderer->commandBuffer, &blurDrawCall);
-            gfx::EndRenderPass(renderer->gfxDevice, renderer->commandBuffer);
-        }
+            pass = AddFullscreenPass(graph, "tonemap", &tonemapPass, renderer->tonemapPipeline, hdr);
+            WriteColor(graph, pass, backbuffer, &clearColor);
 
-        {   // UI blit
+            pass = AddFullscreenPass(graph, "ui blur", &uiBlurPass, renderer->blurPipeline, hdr, ui);
+            WriteColor(graph, pass, backbuffer, &loadColor);
 
-            gfx::DrawCall blitDrawCall;
-            blitDrawCall.pipelineState = renderer->blitPipeline;
-            blitDrawCall.numElements = 4;
-            blitDrawCall.psImageInputs[0] = renderer->mainRT;
+            pass = AddFullscreenPass(graph, "ui blit", &uiBlitPass, renderer->blitPipeline, ui);
+            WriteColor(graph, pass, backbuffer, &loadColor);
+        }
 
-            blitDrawCall.psImageInputs[0] = renderer->uiRenderTarget;
-            gfx::BeginDefaultRenderPass(renderer->gfxDevice, renderer->commandBuffer, swapChain, &blitAction);
-            gfx::SubmitDrawCall(renderer->gfxDevice, renderer->commandBuffer, &blitDrawCall);
-            gfx::EndRenderPass(renderer->gfxDevice, renderer->commandBuffer);
+        if (CompileRenderGraph(graph)) {
+            ExecuteRenderGraph(graph, renderer->commandBuffer);
         }
 
+        RenderGraphStats graphStats;
+        GetRenderGraphStats(graph, &graphStats);
+        world->stats.numRenderPasses = graphStats.numPasses - graphStats.numPassesCulled;
+        world->stats.numRenderPassesCulled = graphStats.numPassesCulled;
+        world->stats.renderTargetBytes = graphStats.physicalBytes;
 
         frameIndex++;
     }
@@ -1716,6 +2553,11 @@ namespace renderer
     {
         return &world->renderer->activeCubemap;
     }
+
+    void GetRenderStats(RenderWorld* world, RenderStats* outStats)
+    {
+        *outStats = world->stats;
+    }
         
 }
 
@@ -1757,5 +2599,7 @@ bool renderer_get_interface(renderer::RendererInterface* outInterface)
 
     outInterface->GetActiveCubemap = &renderer::GetActiveCubemap;
 
+    outInterface->GetRenderStats = &renderer::GetRenderStats;
+
     return true;
 }
\ No newline at end of file
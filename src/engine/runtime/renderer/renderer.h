@@ -17,7 +17,7 @@ namespace renderer
 {
     struct Transform
     {
-        uint32_t entityID = 0;
+        uint64_t entityID = 0;
         float transform[16];
     };
 
@@ -51,6 +51,10 @@ namespace renderer
         size_t meshLibrarySize      = DEFAULT_LIBRARY_SIZE;
         size_t textureLibrarySize   = DEFAULT_LIBRARY_SIZE;
         size_t materialLibrarySize  = DEFAULT_LIBRARY_SIZE;
+
+        // bytes of texture mips streamed in by screen size, 0 creates textures with all mips resident
+        uint64_t textureStreamingBudget     = 0;
+        uint32_t numTextureStreamingThreads = 2;
     
         Renderer* renderer          = nullptr;
     };
@@ -68,6 +72,15 @@ namespace renderer
 
         uint32_t    windowWidth = 0;
         uint32_t    windowHeight = 0;
+
+        // constants written per frame, 256 bytes per visible renderable plus a few for the view
+        uint32_t    constantRingSize = 4 * 1024 * 1024;
+
+        // staging memory that texture streaming reads mips into, they are copied in at the start of the next frames.
+        // it's allocated for the first render world with a textureStreamingBudget, streaming is enabled per world by
+        // that alone. mesh and texture data passed to the libraries is already in memory and creates immutable
+        // resources right away instead, a copy through the ring would only add to it
+        size_t      uploadRingSize = 64 * 1024 * 1024;
     };
 
     bool CreateRenderer(Renderer** outRenderer, fnd::memory::MemoryArenaBase* memoryArena, RendererConfig* config);
@@ -89,6 +102,10 @@ namespace renderer
     struct TextureDesc
     {
         gfx::ImageDesc desc;
+        // reads mips of streamed textures on a streaming thread, without it they are copied to a temporary spill file
+        // reads mips of streamed textures on a streaming thread, without it the initial data is kept around
+        bool    (*readMip)(void* userData, uint32_t mip, void* buffer, size_t size) = nullptr;
+        void*   readMipUserData = nullptr;
     };
 
     struct MaterialDesc
@@ -110,11 +127,11 @@ namespace renderer
 
     gfx::Image GetTextureHandle(RenderWorld* world, core::Asset assetID);
 
-    StaticMesh CreateStaticMesh(RenderWorld* world, uint32_t entityID, core::Asset mesh, core::Asset* materials, size_t numMaterials);
+    StaticMesh CreateStaticMesh(RenderWorld* world, uint64_t entityID, core::Asset mesh, core::Asset* materials, size_t numMaterials);
     void DestroyStaticMesh(RenderWorld* world, StaticMesh mesh);
 
-    StaticMesh GetStaticMesh(RenderWorld* world, uint32_t entityID);
-    StaticMesh CopyStaticMesh(RenderWorld* world, uint32_t entityID, StaticMesh mesh);
+    StaticMesh GetStaticMesh(RenderWorld* world, uint64_t entityID);
+    StaticMesh CopyStaticMesh(RenderWorld* world, uint64_t entityID, StaticMesh mesh);
 
     core::Asset GetMeshAsset(RenderWorld* world, StaticMesh mesh);
     void GetMaterials(RenderWorld* world, StaticMesh mesh, core::Asset* outMaterials, size_t* outNumMaterials);
@@ -132,48 +149,74 @@ namespace renderer
 
     size_t*     GetActiveCubemap(RenderWorld* world);
 
+    // counters of the last call to Render
+    struct RenderStats
+    {
+        uint32_t    numRenderables = 0;         // with a loaded mesh, culled through the spatial index
+        uint32_t    numRenderablesCulled = 0;
+        uint32_t    numSubmeshes = 0;           // submeshes with a material of the renderables in the frustum, tested one by one
+        uint32_t    numSubmeshesCulled = 0;
+        uint32_t    numDrawCalls = 0;           // mesh draw calls of the main pass
+        uint32_t    numInstances = 0;           // submeshes drawn by them
+        uint32_t    numPipelineChanges = 0;
+        uint32_t    numMaterialChanges = 0;
+        double      cullingTime = 0.0;          // milliseconds
+        uint32_t    numRenderPasses = 0;        // render graph passes that ran
+        uint32_t    numRenderPassesCulled = 0;
+        uint64_t    renderTargetBytes = 0;      // transient render targets after aliasing
+        uint64_t    streamedTextureBytes = 0;   // texture mips resident because of their screen size
+        uint32_t    numTextureUploads = 0;
+        uint32_t    numTextureEvictions = 0;
+        uint32_t    numUploads = 0;             // streamed mips copied in at the start of the frame
+        uint64_t    uploadedBytes = 0;
+    };
+
+    void GetRenderStats(RenderWorld* world, RenderStats* outStats);
+
     struct RendererInterface
     {
-        decltype(CreateRenderWorld)*        CreateRenderWorld = nullptr;
-        decltype(DestroyRenderWorld)*       DestroyRenderWorld = nullptr;
+        decltype(renderer::CreateRenderWorld)* CreateRenderWorld = nullptr;
+        decltype(renderer::DestroyRenderWorld)* DestroyRenderWorld = nullptr;
 
-        decltype(SerializeRenderWorld)*     SerializeRenderWorld = nullptr;
-        decltype(DeserializeRenderWorld)*   DeserializeRenderWorld = nullptr;
+        decltype(renderer::SerializeRenderWorld)* SerializeRenderWorld = nullptr;
+        decltype(renderer::DeserializeRenderWorld)* DeserializeRenderWorld = nullptr;
 
-        decltype(UpdateMeshLibrary)*        UpdateMeshLibrary = nullptr;
-        decltype(UpdateTextureLibrary)*     UpdateTextureLibrary = nullptr;
-        decltype(UpdateMaterialLibrary)*    UpdateMaterialLibrary = nullptr;
-        decltype(CreateStaticMesh)*         CreateStaticMesh = nullptr;
-        decltype(DestroyStaticMesh)*        DestroyStaticMesh = nullptr;
-        decltype(GetStaticMesh)*            GetStaticMesh = nullptr;
+        decltype(renderer::UpdateMeshLibrary)* UpdateMeshLibrary = nullptr;
+        decltype(renderer::UpdateTextureLibrary)* UpdateTextureLibrary = nullptr;
+        decltype(renderer::UpdateMaterialLibrary)* UpdateMaterialLibrary = nullptr;
+        decltype(renderer::CreateStaticMesh)* CreateStaticMesh = nullptr;
+        decltype(renderer::DestroyStaticMesh)* DestroyStaticMesh = nullptr;
+        decltype(renderer::GetStaticMesh)*  GetStaticMesh = nullptr;
 
-        decltype(GetMeshAsset)*             GetMeshAsset = nullptr;
-        decltype(GetMaterials)*             GetMaterials = nullptr;
+        decltype(renderer::GetMeshAsset)*   GetMeshAsset = nullptr;
+        decltype(renderer::GetMaterials)*   GetMaterials = nullptr;
 
-        decltype(CopyStaticMesh)*           CopyStaticMesh = nullptr;
+        decltype(renderer::CopyStaticMesh)* CopyStaticMesh = nullptr;
 
-        decltype(Render)*                   Render = nullptr;
-        decltype(RenderUI)*                 RenderUI = nullptr;
+        decltype(renderer::Render)*         Render = nullptr;
+        decltype(renderer::RenderUI)*       RenderUI = nullptr;
 
-        decltype(GetTextureHandle)*         GetTextureHandle = nullptr;
+        decltype(renderer::GetTextureHandle)* GetTextureHandle = nullptr;
 
-        decltype(CreateRenderer)*           CreateRenderer = nullptr;
-        decltype(DestroyRenderer)*          DestroyRenderer = nullptr;
+        decltype(renderer::CreateRenderer)* CreateRenderer = nullptr;
+        decltype(renderer::DestroyRenderer)* DestroyRenderer = nullptr;
 
-        decltype(SetCameraTransform)*       SetCameraTransform = nullptr;
-        decltype(SetCameraProjection)*      SetCameraProjection = nullptr;
+        decltype(renderer::SetCameraTransform)* SetCameraTransform = nullptr;
+        decltype(renderer::SetCameraProjection)* SetCameraProjection = nullptr;
         
-        decltype(GetCameraTransform)*       GetCameraTransform = nullptr;
-        decltype(GetCameraProjection)*      GetCameraProjection = nullptr;
+        decltype(renderer::GetCameraTransform)* GetCameraTransform = nullptr;
+        decltype(renderer::GetCameraProjection)* GetCameraProjection = nullptr;
 
-        decltype(UpdateWorldState)*         UpdateWorldState = nullptr;
+        decltype(renderer::UpdateWorldState)* UpdateWorldState = nullptr;
     
-        decltype(GetActiveCubemap)*         GetActiveCubemap = nullptr;
+        decltype(renderer::GetActiveCubemap)* GetActiveCubemap = nullptr;
+
+        decltype(renderer::GetRenderStats)* GetRenderStats = nullptr;
     };
 }
 
 extern "C"
 {
-    __declspec(dllexport)
+    GT_DLL_EXPORT
     bool renderer_get_interface(renderer::RendererInterface* outInterface);
 }
@@ -0,0 +1,643 @@
+#include "texture_streaming.h"
+#include <foundation/memory/memory.h>
+#include <foundation/logging/logging.h>
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define NO_MIP 0xffffffff
+#define TEXTURE_STREAMING_MAX_WORKERS 8
+#define MAX_STREAMED_MIPS 16
+
+namespace renderer
+{
+    struct TextureStreamer;
+
+    struct StreamedTexture
+    {
+        TextureStreamer*    streamer = nullptr;
+        gfx::ImageDesc      desc;                   // without the pointers of the desc it was created from
+        gfx::Image          image;
+        bool                isStreamed = false;
+        bool                isSpilling = false;     // its mips are still being written to the spill file
+
+        uint32_t            minResidentMip = 0;     // this and all smaller mips are always resident
+        uint32_t            residentMip = 0;
+        uint32_t            firstReadableMip = 0;   // reading the mip before it failed
+        uint32_t            pendingMip = NO_MIP;
+        uint32_t            wantedMip = NO_MIP;     // only valid if the texture was used this frame
+        uint64_t            lastUsedFrame = 0;
+
+        // only touched by worker threads while reading
+        ReadMipFunc         readMip = nullptr;
+        void*               userData = nullptr;
+        uint64_t            mipOffsets[MAX_STREAMED_MIPS];  // of the streamed mips in the spill file if there's no readMip
+
+        // all textures, most recently used first
+        StreamedTexture*    prev = nullptr;
+        StreamedTexture*    next = nullptr;
+    };
+
+    enum class MipRequestState : uint8_t
+    {
+        REQUEST_EMPTY,
+        REQUEST_QUEUED,         // waiting for a worker
+        REQUEST_READING,        // or writing, for spills
+        REQUEST_READ,           // waiting to be submitted to the upload queue on the render thread
+        REQUEST_FAILED,
+        REQUEST_UPLOADING       // submitted, the mip is resident once the fence completes
+    };
+
+    struct MipRequest
+    {
+        MipRequestState     state = MipRequestState::REQUEST_EMPTY;
+        StreamedTexture*    texture = nullptr;
+        uint32_t            mip = 0;
+        size_t              size = 0;
+        gfx::UploadFence    fence = 0;
+        void*               data = nullptr;     // in the upload ring
+        bool                isSpill = false;    // writes a copy of the texture's streamed mips to the spill file instead
+    };
+
+    struct StreamerLock
+    {
+#ifdef _MSC_VER
+        SRWLOCK             lock = SRWLOCK_INIT;
+        CONDITION_VARIABLE  condition = CONDITION_VARIABLE_INIT;
+
+        void Lock() { AcquireSRWLockExclusive(&lock); }
+        void Unlock() { ReleaseSRWLockExclusive(&lock); }
+        void Wait() { SleepConditionVariableSRW(&condition, &lock, INFINITE, 0); }
+        void WakeAll() { WakeAllConditionVariable(&condition); }
+#else
+        pthread_mutex_t     mutex = PTHREAD_MUTEX_INITIALIZER;
+        pthread_cond_t      condition = PTHREAD_COND_INITIALIZER;
+
+        void Lock() { pthread_mutex_lock(&mutex); }
+        void Unlock() { pthread_mutex_unlock(&mutex); }
+        void Wait() { pthread_cond_wait(&condition, &mutex); }
+        void WakeAll() { pthread_cond_broadcast(&condition); }
+#endif
+    };
+
+    struct TextureStreamer
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+        gfx::Device*            device = nullptr;
+        gfx::UploadQueue*       uploadQueue = nullptr;
+        TextureStreamingConfig  config;
+
+        StreamedTexture*        first = nullptr;
+        StreamedTexture*        last = nullptr;
+        uint64_t                frame = 1;
+
+        // guarded by the lock, workers only take queued requests and mark them as read
+        StreamerLock            lock;
+        MipRequest*             requests = nullptr;
+        bool                    isRunning = true;
+#ifdef _MSC_VER
+        HANDLE                  threads[TEXTURE_STREAMING_MAX_WORKERS];
+#else
+        pthread_t               threads[TEXTURE_STREAMING_MAX_WORKERS];
+#endif
+        uint32_t                numThreads = 0;
+
+        // streamed mips of textures without readMip, opened on first use. the render thread reserves space at the end,
+        // workers write it
+#ifdef _MSC_VER
+        HANDLE                  spillFile = INVALID_HANDLE_VALUE;
+#else
+        FILE*                   spillFile = nullptr;
+#endif
+        bool                    isSpillFileOpen = false;
+        bool                    hasSpillFileFailed = false;
+        uint64_t                spillFileSize = 0;
+
+        TextureStreamingStats   stats;
+    };
+
+    static MipRequest* FindRequest(TextureStreamer* streamer, MipRequestState state)
+    {
+        for (uint32_t i = 0; i < streamer->config.maxPendingMips; ++i) {
+            if (streamer->requests[i].state == state) { return &streamer->requests[i]; }
+        }
+        return nullptr;
+    }
+
+    // temporary file that is deleted once it's closed
+    static bool OpenSpillFile(TextureStreamer* streamer)
+    {
+        if (streamer->isSpillFileOpen || streamer->hasSpillFileFailed) { return streamer->isSpillFileOpen; }
+#ifdef _MSC_VER
+        char directory[MAX_PATH + 1];
+        char path[MAX_PATH + 1];
+        if (GetTempPathA(sizeof(directory), directory) > 0 && GetTempFileNameA(directory, "gts", 0, path) != 0) {
+            streamer->spillFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        }
+        streamer->isSpillFileOpen = streamer->spillFile != INVALID_HANDLE_VALUE;
+#else
+        streamer->spillFile = tmpfile();
+        streamer->isSpillFileOpen = streamer->spillFile != nullptr;
+#endif
+        if (!streamer->isSpillFileOpen) {
+            GT_LOG_ERROR("Renderer", "Failed to create the texture streaming spill file, textures without readMip are fully resident");
+            streamer->hasSpillFileFailed = true;
+        }
+        return streamer->isSpillFileOpen;
+    }
+
+    static void CloseSpillFile(TextureStreamer* streamer)
+    {
+        if (!streamer->isSpillFileOpen) { return; }
+#ifdef _MSC_VER
+        CloseHandle(streamer->spillFile);
+#else
+        fclose(streamer->spillFile);
+#endif
+        streamer->isSpillFileOpen = false;
+    }
+
+    // positioned, so workers can read while the render thread appends
+    static bool WriteSpillFile(TextureStreamer* streamer, uint64_t offset, const void* data, size_t size)
+    {
+#ifdef _MSC_VER
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD bytesWritten = 0;
+        return WriteFile(streamer->spillFile, data, (DWORD)size, &bytesWritten, &overlapped) && bytesWritten == size;
+#else
+        return pwrite(fileno(streamer->spillFile), data, size, (off_t)offset) == (ssize_t)size;
+#endif
+    }
+
+    static bool ReadSpillFile(TextureStreamer* streamer, uint64_t offset, void* buffer, size_t size)
+    {
+#ifdef _MSC_VER
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD bytesRead = 0;
+        return ReadFile(streamer->spillFile, buffer, (DWORD)size, &bytesRead, &overlapped) && bytesRead == size;
+#else
+        return pread(fileno(streamer->spillFile), buffer, size, (off_t)offset) == (ssize_t)size;
+#endif
+    }
+
+    static bool ReadSpilledMip(void* userData, uint32_t mip, void* buffer, size_t size)
+    {
+        StreamedTexture* texture = (StreamedTexture*)userData;
+        return ReadSpillFile(texture->streamer, texture->mipOffsets[mip], buffer, size);
+    }
+
+    static void ProcessRequests(TextureStreamer* streamer)
+    {
+        streamer->lock.Lock();
+        for (;;) {
+            MipRequest* request = nullptr;
+            while (streamer->isRunning && (request = FindRequest(streamer, MipRequestState::REQUEST_QUEUED)) == nullptr) {
+                streamer->lock.Wait();
+            }
+            if (!streamer->isRunning) { break; }
+
+            request->state = MipRequestState::REQUEST_READING;
+            StreamedTexture* texture = request->texture;
+            streamer->lock.Unlock();
+            bool isRead = request->isSpill ? WriteSpillFile(streamer, texture->mipOffsets[0], request->data, request->size)
+                : texture->readMip(texture->userData, request->mip, request->data, request->size);
+            streamer->lock.Lock();
+            request->state = isRead ? MipRequestState::REQUEST_READ : MipRequestState::REQUEST_FAILED;
+            streamer->lock.WakeAll();   // for DestroyStreamedTexture waiting on the read
+        }
+        streamer->lock.Unlock();
+    }
+
+#ifdef _MSC_VER
+    static DWORD WINAPI WorkerThread(void* data)
+    {
+        ProcessRequests((TextureStreamer*)data);
+        return 0;
+    }
+#else
+    static void* WorkerThread(void* data)
+    {
+        ProcessRequests((TextureStreamer*)data);
+        return nullptr;
+    }
+#endif
+
+    /**
+        Copies the mips into one block at the end of the spill file and has a worker write it, the copy is freed once
+        it's written. If all requests are busy the block is written right away instead, blocking the calling thread.
+        @NOTE space of destroyed textures isn't reused, the file only shrinks when the streamer is destroyed
+    */
+    static bool SpillMips(TextureStreamer* streamer, StreamedTexture* texture, gfx::ImageDesc* desc, uint32_t numMips)
+    {
+        size_t size = 0;
+        for (uint32_t mip = 0; mip < numMips; ++mip) {
+            size += gfx::GetImageMipSize(&texture->desc, mip);
+        }
+        char* data = GT_NEW_ARRAY(char, size, streamer->memoryArena);
+        size_t offset = 0;
+        for (uint32_t mip = 0; mip < numMips; ++mip) {
+            size_t mipSize = gfx::GetImageMipSize(&texture->desc, mip);
+            size_t dataSize = desc->initialDataSizes != nullptr && desc->initialDataSizes[mip] < mipSize ? desc->initialDataSizes[mip] : mipSize;
+            memcpy(data + offset, desc->initialData[mip], dataSize);
+            memset(data + offset + dataSize, 0x0, mipSize - dataSize);
+            texture->mipOffsets[mip] = streamer->spillFileSize + offset;
+            offset += mipSize;
+        }
+
+        streamer->lock.Lock();
+        MipRequest* request = FindRequest(streamer, MipRequestState::REQUEST_EMPTY);
+        if (request != nullptr) {
+            request->texture = texture;
+            request->size = size;
+            request->data = data;
+            request->isSpill = true;
+            request->state = MipRequestState::REQUEST_QUEUED;
+            texture->isSpilling = true;
+            streamer->lock.WakeAll();
+        }
+        streamer->lock.Unlock();
+
+        bool isWritten = request != nullptr || WriteSpillFile(streamer, streamer->spillFileSize, data, size);
+        if (request == nullptr) {
+            GT_DELETE_ARRAY(data, streamer->memoryArena);
+        }
+        if (!isWritten) {
+            GT_LOG_ERROR("Renderer", "Failed to write %u mips to the texture streaming spill file", numMips);
+            return false;
+        }
+        streamer->spillFileSize += size;
+        return true;
+    }
+
+    bool CreateTextureStreamer(TextureStreamer** outStreamer, fnd::memory::MemoryArenaBase* memoryArena, gfx::Device* device, gfx::UploadQueue* uploadQueue, TextureStreamingConfig* config)
+    {
+        if (config->maxPendingMips == 0) {
+            GT_LOG_ERROR("Renderer", "Texture streaming needs at least %u pending mip", 1);
+            return false;
+        }
+        TextureStreamer* streamer = GT_NEW(TextureStreamer, memoryArena);
+        streamer->memoryArena = memoryArena;
+        streamer->device = device;
+        streamer->uploadQueue = uploadQueue;
+        streamer->config = *config;
+        streamer->requests = GT_NEW_ARRAY(MipRequest, config->maxPendingMips, memoryArena);
+        streamer->stats.budget = config->budget;
+
+        uint32_t numWorkers = config->numWorkerThreads > 0 ? config->numWorkerThreads : 1;
+        numWorkers = numWorkers < TEXTURE_STREAMING_MAX_WORKERS ? numWorkers : TEXTURE_STREAMING_MAX_WORKERS;
+        for (uint32_t i = 0; i < numWorkers; ++i) {
+#ifdef _MSC_VER
+            streamer->threads[streamer->numThreads] = CreateThread(nullptr, 0, WorkerThread, streamer, 0, nullptr);
+            bool isStarted = streamer->threads[streamer->numThreads] != NULL;
+#else
+            bool isStarted = pthread_create(&streamer->threads[streamer->numThreads], nullptr, WorkerThread, streamer) == 0;
+#endif
+            if (!isStarted) {
+                GT_LOG_ERROR("Renderer", "Failed to start texture streaming thread %u, continuing with %u", i, streamer->numThreads);
+                break;
+            }
+            streamer->numThreads++;
+        }
+        if (streamer->numThreads == 0) {
+            GT_DELETE_ARRAY(streamer->requests, memoryArena);
+            GT_DELETE(streamer, memoryArena);
+            return false;
+        }
+
+        *outStreamer = streamer;
+        return true;
+    }
+
+    // gives the ring space or the spill copy back, the render thread owns requests that aren't queued or being read
+    static void ReleaseRequest(TextureStreamer* streamer, MipRequest* request)
+    {
+        if (request->isSpill) {
+            GT_DELETE_ARRAY((char*)request->data, streamer->memoryArena);
+            request->texture->isSpilling = false;
+        }
+        else {
+            gfx::CancelUpload(streamer->uploadQueue, request->fence);
+            request->texture->pendingMip = NO_MIP;
+        }
+        *request = MipRequest();
+    }
+
+    // waits for the texture's request that is being read, if any, and drops all of them
+    static void CancelRequests(TextureStreamer* streamer, StreamedTexture* texture)
+    {
+        streamer->lock.Lock();
+        for (uint32_t i = 0; i < streamer->config.maxPendingMips; ++i) {
+            MipRequest* request = &streamer->requests[i];
+            if (request->texture != texture) { continue; }
+            while (request->state == MipRequestState::REQUEST_READING) {
+                streamer->lock.Wait();
+            }
+            streamer->stats.residentBytes -= request->isSpill ? 0 : request->size;
+            ReleaseRequest(streamer, request);
+        }
+        streamer->lock.Unlock();
+    }
+
+    static uint64_t GetStreamedBytes(StreamedTexture* texture)
+    {
+        uint64_t size = 0;
+        for (uint32_t mip = texture->residentMip; mip < texture->minResidentMip; ++mip) {
+            size += gfx::GetImageMipSize(&texture->desc, mip);
+        }
+        return size;
+    }
+
+    static void FreeTexture(TextureStreamer* streamer, StreamedTexture* texture)
+    {
+        gfx::DestroyImage(streamer->device, texture->image);
+        GT_DELETE(texture, streamer->memoryArena);
+    }
+
+    void DestroyTextureStreamer(TextureStreamer* streamer)
+    {
+        streamer->lock.Lock();
+        streamer->isRunning = false;
+        streamer->lock.WakeAll();
+        streamer->lock.Unlock();
+        for (uint32_t i = 0; i < streamer->numThreads; ++i) {
+#ifdef _MSC_VER
+            WaitForSingleObject(streamer->threads[i], INFINITE);
+            CloseHandle(streamer->threads[i]);
+#else
+            pthread_join(streamer->threads[i], nullptr);
+#endif
+        }
+
+        for (uint32_t i = 0; i < streamer->config.maxPendingMips; ++i) {
+            if (streamer->requests[i].state != MipRequestState::REQUEST_EMPTY) {
+                ReleaseRequest(streamer, &streamer->requests[i]);
+            }
+        }
+        StreamedTexture* texture = streamer->first;
+        while (texture != nullptr) {
+            StreamedTexture* next = texture->next;
+            FreeTexture(streamer, texture);
+            texture = next;
+        }
+        CloseSpillFile(streamer);
+        GT_DELETE_ARRAY(streamer->requests, streamer->memoryArena);
+        GT_DELETE(streamer, streamer->memoryArena);
+    }
+
+    static void Unlink(TextureStreamer* streamer, StreamedTexture* texture)
+    {
+        if (texture->prev != nullptr) { texture->prev->next = texture->next; }
+        else { streamer->first = texture->next; }
+        if (texture->next != nullptr) { texture->next->prev = texture->prev; }
+        else { streamer->last = texture->prev; }
+        texture->prev = texture->next = nullptr;
+    }
+
+    static void PushFront(TextureStreamer* streamer, StreamedTexture* texture)
+    {
+        texture->next = streamer->first;
+        if (streamer->first != nullptr) { streamer->first->prev = texture; }
+        streamer->first = texture;
+        if (streamer->last == nullptr) { streamer->last = texture; }
+    }
+
+    StreamedTexture* CreateStreamedTexture(TextureStreamer* streamer, gfx::ImageDesc* desc, ReadMipFunc readMip, void* userData)
+    {
+        StreamedTexture* texture = GT_NEW(StreamedTexture, streamer->memoryArena);
+        texture->streamer = streamer;
+        texture->desc = *desc;
+        texture->desc.samplerDesc = nullptr;
+        texture->desc.numDataItems = 0;
+        texture->desc.initialData = nullptr;
+        texture->desc.initialDataSizes = nullptr;
+
+        // the first mip that fits is always resident, smaller images aren't streamed at all
+        uint32_t numMipmaps = desc->numMipmaps;
+        uint32_t minResidentMip = 0;
+        while (minResidentMip + 1 < numMipmaps
+            && ((uint32_t)desc->width >> minResidentMip > streamer->config.minResidentSize || (uint32_t)desc->height >> minResidentMip > streamer->config.minResidentSize)) {
+            minResidentMip++;
+        }
+        bool isStreamable = desc->type == gfx::ImageType::IMAGE_TYPE_2D && desc->numSlices == 1 && !desc->isRenderTarget && !desc->isDepthStencilTarget
+            && numMipmaps <= MAX_STREAMED_MIPS && desc->numDataItems == numMipmaps;
+        texture->isStreamed = isStreamable && minResidentMip > 0;
+        if (texture->isStreamed && readMip == nullptr) {
+            // mips that aren't resident are read back from the spill file instead of being kept in memory
+            texture->isStreamed = OpenSpillFile(streamer) && SpillMips(streamer, texture, desc, minResidentMip);
+        }
+
+        gfx::ImageDesc imageDesc = *desc;
+        if (texture->isStreamed) {
+            imageDesc.isStreamed = true;
+            imageDesc.firstResidentMip = (uint16_t)minResidentMip;
+            imageDesc.numDataItems = numMipmaps - minResidentMip;
+            imageDesc.initialData = desc->initialData + minResidentMip;
+            imageDesc.initialDataSizes = desc->initialDataSizes != nullptr ? desc->initialDataSizes + minResidentMip : nullptr;
+        }
+        texture->image = gfx::CreateImage(streamer->device, &imageDesc);
+        if (!GFX_CHECK_RESOURCE(texture->image)) {
+            CancelRequests(streamer, texture);
+            GT_DELETE(texture, streamer->memoryArena);
+            return nullptr;
+        }
+        texture->desc.isStreamed = texture->isStreamed;
+        texture->minResidentMip = texture->residentMip = texture->isStreamed ? minResidentMip : 0;
+        texture->readMip = readMip != nullptr ? readMip : &ReadSpilledMip;
+        texture->userData = readMip != nullptr ? userData : texture;
+
+        PushFront(streamer, texture);
+        streamer->stats.numTextures++;
+        streamer->stats.numStreamedTextures += texture->isStreamed ? 1 : 0;
+        return texture;
+    }
+
+    void DestroyStreamedTexture(TextureStreamer* streamer, StreamedTexture* texture)
+    {
+        CancelRequests(streamer, texture);
+
+        streamer->stats.residentBytes -= GetStreamedBytes(texture);
+        streamer->stats.numTextures--;
+        streamer->stats.numStreamedTextures -= texture->isStreamed ? 1 : 0;
+        Unlink(streamer, texture);
+        FreeTexture(streamer, texture);
+    }
+
+    gfx::Image GetStreamedImage(StreamedTexture* texture)
+    {
+        return texture->image;
+    }
+
+    void RequestTextureMips(TextureStreamer* streamer, StreamedTexture* texture, float screenSize)
+    {
+        if (!texture->isStreamed) { return; }
+
+        // the smallest mip that still has a texel for every pixel
+        uint32_t size = texture->desc.width > texture->desc.height ? texture->desc.width : texture->desc.height;
+        uint32_t mip = 0;
+        while (mip < texture->minResidentMip && (float)(size >> (mip + 1)) >= screenSize) {
+            mip++;
+        }
+
+        if (texture->lastUsedFrame != streamer->frame) {
+            texture->lastUsedFrame = streamer->frame;
+            texture->wantedMip = mip;
+            Unlink(streamer, texture);
+            PushFront(streamer, texture);
+        }
+        else if (mip < texture->wantedMip) {
+            texture->wantedMip = mip;
+        }
+    }
+
+    static void EvictTexture(TextureStreamer* streamer, StreamedTexture* texture)
+    {
+        if (!gfx::SetImageResidentMips(streamer->device, texture->image, texture->minResidentMip)) {
+            return;
+        }
+        streamer->stats.residentBytes -= GetStreamedBytes(texture);
+        streamer->stats.numEvictions++;
+        texture->residentMip = texture->minResidentMip;
+    }
+
+    // evicts the textures that were used least recently until size more bytes fit into the budget
+    static bool MakeRoom(TextureStreamer* streamer, uint64_t size)
+    {
+        StreamedTexture* texture = streamer->last;
+        while (streamer->stats.residentBytes + size > streamer->config.budget && texture != nullptr && texture->lastUsedFrame != streamer->frame) {
+            if (texture->residentMip < texture->minResidentMip && texture->pendingMip == NO_MIP) {
+                EvictTexture(streamer, texture);
+            }
+            texture = texture->prev;
+        }
+        return streamer->stats.residentBytes + size <= streamer->config.budget;
+    }
+
+    static void FailRequest(TextureStreamer* streamer, MipRequest* request)
+    {
+        StreamedTexture* texture = request->texture;
+        GT_LOG_ERROR("Renderer", "Failed to stream in mip %u of image 0x%08x", request->mip, texture->image.id);
+        streamer->stats.residentBytes -= request->size;
+        texture->firstReadableMip = request->mip + 1;
+        streamer->lock.Lock();
+        ReleaseRequest(streamer, request);
+        streamer->lock.Unlock();
+    }
+
+    // without its spilled mips the texture keeps the ones that are always resident
+    static void FinishSpill(TextureStreamer* streamer, MipRequest* request, bool isWritten)
+    {
+        StreamedTexture* texture = request->texture;
+        if (!isWritten) {
+            GT_LOG_ERROR("Renderer", "Failed to write the mips of image 0x%08x to the texture streaming spill file", texture->image.id);
+            texture->firstReadableMip = texture->minResidentMip;
+        }
+        streamer->lock.Lock();
+        ReleaseRequest(streamer, request);
+        streamer->lock.Unlock();
+    }
+
+    // the worker reads straight into the upload ring, the queue copies the mip at the start of a later frame
+    static bool IssueRequest(TextureStreamer* streamer, MipRequest* request, StreamedTexture* texture, uint32_t mip, size_t size)
+    {
+        gfx::UploadFence fence = 0;
+        void* data = gfx::AllocateUpload(streamer->uploadQueue, size, &fence);
+        if (data == nullptr) {
+            return false;
+        }
+
+        texture->pendingMip = mip;
+        streamer->stats.residentBytes += size;
+        streamer->lock.Lock();
+        request->texture = texture;
+        request->mip = mip;
+        request->size = size;
+        request->fence = fence;
+        request->data = data;
+        request->state = MipRequestState::REQUEST_QUEUED;
+        streamer->lock.WakeAll();
+        streamer->lock.Unlock();
+        return true;
+    }
+
+    void UpdateTextureStreaming(TextureStreamer* streamer)
+    {
+        streamer->stats.numUploads = 0;
+        streamer->stats.numEvictions = 0;
+        streamer->stats.numOverBudget = 0;
+
+        uint32_t numFree = 0;
+        for (uint32_t i = 0; i < streamer->config.maxPendingMips; ++i) {
+            MipRequest* request = &streamer->requests[i];
+            streamer->lock.Lock();
+            MipRequestState state = request->state;
+            if (state == MipRequestState::REQUEST_READ && !request->isSpill) {
+                gfx::SubmitImageUpload(streamer->uploadQueue, request->fence, request->texture->image, request->mip, 1);
+                request->state = state = MipRequestState::REQUEST_UPLOADING;
+            }
+            streamer->lock.Unlock();
+
+            if (request->isSpill && (state == MipRequestState::REQUEST_READ || state == MipRequestState::REQUEST_FAILED)) {
+                FinishSpill(streamer, request, state == MipRequestState::REQUEST_READ);
+                state = MipRequestState::REQUEST_EMPTY;
+            }
+            else if (state == MipRequestState::REQUEST_FAILED) {
+                FailRequest(streamer, request);
+                state = MipRequestState::REQUEST_EMPTY;
+            }
+            else if (state == MipRequestState::REQUEST_UPLOADING && gfx::IsUploadComplete(streamer->uploadQueue, request->fence)) {
+                // @NOTE the upload made the mip resident right before copying it
+                request->texture->residentMip = request->mip;
+                request->texture->pendingMip = NO_MIP;
+                streamer->stats.numUploads++;
+                streamer->lock.Lock();
+                *request = MipRequest();
+                streamer->lock.Unlock();
+                state = MipRequestState::REQUEST_EMPTY;
+            }
+            numFree += state == MipRequestState::REQUEST_EMPTY ? 1 : 0;
+        }
+
+        // textures used this frame are at the front, the ones used least recently get the remaining free requests
+        for (StreamedTexture* texture = streamer->first; texture != nullptr && texture->lastUsedFrame == streamer->frame && numFree > 0; texture = texture->next) {
+            if (!texture->isStreamed || texture->isSpilling || texture->pendingMip != NO_MIP || texture->wantedMip >= texture->residentMip) { continue; }
+            uint32_t mip = texture->residentMip - 1;
+            if (mip < texture->firstReadableMip) { continue; }
+
+            size_t size = gfx::GetImageMipSize(&texture->desc, mip);
+            if (!MakeRoom(streamer, size)) {
+                streamer->stats.numOverBudget++;
+                continue;
+            }
+            streamer->lock.Lock();
+            MipRequest* request = FindRequest(streamer, MipRequestState::REQUEST_EMPTY);
+            streamer->lock.Unlock();
+            if (request == nullptr || !IssueRequest(streamer, request, texture, mip, size)) {
+                streamer->stats.numOverBudget++;    // the upload ring is full
+                break;
+            }
+            numFree--;
+        }
+
+        streamer->stats.numPendingMips = streamer->config.maxPendingMips - numFree;
+        streamer->frame++;
+    }
+
+    void GetTextureStreamingStats(TextureStreamer* streamer, TextureStreamingStats* outStats)
+    {
+        *outStats = streamer->stats;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <engine/runtime/gfx/gfx.h>
+
+namespace fnd { namespace memory { class MemoryArenaBase; } }
+
+namespace renderer
+{
+    /**
+        Texture streaming. Streamed textures are created with only their small mips resident, down from the first
+        one that fits into minResidentSize. While culling, the renderer tells the streamer how large the textures of
+        visible submeshes appear on screen, and the streamer makes the mips resident that this needs: worker threads
+        read them straight into the ring of an upload queue, which copies them into the image at the start of a later
+        frame. Mips are added one at a time, larger ones only after all smaller ones are in.
+        Mips above the always resident ones count against a budget. When a new mip doesn't fit, the textures that
+        were used least recently lose their streamed mips, textures used in the current frame are never evicted.
+    */
+    struct TextureStreamer;
+    struct StreamedTexture;
+
+    // fills a mip of the texture, called on a worker thread
+    typedef bool(*ReadMipFunc)(void* userData, uint32_t mip, void* buffer, size_t size);
+
+    struct TextureStreamingConfig
+    {
+        uint64_t    budget = 256 * 1024 * 1024;     // bytes of streamed mips, the always resident ones don't count
+        uint32_t    minResidentSize = 64;           // texels along the larger side of the largest mip that is always resident
+        uint32_t    numWorkerThreads = 2;
+        uint32_t    maxPendingMips = 16;            // being read or waiting to be copied
+    };
+
+    struct TextureStreamingStats
+    {
+        uint32_t    numTextures = 0;
+        uint32_t    numStreamedTextures = 0;        // with mips that aren't always resident
+        uint64_t    residentBytes = 0;              // of streamed mips, including pending ones
+        uint64_t    budget = 0;
+        uint32_t    numPendingMips = 0;
+
+        // of the last update
+        uint32_t    numUploads = 0;
+        uint32_t    numEvictions = 0;               // textures that lost their streamed mips
+        uint32_t    numOverBudget = 0;              // mips that were needed but didn't fit into the budget or the upload ring
+    };
+
+    // uploadQueue has to outlive the streamer and be processed every frame
+    bool CreateTextureStreamer(TextureStreamer** outStreamer, fnd::memory::MemoryArenaBase* memoryArena, gfx::Device* device, gfx::UploadQueue* uploadQueue, TextureStreamingConfig* config);
+    // waits for the worker threads, destroys all textures
+    void DestroyTextureStreamer(TextureStreamer* streamer);
+
+    /**
+        desc describes the whole image including initial data for all of its mips. Images that can't be streamed,
+        e.g. cubemaps or small ones, are created with all mips resident.
+        Without readMip the mips that aren't resident right away are written to a temporary spill file and read back
+        from there. They are copied and written by a worker thread, the copy is freed once it's written and the
+        texture streams in once it is. Only if all pending mips are in use the file is written on the calling thread.
+        If the file can't be created the texture is fully resident instead.
+        With readMip, it has to stay callable with userData until the texture is destroyed.
+    */
+    StreamedTexture* CreateStreamedTexture(TextureStreamer* streamer, gfx::ImageDesc* desc, ReadMipFunc readMip, void* userData);
+    void DestroyStreamedTexture(TextureStreamer* streamer, StreamedTexture* texture);
+    gfx::Image GetStreamedImage(StreamedTexture* texture);
+
+    // the texture is drawn this frame, spanning about screenSize pixels along the larger side of its first mip
+    void RequestTextureMips(TextureStreamer* streamer, StreamedTexture* texture, float screenSize);
+
+    // once per frame after all requests and outside of render passes: copies read mips, evicts and starts new reads
+    void UpdateTextureStreaming(TextureStreamer* streamer);
+    void GetTextureStreamingStats(TextureStreamer* streamer, TextureStreamingStats* outStats);
+}
@@ -28,10 +28,10 @@ namespace runtime
     struct UIContext;
     struct UIContextConfig
     {
-        decltype(CreateWindow)*  CreateWindowCallback;
-        decltype(DestroyWindow)* DestroyWindowCallback;
-        decltype(GetWindowSize)* GetWindowSizeCallback;
-        decltype(SetWindowSize)* SetWindowSizeCallback;
+        decltype(runtime::CreateWindow)* CreateWindowCallback;
+        decltype(runtime::DestroyWindow)* DestroyWindowCallback;
+        decltype(runtime::GetWindowSize)* GetWindowSizeCallback;
+        decltype(runtime::SetWindowSize)* SetWindowSizeCallback;
     
         void* rendererUserData = nullptr;
         void (*RenderViewCallback) (void* window, ImDrawData* drawData, void* userData);
@@ -51,16 +51,16 @@ namespace runtime
 
     struct RuntimeInterface
     {
-        decltype(SetMainWindowTitle)*       SetMainWindowTitle = nullptr;
-        decltype(GetImGuiContextForView)*   GetImGuiContextForView = nullptr;
-        decltype(BeginView)*                BeginView = nullptr;
-        decltype(EndView)*                  EndView = nullptr;
+        decltype(runtime::SetMainWindowTitle)* SetMainWindowTitle = nullptr;
+        decltype(runtime::GetImGuiContextForView)* GetImGuiContextForView = nullptr;
+        decltype(runtime::BeginView)*       BeginView = nullptr;
+        decltype(runtime::EndView)*         EndView = nullptr;
     };
 }
 
 
 extern "C"
 {
-    __declspec(dllexport)
+    GT_DLL_EXPORT
     bool runtime_get_interface(runtime::RuntimeInterface* outInterface);
 }
\ No newline at end of file
@@ -0,0 +1,822 @@
+#include "spatial.h"
+#include <foundation/memory/memory.h>
+#include <cassert>
+#include <string.h>
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SPATIAL_CULL_AVX
+#define SPATIAL_CULL_SSE
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#include <xmmintrin.h>
+#define SPATIAL_CULL_SSE
+#endif
+
+#define NULL_NODE 0xffffffff
+
+// @NOTE top bit of a query stack entry marks subtrees known to be fully inside the query volume
+#define STACK_FULLY_INSIDE 0x80000000
+// deep enough for any tree the rotations keep balanced, degenerate ones continue on the heap
+#define MAX_QUERY_STACK_SIZE 256
+
+namespace spatial
+{
+    struct Node
+    {
+        AABB        box;                    // fattened for leaves, union of the children otherwise
+        AABB        tightBox;               // leaves only, the bounds last passed in by the caller
+        uint64_t    id = 0;                 // leaves only
+        uint32_t    parent = NULL_NODE;     // next free node while on the free list
+        uint32_t    child1 = NULL_NODE;
+        uint32_t    child2 = NULL_NODE;
+        int32_t     height = -1;            // 0 for leaves, -1 for free nodes
+        uint32_t    syncStamp = 0;
+    };
+
+    // open addressing hash map with linear probing from object id to leaf node
+    struct ProxyMap
+    {
+        uint64_t*   keys = nullptr;         // 0 marks an empty slot
+        uint32_t*   nodes = nullptr;
+        uint32_t    capacity = 0;           // power of two
+        uint32_t    count = 0;
+    };
+
+    struct SpatialIndex
+    {
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+
+        Node*       nodes = nullptr;
+        uint32_t    nodeCapacity = 0;
+        uint32_t    freeList = NULL_NODE;
+        uint32_t    root = NULL_NODE;
+
+        float       fatMargin = 0.0f;
+        uint32_t    syncStamp = 0;
+
+        ProxyMap    proxies;
+    };
+
+    // node stack of a tree traversal, starts out on the stack of the caller and moves to the heap if it runs full
+    struct QueryStack
+    {
+        uint32_t    fixed[MAX_QUERY_STACK_SIZE];
+        uint32_t*   entries = fixed;
+        uint32_t    size = 0;
+        uint32_t    capacity = MAX_QUERY_STACK_SIZE;
+        fnd::memory::MemoryArenaBase* memoryArena = nullptr;
+
+        explicit QueryStack(fnd::memory::MemoryArenaBase* arena) : memoryArena(arena) {}
+        ~QueryStack()
+        {
+            if (entries != fixed) {
+                memoryArena->Free(entries);
+            }
+        }
+
+        void Push(uint32_t entry)
+        {
+            if (size == capacity) {
+                uint32_t* grown = (uint32_t*)memoryArena->Allocate(sizeof(uint32_t) * capacity * 2, alignof(uint32_t), GT_SOURCE_INFO);
+                memcpy(grown, entries, sizeof(uint32_t) * size);
+                if (entries != fixed) {
+                    memoryArena->Free(entries);
+                }
+                entries = grown;
+                capacity *= 2;
+            }
+            entries[size++] = entry;
+        }
+
+        uint32_t Pop() { return entries[--size]; }
+    };
+
+    /* AABB helpers */
+
+    static inline void Union(const AABB* a, const AABB* b, AABB* result)
+    {
+        for (int i = 0; i < 3; ++i) {
+            result->min[i] = a->min[i] < b->min[i] ? a->min[i] : b->min[i];
+            result->max[i] = a->max[i] > b->max[i] ? a->max[i] : b->max[i];
+        }
+    }
+
+    static inline float Perimeter(const AABB* box)
+    {
+        float dx = box->max[0] - box->min[0];
+        float dy = box->max[1] - box->min[1];
+        float dz = box->max[2] - box->min[2];
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+
+    static inline bool Contains(const AABB* outer, const AABB* inner)
+    {
+        for (int i = 0; i < 3; ++i) {
+            if (inner->min[i] < outer->min[i] || inner->max[i] > outer->max[i]) { return false; }
+        }
+        return true;
+    }
+
+    static inline bool Overlaps(const AABB* a, const AABB* b)
+    {
+        for (int i = 0; i < 3; ++i) {
+            if (a->max[i] < b->min[i] || a->min[i] > b->max[i]) { return false; }
+        }
+        return true;
+    }
+
+    static inline void Fatten(const AABB* box, float margin, AABB* result)
+    {
+        for (int i = 0; i < 3; ++i) {
+            result->min[i] = box->min[i] - margin;
+            result->max[i] = box->max[i] + margin;
+        }
+    }
+
+    static inline float SquaredDistanceToPoint(const AABB* box, const float point[3])
+    {
+        float distance = 0.0f;
+        for (int i = 0; i < 3; ++i) {
+            float v = point[i] < box->min[i] ? box->min[i] - point[i] : (point[i] > box->max[i] ? point[i] - box->max[i] : 0.0f);
+            distance += v * v;
+        }
+        return distance;
+    }
+
+    // slab test, returns the entry distance along the ray or -1 if the box is missed within [0, maxT]
+    static inline float IntersectRay(const AABB* box, const float origin[3], const float invDirection[3], float maxT)
+    {
+        float tMin = 0.0f;
+        float tMax = maxT;
+        for (int i = 0; i < 3; ++i) {
+            float t1 = (box->min[i] - origin[i]) * invDirection[i];
+            float t2 = (box->max[i] - origin[i]) * invDirection[i];
+            if (t1 > t2) { float tmp = t1; t1 = t2; t2 = tmp; }
+            tMin = t1 > tMin ? t1 : tMin;
+            tMax = t2 < tMax ? t2 : tMax;
+            if (tMin > tMax) { return -1.0f; }
+        }
+        return tMin;
+    }
+
+    enum FrustumTest { FRUSTUM_OUTSIDE, FRUSTUM_INTERSECTS, FRUSTUM_INSIDE };
+
+    static inline FrustumTest TestFrustum(const Frustum* frustum, const AABB* box)
+    {
+        FrustumTest result = FRUSTUM_INSIDE;
+        for (int i = 0; i < 6; ++i) {
+            const float* plane = frustum->planes[i];
+            float farthest = plane[3];
+            float nearest = plane[3];
+            for (int j = 0; j < 3; ++j) {
+                float a = plane[j] * box->min[j];
+                float b = plane[j] * box->max[j];
+                farthest += a > b ? a : b;
+                nearest += a > b ? b : a;
+            }
+            if (farthest < 0.0f) { return FRUSTUM_OUTSIDE; }
+            if (nearest < 0.0f) { result = FRUSTUM_INTERSECTS; }
+        }
+        return result;
+    }
+
+    /* Proxy map */
+
+    static inline uint32_t HashId(uint64_t id)
+    {
+        id ^= id >> 33;
+        id *= 0xff51afd7ed558ccdull;
+        id ^= id >> 33;
+        return (uint32_t)id;
+    }
+
+    static void InitializeProxyMap(ProxyMap* map, uint32_t capacity, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        map->capacity = capacity;
+        map->count = 0;
+        map->keys = GT_NEW_ARRAY(uint64_t, capacity, memoryArena);
+        map->nodes = GT_NEW_ARRAY(uint32_t, capacity, memoryArena);
+        memset(map->keys, 0x0, sizeof(uint64_t) * capacity);
+    }
+
+    static void FreeProxyMap(ProxyMap* map, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        GT_DELETE_ARRAY(map->keys, memoryArena);
+        GT_DELETE_ARRAY(map->nodes, memoryArena);
+        *map = ProxyMap();
+    }
+
+    static uint32_t FindProxy(ProxyMap* map, uint64_t id)
+    {
+        uint32_t mask = map->capacity - 1;
+        for (uint32_t slot = HashId(id) & mask; map->keys[slot] != 0; slot = (slot + 1) & mask) {
+            if (map->keys[slot] == id) { return map->nodes[slot]; }
+        }
+        return NULL_NODE;
+    }
+
+    static void InsertProxy(ProxyMap* map, uint64_t id, uint32_t node, fnd::memory::MemoryArenaBase* memoryArena)
+    {
+        // keep the load factor at or below one half
+        if ((map->count + 1) * 2 > map->capacity) {
+            ProxyMap old = *map;
+            InitializeProxyMap(map, old.capacity * 2, memoryArena);
+            for (uint32_t i = 0; i < old.capacity; ++i) {
+                if (old.keys[i] != 0) {
+                    InsertProxy(map, old.keys[i], old.nodes[i], memoryArena);
+                }
+            }
+            FreeProxyMap(&old, memoryArena);
+        }
+        uint32_t mask = map->capacity - 1;
+        uint32_t slot = HashId(id) & mask;
+        while (map->keys[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        map->keys[slot] = id;
+        map->nodes[slot] = node;
+        map->count++;
+    }
+
+    static void EraseProxy(ProxyMap* map, uint64_t id)
+    {
+        uint32_t mask = map->capacity - 1;
+        uint32_t slot = HashId(id) & mask;
+        while (map->keys[slot] != id) {
+            if (map->keys[slot] == 0) { return; }
+            slot = (slot + 1) & mask;
+        }
+        // backward shift deletion, moves later entries of the probe run into the hole so no tombstones are needed
+        uint32_t hole = slot;
+        for (uint32_t next = (hole + 1) & mask; map->keys[next] != 0; next = (next + 1) & mask) {
+            uint32_t home = HashId(map->keys[next]) & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                map->keys[hole] = map->keys[next];
+                map->nodes[hole] = map->nodes[next];
+                hole = next;
+            }
+        }
+        map->keys[hole] = 0;
+        map->count--;
+    }
+
+    /* Tree */
+
+    static uint32_t AllocateNode(SpatialIndex* index)
+    {
+        if (index->freeList == NULL_NODE) {
+            uint32_t oldCapacity = index->nodeCapacity;
+            uint32_t newCapacity = oldCapacity * 2;
+            Node* nodes = GT_NEW_ARRAY(Node, newCapacity, index->memoryArena);
+            memcpy(nodes, index->nodes, sizeof(Node) * oldCapacity);
+            GT_DELETE_ARRAY(index->nodes, index->memoryArena);
+            index->nodes = nodes;
+            index->nodeCapacity = newCapacity;
+            for (uint32_t i = oldCapacity; i < newCapacity - 1; ++i) {
+                nodes[i].parent = i + 1;
+            }
+            nodes[newCapacity - 1].parent = NULL_NODE;
+            index->freeList = oldCapacity;
+        }
+        uint32_t nodeIndex = index->freeList;
+        Node* node = &index->nodes[nodeIndex];
+        index->freeList = node->parent;
+        node->parent = node->child1 = node->child2 = NULL_NODE;
+        node->height = 0;
+        node->id = 0;
+        return nodeIndex;
+    }
+
+    static void FreeNode(SpatialIndex* index, uint32_t nodeIndex)
+    {
+        Node* node = &index->nodes[nodeIndex];
+        node->parent = index->freeList;
+        node->height = -1;
+        index->freeList = nodeIndex;
+    }
+
+    static inline int32_t MaxHeight(int32_t a, int32_t b)
+    {
+        return a > b ? a : b;
+    }
+
+    // performs a left or right rotation if node a is imbalanced, returns the new root of the subtree
+    static uint32_t Balance(SpatialIndex* index, uint32_t iA)
+    {
+        Node* nodes = index->nodes;
+        Node* A = &nodes[iA];
+        if (A->height < 2) { return iA; }
+
+        uint32_t iB = A->child1;
+        uint32_t iC = A->child2;
+        Node* B = &nodes[iB];
+        Node* C = &nodes[iC];
+        int32_t balance = C->height - B->height;
+
+        // rotate C up
+        if (balance > 1) {
+            uint32_t iF = C->child1;
+            uint32_t iG = C->child2;
+            Node* F = &nodes[iF];
+            Node* G = &nodes[iG];
+
+            C->child1 = iA;
+            C->parent = A->parent;
+            A->parent = iC;
+            if (C->parent != NULL_NODE) {
+                if (nodes[C->parent].child1 == iA) { nodes[C->parent].child1 = iC; }
+                else { nodes[C->parent].child2 = iC; }
+            }
+            else {
+                index->root = iC;
+            }
+
+            if (F->height > G->height) {
+                C->child2 = iF;
+                A->child2 = iG;
+                G->parent = iA;
+                Union(&B->box, &G->box, &A->box);
+                Union(&A->box, &F->box, &C->box);
+                A->height = 1 + MaxHeight(B->height, G->height);
+                C->height = 1 + MaxHeight(A->height, F->height);
+            }
+            else {
+                C->child2 = iG;
+                A->child2 = iF;
+                F->parent = iA;
+                Union(&B->box, &F->box, &A->box);
+                Union(&A->box, &G->box, &C->box);
+                A->height = 1 + MaxHeight(B->height, F->height);
+                C->height = 1 + MaxHeight(A->height, G->height);
+            }
+            return iC;
+        }
+
+        // rotate B up
+        if (balance < -1) {
+            uint32_t iD = B->child1;
+            uint32_t iE = B->child2;
+            Node* D = &nodes[iD];
+            Node* E = &nodes[iE];
+
+            B->child1 = iA;
+            B->parent = A->parent;
+            A->parent = iB;
+            if (B->parent != NULL_NODE) {
+                if (nodes[B->parent].child1 == iA) { nodes[B->parent].child1 = iB; }
+                else { nodes[B->parent].child2 = iB; }
+            }
+            else {
+                index->root = iB;
+            }
+
+            if (D->height > E->height) {
+                B->child2 = iD;
+                A->child1 = iE;
+                E->parent = iA;
+                Union(&C->box, &E->box, &A->box);
+                Union(&A->box, &D->box, &B->box);
+                A->height = 1 + MaxHeight(C->height, E->height);
+                B->height = 1 + MaxHeight(A->height, D->height);
+            }
+            else {
+                B->child2 = iE;
+                A->child1 = iD;
+                D->parent = iA;
+                Union(&C->box, &D->box, &A->box);
+                Union(&A->box, &E->box, &B->box);
+                A->height = 1 + MaxHeight(C->height, D->height);
+                B->height = 1 + MaxHeight(A->height, E->height);
+            }
+            return iB;
+        }
+        return iA;
+    }
+
+    // refits boxes and heights from nodeIndex up to the root, rebalancing on the way
+    static void Refit(SpatialIndex* index, uint32_t nodeIndex)
+    {
+        while (nodeIndex != NULL_NODE) {
+            nodeIndex = Balance(index, nodeIndex);
+            Node* node = &index->nodes[nodeIndex];
+            Node* child1 = &index->nodes[node->child1];
+            Node* child2 = &index->nodes[node->child2];
+            node->height = 1 + MaxHeight(child1->height, child2->height);
+            Union(&child1->box, &child2->box, &node->box);
+            nodeIndex = node->parent;
+        }
+    }
+
+    static void InsertLeaf(SpatialIndex* index, uint32_t leaf)
+    {
+        if (index->root == NULL_NODE) {
+            index->root = leaf;
+            index->nodes[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        // find the best sibling by descending along the cheapest surface area increase
+        AABB leafBox = index->nodes[leaf].box;
+        uint32_t sibling = index->root;
+        while (index->nodes[sibling].height > 0) {
+            Node* node = &index->nodes[sibling];
+            AABB combined;
+            Union(&node->box, &leafBox, &combined);
+            float area = Perimeter(&node->box);
+            float combinedArea = Perimeter(&combined);
+            float cost = 2.0f * combinedArea;
+            float inheritanceCost = 2.0f * (combinedArea - area);
+
+            float childCosts[2];
+            uint32_t children[2] = { node->child1, node->child2 };
+            for (int i = 0; i < 2; ++i) {
+                Node* child = &index->nodes[children[i]];
+                AABB box;
+                Union(&leafBox, &child->box, &box);
+                childCosts[i] = child->height == 0 ? Perimeter(&box) + inheritanceCost : Perimeter(&box) - Perimeter(&child->box) + inheritanceCost;
+            }
+
+            if (cost < childCosts[0] && cost < childCosts[1]) { break; }
+            sibling = childCosts[0] < childCosts[1] ? children[0] : children[1];
+        }
+
+        uint32_t oldParent = index->nodes[sibling].parent;
+        uint32_t newParent = AllocateNode(index);
+        Node* parentNode = &index->nodes[newParent];
+        parentNode->parent = oldParent;
+        parentNode->height = index->nodes[sibling].height + 1;
+        parentNode->child1 = sibling;
+        parentNode->child2 = leaf;
+        Union(&leafBox, &index->nodes[sibling].box, &parentNode->box);
+        index->nodes[sibling].parent = newParent;
+        index->nodes[leaf].parent = newParent;
+
+        if (oldParent != NULL_NODE) {
+            if (index->nodes[oldParent].child1 == sibling) { index->nodes[oldParent].child1 = newParent; }
+            else { index->nodes[oldParent].child2 = newParent; }
+        }
+        else {
+            index->root = newParent;
+        }
+
+        Refit(index, index->nodes[leaf].parent);
+    }
+
+    static void RemoveLeaf(SpatialIndex* index, uint32_t leaf)
+    {
+        if (leaf == index->root) {
+            index->root = NULL_NODE;
+            return;
+        }
+
+        uint32_t parent = index->nodes[leaf].parent;
+        uint32_t grandParent = index->nodes[parent].parent;
+        uint32_t sibling = index->nodes[parent].child1 == leaf ? index->nodes[parent].child2 : index->nodes[parent].child1;
+
+        if (grandParent != NULL_NODE) {
+            if (index->nodes[grandParent].child1 == parent) { index->nodes[grandParent].child1 = sibling; }
+            else { index->nodes[grandParent].child2 = sibling; }
+            index->nodes[sibling].parent = grandParent;
+            FreeNode(index, parent);
+            Refit(index, grandParent);
+        }
+        else {
+            index->root = sibling;
+            index->nodes[sibling].parent = NULL_NODE;
+            FreeNode(index, parent);
+        }
+    }
+
+    static void UpdateProxy(SpatialIndex* index, uint64_t id, const AABB* bounds)
+    {
+        assert(id != 0);
+        uint32_t leaf = FindProxy(&index->proxies, id);
+        if (leaf == NULL_NODE) {
+            leaf = AllocateNode(index);
+            Node* node = &index->nodes[leaf];
+            node->id = id;
+            node->tightBox = *bounds;
+            node->syncStamp = index->syncStamp;
+            Fatten(bounds, index->fatMargin, &node->box);
+            InsertProxy(&index->proxies, id, leaf, index->memoryArena);
+            InsertLeaf(index, leaf);
+            return;
+        }
+
+        Node* node = &index->nodes[leaf];
+        node->tightBox = *bounds;
+        node->syncStamp = index->syncStamp;
+        if (Contains(&node->box, bounds)) {
+            // still within its fattened bounds, unless those have become much too large for it
+            AABB largeBox;
+            Fatten(bounds, 4.0f * index->fatMargin, &largeBox);
+            if (Contains(&largeBox, &node->box)) { return; }
+        }
+        RemoveLeaf(index, leaf);
+        Fatten(bounds, index->fatMargin, &index->nodes[leaf].box);
+        InsertLeaf(index, leaf);
+    }
+
+    static void RemoveProxy(SpatialIndex* index, uint64_t id)
+    {
+        uint32_t leaf = FindProxy(&index->proxies, id);
+        if (leaf == NULL_NODE) { return; }
+        RemoveLeaf(index, leaf);
+        FreeNode(index, leaf);
+        EraseProxy(&index->proxies, id);
+    }
+
+    /* Public API */
+
+    bool CreateSpatialIndex(SpatialIndex** outIndex, fnd::memory::MemoryArenaBase* memoryArena, SpatialIndexConfig* config)
+    {
+        SpatialIndex* index = GT_NEW(SpatialIndex, memoryArena);
+        index->memoryArena = memoryArena;
+        index->fatMargin = config->fatMargin;
+
+        // leaves plus internal nodes
+        index->nodeCapacity = config->initialCapacity * 2 > 16 ? config->initialCapacity * 2 : 16;
+        index->nodes = GT_NEW_ARRAY(Node, index->nodeCapacity, memoryArena);
+        for (uint32_t i = 0; i < index->nodeCapacity - 1; ++i) {
+            index->nodes[i].parent = i + 1;
+        }
+        index->freeList = 0;
+
+        uint32_t mapCapacity = 16;
+        while (mapCapacity < config->initialCapacity * 2) {
+            mapCapacity *= 2;
+        }
+        InitializeProxyMap(&index->proxies, mapCapacity, memoryArena);
+
+        *outIndex = index;
+        return true;
+    }
+
+    void DestroySpatialIndex(SpatialIndex* index)
+    {
+        FreeProxyMap(&index->proxies, index->memoryArena);
+        GT_DELETE_ARRAY(index->nodes, index->memoryArena);
+        GT_DELETE(index, index->memoryArena);
+    }
+
+    void UpdateProxies(SpatialIndex* index, const uint64_t* ids, const AABB* bounds, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            UpdateProxy(index, ids[i], &bounds[i]);
+        }
+    }
+
+    void RemoveProxies(SpatialIndex* index, const uint64_t* ids, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            RemoveProxy(index, ids[i]);
+        }
+    }
+
+    void SyncProxies(SpatialIndex* index, const uint64_t* ids, const AABB* bounds, size_t count)
+    {
+        index->syncStamp++;
+        UpdateProxies(index, ids, bounds, count);
+
+        // removal only frees nodes, so indices stay stable while we sweep
+        for (uint32_t i = 0; i < index->nodeCapacity; ++i) {
+            Node* node = &index->nodes[i];
+            if (node->height == 0 && node->syncStamp != index->syncStamp) {
+                RemoveProxy(index, node->id);
+            }
+        }
+    }
+
+    size_t GetNumProxies(SpatialIndex* index)
+    {
+        return index->proxies.count;
+    }
+
+    size_t QueryAABB(SpatialIndex* index, const AABB* box, uint64_t* outIds, size_t maxResults)
+    {
+        if (index->root == NULL_NODE) { return 0; }
+        size_t numResults = 0;
+        QueryStack stack(index->memoryArena);
+        stack.Push(index->root);
+        while (stack.size > 0 && numResults < maxResults) {
+            Node* node = &index->nodes[stack.Pop()];
+            if (!Overlaps(&node->box, box)) { continue; }
+            if (node->height == 0) {
+                if (Overlaps(&node->tightBox, box)) {
+                    outIds[numResults++] = node->id;
+                }
+                continue;
+            }
+            stack.Push(node->child1);
+            stack.Push(node->child2);
+        }
+        return numResults;
+    }
+
+    size_t QuerySphere(SpatialIndex* index, const float center[3], float radius, uint64_t* outIds, size_t maxResults)
+    {
+        if (index->root == NULL_NODE) { return 0; }
+        float radiusSquared = radius * radius;
+        size_t numResults = 0;
+        QueryStack stack(index->memoryArena);
+        stack.Push(index->root);
+        while (stack.size > 0 && numResults < maxResults) {
+            Node* node = &index->nodes[stack.Pop()];
+            if (SquaredDistanceToPoint(&node->box, center) > radiusSquared) { continue; }
+            if (node->height == 0) {
+                if (SquaredDistanceToPoint(&node->tightBox, center) <= radiusSquared) {
+                    outIds[numResults++] = node->id;
+                }
+                continue;
+            }
+            stack.Push(node->child1);
+            stack.Push(node->child2);
+        }
+        return numResults;
+    }
+
+    size_t QueryFrustum(SpatialIndex* index, const Frustum* frustum, uint64_t* outIds, size_t maxResults)
+    {
+        if (index->root == NULL_NODE) { return 0; }
+        size_t numResults = 0;
+        QueryStack stack(index->memoryArena);
+        stack.Push(index->root);
+        while (stack.size > 0 && numResults < maxResults) {
+            uint32_t entry = stack.Pop();
+            bool fullyInside = (entry & STACK_FULLY_INSIDE) != 0;
+            Node* node = &index->nodes[entry & ~STACK_FULLY_INSIDE];
+            if (!fullyInside) {
+                FrustumTest test = TestFrustum(frustum, node->height == 0 ? &node->tightBox : &node->box);
+                if (test == FRUSTUM_OUTSIDE) { continue; }
+                fullyInside = test == FRUSTUM_INSIDE;
+            }
+            if (node->height == 0) {
+                outIds[numResults++] = node->id;
+                continue;
+            }
+            // no more plane tests below a subtree that is entirely inside
+            uint32_t flag = fullyInside ? STACK_FULLY_INSIDE : 0;
+            stack.Push(node->child1 | flag);
+            stack.Push(node->child2 | flag);
+        }
+        return numResults;
+    }
+
+    bool Raycast(SpatialIndex* index, const float origin[3], const float direction[3], float maxT, RayHit* outHit)
+    {
+        if (index->root == NULL_NODE) { return false; }
+        float invDirection[3];
+        for (int i = 0; i < 3; ++i) {
+            invDirection[i] = direction[i] != 0.0f ? 1.0f / direction[i] : INFINITY;
+        }
+
+        bool hit = false;
+        float closest = maxT;
+        QueryStack stack(index->memoryArena);
+        stack.Push(index->root);
+        while (stack.size > 0) {
+            Node* node = &index->nodes[stack.Pop()];
+            if (IntersectRay(&node->box, origin, invDirection, closest) < 0.0f) { continue; }
+            if (node->height == 0) {
+                float t = IntersectRay(&node->tightBox, origin, invDirection, closest);
+                if (t >= 0.0f) {
+                    hit = true;
+                    closest = t;
+                    outHit->id = node->id;
+                    outHit->t = t;
+                }
+                continue;
+            }
+            stack.Push(node->child1);
+            stack.Push(node->child2);
+        }
+        return hit;
+    }
+
+    void TransformAABB(const AABB* localBounds, const float* transform, AABB* outBounds)
+    {
+        // transform the center and take the absolute matrix for the extents
+        for (int row = 0; row < 3; ++row) {
+            float center = transform[12 + row];
+            float extent = 0.0f;
+            for (int column = 0; column < 3; ++column) {
+                float m = transform[column * 4 + row];
+                center += m * 0.5f * (localBounds->min[column] + localBounds->max[column]);
+                extent += fabsf(m) * 0.5f * (localBounds->max[column] - localBounds->min[column]);
+            }
+            outBounds->min[row] = center - extent;
+            outBounds->max[row] = center + extent;
+        }
+    }
+
+    void ExtractFrustumPlanes(const float* viewProjection, Frustum* outFrustum)
+    {
+        float rows[4][4];
+        for (int row = 0; row < 4; ++row) {
+            for (int column = 0; column < 4; ++column) {
+                rows[row][column] = viewProjection[column * 4 + row];
+            }
+        }
+        for (int i = 0; i < 4; ++i) {
+            outFrustum->planes[0][i] = rows[3][i] + rows[0][i];    // left
+            outFrustum->planes[1][i] = rows[3][i] - rows[0][i];    // right
+            outFrustum->planes[2][i] = rows[3][i] + rows[1][i];    // bottom
+            outFrustum->planes[3][i] = rows[3][i] - rows[1][i];    // top
+            outFrustum->planes[4][i] = rows[2][i];                 // near
+            outFrustum->planes[5][i] = rows[3][i] - rows[2][i];    // far
+        }
+        for (int i = 0; i < 6; ++i) {
+            float* plane = outFrustum->planes[i];
+            float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > 0.0f) {
+                for (int j = 0; j < 4; ++j) {
+                    plane[j] /= length;
+                }
+            }
+        }
+    }
+
+    size_t CullAABBs(const Frustum* frustum, const AABBArrays* boxes, size_t first, size_t count, uint32_t* outIndices)
+    {
+        // a box is outside as soon as its corner farthest along a plane normal is behind that plane, which corner that is
+        // only depends on the signs of the normal, so it's picked once per plane rather than per box
+        const float* corners[6][3];
+        for (int i = 0; i < 6; ++i) {
+            const float* plane = frustum->planes[i];
+            corners[i][0] = plane[0] >= 0.0f ? boxes->maxX : boxes->minX;
+            corners[i][1] = plane[1] >= 0.0f ? boxes->maxY : boxes->minY;
+            corners[i][2] = plane[2] >= 0.0f ? boxes->maxZ : boxes->minZ;
+        }
+
+        // @NOTE the index is written unconditionally and only kept if the box is visible, so this doesn't branch on the result
+        size_t numVisible = 0;
+        size_t index = first;
+        size_t end = first + count;
+#ifdef SPATIAL_CULL_AVX
+        for (; index + 8 <= end; index += 8) {
+            __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int i = 0; i < 6; ++i) {
+                const float* plane = frustum->planes[i];
+                __m256 distance = _mm256_set1_ps(plane[3]);
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane[0]), _mm256_loadu_ps(corners[i][0] + index)));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane[1]), _mm256_loadu_ps(corners[i][1] + index)));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane[2]), _mm256_loadu_ps(corners[i][2] + index)));
+                visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+            int mask = _mm256_movemask_ps(visible);
+            for (int lane = 0; lane < 8; ++lane) {
+                outIndices[numVisible] = (uint32_t)(index + lane);
+                numVisible += (mask >> lane) & 1;
+            }
+        }
+#endif
+#ifdef SPATIAL_CULL_SSE
+        for (; index + 4 <= end; index += 4) {
+            __m128 visible = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+            for (int i = 0; i < 6; ++i) {
+                const float* plane = frustum->planes[i];
+                __m128 distance = _mm_set1_ps(plane[3]);
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane[0]), _mm_loadu_ps(corners[i][0] + index)));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane[1]), _mm_loadu_ps(corners[i][1] + index)));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane[2]), _mm_loadu_ps(corners[i][2] + index)));
+                visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+            }
+            int mask = _mm_movemask_ps(visible);
+            for (int lane = 0; lane < 4; ++lane) {
+                outIndices[numVisible] = (uint32_t)(index + lane);
+                numVisible += (mask >> lane) & 1;
+            }
+        }
+#endif
+        for (; index < end; ++index) {
+            bool visible = true;
+            for (int i = 0; i < 6; ++i) {
+                const float* plane = frustum->planes[i];
+                float distance = plane[3] + plane[0] * corners[i][0][index] + plane[1] * corners[i][1][index] + plane[2] * corners[i][2][index];
+                visible = visible && distance >= 0.0f;
+            }
+            outIndices[numVisible] = (uint32_t)index;
+            numVisible += visible ? 1 : 0;
+        }
+        return numVisible;
+    }
+}
+
+bool spatial_index_get_interface(spatial::SpatialIndexInterface* interface)
+{
+    interface->CreateSpatialIndex = &spatial::CreateSpatialIndex;
+    interface->DestroySpatialIndex = &spatial::DestroySpatialIndex;
+    interface->UpdateProxies = &spatial::UpdateProxies;
+    interface->RemoveProxies = &spatial::RemoveProxies;
+    interface->SyncProxies = &spatial::SyncProxies;
+    interface->GetNumProxies = &spatial::GetNumProxies;
+    interface->QueryAABB = &spatial::QueryAABB;
+    interface->QuerySphere = &spatial::QuerySphere;
+    interface->QueryFrustum = &spatial::QueryFrustum;
+    interface->Raycast = &spatial::Raycast;
+    interface->TransformAABB = &spatial::TransformAABB;
+    interface->ExtractFrustumPlanes = &spatial::ExtractFrustumPlanes;
+    interface->CullAABBs = &spatial::CullAABBs;
+    return true;
+}
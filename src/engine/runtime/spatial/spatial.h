@@ -0,0 +1,103 @@
+#pragma once
+
+#include <foundation/int_types.h>
+
+namespace fnd { namespace memory { class MemoryArenaBase; } }
+
+#define SPATIAL_INDEX_API_NAME "spatial_index"
+
+namespace spatial
+{
+    struct AABB
+    {
+        float min[3];
+        float max[3];
+    };
+
+    // planes as (nx, ny, nz, d), a point p is inside if dot(n, p) + d >= 0 for all of them
+    struct Frustum
+    {
+        float planes[6][4];
+    };
+
+    // boxes stored as one array per component so that several of them can be tested at once
+    struct AABBArrays
+    {
+        float*  minX = nullptr;
+        float*  minY = nullptr;
+        float*  minZ = nullptr;
+        float*  maxX = nullptr;
+        float*  maxY = nullptr;
+        float*  maxZ = nullptr;
+    };
+
+    struct RayHit
+    {
+        uint64_t    id = 0;
+        float       t = 0.0f;
+    };
+
+    struct SpatialIndex;
+
+    struct SpatialIndexConfig
+    {
+        uint32_t    initialCapacity = 1024;
+        // leaves are stored enlarged by this much on every side, objects moving within it don't touch the tree
+        float       fatMargin = 0.1f;
+    };
+
+    /**
+        Dynamic AABB tree over objects identified by a caller chosen, non zero 64 bit id (e.g. an entity id).
+        Updates are incremental: moving an object only restructures the tree once it leaves its fattened bounds.
+    */
+    bool CreateSpatialIndex(SpatialIndex** outIndex, fnd::memory::MemoryArenaBase* memoryArena, SpatialIndexConfig* config);
+    void DestroySpatialIndex(SpatialIndex* index);
+
+    // inserts objects that are not in the index yet and moves those that are
+    void UpdateProxies(SpatialIndex* index, const uint64_t* ids, const AABB* bounds, size_t count);
+    void RemoveProxies(SpatialIndex* index, const uint64_t* ids, size_t count);
+    // like UpdateProxies, but additionally removes every object that is not part of ids. visits every node of the
+    // index, so it's meant for resyncing everything at once, changes made per frame go through the two above
+    void SyncProxies(SpatialIndex* index, const uint64_t* ids, const AABB* bounds, size_t count);
+    size_t GetNumProxies(SpatialIndex* index);
+
+    // queries write up to maxResults ids and return the number of ids written
+    size_t QueryAABB(SpatialIndex* index, const AABB* box, uint64_t* outIds, size_t maxResults);
+    size_t QuerySphere(SpatialIndex* index, const float center[3], float radius, uint64_t* outIds, size_t maxResults);
+    size_t QueryFrustum(SpatialIndex* index, const Frustum* frustum, uint64_t* outIds, size_t maxResults);
+    // closest object whose bounds are hit by the ray within maxT, direction doesn't need to be normalized
+    bool Raycast(SpatialIndex* index, const float origin[3], const float direction[3], float maxT, RayHit* outHit);
+
+    // bounds of the local space box localBounds after transformation by a column major 4x4 matrix
+    void TransformAABB(const AABB* localBounds, const float* transform, AABB* outBounds);
+    // planes of a column major view projection matrix, assuming a [0, 1] clip space depth range
+    void ExtractFrustumPlanes(const float* viewProjection, Frustum* outFrustum);
+    /**
+        Writes the indices of the boxes in [first, first + count) that are at least partially inside the frustum to
+        outIndices, in increasing order, and returns how many were written. outIndices needs room for count indices.
+        Only reads the given range, so disjoint ranges can be culled on separate threads into separate outputs.
+    */
+    size_t CullAABBs(const Frustum* frustum, const AABBArrays* boxes, size_t first, size_t count, uint32_t* outIndices);
+
+    struct SpatialIndexInterface
+    {
+        decltype(spatial::CreateSpatialIndex)* CreateSpatialIndex = nullptr;
+        decltype(spatial::DestroySpatialIndex)* DestroySpatialIndex = nullptr;
+        decltype(spatial::UpdateProxies)*   UpdateProxies = nullptr;
+        decltype(spatial::RemoveProxies)*   RemoveProxies = nullptr;
+        decltype(spatial::SyncProxies)*     SyncProxies = nullptr;
+        decltype(spatial::GetNumProxies)*   GetNumProxies = nullptr;
+        decltype(spatial::QueryAABB)*       QueryAABB = nullptr;
+        decltype(spatial::QuerySphere)*     QuerySphere = nullptr;
+        decltype(spatial::QueryFrustum)*    QueryFrustum = nullptr;
+        decltype(spatial::Raycast)*         Raycast = nullptr;
+        decltype(spatial::TransformAABB)*   TransformAABB = nullptr;
+        decltype(spatial::ExtractFrustumPlanes)* ExtractFrustumPlanes = nullptr;
+        decltype(spatial::CullAABBs)*       CullAABBs = nullptr;
+    };
+}
+
+extern "C"
+{
+    GT_DLL_EXPORT bool spatial_index_get_interface(spatial::SpatialIndexInterface* interface);
+}
@@ -1,18 +1,22 @@
-cbuffer Object : register(b0) {
-    float4x4    ModelViewProjection;
-    float4x4    ModelView;
+cbuffer View : register(b0) {
     float4x4    ViewProjection;
     float4x4    View;
     float4x4    InverseView;
     float4x4    Projection;
-    float4x4    Model;
-    float4      Color;
     float4      LightDir;
+};
+
+#define MAX_INSTANCES_PER_DRAW 256
+
+cbuffer Object : register(b1) {
+    float4      Color;
 
     float       Metallic;
     float       Roughness;
 
     bool        UseTextures;
+
+    float4x4    Models[MAX_INSTANCES_PER_DRAW];     // only as many as there are instances are valid
 };
 
 
@@ -1,18 +1,22 @@
-cbuffer Object : register(b0) {
-    float4x4    ModelViewProjection;
-    float4x4    ModelView;
+cbuffer View : register(b0) {
     float4x4    ViewProjection;
     float4x4    View;
     float4x4    InverseView;
     float4x4    Projection;
-    float4x4    Model;
-    float4      Color;
     float4      LightDir;
+};
+
+#define MAX_INSTANCES_PER_DRAW 256
+
+cbuffer Object : register(b1) {
+    float4      Color;
 
     float       Metallic;
     float       Roughness;
 
     bool        UseTextures;
+
+    float4x4    Models[MAX_INSTANCES_PER_DRAW];     // only as many as there are instances are valid
 };
 
 struct Vertex
@@ -37,11 +41,12 @@ struct PixelInput
 
 
 
-PixelInput main(Vertex vertex)
+PixelInput main(Vertex vertex, uint instance : SV_InstanceID)
 {
     PixelInput output;
-    output.pos = mul(ModelViewProjection, vertex.pos);
+    float4x4 Model = Models[instance];
     output.worldPos = mul(Model, vertex.pos);
+    output.pos = mul(ViewProjection, output.worldPos);
     output.color = Color;
     output.normal = mul(Model, float4(normalize(vertex.normal.xyz), 0.0f));
     output.uv = vertex.uv;
@@ -32,6 +32,9 @@
 
 #include <engine/runtime/core/api_registry.h>
 #include <engine/runtime/renderer/renderer.h>
+#include <engine/runtime/spatial/spatial.h>
+#include <engine/runtime/recording/recording.h>
+#include <foundation/filesystem/filesystem.h>
 
 int WINDOW_WIDTH = 1920;
 int WINDOW_HEIGHT = 1080;
@@ -555,6 +558,7 @@ void AttachWindow(HWND b, HWND a)
 #define GT_TOOL_SERVER_PORT 8080
 #define GT_MAX_TOOL_CONNECTIONS 32
 
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
 
 #define MOUSE_LEFT 0
 #define MOUSE_RIGHT 1
@@ -687,6 +691,134 @@ namespace runtime
 }
 
 
+// hands the current simulation state to the renderer, renderWorld may be null when running headless
+static void UpdateWorldSnapshot(entity_system::World* world, renderer::RenderWorld* renderWorld, fnd::memory::LinearAllocator* frameAllocator)
+{
+    size_t numEntities = 0;
+    entity_system::GetAllEntities(world, nullptr, &numEntities);
+    entity_system::Entity* entityList = (entity_system::Entity*)frameAllocator->Allocate(sizeof(entity_system::Entity) * numEntities, alignof(entity_system::Entity));
+    entity_system::GetAllEntities(world, entityList, &numEntities);
+
+    renderer::WorldSnapshot worldSnapshot;
+    worldSnapshot.numTransforms = (uint32_t)numEntities;
+    worldSnapshot.transforms = (renderer::Transform*)frameAllocator->Allocate(sizeof(renderer::Transform) * numEntities, alignof(renderer::Transform));
+    for (size_t i = 0; i < numEntities; ++i) {
+        worldSnapshot.transforms[i].entityID = entityList[i].id;
+        util::Copy4x4FloatMatrixCM(entity_system::GetEntityTransform(world, entityList[i]), worldSnapshot.transforms[i].transform);
+    }
+    // @NOTE the render world keeps the spatial index of the renderables, with the bounds of their meshes
+    if (renderWorld != nullptr) {
+        renderer::UpdateWorldState(renderWorld, &worldSnapshot);
+    }
+}
+
+static const char* FindCommandLineValue(int argc, char* argv[], const char* option)
+{
+    for (int i = 1; i < argc - 1; ++i) {
+        if (strcmp(argv[i], option) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return nullptr;
+}
+
+static void GatherStepInput(ImGuiIO& io, double dt, sim_recording::StepInput* outInput)
+{
+    *outInput = sim_recording::StepInput();
+    outInput->dt = dt;
+    outInput->mousePos[0] = io.MousePos.x;
+    outInput->mousePos[1] = io.MousePos.y;
+    outInput->displaySize[0] = io.DisplaySize.x;
+    outInput->displaySize[1] = io.DisplaySize.y;
+    outInput->mouseWheel = io.MouseWheel;
+    for (int i = 0; i < 5; ++i) {
+        outInput->mouseButtons |= io.MouseDown[i] ? (uint8_t)(1 << i) : 0;
+    }
+    outInput->modifiers |= io.KeyCtrl ? (uint8_t)sim_recording::MODIFIER_CTRL : 0;
+    outInput->modifiers |= io.KeyShift ? (uint8_t)sim_recording::MODIFIER_SHIFT : 0;
+    outInput->modifiers |= io.KeyAlt ? (uint8_t)sim_recording::MODIFIER_ALT : 0;
+    outInput->modifiers |= io.KeySuper ? (uint8_t)sim_recording::MODIFIER_SUPER : 0;
+    for (int i = 0; i < 16 && io.InputCharacters[i] != 0; ++i) {
+        outInput->inputChars[i] = io.InputCharacters[i];
+    }
+    for (int i = 0; i < 512; ++i) {
+        outInput->keysDown[i / 8] |= io.KeysDown[i] ? (uint8_t)(1 << (i % 8)) : 0;
+    }
+}
+
+static bool WriteFileContents(const char* path, const void* bytes, size_t numBytes)
+{
+    HANDLE handle = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        GT_LOG_ERROR("FileSystem", "Failed to open %s for writing", path);
+        return false;
+    }
+    DWORD bytesWritten = 0;
+    auto res = WriteFile(handle, bytes, (DWORD)numBytes, &bytesWritten, NULL);
+    CloseHandle(handle);
+    if (res == FALSE || bytesWritten != numBytes) {
+        GT_LOG_ERROR("FileSystem", "Failed to write %s - bytes written: %lu / %lu", path, bytesWritten, (DWORD)numBytes);
+        return false;
+    }
+    return true;
+}
+
+// plays a recorded session back as fast as possible without window or graphics device, timing the steps.
+// @NOTE the changes are applied as recorded, the editor that made them can't run headless to replay the input
+static int RunHeadlessPlayback(const char* path, fnd::memory::MemoryArenaBase* memoryArena)
+{
+    fnd::filesystem::MappedFile file;
+    if (!fnd::filesystem::MapFile(path, &file)) {
+        GT_LOG_ERROR("Recording", "Failed to open recording %s", path);
+        return 1;
+    }
+
+    entity_system::World* world = nullptr;
+    entity_system::WorldConfig worldConfig;
+    entity_system::CreateWorld(&world, memoryArena, &worldConfig);
+
+    sim_recording::Replay* replay = nullptr;
+    if (!sim_recording::OpenReplay(&replay, memoryArena, file.data, file.size, world)) {
+        fnd::filesystem::UnmapFile(&file);
+        return 1;
+    }
+
+    static const size_t frameAllocatorSize = MEGABYTES(256);
+    fnd::memory::LinearAllocator frameAllocator(memoryArena->Allocate(frameAllocatorSize, 16, GT_SOURCE_INFO), frameAllocatorSize);
+
+    GT_LOG_INFO("Recording", "Playing back %llu steps from %s", (unsigned long long)sim_recording::GetNumReplaySteps(replay), path);
+    StartCounter();
+    double replayTime = 0.0;
+    double snapshotTime = 0.0;
+    double simulatedTime = 0.0;
+    uint64_t numSteps = 0;
+    sim_recording::StepInput input;
+    do {
+        double stepStart = GetCounter();
+        if (!sim_recording::BeginReplayStep(replay, &input) || !sim_recording::ApplyReplayStep(replay)) { break; }
+        double snapshotStart = GetCounter();
+        UpdateWorldSnapshot(world, nullptr, &frameAllocator);
+        frameAllocator.Reset();
+        double stepEnd = GetCounter();
+
+        replayTime += snapshotStart - stepStart;
+        snapshotTime += stepEnd - snapshotStart;
+        simulatedTime += input.dt;
+        numSteps++;
+    } while (true);
+
+    double stepsDivisor = numSteps > 0 ? (double)numSteps : 1.0;
+    GT_LOG_INFO("Recording", "Played back %llu of %llu steps, %.2f s of simulation", (unsigned long long)numSteps, (unsigned long long)sim_recording::GetNumReplaySteps(replay), simulatedTime);
+    GT_LOG_INFO("Recording", "Applying changes took %f ms (%f ms per step)", 1000.0 * replayTime, 1000.0 * replayTime / stepsDivisor);
+    GT_LOG_INFO("Recording", "Snapshots took %f ms (%f ms per step)", 1000.0 * snapshotTime, 1000.0 * snapshotTime / stepsDivisor);
+
+    bool completed = numSteps == sim_recording::GetNumReplaySteps(replay);
+    sim_recording::CloseReplay(replay);
+    entity_system::DestroyWorld(world);
+    fnd::filesystem::UnmapFile(&file);
+    return completed ? 0 : 1;
+}
+
 GT_RUNTIME_API
 int win32_main(int argc, char* argv[])
 {
@@ -731,6 +863,12 @@ int win32_main(int argc, char* argv[])
 #endif
 
     GT_LOG_INFO("Application", "Initialized memory systems");
+
+    // --playback <file> plays a recorded session back headless and exits
+    const char* playbackPath = FindCommandLineValue(argc, argv, "--playback");
+    if (playbackPath != nullptr) {
+        return RunHeadlessPlayback(playbackPath, &applicationArena);
+    }
     
    /*
     const size_t NUM_WORKER_THREADS = 4;
@@ -869,8 +1007,19 @@ int win32_main(int argc, char* argv[])
         GT_LOG_ERROR("Renderer", "Failed to create a renderer");
     }
 
+    // pipeline states of earlier runs whose shaders exist by now are created up front instead of on first use
+    if (fnd::filesystem::Path(PIPELINE_CACHE_PATH).IsFile()) {
+        fnd::filesystem::MappedFile pipelineCacheFile;
+        if (fnd::filesystem::MapFile(PIPELINE_CACHE_PATH, &pipelineCacheFile)) {
+            uint32_t numWarmed = gfx::WarmPipelineCache(gfxDevice, pipelineCacheFile.data, pipelineCacheFile.size);
+            GT_LOG_INFO("Renderer", "Created %u pipeline states from %s", numWarmed, PIPELINE_CACHE_PATH);
+            fnd::filesystem::UnmapFile(&pipelineCacheFile);
+        }
+    }
+
     renderer::RenderWorldConfig renderWorldConfig;
     renderWorldConfig.renderer = renderer;
+    renderWorldConfig.textureStreamingBudget = 256 * 1024 * 1024;
     if (!renderer::CreateRenderWorld(&renderWorld, &applicationArena, &renderWorldConfig)) {
         GT_LOG_ERROR("Renderer", "Failed to create render world");
     }
@@ -934,6 +1083,15 @@ int win32_main(int argc, char* argv[])
 
     entity_system::Entity* entityList = GT_NEW_ARRAY(entity_system::Entity, worldConfig.maxNumEntities, &applicationArena);
 
+    // --record <file> captures the session for playing it back with --playback
+    sim_recording::Recorder* recorder = nullptr;
+    sim_recording::RecordingConfig recordingConfig;
+    recordingConfig.path = FindCommandLineValue(argc, argv, "--record");
+    const char* recordPath = recordingConfig.path;
+    if (recordPath != nullptr && !sim_recording::BeginRecording(&recorder, &applicationArena, mainWorld, &recordingConfig)) {
+        GT_LOG_ERROR("Recording", "Failed to start recording to %s", recordPath);
+    }
+
     core::api_registry::APIRegistry* apiRegistry = nullptr;
     core::api_registry::APIRegistryInterface apiRegistryInterface;
 
@@ -952,10 +1110,18 @@ int win32_main(int argc, char* argv[])
     runtime::RuntimeInterface runtimeInterface;
     runtime_get_interface(&runtimeInterface);
 
+    spatial::SpatialIndexInterface spatialIndexInterface;
+    spatial_index_get_interface(&spatialIndexInterface);
+
+    sim_recording::SimRecordingInterface simRecordingInterface;
+    sim_recording_get_interface(&simRecordingInterface);
+
     core::api_registry::Add(apiRegistry, ENTITY_SYSTEM_API_NAME, &entitySystem);
     core::api_registry::Add(apiRegistry, RENDERER_API_NAME, &rendererInterface);
     core::api_registry::Add(apiRegistry, FBX_IMPORTER_API_NAME, &fbxImporterInterface);
     core::api_registry::Add(apiRegistry, RUNTIME_API_NAME, &runtimeInterface);
+    core::api_registry::Add(apiRegistry, SPATIAL_INDEX_API_NAME, &spatialIndexInterface);
+    core::api_registry::Add(apiRegistry, SIM_RECORDING_API_NAME, &simRecordingInterface);
 
     void(*UpdateModule)(void*, ImGuiContext*, runtime::UIContext*, entity_system::World*, renderer::RenderWorld*, fnd::memory::LinearAllocator*, entity_system::Entity**, size_t*);
     void*(*InitializeModule)(memory::MemoryArenaBase*, core::api_registry::APIRegistry* apiRegistry, core::api_registry::APIRegistryInterface* apiInterface);
@@ -1090,6 +1256,11 @@ int win32_main(int argc, char* argv[])
 
             entity_system::GetAllEntities(mainWorld, entityList, &numEntities);
 
+            if (recorder != nullptr) {
+                sim_recording::StepInput stepInput;
+                GatherStepInput(ImGui::GetIO(), dt, &stepInput);
+                sim_recording::RecordStep(recorder, &stepInput);
+            }
             
 #ifdef GT_DEVELOPMENT
             if (ImGui::Begin(ICON_FA_FLOPPY_O "  Memory usage", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
@@ -1116,11 +1287,19 @@ int win32_main(int argc, char* argv[])
             math::float3 mousePosScreen(ImGui::GetIO().MousePos.x, ImGui::GetIO().MousePos.y, 15.0f);
 
             /* Basic UI: frame statistics */
-            ImGui::SetNextWindowPos(ImVec2(10.0f, ImGui::GetIO().DisplaySize.y - 50));
+            renderer::RenderStats renderStats;
+            renderer::GetRenderStats(renderWorld, &renderStats);
+            ImGui::SetNextWindowPos(ImVec2(10.0f, ImGui::GetIO().DisplaySize.y - 100));
             ImGui::Begin("#framestatistics", (bool*)0, ImVec2(0, 0), 0.45f, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar);
             ImGui::Text("Window dimensions = %ix%i", WINDOW_WIDTH, WINDOW_HEIGHT);
             ImGui::Text("Mouse Screen Pos: %f, %f", mousePosScreen.x, mousePosScreen.y);
             ImGui::Text("Simulation time average: %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+            ImGui::Text("Submeshes: %u drawn in %u draw calls, %u culled in %.3f ms", renderStats.numInstances, renderStats.numDrawCalls, renderStats.numSubmeshesCulled, renderStats.cullingTime);
+            ImGui::Text("Renderables: %u, %u culled by the spatial index", renderStats.numRenderables, renderStats.numRenderablesCulled);
+            ImGui::Text("State changes: %u pipeline, %u material", renderStats.numPipelineChanges, renderStats.numMaterialChanges);
+            ImGui::Text("Render passes: %u, %u culled, %llu kb in render targets", renderStats.numRenderPasses, renderStats.numRenderPassesCulled, (unsigned long long)(renderStats.renderTargetBytes / 1024));
+            ImGui::Text("Streamed textures: %llu kb, %u uploads, %u evictions", (unsigned long long)(renderStats.streamedTextureBytes / 1024), renderStats.numTextureUploads, renderStats.numTextureEvictions);
+            ImGui::Text("Uploads: %u, %llu kb", renderStats.numUploads, (unsigned long long)(renderStats.uploadedBytes / 1024));
             ImGui::End();
 
             /*static float angle = 0.0f;
@@ -1141,18 +1320,7 @@ int win32_main(int argc, char* argv[])
             accumulator -= dt;
         }
         if (didUpdate) {
-                
-            renderer::WorldSnapshot worldSnapshot;
-            
-            entity_system::GetAllEntities(mainWorld, entityList, &numEntities);
-            worldSnapshot.numTransforms = (uint32_t)numEntities;
-            worldSnapshot.transforms = (renderer::Transform*)frameAllocator.Allocate(sizeof(renderer::Transform) * numEntities, alignof(renderer::Transform));
-            for (size_t i = 0; i < numEntities; ++i) {
-                worldSnapshot.transforms[i].entityID = entityList[i].id;
-                util::Copy4x4FloatMatrixCM(entity_system::GetEntityTransform(mainWorld, entityList[i]), worldSnapshot.transforms[i].transform);
-            }
-            renderer::UpdateWorldState(renderWorld, &worldSnapshot);
-
+            UpdateWorldSnapshot(mainWorld, renderWorld, &frameAllocator);
             frameAllocator.Reset();
         }
 
@@ -1184,6 +1352,23 @@ int win32_main(int argc, char* argv[])
         GT_LOG_INFO("RenderProfile", "Render frame took %f ms", 1000.0 * (GetCounter() - renderFrameTimerStart));
     } while (!exitFlag);
 
+    {
+        size_t pipelineCacheSize = gfx::SavePipelineCache(gfxDevice, nullptr, 0);
+        void* pipelineCache = applicationArena.Allocate(pipelineCacheSize, 16, GT_SOURCE_INFO);
+        gfx::SavePipelineCache(gfxDevice, pipelineCache, pipelineCacheSize);
+        if (WriteFileContents(PIPELINE_CACHE_PATH, pipelineCache, pipelineCacheSize)) {
+            GT_LOG_INFO("Renderer", "Wrote %llu bytes to %s", (unsigned long long)pipelineCacheSize, PIPELINE_CACHE_PATH);
+        }
+        applicationArena.Free(pipelineCache);
+    }
+
+    if (recorder != nullptr) {
+        uint64_t recordingSize = sim_recording::GetRecordingSize(recorder);
+        if (sim_recording::EndRecording(recorder)) {
+            GT_LOG_INFO("Recording", "Wrote %llu bytes to %s", (unsigned long long)recordingSize, recordPath);
+        }
+    }
+
     ImGui_ImplDX11_Shutdown();
 
     fnd::sockets::ShutdownSocketLayer();
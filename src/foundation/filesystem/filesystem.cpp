@@ -11,14 +11,20 @@
 #undef near
 #undef far
 #undef interface
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include <cassert>
+#include <string.h>
 
 #ifdef _MSC_VER
 #define PATH_SEPARATOR '\\'
 #else
-#define PATH_SEPARATOR '\/'
+#define PATH_SEPARATOR '/'
 #endif
 
 namespace fnd
@@ -108,5 +114,63 @@ namespace fnd
             FileInfo fileInfo;
             return IsFile(&fileInfo);
         }
+
+        /* MappedFile implementation */
+
+        bool MapFile(const char* path, MappedFile* outFile)
+        {
+#ifdef _MSC_VER
+            HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE) { return false; }
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+                CloseHandle(file);
+                return false;
+            }
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+            if (mapping == NULL) {
+                CloseHandle(file);
+                return false;
+            }
+            void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            if (view == nullptr) {
+                CloseHandle(mapping);
+                CloseHandle(file);
+                return false;
+            }
+            outFile->data = view;
+            outFile->size = (size_t)fileSize.QuadPart;
+            outFile->_fileHandle = file;
+            outFile->_mappingHandle = mapping;
+            return true;
+#else
+            int file = open(path, O_RDONLY);
+            if (file < 0) { return false; }
+            struct stat fileStat;
+            if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+                close(file);
+                return false;
+            }
+            void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+            close(file);
+            if (view == MAP_FAILED) { return false; }
+            outFile->data = view;
+            outFile->size = (size_t)fileStat.st_size;
+            return true;
+#endif
+        }
+
+        void UnmapFile(MappedFile* file)
+        {
+            if (file->data == nullptr) { return; }
+#ifdef _MSC_VER
+            UnmapViewOfFile(file->data);
+            CloseHandle((HANDLE)file->_mappingHandle);
+            CloseHandle((HANDLE)file->_fileHandle);
+#else
+            munmap(file->data, file->size);
+#endif
+            *file = MappedFile();
+        }
     }
 }
\ No newline at end of file
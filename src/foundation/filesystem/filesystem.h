@@ -40,5 +40,17 @@ namespace fnd
             Path        path;
             FileTime    lastModifiedTime = 0;
         };
+
+        struct MappedFile
+        {
+            void*   data = nullptr;
+            size_t  size = 0;
+            void*   _fileHandle = nullptr;
+            void*   _mappingHandle = nullptr;
+        };
+
+        /* Maps a whole file copy-on-write: the view is writable, but writes stay private to the process and never reach the file */
+        bool    MapFile(const char* path, MappedFile* outFile);
+        void    UnmapFile(MappedFile* file);
     }
 }
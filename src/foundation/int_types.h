@@ -1,9 +1,16 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define GT_SOURCE_INFO {__LINE__, __FILE__}
 
+#ifdef _MSC_VER
+#define GT_DLL_EXPORT __declspec(dllexport)
+#else
+#define GT_DLL_EXPORT
+#endif
+
 namespace fnd
 {
     struct SourceInfo
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../int_types.h"
+#include <stdarg.h>
 
 
 namespace fnd
@@ -90,17 +91,17 @@ namespace fnd
 }
 
 
-#define GT_LOG_INFO(channelAsString, format, ...) \
-fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_INFO, 0, GT_SOURCE_INFO, format, __VA_ARGS__)
+#define GT_LOG_INFO(channelAsString, ...) \
+fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_INFO, 0, GT_SOURCE_INFO, __VA_ARGS__)
 
-#define GT_LOG_DEBUG(channelAsString, format, ...) \
-fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_DEBUG, 0, GT_SOURCE_INFO, format, __VA_ARGS__)
+#define GT_LOG_DEBUG(channelAsString, ...) \
+fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_DEBUG, 0, GT_SOURCE_INFO, __VA_ARGS__)
 
-#define GT_LOG_WARNING(channelAsString, format, ...) \
-fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_WARNING, 0, GT_SOURCE_INFO, format, __VA_ARGS__)
+#define GT_LOG_WARNING(channelAsString, ...) \
+fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_WARNING, 0, GT_SOURCE_INFO, __VA_ARGS__)
 
-#define GT_LOG_ERROR(channelAsString, format, ...) \
-fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_ERROR, 0, GT_SOURCE_INFO, format, __VA_ARGS__)
+#define GT_LOG_ERROR(channelAsString, ...) \
+fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_ERROR, 0, GT_SOURCE_INFO, __VA_ARGS__)
 
-#define GT_LOG_FATAL(channelAsString, format, ...) \
-fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_FATAL, 0, GT_SOURCE_INFO, format, __VA_ARGS__)
+#define GT_LOG_FATAL(channelAsString, ...) \
+fnd::logging::LoggerBase::LogDispatch(channelAsString, fnd::logging::LogLevel::LOG_LEVEL_FATAL, 0, GT_SOURCE_INFO, __VA_ARGS__)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string.h>
+
 #define GT_COMMON_VECTOR_OP(TElement, ELEMENT_COUNT) \
 Vector() { memset(elements, 0x0, sizeof(TElement) * ELEMENT_COUNT); } \
 explicit Vector(TElement v) { for(size_t i = 0; i < ELEMENT_COUNT; ++i) { elements[i] = v; } } \
@@ -88,7 +90,7 @@ namespace fnd
 
             GT_COMMON_VECTOR_OP(TElement, 3)
 
-            Vector(Vector<TElement, 2> ab, TElement c) : xy(ab), z(c) {}
+            Vector(Vector<TElement, 2> ab, TElement c) : x(ab.x), y(ab.y), z(c) {}
             Vector(TElement a, TElement b, TElement c) : x(a), y(b), z(c) {}
         };
 
@@ -106,7 +108,7 @@ namespace fnd
             };
             GT_COMMON_VECTOR_OP(TElement, 4)
 
-            Vector(Vector<TElement, 3> abc, TElement d) : xyz(abc), w(d) {}
+            Vector(Vector<TElement, 3> abc, TElement d) : x(abc.x), y(abc.y), z(abc.z), w(d) {}
             Vector(TElement a, TElement b, TElement c, TElement d) : x(a), y(b), z(c), w(d) {}
         };
 
@@ -177,7 +179,7 @@ namespace fnd
 
         
         template <class TElement, size_t ELEMENT_COUNT>   // @TODO static_assert is ugly solution, really needs concepts or whatever
-        TElement Dot(const Vector<TElement, ELEMENT_COUNT>& a, const Vector<TElement, ELEMENT_COUNT>& b) { static_assert(false, "Only float and double supported as element types") }
+        TElement Dot(const Vector<TElement, ELEMENT_COUNT>& a, const Vector<TElement, ELEMENT_COUNT>& b) { static_assert(sizeof(TElement) == 0, "Only float and double supported as element types"); }
 
 
         template <size_t ELEMENT_COUNT>
@@ -112,13 +112,14 @@ namespace fnd
         template <class TAllocator, class TTrackingPolicy>
         class SimpleTrackingArena : public MemoryArena<TAllocator, EmptyThreadPolicy, EmptyBoundsCheckingPolicy, TTrackingPolicy, EmptyMemoryTaggingPolicy>
         {
+            typedef MemoryArena<TAllocator, EmptyThreadPolicy, EmptyBoundsCheckingPolicy, TTrackingPolicy, EmptyMemoryTaggingPolicy> BaseArena;
         public:
-            SimpleTrackingArena(typename MemoryArena::Allocator* allocator) : MemoryArena(allocator) {}
+            SimpleTrackingArena(typename BaseArena::Allocator* allocator) : BaseArena(allocator) {}
             virtual ~SimpleTrackingArena() = default;
 
             inline TTrackingPolicy* GetTrackingPolicy()
             {
-                return &m_memTracker;
+                return &this->m_memTracker;
             }
             
         };
@@ -297,10 +298,10 @@ namespace fnd {
 GT_PLACEMENT_NEW (arenaAsPtr->Allocate(sizeof(Type), alignof(Type), GT_SOURCE_INFO)) Type
 
 #define GT_NEW_ARRAY(ArrayType, count, arenaAsPtr) \
-fnd::internal::NewArray<ArrayType, fnd::internal::RemovePointer<decltype(arenaAsPtr)>::Type>(count, arenaAsPtr, GT_SOURCE_INFO)
+fnd::internal::NewArray<ArrayType, typename fnd::internal::RemovePointer<decltype(arenaAsPtr)>::Type>(count, arenaAsPtr, GT_SOURCE_INFO)
 
 #define GT_NEW_ARRAY_WITH_INITIALIZER(ArrayType, count, arenaAsPtr, initializerFunc) \
-fnd::internal::NewArrayWithInitializer<ArrayType, fnd::internal::RemovePointer<decltype(arenaAsPtr)>::Type>(count, arenaAsPtr, initializerFunc, GT_SOURCE_INFO)
+fnd::internal::NewArrayWithInitializer<ArrayType, typename fnd::internal::RemovePointer<decltype(arenaAsPtr)>::Type>(count, arenaAsPtr, initializerFunc, GT_SOURCE_INFO)
 
 #define GT_DELETE(objectAsPtr, arenaAsPtr) \
 fnd::internal::Delete(objectAsPtr, arenaAsPtr)
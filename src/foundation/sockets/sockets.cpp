@@ -3,10 +3,13 @@
 #ifdef _MSC_VER
 #include <WinSock2.h>
 #pragma comment(lib, "wsock32.lib")
+typedef int socklen_t;
 #else
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 #include <fcntl.h>
+#include <unistd.h>
 #endif
 
 //
@@ -71,7 +74,7 @@ namespace fnd
         }
         
 #ifndef _MSC_VER
-#define INVALID_SOCKET -1
+#define INVALID_SOCKET ((SocketHandle)-1)
 #endif
 
         UDPSocket::UDPSocket()
@@ -103,9 +106,8 @@ namespace fnd
 
 #ifndef _MSC_VER
 
-            int nonBlocking = 1;
-            if (fcntl(handle, F_SETFL, O_NONBLOCK, nonBlocking) == -1) {
-                Close()
+            if (fcntl(m_handle, F_SETFL, O_NONBLOCK) == -1) {
+                Close();
                 return false;
             }
 
@@ -147,8 +149,8 @@ namespace fnd
             if (m_handle == INVALID_SOCKET) { return false; }
             
             int error;
-            size_t errorSize = sizeof(error);
-            if (getsockopt(m_handle, SOL_SOCKET, SO_ERROR, (char*)&error, reinterpret_cast<int*>(&errorSize)) < 0) {
+            socklen_t errorSize = sizeof(error);
+            if (getsockopt(m_handle, SOL_SOCKET, SO_ERROR, (char*)&error, &errorSize) < 0) {
                 return false;
             }
             if (error == 0)
@@ -174,9 +176,6 @@ namespace fnd
 
         size_t UDPSocket::Receive(Address* address, void* buffer, size_t bufferSize)
         {
-#ifdef _MSC_VER
-            typedef int socklen_t;
-#endif
             sockaddr_in from;
             socklen_t fromLength = sizeof(from);
 
@@ -218,10 +217,9 @@ namespace fnd
 
 #ifndef _MSC_VER
 
-            int nonBlocking = 1;
-            if (fcntl(handle, F_SETFL, O_NONBLOCK, nonBlocking) == -1) {
-                Close()
-                    return false;
+            if (fcntl(m_handle, F_SETFL, O_NONBLOCK) == -1) {
+                StopListen();
+                return false;
             }
 
 #else
@@ -264,8 +262,8 @@ namespace fnd
             if (m_handle == INVALID_SOCKET) { return false; }
 
             int error;
-            size_t errorSize = sizeof(error);
-            if (getsockopt(m_handle, SOL_SOCKET, SO_ACCEPTCONN, (char*)&error, reinterpret_cast<int*>(&errorSize)) < 0) {
+            socklen_t errorSize = sizeof(error);
+            if (getsockopt(m_handle, SOL_SOCKET, SO_ACCEPTCONN, (char*)&error, &errorSize) < 0) {
                 return false;
             }
             if (error)
@@ -278,8 +276,8 @@ namespace fnd
         bool TCPListenSocket::HasConnection(Address* address, TCPConnectionSocket* socket)
         {
             sockaddr_in addr;
-            size_t addrlen = sizeof(addr);
-            SOCKET sock = accept(m_handle, (sockaddr*)(&addr), (int*)&addrlen);
+            socklen_t addrlen = sizeof(addr);
+            SocketHandle sock = accept(m_handle, (sockaddr*)(&addr), &addrlen);
             if (sock == INVALID_SOCKET) {
                 return false;
             }
@@ -309,10 +307,9 @@ namespace fnd
 
 #ifndef _MSC_VER
 
-            int nonBlocking = 1;
-            if (fcntl(handle, F_SETFL, O_NONBLOCK, nonBlocking) == -1) {
-                Close()
-                    return false;
+            if (fcntl(m_handle, F_SETFL, O_NONBLOCK) == -1) {
+                Close();
+                return false;
             }
 
 #else
@@ -334,16 +331,15 @@ namespace fnd
 
             // get the address
             sockaddr_in addr;
-            size_t addrlen = sizeof(addr);
-            getpeername(m_handle, (sockaddr*)&addr, (int*)&addrlen);
+            socklen_t addrlen = sizeof(addr);
+            getpeername(m_handle, (sockaddr*)&addr, &addrlen);
             m_remoteAddress = Address(ntohl(addr.sin_addr.s_addr), ntohs(addr.sin_port));
 
 #ifndef _MSC_VER
 
-            int nonBlocking = 1;
-            if (fcntl(handle, F_SETFL, O_NONBLOCK, nonBlocking) == -1) {
-                Close()
-                    return false;
+            if (fcntl(m_handle, F_SETFL, O_NONBLOCK) == -1) {
+                Close();
+                return false;
             }
 
 #else
@@ -377,16 +373,18 @@ namespace fnd
             return IsConnected(&addr);
         }
 #include <stdio.h>
+#ifdef _MSC_VER
 #pragma warning(disable: 4996)
+#endif
         bool TCPConnectionSocket::IsConnected(Address* address)
         {
             *address = m_remoteAddress;
             if (m_handle == INVALID_SOCKET) { return false; }
 
             int error;
-            size_t errorSize = sizeof(error);
+            socklen_t errorSize = sizeof(error);
             int res = 0;
-            if ((res = getsockopt(m_handle, SOL_SOCKET, SO_ERROR, (char*)&error, reinterpret_cast<int*>(&errorSize))) < 0) {
+            if ((res = getsockopt(m_handle, SOL_SOCKET, SO_ERROR, (char*)&error, &errorSize)) < 0) {
                 return false;
             }
             if (error == 0)
@@ -412,9 +410,6 @@ namespace fnd
 
         size_t TCPConnectionSocket::Receive(void* buffer, size_t bufferSize)
         {
-#ifdef _MSC_VER
-            typedef int socklen_t;
-#endif
             sockaddr_in from;
             socklen_t fromLength = sizeof(from);
 